@@ -199,6 +199,60 @@ SEXP mb, labels, try, temp, node_data;
 
 }/*FITTED_MB*/
 
+/* list the local distributions in the Markov blanket of each node, that is, its
+ * own and those of its children. They are stored in compressed form: those of
+ * the i-th node are factors[start[i]], ..., factors[start[i + 1] - 1], and the
+ * node is the position-th variable in each of them (0 for the node itself, j
+ * for its j-th parent). */
+void c_fitted_mb_factors(fitted_bn bn, int **start, int **factors,
+    int **position) {
+
+int i = 0, j = 0, par = 0, n = bn.nnodes, *count = NULL;
+
+  *start = Calloc1D(n + 1, sizeof(int));
+
+  /* first pass: count the children of each node. */
+  for (i = 0; i < n; i++) {
+
+    (*start)[i + 1]++;
+    for (j = 0; j < bn.ldists[i].nparents; j++)
+      (*start)[bn.ldists[i].parents[j] + 1]++;
+
+  }/*FOR*/
+
+  for (i = 0; i < n; i++)
+    (*start)[i + 1] += (*start)[i];
+
+  *factors = Calloc1D((*start)[n], sizeof(int));
+  *position = Calloc1D((*start)[n], sizeof(int));
+  count = Calloc1D(n, sizeof(int));
+  memcpy(count, *start, n * sizeof(int));
+
+  /* second pass: the local distribution of the node itself comes first, then
+   * those of the children in the order they are stored in. */
+  for (i = 0; i < n; i++) {
+
+    (*factors)[count[i]] = i;
+    (*position)[count[i]++] = 0;
+
+  }/*FOR*/
+
+  for (i = 0; i < n; i++) {
+
+    for (j = 0; j < bn.ldists[i].nparents; j++) {
+
+      par = bn.ldists[i].parents[j];
+      (*factors)[count[par]] = i;
+      (*position)[count[par]++] = j + 1;
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  Free1D(count);
+
+}/*C_FITTED_MB_FACTORS*/
+
 /* return the size of the arc set. */
 SEXP num_arcs(SEXP bn) {
 
@@ -0,0 +1,84 @@
+#include "../include/rcore.h"
+#include "allocations.h"
+#include "bitmaps.h"
+
+/* allocate a bitmap for the given number of observations, with all the bits
+ * cleared. */
+uint64_t *new_bitmap(int nobs) {
+
+  return Calloc1D(BITMAP_NWORDS(nobs), sizeof(uint64_t));
+
+}/*NEW_BITMAP*/
+
+/* set the bits corresponding to the observations that are not missing. */
+void c_validity_bitmap(double *x, int nobs, uint64_t *bits) {
+
+int i = 0, w = 0, n = 0;
+uint64_t word = 0;
+
+  for (w = 0; w < BITMAP_NWORDS(nobs); w++) {
+
+    n = (nobs - w * BITMAP_WORD < BITMAP_WORD) ? nobs - w * BITMAP_WORD :
+                                                 BITMAP_WORD;
+
+    for (i = 0, word = 0; i < n; i++)
+      word |= (uint64_t)(!ISNAN(x[w * BITMAP_WORD + i])) << i;
+
+    bits[w] = word;
+
+  }/*FOR*/
+
+}/*C_VALIDITY_BITMAP*/
+
+/* set all the bits corresponding to an observation, leaving the padding in the
+ * last word cleared. */
+void bitmap_fill(uint64_t *bits, int nobs) {
+
+int nwords = BITMAP_NWORDS(nobs), tail = nobs % BITMAP_WORD;
+
+  if (nwords == 0)
+    return;
+
+  memset(bits, 0xff, nwords * sizeof(uint64_t));
+  if (tail > 0)
+    bits[nwords - 1] = ((uint64_t)1 << tail) - 1;
+
+}/*BITMAP_FILL*/
+
+/* count the bits that are set. */
+int bitmap_count(uint64_t *bits, int nwords) {
+
+int w = 0, count = 0;
+
+  for (w = 0; w < nwords; w++)
+    count += __builtin_popcountll(bits[w]);
+
+  return count;
+
+}/*BITMAP_COUNT*/
+
+/* intersect two bitmaps (which can alias the result) and count the bits that
+ * are set in the intersection. */
+int bitmap_and(uint64_t *a, uint64_t *b, uint64_t *result, int nwords) {
+
+int w = 0, count = 0;
+
+  for (w = 0; w < nwords; w++) {
+
+    result[w] = a[w] & b[w];
+    count += __builtin_popcountll(result[w]);
+
+  }/*FOR*/
+
+  return count;
+
+}/*BITMAP_AND*/
+
+/* expand a bitmap into missingness indicators, for the functions that still
+ * expect them. */
+void bitmap_to_missing(uint64_t *bits, int nobs, bool *missing) {
+
+  for (int i = 0; i < nobs; i++)
+    missing[i] = !((bits[i / BITMAP_WORD] >> (i % BITMAP_WORD)) & 1);
+
+}/*BITMAP_TO_MISSING*/
@@ -0,0 +1,26 @@
+#ifndef BITMAPS_HEADER
+#define BITMAPS_HEADER
+
+#include <stdint.h>
+
+/* number of observations stored in each word of a bitmap. */
+#define BITMAP_WORD 64
+/* number of words needed to store a bitmap for n observations. */
+#define BITMAP_NWORDS(n) (((n) + BITMAP_WORD - 1) / BITMAP_WORD)
+
+/* iterate over the positions of the bits that are set in a bitmap: "k" is the
+ * position, "w" and "bits" are the scratch variables for the current word. */
+#define FOR_EACH_BIT(mask, nwords, w, bits, k) \
+  for (w = 0; w < (nwords); w++) \
+    for (bits = (mask)[w]; \
+         bits && ((k = w * BITMAP_WORD + __builtin_ctzll(bits)), TRUE); \
+         bits &= bits - 1)
+
+uint64_t *new_bitmap(int nobs);
+void c_validity_bitmap(double *x, int nobs, uint64_t *bits);
+void bitmap_fill(uint64_t *bits, int nobs);
+int bitmap_count(uint64_t *bits, int nwords);
+int bitmap_and(uint64_t *a, uint64_t *b, uint64_t *result, int nwords);
+void bitmap_to_missing(uint64_t *bits, int nobs, bool *missing);
+
+#endif
@@ -282,6 +282,114 @@ void Free3DTAB(counts3d table) {
 
 }/*FREE3DTAB*/
 
+/* relabel the strata of the third dimension that are observed in the data
+ * with consecutive integers (starting from 1) using an open-addressing hash
+ * table. The new labels preserve the order of the original ones, so strata are
+ * visited in the same order as in the dense table. Returns the number of
+ * observed strata. */
+int sparse_strata(int *zz, int num, int *strata) {
+
+int i = 0, nobs = 0, *slot_key = NULL, *slot_val = NULL, *keys = NULL;
+int *idx = NULL;
+size_t size = 16, mask = 0, pos = 0;
+
+  while (size < 2 * (size_t)num)
+    size <<= 1;
+  mask = size - 1;
+
+  /* keys are the original labels, which are positive integers. */
+  slot_key = Calloc1D(size, sizeof(int));
+  slot_val = Calloc1D(size, sizeof(int));
+  keys = Calloc1D(num, sizeof(int));
+
+  /* first pass: find the distinct labels, saving the slot of each one. */
+  for (i = 0; i < num; i++) {
+
+    if (zz[i] == NA_INTEGER) {
+
+      strata[i] = NA_INTEGER;
+      continue;
+
+    }/*THEN*/
+
+    /* Knuth's multiplicative hashing, with linear probing. */
+    for (pos = ((unsigned int)zz[i] * 2654435761U) & mask;
+         slot_key[pos] != 0 && slot_key[pos] != zz[i];
+         pos = (pos + 1) & mask);
+
+    if (slot_key[pos] == 0) {
+
+      slot_key[pos] = zz[i];
+      keys[nobs++] = zz[i];
+
+    }/*THEN*/
+
+    strata[i] = (int)pos;
+
+  }/*FOR*/
+
+  /* sort the distinct labels and store their ranks in the hash table... */
+  idx = Calloc1D(nobs, sizeof(int));
+  for (i = 0; i < nobs; i++)
+    idx[i] = i;
+  if (nobs > 1)
+    R_qsort_int_I(keys, idx, 1, nobs);
+
+  for (i = 0; i < nobs; i++) {
+
+    for (pos = ((unsigned int)keys[i] * 2654435761U) & mask;
+         slot_key[pos] != keys[i];
+         pos = (pos + 1) & mask);
+
+    slot_val[pos] = i + 1;
+
+  }/*FOR*/
+
+  /* ... and then replace the slots with the ranks. */
+  for (i = 0; i < num; i++)
+    if (strata[i] != NA_INTEGER)
+      strata[i] = slot_val[strata[i]];
+
+  Free1D(idx);
+  Free1D(keys);
+  Free1D(slot_key);
+  Free1D(slot_val);
+
+  return nobs;
+
+}/*SPARSE_STRATA*/
+
+/* create and fill a three-dimensional contingency table. If there are more
+ * strata than observations, most of them are necessarily empty: in that case
+ * only the observed strata are stored, so that memory use and the time spent
+ * in the kernels are bounded by the sample size. The statistics computed from
+ * the table are the same, since empty strata do not contribute to them. */
+counts3d new_filled_3d_table(int *xx, int llx, int *yy, int lly, int *zz,
+    int llz, int num) {
+
+int *strata = NULL, nstrata = 0;
+counts3d table = { 0 };
+
+  if (llz <= num) {
+
+    table = new_3d_table(llx, lly, llz);
+    fill_3d_table(xx, yy, zz, &table, num);
+
+  }/*THEN*/
+  else {
+
+    strata = Calloc1D(num, sizeof(int));
+    nstrata = sparse_strata(zz, num, strata);
+    table = new_3d_table(llx, lly, (nstrata > 0) ? nstrata : 1);
+    fill_3d_table(xx, yy, strata, &table, num);
+    Free1D(strata);
+
+  }/*ELSE*/
+
+  return table;
+
+}/*NEW_FILLED_3D_TABLE*/
+
 /* --------------------- uniform random table sampling ------------------- */
 
 /* Modified version of the rcont2() function from R. */
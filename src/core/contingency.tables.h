@@ -53,6 +53,10 @@ void resize_1d_table(int llx, counts1d *table);
 void resize_2d_table(int llx, int lly, counts2d *table);
 void resize_3d_table(int llx, int lly, int llz, counts3d *table);
 
+int sparse_strata(int *zz, int num, int *strata);
+counts3d new_filled_3d_table(int *xx, int llx, int *yy, int lly, int *zz,
+    int llz, int num);
+
 void print_1d_table(counts1d table);
 void print_2d_table(counts2d table);
 void print_3d_table(counts3d table);
@@ -90,6 +90,24 @@ double tol = MACHINE_TOL, sv_tol = 0;
 
 }/*C_FAST_PCOR*/
 
+/* Partial Linear Correlation from the inverse of the covariance matrix, for
+ * when it is kept up to date instead of being recomputed for each test. */
+double c_fast_pcor_precision(covariance prec, int v1, int v2) {
+
+double res = 0, tol = MACHINE_TOL;
+double k11 = prec.mat[CMC(v1, v1, prec.dim)];
+double k12 = prec.mat[CMC(v1, v2, prec.dim)];
+double k22 = prec.mat[CMC(v2, v2, prec.dim)];
+
+  /* safety check against "divide by zero" errors and negative variances. */
+  res = SAFE_COR(-k12, k11, k22)
+  /* double-check that the partial correlation is in the [-1, 1] range. */
+  COR_BOUNDS(res);
+
+  return res;
+
+}/*C_FAST_PCOR_PRECISION*/
+
 /* linear correlation from incomplete data, which also computes the number of
  * complete observations. */
 double c_cor_with_missing(double *x, double *y, int nobs, double *xm,
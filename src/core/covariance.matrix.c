@@ -1,6 +1,8 @@
 #include "../include/rcore.h"
 #include "allocations.h"
+#include "../include/globals.h"
 #include "../math/linear.algebra.h"
+#include "bitmaps.h"
 #include "covariance.matrix.h"
 
 covariance new_covariance(int dim, bool decomp) {
@@ -52,6 +54,38 @@ void covariance_drop_variable(covariance *full, covariance *sub, int to_drop) {
 
 }/*COVARIANCE_DROP_COLUMN*/
 
+/* remove a variable from a precision (inverse covariance) matrix, which gives
+ * the inverse of the covariance matrix with that variable removed without
+ * inverting it again: a rank-one downdate by the Schur complement. Returns
+ * FALSE if the diagonal element of the variable is too small for the downdate
+ * to be numerically safe. */
+bool precision_drop_variable(covariance *full, covariance *sub, int to_drop) {
+
+int i = 0, j = 0, k = 0, dim = (*full).dim;
+double *col = NULL, pivot = (*full).mat[CMC(to_drop, to_drop, dim)];
+
+  if (pivot < MACHINE_TOL)
+    return FALSE;
+
+  /* save the row/column of the dropped variable, since it may be overwritten
+   * when the downdate is performed in place. */
+  col = Calloc1D(dim, sizeof(double));
+  for (i = 0; i < dim; i++)
+    col[i] = (*full).mat[CMC(i, to_drop, dim)];
+
+  for (j = 0, k = 0; j < dim; j++)
+    for (i = 0; i < dim; i++)
+      if ((i != to_drop) && (j != to_drop))
+        (*sub).mat[k++] = (*full).mat[CMC(i, j, dim)] - col[i] * col[j] / pivot;
+
+  (*sub).dim = dim - 1;
+
+  Free1D(col);
+
+  return TRUE;
+
+}/*PRECISION_DROP_VARIABLE*/
+
 void FreeCOV(covariance cov) {
 
   Free1D(cov.mat);
@@ -183,6 +217,116 @@ long double temp = 0;
 
 }/*C_COVMAT_WITH_MISSING*/
 
+/* fill a covariance matrix from the observations whose bits are set in a
+ * validity mask (the intersection of the bitmaps of the columns), computing
+ * means as well. */
+void c_covmat_with_mask(double **data, int nrow, int ncol, uint64_t *mask,
+    int ncomplete, double *mean, double *mat) {
+
+int i = 0, j = 0, k = 0, w = 0, nwords = BITMAP_NWORDS(nrow);
+uint64_t bits = 0;
+long double temp = 0;
+
+  /* if there are no complete data points, return a zero matrix. */
+  if (ncomplete == 0)
+    return;
+
+  /* compute the means. */
+  for (j = 0; j < ncol; j++) {
+
+    temp = 0;
+    FOR_EACH_BIT(mask, nwords, w, bits, k)
+      temp += data[j][k];
+
+    mean[j] = temp / ncomplete;
+
+  }/*FOR*/
+
+  /* compute the covariance from complete observations. */
+  for (i = 0; i < ncol; i++)
+    for (j = i; j < ncol; j++) {
+
+      temp = 0;
+      FOR_EACH_BIT(mask, nwords, w, bits, k)
+        temp += (data[j][k] - mean[j]) * (data[i][k] - mean[i]);
+
+      /* fill in the symmetric element of the matrix. */
+      mat[CMC(j, i, ncol)] = mat[CMC(i, j, ncol)] =
+        (double)(temp / (ncomplete - 1));
+
+    }/*FOR*/
+
+}/*C_COVMAT_WITH_MASK*/
+
+/* update the mean and the row/column of a single variable in a covariance
+ * matrix computed by c_covmat_with_mask(), keeping the rest; the mask must be
+ * the same one used to compute the latter. */
+void c_update_covmat_with_mask(double **data, int nrow, int ncol,
+    uint64_t *mask, int ncomplete, int update, double *mean, double *mat) {
+
+int j = 0, k = 0, w = 0, nwords = BITMAP_NWORDS(nrow);
+uint64_t bits = 0;
+long double temp = 0;
+
+  if (ncomplete == 0)
+    return;
+
+  FOR_EACH_BIT(mask, nwords, w, bits, k)
+    temp += data[update][k];
+  mean[update] = temp / ncomplete;
+
+  for (j = 0; j < ncol; j++) {
+
+    temp = 0;
+    FOR_EACH_BIT(mask, nwords, w, bits, k)
+      temp += (data[update][k] - mean[update]) * (data[j][k] - mean[j]);
+
+    /* fill the symmetric elements of the matrix. */
+    mat[CMC(j, update, ncol)] = mat[CMC(update, j, ncol)] =
+      (double)(temp / (ncomplete - 1));
+
+  }/*FOR*/
+
+}/*C_UPDATE_COVMAT_WITH_MASK*/
+
+/* add one observation to a covariance matrix and to the corresponding means,
+ * computed from the ncomplete observations that are already in it (Welford's
+ * rank-one update). */
+void c_covmat_add_observation(double **data, int row, int ncol, double *mean,
+    double *mat, int *ncomplete) {
+
+int i = 0, j = 0, nc = *ncomplete;
+double *delta = NULL;
+
+  delta = Calloc1D(ncol, sizeof(double));
+
+  /* rescale the covariance matrix back to the sums of squares... */
+  for (i = 0; i < ncol * ncol; i++)
+    mat[i] *= (nc > 1) ? nc - 1 : 0;
+
+  /* ... update means and sums of squares... */
+  nc++;
+  for (j = 0; j < ncol; j++) {
+
+    delta[j] = data[j][row] - mean[j];
+    mean[j] += delta[j] / nc;
+
+  }/*FOR*/
+
+  for (i = 0; i < ncol; i++)
+    for (j = 0; j < ncol; j++)
+      mat[CMC(i, j, ncol)] += delta[i] * (data[j][row] - mean[j]);
+
+  /* ... and scale them again. */
+  for (i = 0; i < ncol * ncol; i++)
+    mat[i] = (nc > 1) ? mat[i] / (nc - 1) : 0;
+
+  *ncomplete = nc;
+
+  Free1D(delta);
+
+}/*C_COVMAT_ADD_OBSERVATION*/
+
 /* update only a single row/column in a covariance matrix. */
 void c_update_covmat(double **data, double *mean, int update, int nrow,
     int ncol, double *mat) {
@@ -1,6 +1,8 @@
 #ifndef COVARIANCE_MATRIX_HEADER
 #define COVARIANCE_MATRIX_HEADER
 
+#include <stdint.h>
+
 /* covariance matrix, with additional fields to carry around its own SVD
  * decomposition and dimension. */
 typedef struct {
@@ -17,6 +19,7 @@ covariance new_covariance(int dim, bool decomp);
 void print_covariance(covariance cov);
 void copy_covariance(covariance *src, covariance *copy);
 void covariance_drop_variable(covariance *full, covariance *sub, int to_drop);
+bool precision_drop_variable(covariance *full, covariance *sub, int to_drop);
 void FreeCOV(covariance cov);
 
 void c_covmat(double **data, double *mean, int nrow, int ncol, covariance cov,
@@ -26,5 +29,11 @@ void c_update_covmat(double **data, double *mean, int update, int nrow,
 void c_covmat_with_missing(double **data, int nrow, int ncol,
     bool *missing_partial, bool *missing_all, double *mean, double *mat,
     int *ncomplete);
+void c_covmat_with_mask(double **data, int nrow, int ncol, uint64_t *mask,
+    int ncomplete, double *mean, double *mat);
+void c_update_covmat_with_mask(double **data, int nrow, int ncol,
+    uint64_t *mask, int ncomplete, int update, double *mean, double *mat);
+void c_covmat_add_observation(double **data, int row, int ncol, double *mean,
+    double *mat, int *ncomplete);
 
 #endif
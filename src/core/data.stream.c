@@ -0,0 +1,431 @@
+#include "../include/rcore.h"
+#include "allocations.h"
+#include "data.stream.h"
+
+#define ENTRY(key, value) if (strcmp(label, key) == 0) return value;
+
+stream_format_e stream_format_to_enum(const char *label) {
+
+  ENTRY("csv", STREAM_CSV);
+  ENTRY("binary", STREAM_BINARY);
+
+  return STREAM_ENOFMT;
+
+}/*STREAM_FORMAT_TO_ENUM*/
+
+/* read a whole line, however long, into the buffer and strip the newline. */
+static bool stream_read_line(data_stream *s) {
+
+size_t len = 0;
+char *buf = NULL;
+
+  if (!fgets((*s).buffer, (*s).size, (*s).fp))
+    return FALSE;
+
+  len = strlen((*s).buffer);
+
+  /* the line did not fit in the buffer, make it larger and keep reading. */
+  while ((len == (*s).size - 1) && ((*s).buffer[len - 1] != '\n')) {
+
+    (*s).buffer = Realloc1D((*s).buffer, 2 * (*s).size, sizeof(char));
+    (*s).size *= 2;
+    buf = (*s).buffer;
+
+    if (!fgets(buf + len, (*s).size - len, (*s).fp))
+      break;
+
+    len += strlen(buf + len);
+
+  }/*WHILE*/
+
+  while ((len > 0) &&
+         (((*s).buffer[len - 1] == '\n') || ((*s).buffer[len - 1] == '\r')))
+    (*s).buffer[--len] = '\0';
+
+  return TRUE;
+
+}/*STREAM_READ_LINE*/
+
+/* split a line into comma-separated fields, in place, removing the quotes
+ * around them; if values is NULL, the fields are only counted and the line is
+ * not modified. Returns the number of fields. */
+static int stream_split_line(char *line, char **values, int max) {
+
+int n = 0;
+char *r = line, *w = line;
+bool store = (values != NULL);
+
+  while (TRUE) {
+
+    if (store && (n < max))
+      values[n] = w;
+    n++;
+
+    /* quoted fields may contain commas and doubled quotes... */
+    if (*r == '"') {
+
+      for (r++; *r; r++) {
+
+        if (*r == '"') {
+
+          if (*(r + 1) != '"') {
+
+            r++;
+            break;
+
+          }/*THEN*/
+
+          r++;
+
+        }/*THEN*/
+
+        if (store)
+          *w = *r;
+        w++;
+
+      }/*FOR*/
+
+    }/*THEN*/
+
+    /* ... while everything else runs until the next comma. */
+    for (; *r && (*r != ','); r++, w++)
+      if (store)
+        *w = *r;
+
+    if (*r != ',')
+      break;
+
+    if (store)
+      *w = '\0';
+    w++;
+    r++;
+
+  }/*WHILE*/
+
+  if (store)
+    *w = '\0';
+
+  return n;
+
+}/*STREAM_SPLIT_LINE*/
+
+/* map the fields in the header of a CSV file to the variables. */
+static void stream_read_header(data_stream *s, const char **names) {
+
+int k = 0, v = 0;
+
+  if (!stream_read_line(s)) {
+
+    snprintf((*s).msg, sizeof((*s).msg), "the file is empty.");
+    return;
+
+  }/*THEN*/
+
+  (*s).nfields = stream_split_line((*s).buffer, NULL, 0);
+  (*s).values = Calloc1D((*s).nfields, sizeof(char *));
+  (*s).field = Calloc1D((*s).nfields, sizeof(int));
+  stream_split_line((*s).buffer, (*s).values, (*s).nfields);
+
+  for (k = 0; k < (*s).nfields; k++) {
+
+    (*s).field[k] = -1;
+
+    for (v = 0; v < (*s).ncols; v++)
+      if (strcmp((*s).values[k], names[v]) == 0) {
+
+        (*s).field[k] = v;
+        break;
+
+      }/*THEN*/
+
+  }/*FOR*/
+
+  /* all the variables must be in the file, exactly once. */
+  for (v = 0; v < (*s).ncols; v++) {
+
+    int found = 0;
+
+    for (k = 0; k < (*s).nfields; k++)
+      found += ((*s).field[k] == v);
+
+    if (found != 1) {
+
+      snprintf((*s).msg, sizeof((*s).msg),
+        "variable %s %s in the header of the file.", names[v],
+        (found == 0) ? "is missing" : "appears more than once");
+      return;
+
+    }/*THEN*/
+
+  }/*FOR*/
+
+}/*STREAM_READ_HEADER*/
+
+/* open a file and prepare to read it in batches. */
+data_stream *data_stream_open(const char *path, stream_format_e format,
+    int ncols, const char **names, bool *discrete, int *nlevels,
+    const char ***levels) {
+
+data_stream *s = Calloc1D(1, sizeof(data_stream));
+
+  (*s).format = format;
+  (*s).ncols = ncols;
+  (*s).discrete = discrete;
+  (*s).nlevels = nlevels;
+  (*s).levels = levels;
+
+  (*s).fp = fopen(path, (format == STREAM_CSV) ? "r" : "rb");
+  if (!(*s).fp) {
+
+    snprintf((*s).msg, sizeof((*s).msg), "unable to open %s.", path);
+    return s;
+
+  }/*THEN*/
+
+  if (format == STREAM_CSV) {
+
+    (*s).size = 4096;
+    (*s).buffer = Calloc1D((*s).size, sizeof(char));
+    stream_read_header(s, names);
+
+  }/*THEN*/
+  else {
+
+    /* the offset of each variable in the record. */
+    (*s).offset = Calloc1D(ncols, sizeof(int));
+    for (int v = 0; v < ncols; v++) {
+
+      (*s).offset[v] = (*s).recsize;
+      (*s).recsize += discrete[v] ? sizeof(int) : sizeof(double);
+
+    }/*FOR*/
+
+  }/*ELSE*/
+
+  return s;
+
+}/*DATA_STREAM_OPEN*/
+
+/* parse one line of a CSV file into the r-th observation of the data. */
+static bool stream_parse_line(data_stream *s, cgdata *dt, int r) {
+
+int k = 0, v = 0, l = 0, n = 0;
+char *str = NULL, *end = NULL;
+bool missing = FALSE;
+
+  n = stream_split_line((*s).buffer, (*s).values, (*s).nfields);
+
+  if (n != (*s).nfields) {
+
+    snprintf((*s).msg, sizeof((*s).msg),
+      "observation %.0lf has %d fields instead of %d.", (*s).nrows + r + 1,
+      n, (*s).nfields);
+    return FALSE;
+
+  }/*THEN*/
+
+  for (k = 0; k < (*s).nfields; k++) {
+
+    v = (*s).field[k];
+    if (v < 0)
+      continue;
+
+    str = (*s).values[k];
+    missing = (str[0] == '\0') || (strcmp(str, "NA") == 0);
+    (*dt).m.flag[v].complete &= !missing;
+
+    if ((*s).discrete[v]) {
+
+      if (missing) {
+
+        (*dt).dcol[(*dt).map[v]][r] = NA_INTEGER;
+        continue;
+
+      }/*THEN*/
+
+      for (l = 0; l < (*s).nlevels[v]; l++)
+        if (strcmp(str, (*s).levels[v][l]) == 0)
+          break;
+
+      if (l == (*s).nlevels[v]) {
+
+        snprintf((*s).msg, sizeof((*s).msg),
+          "observation %.0lf has unknown level '%s' in field %d.",
+          (*s).nrows + r + 1, str, k + 1);
+        return FALSE;
+
+      }/*THEN*/
+
+      (*dt).dcol[(*dt).map[v]][r] = l + 1;
+
+    }/*THEN*/
+    else {
+
+      if (missing) {
+
+        (*dt).gcol[(*dt).map[v]][r] = NA_REAL;
+        continue;
+
+      }/*THEN*/
+
+      (*dt).gcol[(*dt).map[v]][r] = strtod(str, &end);
+      while (*end == ' ')
+        end++;
+
+      if ((end == str) || (*end != '\0')) {
+
+        snprintf((*s).msg, sizeof((*s).msg),
+          "observation %.0lf has a non-numeric value '%s' in field %d.",
+          (*s).nrows + r + 1, str, k + 1);
+        return FALSE;
+
+      }/*THEN*/
+
+    }/*ELSE*/
+
+  }/*FOR*/
+
+  return TRUE;
+
+}/*STREAM_PARSE_LINE*/
+
+/* read the next batch of binary records into the data. */
+static int stream_read_records(data_stream *s, cgdata *dt, int batch) {
+
+int r = 0, v = 0, nrec = 0, ival = 0;
+size_t nbytes = 0;
+char *rec = NULL;
+double dval = 0;
+
+  if ((*s).size < batch * (*s).recsize) {
+
+    Free1D((*s).buffer);
+    (*s).size = batch * (*s).recsize;
+    (*s).buffer = Calloc1D((*s).size, sizeof(char));
+
+  }/*THEN*/
+
+  nbytes = fread((*s).buffer, 1, batch * (*s).recsize, (*s).fp);
+
+  if (ferror((*s).fp)) {
+
+    snprintf((*s).msg, sizeof((*s).msg), "error while reading the file.");
+    return -1;
+
+  }/*THEN*/
+
+  if (nbytes % (*s).recsize != 0) {
+
+    snprintf((*s).msg, sizeof((*s).msg),
+      "the file is truncated, the size of the last record is %d instead of %d bytes.",
+      (int)(nbytes % (*s).recsize), (int)(*s).recsize);
+    return -1;
+
+  }/*THEN*/
+
+  nrec = nbytes / (*s).recsize;
+
+  for (r = 0; r < nrec; r++) {
+
+    rec = (*s).buffer + r * (*s).recsize;
+
+    for (v = 0; v < (*s).ncols; v++) {
+
+      if ((*s).discrete[v]) {
+
+        memcpy(&ival, rec + (*s).offset[v], sizeof(int));
+
+        if ((ival != NA_INTEGER) && ((ival < 1) || (ival > (*s).nlevels[v]))) {
+
+          snprintf((*s).msg, sizeof((*s).msg),
+            "observation %.0lf has level %d for variable %d, which has only %d levels.",
+            (*s).nrows + r + 1, ival, v + 1, (*s).nlevels[v]);
+          return -1;
+
+        }/*THEN*/
+
+        (*dt).dcol[(*dt).map[v]][r] = ival;
+        (*dt).m.flag[v].complete &= (ival != NA_INTEGER);
+
+      }/*THEN*/
+      else {
+
+        memcpy(&dval, rec + (*s).offset[v], sizeof(double));
+        (*dt).gcol[(*dt).map[v]][r] = dval;
+        (*dt).m.flag[v].complete &= !ISNAN(dval);
+
+      }/*ELSE*/
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  return nrec;
+
+}/*STREAM_READ_RECORDS*/
+
+/* read up to batch observations into the data, which must have room for them
+ * and map the variables to its columns. Returns the number of observations
+ * read (zero at the end of the file), or -1 after setting the error message. */
+int data_stream_read(data_stream *s, cgdata *dt, int batch) {
+
+int r = 0;
+
+  for (int v = 0; v < (*s).ncols; v++)
+    (*dt).m.flag[v].complete = TRUE;
+
+  if ((*s).format == STREAM_BINARY) {
+
+    r = stream_read_records(s, dt, batch);
+
+  }/*THEN*/
+  else {
+
+    while ((r < batch) && stream_read_line(s)) {
+
+      /* skip empty lines. */
+      if ((*s).buffer[0] == '\0')
+        continue;
+
+      if (!stream_parse_line(s, dt, r))
+        return -1;
+
+      r++;
+
+    }/*WHILE*/
+
+    if (ferror((*s).fp)) {
+
+      snprintf((*s).msg, sizeof((*s).msg), "error while reading the file.");
+      return -1;
+
+    }/*THEN*/
+
+  }/*ELSE*/
+
+  if (r > 0) {
+
+    (*dt).m.nobs = r;
+    (*s).nrows += r;
+
+  }/*THEN*/
+
+  return r;
+
+}/*DATA_STREAM_READ*/
+
+void FreeDATASTREAM(data_stream *s) {
+
+  if (!s)
+    return;
+
+  if ((*s).fp)
+    fclose((*s).fp);
+
+  Free1D((*s).field);
+  Free1D((*s).values);
+  Free1D((*s).offset);
+  Free1D((*s).buffer);
+  Free1D(s);
+
+}/*FREEDATASTREAM*/
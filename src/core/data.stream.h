@@ -0,0 +1,49 @@
+#ifndef DATA_STREAM_HEADER
+#define DATA_STREAM_HEADER
+
+#include <stdio.h>
+#include "data.table.h"
+
+/* enum for the formats of the files data are streamed from. */
+typedef enum {
+  STREAM_ENOFMT  =  0, /* error code, no such format. */
+  STREAM_CSV     =  1, /* comma-separated text file with a header. */
+  STREAM_BINARY  =  2  /* fixed-size binary records, one for each observation,
+                        * with a 32-bit integer level (1-based) for each discrete
+                        * variable and a double for each continuous variable. */
+} stream_format_e;
+
+stream_format_e stream_format_to_enum(const char *label);
+
+/* a file read in batches of observations, each of them overwriting the columns
+ * of the same data table. */
+typedef struct {
+
+  FILE *fp;                /* the file. */
+  stream_format_e format;  /* the format of the file. */
+  int ncols;               /* number of variables. */
+  bool *discrete;          /* whether each variable is discrete. */
+  int *nlevels;            /* number of levels of each discrete variable. */
+  const char ***levels;    /* labels of the levels (CSV only). */
+  int nfields;             /* number of fields in each line (CSV only). */
+  int *field;              /* the variable each field is read into, or -1 if
+                            * it is not needed (CSV only). */
+  char **values;           /* the fields of the current line (CSV only). */
+  int *offset;             /* offset of each variable in a record (binary
+                            * only). */
+  size_t recsize;          /* size of each record (binary only). */
+  char *buffer;            /* the current line (CSV) or batch of records
+                            * (binary). */
+  size_t size;             /* size of the buffer. */
+  double nrows;            /* number of observations read so far. */
+  char msg[256];           /* why reading the file failed, if it did. */
+
+} data_stream;
+
+data_stream *data_stream_open(const char *path, stream_format_e format,
+    int ncols, const char **names, bool *discrete, int *nlevels,
+    const char ***levels);
+int data_stream_read(data_stream *s, cgdata *dt, int batch);
+void FreeDATASTREAM(data_stream *s);
+
+#endif
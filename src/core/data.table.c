@@ -1,5 +1,6 @@
 #include "../include/rcore.h"
 #include "allocations.h"
+#include "bitmaps.h"
 #include "data.table.h"
 #include "moments.h"
 #include "../minimal/common.h"
@@ -57,10 +58,10 @@ int i = 0, j = 0;
     if ((*src).flag)
       (*dest).flag[j] = (*src).flag[i];
 
-    /* the source and the destination are different structs, the columns belong
-     * with the former and not with the latter. */
+    /* the source and the destination are different structs, the columns (and
+     * their bitmaps) belong with the former and not with the latter. */
     if (src != dest)
-      (*dest).flag[j].own = FALSE;
+      (*dest).flag[j].own = (*dest).flag[j].bitmap = FALSE;
 
     j++;
 
@@ -85,10 +86,10 @@ int i = 0;
     if ((*src).flag)
       (*dest).flag[i] = (*src).flag[ids[i]];
 
-    /* the source and the destination are different structs, the columns belong
-     * with the former and not with the latter. */
+    /* the source and the destination are different structs, the columns (and
+     * their bitmaps) belong with the former and not with the latter. */
     if (src != dest)
-      (*dest).flag[i].own = FALSE;
+      (*dest).flag[i].own = (*dest).flag[i].bitmap = FALSE;
 
   }/*FOR*/
 
@@ -100,15 +101,17 @@ int i = 0;
 void meta_copy(meta *src, meta *dest) {
 
 int i = 0;
-bool own = FALSE;
+bool own = FALSE, bitmap = FALSE;
 
   /* copy all the flags that describe the contents and the types of the columns,
    * but preserve ownership of the memory in the destination struct. */
   for (i = 0; i < (*src).ncols; i++) {
 
     own = (*dest).flag[i].own;
+    bitmap = (*dest).flag[i].bitmap;
     (*dest).flag[i] = (*src).flag[i];
     (*dest).flag[i].own = own;
+    (*dest).flag[i].bitmap = bitmap;
 
   }/*FOR*/
 
@@ -320,6 +323,50 @@ void gdata_cache_means(gdata *dt, int offset) {
 
 }/*CACHE_MEANS*/
 
+/* cache the validity bitmaps of the continuous columns, so that the complete
+ * observations of any set of columns can be found by intersecting them instead
+ * of scanning the data again. Columns without missing values share the same
+ * bitmap, which belongs with the first of them. */
+void gdata_cache_validity(gdata *dt, int offset) {
+
+int j = 0, nwords = BITMAP_NWORDS((*dt).m.nobs);
+uint64_t *bits = NULL, *all = NULL;
+
+  (*dt).valid = Calloc1D((*dt).m.ncols, sizeof(uint64_t *));
+
+  for (j = offset; j < (*dt).m.ncols; j++) {
+
+    bits = new_bitmap((*dt).m.nobs);
+    c_validity_bitmap((*dt).col[j], (*dt).m.nobs, bits);
+
+    if (bitmap_count(bits, nwords) == (*dt).m.nobs) {
+
+      (*dt).m.flag[j].complete = TRUE;
+
+      if (all) {
+
+        Free1D(bits);
+        (*dt).valid[j] = all;
+        continue;
+
+      }/*THEN*/
+
+      all = bits;
+
+    }/*THEN*/
+    else {
+
+      (*dt).m.flag[j].complete = FALSE;
+
+    }/*ELSE*/
+
+    (*dt).valid[j] = bits;
+    (*dt).m.flag[j].bitmap = TRUE;
+
+  }/*FOR*/
+
+}/*GDATA_CACHE_VALIDITY*/
+
 void print_gdata(gdata dt) {
 
 int i = 0;
@@ -353,6 +400,8 @@ int i = 0, k = 0;
     (*copy).col[k] = (*dt).col[i];
     if ((*dt).mean && (*copy).mean)
       (*copy).mean[k] = (*dt).mean[i];
+    if ((*dt).valid && (*copy).valid)
+      (*copy).valid[k] = (*dt).valid[i];
     k++;
 
   }/*FOR*/
@@ -372,6 +421,8 @@ int i = 0;
     (*copy).col[i] = (*dt).col[ids[i]];
     if ((*dt).mean && (*copy).mean)
       (*copy).mean[i] = (*dt).mean[ids[i]];
+    if ((*dt).valid && (*copy).valid)
+      (*copy).valid[i] = (*dt).valid[ids[i]];
 
   }/*FOR*/
 
@@ -427,6 +478,13 @@ int i = 0;
   /* free the column pointers, unconditionally. */
   Free1D(dt.col);
 
+  /* free the cached validity bitmaps that belong with the struct. */
+  if (dt.valid)
+    for (i = 0; i < dt.m.ncols; i++)
+      if (dt.m.flag[i].bitmap)
+        Free1D(dt.valid[i]);
+  Free1D(dt.valid);
+
   /* free the cached means and, finally, the meta data. */
   Free1D(dt.mean);
   FreeMETA(&(dt.m));
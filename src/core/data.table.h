@@ -1,6 +1,8 @@
 #ifndef DATA_TABLE_HEADER
 #define DATA_TABLE_HEADER
 
+#include <stdint.h>
+
 /* flags for the columns (variables) of a data table, stored in the metadata. */
 typedef struct {
 
@@ -10,7 +12,9 @@ typedef struct {
   unsigned int complete : 1;  /* this column contains no missing data points. */
   unsigned int fixed    : 1;  /* this column should never be (re)moved. */
   unsigned int drop     : 1;  /* this column is to be removed. */
-  unsigned int padding  : 2;  /* pad to 1 byte. */
+  unsigned int bitmap   : 1;  /* this column's validity bitmap belongs with the
+                               * struct. */
+  unsigned int padding  : 1;  /* pad to 1 byte. */
 
 } flags;
 
@@ -39,6 +43,8 @@ typedef struct {
   meta m;               /* metadata. */
   double **col;         /* pointers to the continuous columns. */
   double *mean;         /* means of the continuous columns (optional). */
+  uint64_t **valid;     /* validity bitmaps of the continuous columns, with one
+                         * bit set for each observed value (optional). */
 
 } gdata;
 
@@ -72,6 +78,7 @@ gdata gdata_from_SEXP(SEXP df, int offset);
 gdata new_gdata(int nobs, int ncols);
 gdata empty_gdata(int nobs, int ncols);
 void gdata_cache_means(gdata *dt, int offset);
+void gdata_cache_validity(gdata *dt, int offset);
 void gdata_move_column(gdata *dt, gdata *copy, int i, int j);
 void print_gdata(gdata dt);
 void gdata_drop_flagged(gdata *dt, gdata *copy);
@@ -151,3 +151,57 @@ double tol = MACHINE_TOL;
 
 }/*ALL_MAX*/
 
+/* sum a double array by recursive halving: the rounding errors grow with the
+ * logarithm of the length instead of the length, and the result depends only
+ * on the order of the elements. */
+double d_pairwise_sum(double *array, int length) {
+
+int i = 0, half = 0;
+double sum = 0;
+
+  if (length <= 8) {
+
+    for (i = 0; i < length; i++)
+      sum += array[i];
+
+    return sum;
+
+  }/*THEN*/
+
+  half = length / 2;
+
+  return d_pairwise_sum(array, half) +
+           d_pairwise_sum(array + half, length - half);
+
+}/*D_PAIRWISE_SUM*/
+
+/* log-densities of a vector of observations from normal distributions with
+ * the given expected values (which are overwritten) and a common standard
+ * deviation: the constant and the inverse of the standard deviation are
+ * computed once so that the loop vectorizes, falling back to dnorm() for
+ * singular or non-finite standard deviations. */
+void gaussian_logdensity(double *x, double *mean, int n, double sd) {
+
+int i = 0;
+double c = 0, isd = 0, z = 0;
+
+  if (!(sd > 0) || !R_FINITE(sd)) {
+
+    for (i = 0; i < n; i++)
+      mean[i] = dnorm(x[i], mean[i], sd, TRUE);
+
+    return;
+
+  }/*THEN*/
+
+  c = -(M_LN_SQRT_2PI + log(sd));
+  isd = 1 / sd;
+
+  for (i = 0; i < n; i++) {
+
+    z = (x[i] - mean[i]) * isd;
+    mean[i] = c - 0.5 * z * z;
+
+  }/*FOR*/
+
+}/*GAUSSIAN_LOGDENSITY*/
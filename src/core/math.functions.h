@@ -6,5 +6,7 @@ int all_max(double *array, int length, int *maxima, int *indexes, double *buf);
 int i_which_max(int *array, int length);
 int d_which_max(double *array, int length);
 int ld_which_max(long double *array, int length);
+double d_pairwise_sum(double *array, int length);
+void gaussian_logdensity(double *x, double *mean, int n, double sd);
 
 #endif
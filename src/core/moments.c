@@ -1,6 +1,7 @@
 #include "../include/rcore.h"
 #include "allocations.h"
 #include "moments.h"
+#include "../math/linear.algebra.h"
 #include "../minimal/common.h"
 
 /* compute the sum of the squared errors. */
@@ -171,3 +172,103 @@ SEXP sd;
 
 }/*CGSD*/
 
+
+/* allocate the per-stratum moments, all set to zero. */
+strata_moments new_strata_moments(int nstrata, int dim) {
+
+strata_moments sm = { 0 };
+
+  sm.nstrata = nstrata;
+  sm.dim = dim;
+  sm.n = Calloc1D(nstrata, sizeof(int));
+  sm.mean = Calloc1D(nstrata * dim, sizeof(long double));
+  sm.comoment = Calloc1D(nstrata * dim * dim, sizeof(long double));
+
+  return sm;
+
+}/*NEW_STRATA_MOMENTS*/
+
+/* accumulate the per-stratum moments of all the variables in a single pass
+ * over the data, using Welford's updates to avoid the cancellation in the raw
+ * sums of squares. If the strata (which start from 1) are not specified, all
+ * observations are in the first stratum. */
+void c_strata_moments(double **data, int nobs, int *strata,
+    strata_moments sm) {
+
+int i = 0, a = 0, b = 0, s = 0, d = sm.dim;
+long double *mu = NULL, *cm = NULL, *delta = NULL;
+
+  delta = Calloc1D(d, sizeof(long double));
+
+  for (i = 0; i < nobs; i++) {
+
+    s = strata ? strata[i] - 1 : 0;
+    mu = sm.mean + s * d;
+    cm = sm.comoment + s * d * d;
+    sm.n[s]++;
+
+    for (a = 0; a < d; a++) {
+
+      delta[a] = data[a][i] - mu[a];
+      mu[a] += delta[a] / sm.n[s];
+
+    }/*FOR*/
+
+    for (b = 0; b < d; b++)
+      for (a = 0; a <= b; a++)
+        cm[CMC(a, b, d)] += delta[a] * (data[b][i] - mu[b]);
+
+  }/*FOR*/
+
+  Free1D(delta);
+
+}/*C_STRATA_MOMENTS*/
+
+/* pool the moments of the strata that are mapped to the same coarser stratum
+ * (map[s] is the coarser stratum, starting from 0, of the s-th stratum), so
+ * that nested stratifications need a single pass over the data. */
+void strata_moments_collapse(strata_moments fine, int *map,
+    strata_moments coarse) {
+
+int s = 0, t = 0, a = 0, b = 0, d = fine.dim, n = 0;
+long double *mu = NULL, *cm = NULL, *delta = NULL;
+
+  delta = Calloc1D(d, sizeof(long double));
+
+  for (s = 0; s < fine.nstrata; s++) {
+
+    if (fine.n[s] == 0)
+      continue;
+
+    t = map[s];
+    mu = coarse.mean + t * d;
+    cm = coarse.comoment + t * d * d;
+    n = coarse.n[t] + fine.n[s];
+
+    /* combine means and cross-products as in Chan, Golub and LeVeque. */
+    for (a = 0; a < d; a++)
+      delta[a] = fine.mean[s * d + a] - mu[a];
+
+    for (b = 0; b < d; b++)
+      for (a = 0; a <= b; a++)
+        cm[CMC(a, b, d)] += fine.comoment[s * d * d + CMC(a, b, d)] +
+          delta[a] * delta[b] * coarse.n[t] * fine.n[s] / n;
+
+    for (a = 0; a < d; a++)
+      mu[a] += delta[a] * fine.n[s] / n;
+
+    coarse.n[t] = n;
+
+  }/*FOR*/
+
+  Free1D(delta);
+
+}/*STRATA_MOMENTS_COLLAPSE*/
+
+void FreeSMOMENTS(strata_moments sm) {
+
+  Free1D(sm.n);
+  Free1D(sm.mean);
+  Free1D(sm.comoment);
+
+}/*FREESMOMENTS*/
@@ -1,6 +1,19 @@
 #ifndef MOMENTS_HEADER
 #define MOMENTS_HEADER
 
+/* sample sizes, means and centred cross-products of a set of continuous
+ * variables within each stratum of a discrete variable. */
+typedef struct {
+
+  int nstrata;            /* number of strata. */
+  int dim;                /* number of continuous variables. */
+  int *n;                 /* sample size of each stratum. */
+  long double *mean;      /* means, dim values for each stratum. */
+  long double *comoment;  /* centred cross-products, a dim x dim matrix for
+                           * each stratum (only the upper triangle is used). */
+
+} strata_moments;
+
 double c_sse(double *data, double mean, int nrow);
 double c_mean(double *data, int nrow);
 
@@ -12,4 +25,11 @@ void c_sd(double *xx, int nobs, int p, double mean, double *sd);
 void c_cgsd(double *xx, int *z, int *nz, int nobs, int nstrata, int p,
     long double *means, double *sd);
 
+strata_moments new_strata_moments(int nstrata, int dim);
+void c_strata_moments(double **data, int nobs, int *strata,
+    strata_moments sm);
+void strata_moments_collapse(strata_moments fine, int *map,
+    strata_moments coarse);
+void FreeSMOMENTS(strata_moments sm);
+
 #endif
@@ -0,0 +1,88 @@
+#include "../include/rcore.h"
+#include "random.streams.h"
+
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+
+/* derive the key of a set of streams from R's random number generator, which
+ * must have been initialized with GetRNGstate(). */
+void rng_stream_key(uint32_t *key) {
+
+  key[0] = (uint32_t)(unif_rand() * 4294967296.0);
+  key[1] = (uint32_t)(unif_rand() * 4294967296.0);
+
+}/*RNG_STREAM_KEY*/
+
+/* initialize a stream, which will start from the first block. */
+void rng_stream_init(rng_stream *s, uint32_t *key, uint64_t stream) {
+
+  (*s).key[0] = key[0];
+  (*s).key[1] = key[1];
+  (*s).ctr[0] = (*s).ctr[1] = 0;
+  (*s).ctr[2] = (uint32_t)stream;
+  (*s).ctr[3] = (uint32_t)(stream >> 32);
+  /* no block has been generated yet. */
+  (*s).used = 4;
+
+}/*RNG_STREAM_INIT*/
+
+/* the ten rounds of Philox4x32, from the current counter into the output. */
+static void philox_block(rng_stream *s) {
+
+uint32_t c0 = (*s).ctr[0], c1 = (*s).ctr[1], c2 = (*s).ctr[2], c3 = (*s).ctr[3];
+uint32_t k0 = (*s).key[0], k1 = (*s).key[1];
+uint64_t p0 = 0, p1 = 0;
+
+  for (int r = 0; r < 10; r++) {
+
+    p0 = (uint64_t)PHILOX_M0 * c0;
+    p1 = (uint64_t)PHILOX_M1 * c2;
+
+    c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+    c1 = (uint32_t)p1;
+    c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+    c3 = (uint32_t)p0;
+
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+
+  }/*FOR*/
+
+  (*s).out[0] = c0;
+  (*s).out[1] = c1;
+  (*s).out[2] = c2;
+  (*s).out[3] = c3;
+
+  /* move to the next block. */
+  if (++(*s).ctr[0] == 0)
+    (*s).ctr[1]++;
+
+  (*s).used = 0;
+
+}/*PHILOX_BLOCK*/
+
+/* a uniform random number in (0, 1) with 53 random bits, built from two
+ * consecutive words. */
+double rng_stream_unif(rng_stream *s) {
+
+uint32_t a = 0, b = 0;
+
+  if ((*s).used >= 4)
+    philox_block(s);
+
+  a = (*s).out[(*s).used] >> 5;
+  b = (*s).out[(*s).used + 1] >> 6;
+  (*s).used += 2;
+
+  return (a * 67108864.0 + b + 0.5) / 9007199254740992.0;
+
+}/*RNG_STREAM_UNIF*/
+
+/* a standard normal random number, by inversion as in R's default. */
+double rng_stream_norm(rng_stream *s) {
+
+  return qnorm(rng_stream_unif(s), 0, 1, TRUE, FALSE);
+
+}/*RNG_STREAM_NORM*/
@@ -0,0 +1,25 @@
+#ifndef RANDOM_STREAMS_HEADER
+#define RANDOM_STREAMS_HEADER
+
+#include <stdint.h>
+
+/* a counter-based random number stream (Philox4x32-10): each stream is
+ * identified by a key shared by all streams and by its own stream number, and
+ * the numbers it produces depend only on those and on how many numbers have
+ * been drawn from it. Streams do not touch R's random number generator, so
+ * they can be used inside parallel regions. */
+typedef struct {
+
+  uint32_t key[2];      /* key, derived from R's random seed. */
+  uint32_t ctr[4];      /* counter: block number and stream number. */
+  uint32_t out[4];      /* the last block of random bits. */
+  int used;             /* how many words of the last block have been used. */
+
+} rng_stream;
+
+void rng_stream_key(uint32_t *key);
+void rng_stream_init(rng_stream *s, uint32_t *key, uint64_t stream);
+double rng_stream_unif(rng_stream *s);
+double rng_stream_norm(rng_stream *s);
+
+#endif
@@ -41,52 +41,102 @@ int i;
 
 }/*SAMPLEREPLACE*/
 
-/* sampling with replacement and unequal probabilties, internal copy of the
- * ProbSampleReplace function in src/main/random.c.
- * Copyright (C) 1995, 1996  Robert Gentleman and Ross Ihaka
- * Copyright (C) 1997--2010  The R Development Core Team
- * Copyright (C) 2003--2008  The R Foundation
- * licensed under "GPLv2 or later" licence. */
-void ProbSampleReplace(int nprobs, double *probs, int *values, int ns,
-    int *samples) {
+/* build the alias table of a discrete distribution with Vose's method: on
+ * return, probs contains the probability of keeping each outcome and alias the
+ * outcome to return otherwise. The work space must hold nprobs integers. */
+void c_alias_table(double *probs, int nprobs, int *alias, int *work) {
 
-double rU = 0;
-int i = 0, j = 0;
+int i = 0, s = 0, l = 0, nsmall = 0, nlarge = 0;
+long double sum = 0;
 
-  /* record element identities. */
+  /* rescale the probabilities so that their average is one; the sum is not
+   * assumed to be exactly one, to absorb rounding errors in the tables. */
   for (i = 0; i < nprobs; i++)
-    values[i] = i + 1;
+    sum += probs[i];
 
-  /* sort the probabilities in descending order. */
-  revsort(probs, values, nprobs);
+  /* small outcomes are stacked from the start of the work space, large
+   * outcomes from the end. */
+  for (i = 0; i < nprobs; i++) {
 
-  /* compute cumulative probabilities. */
-  for (i = 1 ; i < nprobs; i++)
-    probs[i] += probs[i - 1];
+    probs[i] = probs[i] * nprobs / sum;
+    alias[i] = i;
 
-  /* generate the sample. */
-  for (i = 0; i < ns; i++) {
+    if (probs[i] < 1)
+      work[nsmall++] = i;
+    else
+      work[nprobs - 1 - nlarge++] = i;
+
+  }/*FOR*/
 
-    rU = unif_rand();
+  /* pair each small outcome with a large one, which covers the rest of its
+   * column and may become small in turn. */
+  while ((nsmall > 0) && (nlarge > 0)) {
 
-    for (j = 0; j < nprobs - 1; j++)
-      if (rU <= probs[j])
-        break;
+    s = work[--nsmall];
+    l = work[nprobs - nlarge];
 
-    samples[i] = values[j];
+    alias[s] = l;
+    probs[l] = (probs[l] + probs[s]) - 1;
 
-  }/*FOR*/
+    if (probs[l] < 1) {
+
+      nlarge--;
+      work[nsmall++] = l;
+
+    }/*THEN*/
+
+  }/*WHILE*/
+
+  /* whatever is left over is one up to floating point errors. */
+  while (nlarge > 0)
+    probs[work[nprobs - nlarge--]] = 1;
+  while (nsmall > 0)
+    probs[work[--nsmall]] = 1;
+
+}/*C_ALIAS_TABLE*/
+
+/* draw an outcome (starting from zero) from an alias table, using a single
+ * uniform random number for both the column and the coin flip. */
+int c_alias_draw(double *probs, int *alias, int nprobs, double u) {
+
+int j = 0;
+double x = u * nprobs;
+
+  j = (int)x;
+  if (j >= nprobs)
+    j = nprobs - 1;
+
+  return (x - j < probs[j]) ? j : alias[j];
+
+}/*C_ALIAS_DRAW*/
+
+/* sampling with replacement and unequal probabilties, using an alias table so
+ * that each draw takes constant time. The probabilities are overwritten with
+ * the table, and values must hold 2 * nprobs integers. */
+void ProbSampleReplace(int nprobs, double *probs, int *values, int ns,
+    int *samples) {
+
+int i = 0;
+
+  c_alias_table(probs, nprobs, values, values + nprobs);
+
+  for (i = 0; i < ns; i++)
+    samples[i] = c_alias_draw(probs, values, nprobs, unif_rand()) + 1;
 
 }/*PROBSAMPLEREPLACE*/
 
+/* conditional sampling with replacement and unequal probabilities, building
+ * the alias tables only for the conditional distributions that are actually
+ * sampled from. The probabilities are overwritten with the tables, values must
+ * hold nprobs * nconf integers. */
 void CondProbSampleReplace(int nprobs, int nconf, double *probs, int *conf,
     int *values, int ns, int *samples, bool *warn) {
 
-int i = 0, j = 0;
-double rU = 0;
+int i = 0, *work = NULL;
 bool *prepd = NULL;
 
   prepd = Calloc1D(nconf, sizeof(bool));
+  work = Calloc1D(nprobs, sizeof(int));
 
   /* generate the sample. */
   for (i = 0; i < ns; i++) {
@@ -100,22 +150,6 @@ bool *prepd = NULL;
 
     }/*THEN*/
 
-    /* prepare the cumulative probabilities only for the conditional
-       distributions we are effectively sampling from. */
-    if (!prepd[conf[i]]) {
-
-      /* sort the probabilities in descending order. */
-      for (j = 0; j < nprobs; j++)
-        values[CMC(j, conf[i], nprobs)] = j + 1;
-      revsort(probs + conf[i] * nprobs, values + conf[i] * nprobs, nprobs);
-      /* compute cumulative probabilities. */
-      for (j = 1 ; j < nprobs; j++)
-        probs[CMC(j, conf[i], nprobs)] += probs[CMC(j - 1, conf[i], nprobs)];
-      /* flag the conditional distribution to avoid preparing it again. */
-      prepd[conf[i]] = TRUE;
-
-    }/*FOR*/
-
     /* check whether the conditional distribution is missing. */
     if (ISNAN(probs[CMC(0, conf[i], nprobs)])) {
 
@@ -125,17 +159,22 @@ bool *prepd = NULL;
 
     }/*THEN*/
 
-    rU = unif_rand();
+    /* prepare the alias table the first time the conditional distribution is
+     * sampled from. */
+    if (!prepd[conf[i]]) {
 
-    for (j = 0; j < nprobs; j++)
-      if (rU <= probs[CMC(j, conf[i], nprobs)])
-        break;
+      c_alias_table(probs + conf[i] * nprobs, nprobs,
+        values + conf[i] * nprobs, work);
+      prepd[conf[i]] = TRUE;
 
-    samples[i] = values[CMC(j, conf[i], nprobs)];
+    }/*THEN*/
+
+    samples[i] = c_alias_draw(probs + conf[i] * nprobs,
+                   values + conf[i] * nprobs, nprobs, unif_rand()) + 1;
 
   }/*FOR*/
 
   Free1D(prepd);
+  Free1D(work);
 
 }/*CONDPROBSAMPLEREPLACE*/
-
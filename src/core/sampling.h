@@ -4,6 +4,8 @@
 void SampleNoReplace(int k, int n, int *y, int *x);
 #define RandomPermutation(n, y, x) SampleNoReplace(n, n, y, x)
 void SampleReplace(int k, int n, int *y, int *x);
+void c_alias_table(double *probs, int nprobs, int *alias, int *work);
+int c_alias_draw(double *probs, int *alias, int nprobs, double u);
 void ProbSampleReplace(int n, double *probs, int *values, int ns, int *samples);
 void CondProbSampleReplace(int nprobs, int nconf, double *probs, int *conf,
     int *values, int ns, int *samples, bool *warn);
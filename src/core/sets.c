@@ -217,3 +217,315 @@ long long *cumlevels = NULL, nl = 0;
 
 }/*C_FAST_CONFIG*/
 
+/* hash the values of a row of a set of factors. */
+static unsigned long long row_hash(int **columns, int ncol, int row) {
+
+unsigned long long h = 1469598103934665603ULL;
+
+  for (int j = 0; j < ncol; j++) {
+
+    h ^= (unsigned int)columns[j][row];
+    h *= 1099511628211ULL;
+
+  }/*FOR*/
+
+  return h ^ (h >> 29);
+
+}/*ROW_HASH*/
+
+/* assign consecutive integer codes to the configurations of a set of factors
+ * that are actually observed in the data, in order of appearance, using an
+ * open-addressing hash table over the rows. Unlike c_fast_config(), this never
+ * overflows regardless of the number of possible configurations. Returns the
+ * number of observed configurations. */
+int c_sparse_config(int **columns, int nrow, int ncol, int *configurations,
+    int offset) {
+
+int i = 0, j = 0, nobs = 0, *slot_row = NULL, *slot_cfg = NULL;
+size_t size = 16, mask = 0, pos = 0;
+bool match = FALSE;
+
+  /* the hash table is at least twice as large as the number of rows, to keep
+   * probe sequences short. */
+  while (size < 2 * (size_t)nrow)
+    size <<= 1;
+  mask = size - 1;
+
+  slot_row = Calloc1D(size, sizeof(int));
+  slot_cfg = Calloc1D(size, sizeof(int));
+  for (pos = 0; pos < size; pos++)
+    slot_row[pos] = -1;
+
+  for (i = 0; i < nrow; i++) {
+
+    /* configurations with missing values are missing. */
+    for (j = 0; j < ncol; j++)
+      if (columns[j][i] == NA_INTEGER)
+        break;
+
+    if (j < ncol) {
+
+      configurations[i] = NA_INTEGER;
+      continue;
+
+    }/*THEN*/
+
+    /* linear probing until either a matching row or an empty slot is found. */
+    for (pos = row_hash(columns, ncol, i) & mask; ; pos = (pos + 1) & mask) {
+
+      if (slot_row[pos] < 0) {
+
+        slot_row[pos] = i;
+        slot_cfg[pos] = nobs++;
+        break;
+
+      }/*THEN*/
+
+      for (j = 0, match = TRUE; j < ncol; j++)
+        if (columns[j][slot_row[pos]] != columns[j][i]) {
+
+          match = FALSE;
+          break;
+
+        }/*THEN*/
+
+      if (match)
+        break;
+
+    }/*FOR*/
+
+    configurations[i] = slot_cfg[pos] + offset;
+
+  }/*FOR*/
+
+  Free1D(slot_row);
+  Free1D(slot_cfg);
+
+  return nobs;
+
+}/*C_SPARSE_CONFIG*/
+
+/* configurations of the conditioning variables of a test: the same as
+ * c_fast_config() if the number of possible configurations fits in an integer,
+ * otherwise only the observed configurations are coded. Returns FALSE in the
+ * latter case. */
+bool c_test_config(int **columns, int nrow, int ncol, int *levels,
+    int *configurations, int *nlevels, int offset) {
+
+double nl = 1;
+
+  for (int j = 0; j < ncol; j++)
+    nl *= levels[j];
+
+  if (nl < INT_MAX) {
+
+    c_fast_config(columns, nrow, ncol, levels, configurations, nlevels, offset);
+
+    return TRUE;
+
+  }/*THEN*/
+
+  *nlevels = c_sparse_config(columns, nrow, ncol, configurations, offset);
+
+  return FALSE;
+
+}/*C_TEST_CONFIG*/
+
+
+/* (re)compute the mixed-radix configurations of the factors that have not
+ * been dropped, or flag them as sparse if their number does not fit in an
+ * integer. */
+static void rconfig_fill(rconfig *rc) {
+
+int i = 0, j = 0;
+double nl = 1;
+
+  for (j = 0; j < (*rc).ncol; j++)
+    if (!(*rc).dropped[j])
+      nl *= (*rc).nlvl[j];
+
+  (*rc).sparse = (nl >= INT_MAX);
+  if ((*rc).sparse)
+    return;
+
+  /* compute the place values... */
+  for (j = 0, nl = 1; j < (*rc).ncol; j++) {
+
+    if ((*rc).dropped[j])
+      continue;
+
+    (*rc).stride[j] = (int)nl;
+    nl *= (*rc).nlvl[j];
+
+  }/*FOR*/
+
+  (*rc).nl = (int)nl;
+
+  /* ... and the configurations. */
+  memset((*rc).cfg, '\0', (*rc).nrow * sizeof(int));
+  memset((*rc).nmissing, '\0', (*rc).nrow * sizeof(int));
+
+  for (j = 0; j < (*rc).ncol; j++) {
+
+    if ((*rc).dropped[j])
+      continue;
+
+    for (i = 0; i < (*rc).nrow; i++) {
+
+      if ((*rc).columns[j][i] == NA_INTEGER)
+        (*rc).nmissing[i]++;
+      else
+        (*rc).cfg[i] += ((*rc).columns[j][i] - 1) * (*rc).stride[j];
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+}/*RCONFIG_FILL*/
+
+/* compute the configurations of a set of factors as mixed-radix numbers and
+ * keep track of the place value of each factor, so that factors can later be
+ * removed one at a time without recomputing the configurations from scratch.
+ * Missing values contribute a zero digit and are counted separately. If the
+ * number of possible configurations does not fit in an integer, only the
+ * observed ones are coded and they are recomputed as needed. */
+rconfig new_rconfig(int **columns, int nrow, int ncol, int *levels) {
+
+rconfig rc = { 0 };
+
+  rc.nrow = nrow;
+  rc.ncol = ncol;
+  rc.columns = columns;
+  rc.cfg = Calloc1D(nrow, sizeof(int));
+  rc.nmissing = Calloc1D(nrow, sizeof(int));
+  rc.stride = Calloc1D(ncol, sizeof(int));
+  rc.nlvl = Calloc1D(ncol, sizeof(int));
+  rc.dropped = Calloc1D(ncol, sizeof(bool));
+  memcpy(rc.nlvl, levels, ncol * sizeof(int));
+
+  rconfig_fill(&rc);
+
+  return rc;
+
+}/*NEW_RCONFIG*/
+
+/* sparse configurations of the factors that have not been dropped, except
+ * (optionally) the one in the j-th position. */
+static int rconfig_sparse(rconfig rc, int j, int *configurations, int offset) {
+
+int k = 0, ncol = 0, nobs = 0, **columns = NULL;
+
+  columns = Calloc1D(rc.ncol, sizeof(int *));
+  for (k = 0; k < rc.ncol; k++)
+    if (!rc.dropped[k] && (k != j))
+      columns[ncol++] = rc.columns[k];
+
+  nobs = c_sparse_config(columns, rc.nrow, ncol, configurations, offset);
+
+  Free1D(columns);
+
+  return nobs;
+
+}/*RCONFIG_SPARSE*/
+
+/* compute the configurations of all the factors that have not been dropped,
+ * minus the one in the j-th position, in the same format as c_fast_config(). */
+void rconfig_without(rconfig rc, int j, int *configurations, int *nlevels,
+    int offset) {
+
+int i = 0, *xx = rc.columns[j];
+int lo = rc.stride[j], hi = rc.stride[j] * rc.nlvl[j];
+
+  if (rc.sparse) {
+
+    i = rconfig_sparse(rc, j, configurations, offset);
+    if (nlevels)
+      *nlevels = i;
+
+    return;
+
+  }/*THEN*/
+
+  if (nlevels)
+    *nlevels = rc.nl / rc.nlvl[j];
+
+  /* remove the digit of the j-th factor from each configuration: the lower
+   * digits are the remainder of the division by its place value, the higher
+   * digits shift down by one position. */
+  for (i = 0; i < rc.nrow; i++) {
+
+    if (rc.nmissing[i] - (xx[i] == NA_INTEGER) > 0)
+      configurations[i] = NA_INTEGER;
+    else
+      configurations[i] = rc.cfg[i] % lo + (rc.cfg[i] / hi) * lo + offset;
+
+  }/*FOR*/
+
+}/*RCONFIG_WITHOUT*/
+
+/* permanently remove the factor in the j-th position from the configurations. */
+void rconfig_drop(rconfig *rc, int j) {
+
+int i = 0, k = 0, *xx = (*rc).columns[j];
+int lo = (*rc).stride[j], hi = (*rc).stride[j] * (*rc).nlvl[j];
+
+  /* sparse configurations are recomputed from scratch, and may become dense
+   * again once there are few enough possible configurations. */
+  if ((*rc).sparse) {
+
+    (*rc).dropped[j] = TRUE;
+    rconfig_fill(rc);
+
+    return;
+
+  }/*THEN*/
+
+  for (i = 0; i < (*rc).nrow; i++) {
+
+    (*rc).cfg[i] = (*rc).cfg[i] % lo + ((*rc).cfg[i] / hi) * lo;
+    if (xx[i] == NA_INTEGER)
+      (*rc).nmissing[i]--;
+
+  }/*FOR*/
+
+  /* the place values of the factors that follow the dropped one shrink. */
+  for (k = 0; k < (*rc).ncol; k++)
+    if (!(*rc).dropped[k] && ((*rc).stride[k] > lo))
+      (*rc).stride[k] /= (*rc).nlvl[j];
+
+  (*rc).nl /= (*rc).nlvl[j];
+  (*rc).dropped[j] = TRUE;
+
+}/*RCONFIG_DROP*/
+
+/* compute the configurations of all the factors that have not been dropped. */
+void rconfig_current(rconfig rc, int *configurations, int *nlevels,
+    int offset) {
+
+  if (rc.sparse) {
+
+    int nobs = rconfig_sparse(rc, -1, configurations, offset);
+    if (nlevels)
+      *nlevels = nobs;
+
+    return;
+
+  }/*THEN*/
+
+  if (nlevels)
+    *nlevels = rc.nl;
+
+  for (int i = 0; i < rc.nrow; i++)
+    configurations[i] = (rc.nmissing[i] > 0) ? NA_INTEGER : rc.cfg[i] + offset;
+
+}/*RCONFIG_CURRENT*/
+
+void FreeRCONFIG(rconfig rc) {
+
+  Free1D(rc.cfg);
+  Free1D(rc.nmissing);
+  Free1D(rc.stride);
+  Free1D(rc.nlvl);
+  Free1D(rc.dropped);
+
+}/*FREERCONFIG*/
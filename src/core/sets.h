@@ -1,11 +1,40 @@
 #ifndef SETS_HEADER
 #define SETS_HEADER
 
+/* configurations of a set of factors, stored as mixed-radix numbers so that
+ * factors can be removed one at a time. */
+typedef struct {
+
+  int nrow;       /* number of observations. */
+  int ncol;       /* number of factors. */
+  int nl;         /* number of possible configurations. */
+  int **columns;  /* pointers to the factors (not owned). */
+  int *cfg;       /* configurations, with missing values as zero digits. */
+  int *nmissing;  /* number of missing values in each observation. */
+  int *stride;    /* place values of the factors. */
+  int *nlvl;      /* number of levels of the factors. */
+  bool *dropped;  /* whether the factors have been removed. */
+  bool sparse;    /* whether only the observed configurations are coded. */
+
+} rconfig;
+
 void cfg(SEXP parents, int *configurations, int *nlevels);
 void c_fast_config(int **columns, int nrow, int ncol, int *levels,
     int *configurations, int *nlevels, int offset);
+int c_sparse_config(int **columns, int nrow, int ncol, int *configurations,
+    int offset);
+bool c_test_config(int **columns, int nrow, int ncol, int *levels,
+    int *configurations, int *nlevels, int offset);
 SEXP c_configurations(SEXP parents, int factor, int all_levels);
 
+rconfig new_rconfig(int **columns, int nrow, int ncol, int *levels);
+void rconfig_without(rconfig rc, int j, int *configurations, int *nlevels,
+    int offset);
+void rconfig_drop(rconfig *rc, int j);
+void rconfig_current(rconfig rc, int *configurations, int *nlevels,
+    int offset);
+void FreeRCONFIG(rconfig rc);
+
 void first_subset(int *work, int n, int offset);
 int next_subset(int *work, int n, int max, int offset);
 
@@ -0,0 +1,209 @@
+#include "../include/rcore.h"
+#include "../core/allocations.h"
+#include "../core/sampling.h"
+#include "../include/graph.h"
+#include "compiled.h"
+
+/* the last network that was compiled, wrapped in an external pointer that also
+ * protects the bn.fit object the local distributions point into. */
+static SEXP last_compiled = NULL;
+
+/* free a compiled network, including the fitted_bn it is built on. */
+static void FreeCompiledBN(compiled_bn *plan) {
+
+  for (int i = 0; i < (*plan).bn.nnodes; i++) {
+
+    Free1D((*plan).cumlevels[i]);
+    Free1D((*plan).aprobs[i]);
+    Free1D((*plan).alias[i]);
+    Free1D((*plan).undefined[i]);
+
+  }/*FOR*/
+
+  Free1D((*plan).nodes);
+  Free1D((*plan).poset);
+  Free1D((*plan).nlevels);
+  Free1D((*plan).nconfigs);
+  Free1D((*plan).cumlevels);
+  Free1D((*plan).aprobs);
+  Free1D((*plan).alias);
+  Free1D((*plan).undefined);
+  FreeJTREE((*plan).jt);
+  FreeGPREC((*plan).gp);
+  FreeFittedBN((*plan).bn);
+  Free1D(plan);
+
+}/*FREECOMPILEDBN*/
+
+static void compiled_network_finalizer(SEXP ptr) {
+
+compiled_bn *plan = R_ExternalPtrAddr(ptr);
+
+  if (!plan)
+    return;
+
+  FreeCompiledBN(plan);
+  R_ClearExternalPtr(ptr);
+
+}/*COMPILED_NETWORK_FINALIZER*/
+
+/* compute the cumulative products of the number of levels of a set of discrete
+ * parents, in the same order as c_fast_config(). */
+static int *parents_cumlevels(compiled_bn *plan, int *parents, int nparents,
+    int *nconfigs) {
+
+int *cumlevels = Calloc1D(nparents, sizeof(int));
+long long nl = 1;
+
+  for (int j = 0; j < nparents; j++) {
+
+    cumlevels[j] = (int)nl;
+    nl *= (*plan).bn.ldists[parents[j]].d.dims[0];
+
+    if (nl >= INT_MAX)
+      error("attempting to create a factor with more than INT_MAX levels.");
+
+  }/*FOR*/
+
+  *nconfigs = (int)nl;
+
+  return cumlevels;
+
+}/*PARENTS_CUMLEVELS*/
+
+/* build the alias tables for all the conditional distributions in a CPT. */
+static void compile_discrete_node(compiled_bn *plan, int cur) {
+
+ldist *ld = (*plan).bn.ldists + cur;
+int nl = (*ld).d.dims[0], nc = 1, *work = NULL;
+
+  (*plan).nlevels[cur] = nl;
+  (*plan).cumlevels[cur] =
+    parents_cumlevels(plan, (*ld).parents, (*ld).nparents, &nc);
+  (*plan).nconfigs[cur] = nc;
+
+  (*plan).aprobs[cur] = Calloc1D((size_t)nl * nc, sizeof(double));
+  (*plan).alias[cur] = Calloc1D((size_t)nl * nc, sizeof(int));
+  (*plan).undefined[cur] = Calloc1D(nc, sizeof(bool));
+  memcpy((*plan).aprobs[cur], (*ld).d.cpt, (size_t)nl * nc * sizeof(double));
+
+  work = Calloc1D(nl, sizeof(int));
+
+  for (int k = 0; k < nc; k++) {
+
+    /* conditional distributions that were not estimated produce missing
+     * values, as in CondProbSampleReplace(). */
+    if (ISNAN((*plan).aprobs[cur][(size_t)k * nl])) {
+
+      (*plan).undefined[cur][k] = TRUE;
+      continue;
+
+    }/*THEN*/
+
+    c_alias_table((*plan).aprobs[cur] + (size_t)k * nl, nl,
+      (*plan).alias[cur] + (size_t)k * nl, work);
+
+  }/*FOR*/
+
+  Free1D(work);
+
+}/*COMPILE_DISCRETE_NODE*/
+
+/* compile a fitted network into a plan for simulation. */
+static compiled_bn *compile_network(SEXP fitted) {
+
+int nnodes = length(fitted);
+compiled_bn *plan = Calloc1D(1, sizeof(compiled_bn));
+
+  (*plan).bn = fitted_network_from_SEXP(fitted);
+  (*plan).nodes = Calloc1D(nnodes, sizeof(SEXP));
+  (*plan).poset = Calloc1D(nnodes, sizeof(int));
+  (*plan).nlevels = Calloc1D(nnodes, sizeof(int));
+  (*plan).nconfigs = Calloc1D(nnodes, sizeof(int));
+  (*plan).cumlevels = Calloc1D(nnodes, sizeof(int *));
+  (*plan).aprobs = Calloc1D(nnodes, sizeof(double *));
+  (*plan).alias = Calloc1D(nnodes, sizeof(int *));
+  (*plan).undefined = Calloc1D(nnodes, sizeof(bool *));
+
+  for (int i = 0; i < nnodes; i++)
+    (*plan).nodes[i] = VECTOR_ELT(fitted, i);
+
+  /* order the nodes according to their depth in the graph. */
+  topological_sort(fitted, (*plan).poset, nnodes);
+
+  /* discrete nodes must be compiled first, because the number of levels of
+   * discrete parents is needed by conditional Gaussian nodes. */
+  for (int i = 0; i < nnodes; i++)
+    if (((*plan).bn.node_types[i] == DNODE) ||
+        ((*plan).bn.node_types[i] == ONODE))
+      compile_discrete_node(plan, i);
+
+  for (int i = 0; i < nnodes; i++) {
+
+    if ((*plan).bn.node_types[i] != CGNODE)
+      continue;
+
+    (*plan).cumlevels[i] = parents_cumlevels(plan,
+      (*plan).bn.ldists[i].cg.dparents, (*plan).bn.ldists[i].cg.ndparents,
+      (*plan).nconfigs + i);
+
+  }/*FOR*/
+
+  return plan;
+
+}/*COMPILE_NETWORK*/
+
+/* check whether a compiled network still matches the bn.fit object. */
+static bool compiled_network_matches(SEXP ptr, SEXP fitted) {
+
+compiled_bn *plan = R_ExternalPtrAddr(ptr);
+
+  if (!plan || (R_ExternalPtrProtected(ptr) != fitted))
+    return FALSE;
+  if ((*plan).bn.nnodes != length(fitted))
+    return FALSE;
+
+  for (int i = 0; i < (*plan).bn.nnodes; i++)
+    if ((*plan).nodes[i] != VECTOR_ELT(fitted, i))
+      return FALSE;
+
+  return TRUE;
+
+}/*COMPILED_NETWORK_MATCHES*/
+
+/* return the compiled version of a fitted network, reusing the last one if the
+ * network has not changed in the meantime. */
+compiled_bn *compiled_network(SEXP fitted) {
+
+SEXP ptr;
+
+  if (last_compiled && compiled_network_matches(last_compiled, fitted))
+    return R_ExternalPtrAddr(last_compiled);
+
+  /* the external pointer keeps the bn.fit object alive, since the compiled
+   * network points into its local distributions. */
+  PROTECT(ptr = R_MakeExternalPtr(compile_network(fitted), R_NilValue, fitted));
+  R_RegisterCFinalizerEx(ptr, compiled_network_finalizer, TRUE);
+
+  compiled_network_release();
+  R_PreserveObject(ptr);
+  last_compiled = ptr;
+
+  UNPROTECT(1);
+
+  return R_ExternalPtrAddr(ptr);
+
+}/*COMPILED_NETWORK*/
+
+/* drop the last compiled network, freeing it right away so that no finalizer
+ * is left pointing into the shared library after it is unloaded. */
+void compiled_network_release(void) {
+
+  if (!last_compiled)
+    return;
+
+  compiled_network_finalizer(last_compiled);
+  R_ReleaseObject(last_compiled);
+  last_compiled = NULL;
+
+}/*COMPILED_NETWORK_RELEASE*/
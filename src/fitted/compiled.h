@@ -0,0 +1,34 @@
+#ifndef COMPILED_NETWORK_HEADER
+#define COMPILED_NETWORK_HEADER
+
+#include "fitted.h"
+#include "../inference/junction.tree.h"
+#include "../inference/gaussian.precision.h"
+
+/* a fitted Bayesian network compiled for simulation: everything that does not
+ * depend on the number of observations or on the evidence is computed once and
+ * reused across calls. */
+typedef struct {
+
+  fitted_bn bn;      /* local distributions, pointing into the bn.fit object. */
+  SEXP *nodes;       /* the local distributions in the bn.fit object, to detect
+                      * changes. */
+  int *poset;        /* topological ordering of the nodes. */
+  int *nlevels;      /* number of levels of discrete nodes. */
+  int *nconfigs;     /* number of configurations of the discrete parents. */
+  int **cumlevels;   /* cumulative products of the number of levels of the
+                      * discrete parents, to compute their configurations. */
+  double **aprobs;   /* alias tables of discrete nodes (keep probabilities), one
+                      * for each configuration of the parents. */
+  int **alias;       /* alias tables of discrete nodes (alias outcomes). */
+  bool **undefined;  /* conditional distributions with missing probabilities. */
+  jtree *jt;         /* junction tree for exact inference, built on demand. */
+  gprec *gp;         /* precision matrix for exact inference, built on
+                      * demand. */
+
+} compiled_bn;
+
+compiled_bn *compiled_network(SEXP fitted);
+void compiled_network_release(void);
+
+#endif
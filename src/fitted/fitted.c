@@ -87,6 +87,35 @@ SEXP temp, nodes_in_fitted_bn, cur_node, parents;
 
 }/*FITTED_NETWORK_FROM_SEXP*/
 
+/* compute the logarithms of the conditional probability tables of the discrete
+ * nodes once, so that they can be looked up instead of calling log() for each
+ * observation. */
+void fitted_network_logcpt(fitted_bn *bn) {
+
+int ncells = 0;
+ldist *ld = NULL;
+
+  for (int i = 0; i < (*bn).nnodes; i++) {
+
+    if (((*bn).node_types[i] != DNODE) && ((*bn).node_types[i] != ONODE))
+      continue;
+
+    ld = (*bn).ldists + i;
+    if ((*ld).d.logcpt)
+      continue;
+
+    ncells = 1;
+    for (int j = 0; j < (*ld).d.ndims; j++)
+      ncells *= (*ld).d.dims[j];
+
+    (*ld).d.logcpt = Calloc1D(ncells, sizeof(double));
+    for (int j = 0; j < ncells; j++)
+      (*ld).d.logcpt[j] = log((*ld).d.cpt[j]);
+
+  }/*FOR*/
+
+}/*FITTED_NETWORK_LOGCPT*/
+
 /* print a short summary of a fitted_bn data structure. */
 void print_fitted_network(fitted_bn bn) {
 
@@ -194,6 +223,11 @@ void FreeFittedBN(fitted_bn bn) {
       Free1D(bn.ldists[i].cg.gparents);
 
     }/*THEN*/
+    else if ((bn.node_types[i] == DNODE) || (bn.node_types[i] == ONODE)) {
+
+      Free1D(bn.ldists[i].d.logcpt);
+
+    }/*THEN*/
 
   }/*THEN*/
   Free1D(bn.node_types);
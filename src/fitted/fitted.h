@@ -36,6 +36,7 @@ typedef struct {
       int ndims;       /* number of dimensions of the CPT. */
       int *dims;       /* dimensions of the CPT. */
       double *cpt;     /* conditional probability table. */
+      double *logcpt;  /* its logarithm, only when needed (NULL otherwise). */
 
     } d;
 
@@ -76,6 +77,7 @@ typedef struct {
 } fitted_bn;
 
 fitted_bn fitted_network_from_SEXP(SEXP fitted);
+void fitted_network_logcpt(fitted_bn *bn);
 void print_fitted_network(fitted_bn);
 void FreeFittedBN(fitted_bn bn);
 
@@ -1,5 +1,7 @@
 #include "include/rcore.h"
 #include "include/register.h"
+#include "fitted/compiled.h"
+#include "predict/compiled.predictor.h"
 #include <R_ext/Rdynload.h>
 
 SEXP BN_ModelstringSymbol;
@@ -7,6 +9,7 @@ SEXP BN_NodesSymbol;
 SEXP BN_ProbSymbol;
 SEXP BN_MethodSymbol;
 SEXP BN_WeightsSymbol;
+SEXP BN_EssSymbol;
 SEXP BN_DsepsetSymbol;
 SEXP BN_MetaDataSymbol;
 SEXP TRUESEXP, FALSESEXP;
@@ -21,6 +24,7 @@ SEXP onLoad(void) {
   BN_ProbSymbol = install("prob");
   BN_MethodSymbol = install("method");
   BN_WeightsSymbol = install("weights");
+  BN_EssSymbol = install("ess");
   BN_DsepsetSymbol = install("dsep.set");
   BN_MetaDataSymbol = install("metadata");
   TRUESEXP = ScalarLogical(TRUE);
@@ -34,6 +38,8 @@ SEXP onLoad(void) {
 
 SEXP onUnload(void) {
 
+  compiled_network_release();
+  compiled_predictors_release();
   R_ReleaseObject(TRUESEXP);
   R_ReleaseObject(FALSESEXP);
 
@@ -45,6 +51,7 @@ SEXP onUnload(void) {
   {"call_"#fun,                (DL_FUNC) &fun,                 args}
 
 static const R_CallMethodDef CallEntries[] = {
+  CALL_ENTRY(ais_particles, 7),
   CALL_ENTRY(all_equal_bn, 2),
   CALL_ENTRY(allsubs_test, 12),
   CALL_ENTRY(alpha_star, 3),
@@ -61,8 +68,8 @@ static const R_CallMethodDef CallEntries[] = {
   CALL_ENTRY(cache_partial_structure, 4),
   CALL_ENTRY(cache_structure, 3),
   CALL_ENTRY(castelo_completion, 3),
-  CALL_ENTRY(ccgpred, 4),
-  CALL_ENTRY(cdpred, 4),
+  CALL_ENTRY(ccgpred, 5),
+  CALL_ENTRY(cdpred, 5),
   CALL_ENTRY(cg_banned_arcs, 2),
   CALL_ENTRY(cgpred, 3),
   CALL_ENTRY(cgsd, 3),
@@ -89,7 +96,9 @@ static const R_CallMethodDef CallEntries[] = {
   CALL_ENTRY(fitted_vs_data, 3),
   CALL_ENTRY(gaussian_ols_parameters, 6),
   CALL_ENTRY(get_test_counter, 0),
+  CALL_ENTRY(gibbs_particles, 8),
   CALL_ENTRY(gpred, 3),
+  CALL_ENTRY(gprecpred, 5),
   CALL_ENTRY(has_pdag_path, 8),
   CALL_ENTRY(hc_opt_step, 10),
   CALL_ENTRY(hc_to_be_added, 7),
@@ -102,17 +111,20 @@ static const R_CallMethodDef CallEntries[] = {
   CALL_ENTRY(is_pdag_acyclic, 5),
   CALL_ENTRY(is_row_equal, 2),
   CALL_ENTRY(joint_discretize, 7),
+  CALL_ENTRY(jtpred, 6),
+  CALL_ENTRY(lbp_beliefs, 7),
   CALL_ENTRY(loglikelihood_function, 6),
-  CALL_ENTRY(lw_weights, 4),
-  CALL_ENTRY(mappred, 7),
+  CALL_ENTRY(lw_particles, 5),
+  CALL_ENTRY(mappred, 8),
   CALL_ENTRY(marginal_discretize, 5),
   CALL_ENTRY(match_brace, 4),
   CALL_ENTRY(mean_strength, 3),
   CALL_ENTRY(minimal_data_frame, 1),
   CALL_ENTRY(minimal_table, 2),
   CALL_ENTRY(mixture_gaussian_ols_parameters, 7),
-  CALL_ENTRY(naivepred, 7),
+  CALL_ENTRY(naivepred, 8),
   CALL_ENTRY(nbr2arcs, 1),
+  CALL_ENTRY(network_parameters, 10),
   CALL_ENTRY(normalize_cpt, 1),
   CALL_ENTRY(nparams_cgnet, 3),
   CALL_ENTRY(nparams_fitted, 3),
@@ -123,7 +135,7 @@ static const R_CallMethodDef CallEntries[] = {
   CALL_ENTRY(pdag_extension, 3),
   CALL_ENTRY(pdag2dag, 2),
   CALL_ENTRY(per_node_score, 6),
-  CALL_ENTRY(rbn_master, 4),
+  CALL_ENTRY(rbn_master, 5),
   CALL_ENTRY(reset_test_counter, 0),
   CALL_ENTRY(root_nodes, 2),
   CALL_ENTRY(roundrobin_test, 9),
@@ -131,6 +143,7 @@ static const R_CallMethodDef CallEntries[] = {
   CALL_ENTRY(score_delta, 9),
   CALL_ENTRY(shd, 3),
   CALL_ENTRY(smart_network_averaging, 3),
+  CALL_ENTRY(stream_loglikelihood, 7),
   CALL_ENTRY(subsets, 2),
   CALL_ENTRY(tabu_hash, 4),
   CALL_ENTRY(tabu_step, 13),
@@ -138,6 +151,7 @@ static const R_CallMethodDef CallEntries[] = {
   CALL_ENTRY(topological_ordering, 4),
   CALL_ENTRY(tree_directions, 4),
   CALL_ENTRY(unique_arcs, 3),
+  CALL_ENTRY(update_parameters, 7),
   CALL_ENTRY(which_undirected, 2),
   {NULL, NULL, 0}
 };
@@ -1,5 +1,10 @@
+#include "../fitted/fitted.h"
 
 /* from cache.structure.c */
 SEXP cache_structure(SEXP nodes, SEXP amat, SEXP debug);
 SEXP cache_node_structure(int cur, SEXP nodes, int *amat, int nrow,
     int *status, bool debugging);
+
+/* from fitted.c */
+void c_fitted_mb_factors(fitted_bn bn, int **start, int **factors,
+    int **position);
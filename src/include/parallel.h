@@ -0,0 +1,17 @@
+#ifndef PARALLEL_HEADER
+#define PARALLEL_HEADER
+
+/* OpenMP is optional: without it, everything runs in a single thread. Code
+ * running inside parallel regions must not call the R API (no allocations
+ * through R, no warnings, no errors, no printing): scratch spaces are allocated
+ * per-thread beforehand and messages are deferred until the region ends. */
+#ifdef _OPENMP
+#include <omp.h>
+#define THREAD_ID omp_get_thread_num()
+#define MAX_THREADS omp_get_max_threads()
+#else
+#define THREAD_ID 0
+#define MAX_THREADS 1
+#endif
+
+#endif
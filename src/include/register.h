@@ -1,5 +1,6 @@
 
 /* functions registered to make them visible to .Call() in R. */
+extern SEXP ais_particles(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP all_equal_bn(SEXP, SEXP);
 extern SEXP allsubs_test(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP alpha_star(SEXP, SEXP, SEXP);
@@ -16,8 +17,8 @@ extern SEXP bootstrap_strength_counters(SEXP, SEXP, SEXP, SEXP);
 extern SEXP cache_partial_structure(SEXP, SEXP, SEXP, SEXP);
 extern SEXP cache_structure(SEXP, SEXP, SEXP);
 extern SEXP castelo_completion(SEXP, SEXP, SEXP);
-extern SEXP ccgpred(SEXP, SEXP, SEXP, SEXP);
-extern SEXP cdpred(SEXP, SEXP, SEXP, SEXP);
+extern SEXP ccgpred(SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP cdpred(SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP cg_banned_arcs(SEXP, SEXP);
 extern SEXP cgpred(SEXP, SEXP, SEXP);
 extern SEXP cgsd(SEXP, SEXP, SEXP);
@@ -44,7 +45,9 @@ extern SEXP fitted_mb(SEXP, SEXP);
 extern SEXP fitted_vs_data(SEXP, SEXP, SEXP);
 extern SEXP gaussian_ols_parameters(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP get_test_counter(void);
+extern SEXP gibbs_particles(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP gpred(SEXP, SEXP, SEXP);
+extern SEXP gprecpred(SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP has_pdag_path(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP hc_opt_step(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP hc_to_be_added(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
@@ -57,17 +60,20 @@ extern SEXP is_listed(SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP is_pdag_acyclic(SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP is_row_equal(SEXP, SEXP);
 extern SEXP joint_discretize(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP jtpred(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP lbp_beliefs(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP loglikelihood_function(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
-extern SEXP lw_weights(SEXP, SEXP, SEXP, SEXP);
-extern SEXP mappred(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP lw_particles(SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP mappred(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP marginal_discretize(SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP match_brace(SEXP, SEXP, SEXP, SEXP);
 extern SEXP mean_strength(SEXP, SEXP, SEXP);
 extern SEXP minimal_data_frame(SEXP);
 extern SEXP minimal_table(SEXP, SEXP);
 extern SEXP mixture_gaussian_ols_parameters(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
-extern SEXP naivepred(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP naivepred(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP nbr2arcs(SEXP);
+extern SEXP network_parameters(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP normalize_cpt(SEXP);
 extern SEXP nparams_cgnet(SEXP, SEXP, SEXP);
 extern SEXP nparams_fitted(SEXP, SEXP, SEXP);
@@ -78,7 +84,7 @@ extern SEXP ordered_graph(SEXP, SEXP, SEXP);
 extern SEXP pdag_extension(SEXP, SEXP, SEXP);
 extern SEXP pdag2dag(SEXP, SEXP);
 extern SEXP per_node_score(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
-extern SEXP rbn_master(SEXP, SEXP, SEXP, SEXP);
+extern SEXP rbn_master(SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP reset_test_counter(void);
 extern SEXP root_nodes(SEXP, SEXP);
 extern SEXP roundrobin_test(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
@@ -86,6 +92,7 @@ extern SEXP score_cache_fill(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEX
 extern SEXP score_delta(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP shd(SEXP, SEXP, SEXP);
 extern SEXP smart_network_averaging(SEXP, SEXP, SEXP);
+extern SEXP stream_loglikelihood(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP subsets(SEXP, SEXP);
 extern SEXP tabu_hash(SEXP, SEXP, SEXP, SEXP);
 extern SEXP tabu_step(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
@@ -93,5 +100,6 @@ extern SEXP tiers(SEXP, SEXP);
 extern SEXP topological_ordering(SEXP, SEXP, SEXP, SEXP);
 extern SEXP tree_directions(SEXP, SEXP, SEXP, SEXP);
 extern SEXP unique_arcs(SEXP, SEXP, SEXP);
+extern SEXP update_parameters(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP which_undirected(SEXP, SEXP);
 
@@ -0,0 +1,441 @@
+#include "../include/rcore.h"
+#include "../core/allocations.h"
+#include "../minimal/data.frame.h"
+#include "../minimal/common.h"
+#include "../include/globals.h"
+#include "adaptive.sampling.h"
+
+/* number of particles simulated at a time by c_ais_particles(), as in
+ * likelihood weighting. */
+#define AIS_CHUNK 8192
+/* the smallest probability of a level in an importance CPT is this divided by
+ * the number of levels, unless the level is impossible (epsilon-cutoff). */
+#define AIS_CUTOFF 0.1
+/* the learning rate decays from the first value to the second over the
+ * updates of the importance CPTs. */
+#define AIS_RATE_FIRST 0.4
+#define AIS_RATE_LAST  0.14
+
+/* draw from R's random number generator or from a random stream. */
+static inline double ais_unif(rng_stream *rng) {
+
+  return rng ? rng_stream_unif(rng) : unif_rand();
+
+}/*AIS_UNIF*/
+
+/* allocate the importance CPTs of all the discrete nodes; this is the only
+ * function that allocates memory, so that the others can be called from
+ * parallel regions. */
+ais_proposal *ais_alloc(compiled_bn *plan) {
+
+int i = 0, nnodes = (*plan).bn.nnodes;
+size_t size = 0;
+ais_proposal *q = Calloc1D(1, sizeof(ais_proposal));
+
+  (*q).nnodes = nnodes;
+  (*q).adapt = Calloc1D(nnodes, sizeof(bool));
+  (*q).icpt = Calloc1D(nnodes, sizeof(double *));
+  (*q).counts = Calloc1D(nnodes, sizeof(double *));
+
+  for (i = 0; i < nnodes; i++) {
+
+    if (((*plan).bn.node_types[i] != DNODE) &&
+        ((*plan).bn.node_types[i] != ONODE))
+      continue;
+
+    size = (size_t)(*plan).nlevels[i] * (*plan).nconfigs[i];
+    (*q).icpt[i] = Calloc1D(size, sizeof(double));
+    (*q).counts[i] = Calloc1D(size, sizeof(double));
+
+  }/*FOR*/
+
+  return q;
+
+}/*AIS_ALLOC*/
+
+/* make sure that no possible level has a vanishing importance probability,
+ * since particles with that level would have huge weights. */
+static void ais_cutoff(double *q, const double *p, int nl) {
+
+int l = 0;
+double theta = AIS_CUTOFF / nl, sum = 0;
+
+  for (l = 0; l < nl; l++) {
+
+    if (p[l] > 0)
+      q[l] = (q[l] < theta) ? theta : q[l];
+    else
+      q[l] = 0;
+
+    sum += q[l];
+
+  }/*FOR*/
+
+  for (l = 0; l < nl; l++)
+    q[l] /= sum;
+
+}/*AIS_CUTOFF*/
+
+/* initialize the importance CPTs for a given evidence: they start from the
+ * CPTs, but the parents of evidence nodes start from uniform distributions
+ * since the evidence is likely to be unlikely under their CPTs. */
+void ais_reset(compiled_bn *plan, ais_proposal *q, rbn_fixed *fixed) {
+
+int i = 0, j = 0, k = 0, l = 0, nl = 0, nnodes = (*plan).bn.nnodes;
+bool *evparent = (*q).adapt;
+const double *cpt = NULL;
+double *icpt = NULL;
+
+  /* mark the parents of the evidence nodes first... */
+  memset(evparent, '\0', nnodes * sizeof(bool));
+  for (i = 0; i < nnodes; i++)
+    if (fixed[i].n > 0)
+      for (j = 0; j < (*plan).bn.ldists[i].nparents; j++)
+        evparent[(*plan).bn.ldists[i].parents[j]] = TRUE;
+
+  for (i = 0; i < nnodes; i++) {
+
+    if (!(*q).icpt[i] || (fixed[i].n > 0)) {
+
+      (*q).adapt[i] = FALSE;
+      continue;
+
+    }/*THEN*/
+
+    nl = (*plan).nlevels[i];
+    cpt = (*plan).bn.ldists[i].d.cpt;
+    icpt = (*q).icpt[i];
+
+    for (k = 0; k < (*plan).nconfigs[i]; k++) {
+
+      /* conditional distributions that were not estimated stay that way, and
+       * produce missing values as in likelihood weighting. */
+      if (ISNAN(cpt[k * nl])) {
+
+        for (l = 0; l < nl; l++)
+          icpt[k * nl + l] = NA_REAL;
+
+        continue;
+
+      }/*THEN*/
+
+      for (l = 0; l < nl; l++)
+        icpt[k * nl + l] = evparent[i] ? 1 : cpt[k * nl + l];
+
+      ais_cutoff(icpt + k * nl, cpt + k * nl, nl);
+
+    }/*FOR*/
+
+    /* ... and then reuse the flags to mark the nodes that are adapted. */
+    (*q).adapt[i] = TRUE;
+
+  }/*FOR*/
+
+}/*AIS_RESET*/
+
+/* generate particles from the importance distribution, along with their
+ * log-weights. This does not touch the R API unless rng is NULL, so it can be
+ * called from parallel regions. */
+void ais_sample(compiled_bn *plan, ais_proposal *q, rbn_fixed *fixed,
+    void **cols, int len, double *lw, rng_stream *rng, bool *warn) {
+
+int i = 0, j = 0, l = 0, cur = 0, cfg = 0, nl = 0, *x = NULL;
+ldist *ld = NULL;
+double u = 0, *icpt = NULL;
+
+  memset(lw, '\0', len * sizeof(double));
+
+  for (j = 0; j < (*plan).bn.nnodes; j++) {
+
+    cur = (*plan).poset[j];
+
+    if (!(*q).adapt[cur]) {
+
+      rbn_node(plan, cols, fixed, cur, 0, len, rng, warn);
+
+      if (fixed[cur].n > 0)
+        lw_logdensity(plan, cols, cur, len, lw);
+
+      continue;
+
+    }/*THEN*/
+
+    ld = (*plan).bn.ldists + cur;
+    nl = (*plan).nlevels[cur];
+    x = cols[cur];
+
+    for (i = 0; i < len; i++) {
+
+      cfg = lw_config(cols, (*ld).parents, (*plan).cumlevels[cur],
+              (*ld).nparents, i);
+
+      if ((cfg == NA_INTEGER) || ISNAN((*q).icpt[cur][cfg * nl])) {
+
+        x[i] = NA_INTEGER;
+        lw[i] += NA_REAL;
+        warn[cur] = TRUE;
+        continue;
+
+      }/*THEN*/
+
+      /* inversion sampling from the importance CPT. */
+      icpt = (*q).icpt[cur] + cfg * nl;
+      u = ais_unif(rng);
+      for (l = 0; l < nl - 1; l++) {
+
+        u -= icpt[l];
+        if ((u < 0) && (icpt[l] > 0))
+          break;
+
+      }/*FOR*/
+      while ((l > 0) && (icpt[l] == 0))
+        l--;
+
+      x[i] = l + 1;
+      lw[i] += log((*ld).d.cpt[cfg * nl + l]) - log(icpt[l]);
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+}/*AIS_SAMPLE*/
+
+/* effective sample size of a set of weighted particles. */
+double ais_ess(double *w, int n) {
+
+long double sum = 0, sum2 = 0;
+
+  for (int i = 0; i < n; i++) {
+
+    if (ISNAN(w[i]))
+      continue;
+
+    sum += w[i];
+    sum2 += w[i] * w[i];
+
+  }/*FOR*/
+
+  return (sum2 > 0) ? (double)(sum * sum / sum2) : 0;
+
+}/*AIS_ESS*/
+
+/* learn the importance CPTs: at each update, generate a set of particles from
+ * the current importance distribution and move the importance CPTs towards the
+ * posterior frequencies they estimate. This does not touch the R API unless
+ * rng is NULL or debugging is TRUE. */
+void ais_learn(compiled_bn *plan, ais_proposal *q, rbn_fixed *fixed,
+    void **cols, int len, double *w, int updates, rng_stream *rng, bool *warn,
+    bool debugging) {
+
+int i = 0, j = 0, k = 0, l = 0, t = 0, cfg = 0, nl = 0, *x = NULL;
+ldist *ld = NULL;
+double rate = 0, tot = 0, *counts = NULL, *icpt = NULL;
+const double *cpt = NULL;
+
+  for (t = 0; t < updates; t++) {
+
+    ais_sample(plan, q, fixed, cols, len, w, rng, warn);
+    lw_rescale(w, len);
+    (*q).ess = ais_ess(w, len);
+
+    if (debugging)
+      Rprintf("  > update %d of the importance distribution, effective sample size %.2lf.\n",
+        t + 1, (*q).ess);
+
+    /* if all weights are zero, there is nothing to learn from. */
+    if ((*q).ess == 0)
+      continue;
+
+    rate = AIS_RATE_FIRST *
+             pow(AIS_RATE_LAST / AIS_RATE_FIRST, (double)t / updates);
+
+    for (j = 0; j < (*plan).bn.nnodes; j++) {
+
+      if (!(*q).adapt[j])
+        continue;
+
+      ld = (*plan).bn.ldists + j;
+      nl = (*plan).nlevels[j];
+      x = cols[j];
+      cpt = (*ld).d.cpt;
+      counts = (*q).counts[j];
+      memset(counts, '\0', (size_t)nl * (*plan).nconfigs[j] * sizeof(double));
+
+      /* tabulate the weighted levels for each configuration of the parents. */
+      for (i = 0; i < len; i++) {
+
+        if ((x[i] == NA_INTEGER) || ISNAN(w[i]))
+          continue;
+
+        cfg = lw_config(cols, (*ld).parents, (*plan).cumlevels[j],
+                (*ld).nparents, i);
+        counts[cfg * nl + x[i] - 1] += w[i];
+
+      }/*FOR*/
+
+      for (k = 0; k < (*plan).nconfigs[j]; k++) {
+
+        icpt = (*q).icpt[j] + k * nl;
+
+        for (l = 0, tot = 0; l < nl; l++)
+          tot += counts[k * nl + l];
+
+        if (tot == 0)
+          continue;
+
+        for (l = 0; l < nl; l++)
+          icpt[l] += rate * (counts[k * nl + l] / tot - icpt[l]);
+
+        ais_cutoff(icpt, cpt + k * nl, nl);
+
+      }/*FOR*/
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+}/*AIS_LEARN*/
+
+void FreeAIS(ais_proposal *q) {
+
+  if (!q)
+    return;
+
+  for (int i = 0; i < (*q).nnodes; i++) {
+
+    Free1D((*q).icpt[i]);
+    Free1D((*q).counts[i]);
+
+  }/*FOR*/
+
+  Free1D((*q).adapt);
+  Free1D((*q).icpt);
+  Free1D((*q).counts);
+  Free1D(q);
+
+}/*FREEAIS*/
+
+/* generate particles and their importance weights with adaptive importance
+ * sampling: first learn the importance distribution from "updates" sets of
+ * "size" particles, then generate the particles that are returned from it. As
+ * in c_lw_particles(), only the columns of the nodes listed in "nodes" are
+ * returned. */
+SEXP c_ais_particles(SEXP fitted, SEXP nodes, int n, SEXP fix, int updates,
+    int size, bool debugging) {
+
+int i = 0, k = 0, from = 0, len = 0, chunk = 0, nkeep = 0, nnodes = 0;
+int *keep = NULL;
+size_t *csize = NULL;
+bool *warn = NULL;
+double *w = NULL, *scratch = NULL;
+void **cols = NULL, **out = NULL;
+compiled_bn *plan = NULL;
+rbn_fixed *fixed = NULL;
+ais_proposal *q = NULL;
+SEXP result, weights, try;
+
+  plan = compiled_network(fitted);
+  nnodes = (*plan).bn.nnodes;
+
+  for (i = 0; i < nnodes; i++)
+    if ((*plan).bn.node_types[i] == ENOFIT)
+      error("unknown node type (class: %s).",
+         CHAR(STRING_ELT(getAttrib(VECTOR_ELT(fitted, i), R_ClassSymbol), 0)));
+
+  /* allocate the return value, only for the nodes we were asked for. */
+  nkeep = length(nodes);
+  PROTECT(try = match(getAttrib(fitted, R_NamesSymbol), nodes, 0));
+  keep = INTEGER(try);
+  PROTECT(result = allocVector(VECSXP, nkeep));
+  for (k = 0; k < nkeep; k++)
+    SET_VECTOR_ELT(result, k, fitnode2df(fitted, STRING_ELT(nodes, k), n));
+  setAttrib(result, R_NamesSymbol, nodes);
+  if (nkeep > 0)
+    minimal_data_frame(result);
+  PROTECT(weights = allocVector(REALSXP, n));
+  w = REAL(weights);
+
+  /* match fixed nodes, if any, with the variables in the fitted network. */
+  fixed = rbn_match_fixed(plan, fitted, fix);
+
+  /* allocate the scratch space, large enough for both the particles used to
+   * learn the importance distribution and for one chunk of those returned. */
+  chunk = MIN(n, AIS_CHUNK);
+  len = MAX(chunk, size);
+  cols = Calloc1D(nnodes, sizeof(void *));
+  csize = Calloc1D(nnodes, sizeof(size_t));
+  for (i = 0; i < nnodes; i++) {
+
+    if (((*plan).bn.node_types[i] == DNODE) ||
+        ((*plan).bn.node_types[i] == ONODE))
+      csize[i] = sizeof(int);
+    else
+      csize[i] = sizeof(double);
+
+    cols[i] = Calloc1D(len, csize[i]);
+
+  }/*FOR*/
+  scratch = Calloc1D(len, sizeof(double));
+  out = Calloc1D(nkeep, sizeof(void *));
+  for (k = 0; k < nkeep; k++)
+    out[k] = DATAPTR(VECTOR_ELT(result, k));
+  warn = Calloc1D(nnodes, sizeof(bool));
+
+  q = ais_alloc(plan);
+  ais_reset(plan, q, fixed);
+
+  if (debugging)
+    for (i = 0; i < nnodes; i++)
+      if (fixed[i].n > 0)
+        Rprintf("* weighting particles with the evidence on node %s.\n",
+          (*plan).bn.labels[i]);
+
+  GetRNGstate();
+
+  if (debugging)
+    Rprintf("* learning the importance distribution from %d update(s) of %d particles.\n",
+      updates, size);
+
+  ais_learn(plan, q, fixed, cols, size, scratch, updates, NULL, warn,
+    debugging);
+
+  for (from = 0; from < n; from += chunk) {
+
+    len = MIN(n - from, chunk);
+    ais_sample(plan, q, fixed, cols, len, w + from, NULL, warn);
+
+    /* save the nodes we were asked for. */
+    for (k = 0; k < nkeep; k++)
+      memcpy((char *)out[k] + from * csize[keep[k] - 1], cols[keep[k] - 1],
+        len * csize[keep[k] - 1]);
+
+  }/*FOR*/
+
+  PutRNGstate();
+
+  /* rescale before exponentiating them into probabilities (if possible). */
+  lw_rescale(w, n);
+  (*q).ess = ais_ess(w, n);
+
+  if (debugging)
+    Rprintf("* generated %d particles, effective sample size %.2lf.\n",
+      n, (*q).ess);
+
+  setAttrib(result, BN_WeightsSymbol, weights);
+  setAttrib(result, BN_EssSymbol, ScalarReal((*q).ess));
+
+  for (i = 0; i < nnodes; i++)
+    Free1D(cols[i]);
+  Free1D(cols);
+  Free1D(csize);
+  Free1D(scratch);
+  Free1D(out);
+  Free1D(warn);
+  FreeAIS(q);
+  FreeRBNFIXED(fixed, nnodes);
+
+  UNPROTECT(3);
+
+  return result;
+
+}/*C_AIS_PARTICLES*/
@@ -0,0 +1,33 @@
+#ifndef ADAPTIVE_SAMPLING_HEADER
+#define ADAPTIVE_SAMPLING_HEADER
+
+#include "rbn.h"
+
+/* the importance distribution of adaptive importance sampling (AIS-BN): the
+ * discrete nodes that are not fixed by the evidence are sampled from importance
+ * CPTs, which are learned from the weighted particles; all other nodes are
+ * sampled as in likelihood weighting. */
+typedef struct {
+
+  int nnodes;        /* number of nodes in the network. */
+  bool *adapt;       /* whether each node is sampled from its importance CPT. */
+  double **icpt;     /* importance CPTs, with the same layout as the CPTs. */
+  double **counts;   /* weighted frequencies of the levels in the particles. */
+  double ess;        /* effective sample size of the last set of particles. */
+
+} ais_proposal;
+
+ais_proposal *ais_alloc(compiled_bn *plan);
+void ais_reset(compiled_bn *plan, ais_proposal *q, rbn_fixed *fixed);
+void ais_sample(compiled_bn *plan, ais_proposal *q, rbn_fixed *fixed,
+    void **cols, int len, double *lw, rng_stream *rng, bool *warn);
+void ais_learn(compiled_bn *plan, ais_proposal *q, rbn_fixed *fixed,
+    void **cols, int len, double *w, int updates, rng_stream *rng, bool *warn,
+    bool debugging);
+double ais_ess(double *w, int n);
+void FreeAIS(ais_proposal *q);
+
+SEXP c_ais_particles(SEXP fitted, SEXP nodes, int n, SEXP fix, int updates,
+    int size, bool debugging);
+
+#endif
@@ -0,0 +1,504 @@
+#include "../include/rcore.h"
+#include "../core/allocations.h"
+#include "../include/globals.h"
+#include "belief.propagation.h"
+
+/* build the factor graph of a discrete Bayesian network, with uniform messages
+ * and no evidence. */
+lbp_graph *c_lbp_build(fitted_bn bn) {
+
+int i = 0, j = 0, k = 0, e = 0, n = bn.nnodes, size = 0, nmsg = 0, nev = 0;
+int *count = NULL;
+bool nan_found = FALSE;
+ldist *ld = NULL;
+lbp_graph *lbp = NULL;
+
+  for (i = 0; i < n; i++)
+    if ((bn.node_types[i] != DNODE) && (bn.node_types[i] != ONODE))
+      error("node %s is not discrete, belief propagation is not possible.",
+        bn.labels[i]);
+
+  lbp = Calloc1D(1, sizeof(lbp_graph));
+  (*lbp).nnodes = n;
+  (*lbp).nlevels = Calloc1D(n, sizeof(int));
+  (*lbp).cpt = Calloc1D(n, sizeof(double *));
+  (*lbp).owned = Calloc1D(n, sizeof(double *));
+  (*lbp).fstart = Calloc1D(n + 1, sizeof(int));
+  (*lbp).voff = Calloc1D(n + 1, sizeof(int));
+
+  for (i = 0; i < n; i++) {
+
+    (*lbp).nlevels[i] = bn.ldists[i].d.dims[0];
+    (*lbp).voff[i + 1] = (*lbp).voff[i] + (*lbp).nlevels[i];
+    (*lbp).fstart[i + 1] = (*lbp).fstart[i] + bn.ldists[i].nparents + 1;
+
+  }/*FOR*/
+
+  (*lbp).nedges = (*lbp).fstart[n];
+  (*lbp).evar = Calloc1D((*lbp).nedges, sizeof(int));
+  (*lbp).efac = Calloc1D((*lbp).nedges, sizeof(int));
+  (*lbp).moff = Calloc1D((*lbp).nedges + 1, sizeof(int));
+  (*lbp).vstart = Calloc1D(n + 1, sizeof(int));
+  (*lbp).vedges = Calloc1D((*lbp).nedges, sizeof(int));
+
+  for (i = 0, e = 0; i < n; i++) {
+
+    ld = bn.ldists + i;
+
+    for (j = 0; j <= (*ld).nparents; j++, e++) {
+
+      (*lbp).evar[e] = (j == 0) ? i : (*ld).parents[j - 1];
+      (*lbp).efac[e] = i;
+      (*lbp).moff[e + 1] = (*lbp).moff[e] + (*lbp).nlevels[(*lbp).evar[e]];
+      (*lbp).vstart[(*lbp).evar[e] + 1]++;
+
+    }/*FOR*/
+
+    /* conditional distributions that were not estimated are replaced with
+     * uniform distributions, as in the junction tree. */
+    size = (*lbp).nlevels[i];
+    for (j = 0; j < (*ld).nparents; j++)
+      size *= (*lbp).nlevels[(*ld).parents[j]];
+
+    nan_found = FALSE;
+    for (k = 0; k < size; k += (*lbp).nlevels[i])
+      if (ISNAN((*ld).d.cpt[k]))
+        nan_found = TRUE;
+
+    if (nan_found) {
+
+      (*lbp).owned[i] = Calloc1D(size, sizeof(double));
+      memcpy((*lbp).owned[i], (*ld).d.cpt, size * sizeof(double));
+      for (k = 0; k < size; k++)
+        if (ISNAN((*lbp).owned[i][k]))
+          (*lbp).owned[i][k] = 1.0 / (*lbp).nlevels[i];
+      (*lbp).cpt[i] = (*lbp).owned[i];
+
+      warning("NaN conditional probabilities in %s, replaced with a uniform distribution.",
+        bn.labels[i]);
+
+    }/*THEN*/
+    else {
+
+      (*lbp).cpt[i] = (*ld).d.cpt;
+
+    }/*ELSE*/
+
+  }/*FOR*/
+
+  /* index the edges by node. */
+  for (i = 0; i < n; i++)
+    (*lbp).vstart[i + 1] += (*lbp).vstart[i];
+  count = Calloc1D(n, sizeof(int));
+  memcpy(count, (*lbp).vstart, n * sizeof(int));
+  for (e = 0; e < (*lbp).nedges; e++)
+    (*lbp).vedges[count[(*lbp).evar[e]]++] = e;
+  Free1D(count);
+
+  /* allocate the flat message buffers, and the priority queue. */
+  nmsg = (*lbp).moff[(*lbp).nedges];
+  nev = (*lbp).voff[n];
+  (*lbp).evidence = Calloc1D(nev, sizeof(double));
+  (*lbp).fv = Calloc1D(nmsg, sizeof(double));
+  (*lbp).vf = Calloc1D(nmsg, sizeof(double));
+  (*lbp).cand = Calloc1D(nmsg, sizeof(double));
+  (*lbp).residual = Calloc1D((*lbp).nedges, sizeof(double));
+  (*lbp).heap = Calloc1D((*lbp).nedges, sizeof(int));
+  (*lbp).hpos = Calloc1D((*lbp).nedges, sizeof(int));
+  (*lbp).counter = Calloc1D(n, sizeof(int));
+
+  for (k = 0; k < nev; k++)
+    (*lbp).evidence[k] = 1;
+
+  return lbp;
+
+}/*C_LBP_BUILD*/
+
+void FreeLBP(lbp_graph *lbp) {
+
+  if (!lbp)
+    return;
+
+  for (int i = 0; i < (*lbp).nnodes; i++)
+    Free1D((*lbp).owned[i]);
+
+  Free1D((*lbp).nlevels);
+  Free1D((*lbp).cpt);
+  Free1D((*lbp).owned);
+  Free1D((*lbp).fstart);
+  Free1D((*lbp).vstart);
+  Free1D((*lbp).vedges);
+  Free1D((*lbp).evar);
+  Free1D((*lbp).efac);
+  Free1D((*lbp).moff);
+  Free1D((*lbp).voff);
+  Free1D((*lbp).evidence);
+  Free1D((*lbp).fv);
+  Free1D((*lbp).vf);
+  Free1D((*lbp).cand);
+  Free1D((*lbp).residual);
+  Free1D((*lbp).heap);
+  Free1D((*lbp).hpos);
+  Free1D((*lbp).counter);
+  Free1D(lbp);
+
+}/*FREELBP*/
+
+/* set the evidence on a node, as the set of levels (0-based) it can take. */
+void c_lbp_evidence(lbp_graph *lbp, int node, int *levels, int nlevels) {
+
+double *ev = (*lbp).evidence + (*lbp).voff[node];
+
+  memset(ev, '\0', (*lbp).nlevels[node] * sizeof(double));
+  for (int l = 0; l < nlevels; l++)
+    ev[levels[l]] = 1;
+
+}/*C_LBP_EVIDENCE*/
+
+/* rescale a message to sum to one, leaving it alone if it is all zeroes. */
+static void lbp_normalize(double *msg, int n) {
+
+double sum = 0;
+
+  for (int l = 0; l < n; l++)
+    sum += msg[l];
+  if (sum > 0)
+    for (int l = 0; l < n; l++)
+      msg[l] /= sum;
+
+}/*LBP_NORMALIZE*/
+
+/* compute the message from a node to a factor, from the evidence on the node
+ * and the messages from all the other factors. */
+static void lbp_node_message(lbp_graph *lbp, int e) {
+
+int v = (*lbp).evar[e], nl = (*lbp).nlevels[v], e2 = 0, l = 0;
+double *out = (*lbp).vf + (*lbp).moff[e], *in = NULL;
+
+  memcpy(out, (*lbp).evidence + (*lbp).voff[v], nl * sizeof(double));
+
+  for (int k = (*lbp).vstart[v]; k < (*lbp).vstart[v + 1]; k++) {
+
+    e2 = (*lbp).vedges[k];
+    if (e2 == e)
+      continue;
+
+    in = (*lbp).fv + (*lbp).moff[e2];
+    for (l = 0; l < nl; l++)
+      out[l] *= in[l];
+
+  }/*FOR*/
+
+  lbp_normalize(out, nl);
+
+}/*LBP_NODE_MESSAGE*/
+
+/* compute the candidate message from a factor to a node, summing the product
+ * of the CPT and of the messages from all the other nodes over the cells of
+ * the CPT. The first variable of the CPT varies fastest. */
+static void lbp_factor_message(lbp_graph *lbp, int e) {
+
+int f = (*lbp).efac[e], first = (*lbp).fstart[f], last = (*lbp).fstart[f + 1];
+int nfam = last - first, target = e - first, j = 0, k = 0, size = 1;
+int *counter = (*lbp).counter;
+double p = 0, *out = (*lbp).cand + (*lbp).moff[e];
+const double *cpt = (*lbp).cpt[f];
+
+  for (j = 0; j < nfam; j++)
+    size *= (*lbp).nlevels[(*lbp).evar[first + j]];
+
+  memset(out, '\0', (*lbp).nlevels[(*lbp).evar[e]] * sizeof(double));
+  memset(counter, '\0', nfam * sizeof(int));
+
+  for (k = 0; k < size; k++) {
+
+    p = cpt[k];
+    for (j = 0; (j < nfam) && (p > 0); j++)
+      if (j != target)
+        p *= (*lbp).vf[(*lbp).moff[first + j] + counter[j]];
+
+    out[counter[target]] += p;
+
+    /* move to the next cell, odometer-style. */
+    for (j = 0; j < nfam; j++) {
+
+      if (++counter[j] < (*lbp).nlevels[(*lbp).evar[first + j]])
+        break;
+      counter[j] = 0;
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  lbp_normalize(out, (*lbp).nlevels[(*lbp).evar[e]]);
+
+}/*LBP_FACTOR_MESSAGE*/
+
+/* the largest absolute difference between the candidate and the sent message
+ * on an edge. */
+static double lbp_residual(lbp_graph *lbp, int e) {
+
+int nl = (*lbp).nlevels[(*lbp).evar[e]];
+double r = 0, *cand = (*lbp).cand + (*lbp).moff[e];
+double *sent = (*lbp).fv + (*lbp).moff[e];
+
+  for (int l = 0; l < nl; l++)
+    r = MAX(r, fabs(cand[l] - sent[l]));
+
+  return r;
+
+}/*LBP_RESIDUAL*/
+
+/* restore the heap property after the residual of an edge has changed. */
+static void lbp_heap_update(lbp_graph *lbp, int e) {
+
+int pos = (*lbp).hpos[e], child = 0, n = (*lbp).nedges;
+int *heap = (*lbp).heap, *hpos = (*lbp).hpos;
+double *res = (*lbp).residual;
+
+  /* sift up... */
+  while ((pos > 0) && (res[heap[(pos - 1) / 2]] < res[e])) {
+
+    heap[pos] = heap[(pos - 1) / 2];
+    hpos[heap[pos]] = pos;
+    pos = (pos - 1) / 2;
+
+  }/*WHILE*/
+
+  /* ... or sift down. */
+  while ((child = 2 * pos + 1) < n) {
+
+    if ((child + 1 < n) && (res[heap[child + 1]] > res[heap[child]]))
+      child++;
+    if (res[heap[child]] <= res[e])
+      break;
+
+    heap[pos] = heap[child];
+    hpos[heap[pos]] = pos;
+    pos = child;
+
+  }/*WHILE*/
+
+  heap[pos] = e;
+  hpos[e] = pos;
+
+}/*LBP_HEAP_UPDATE*/
+
+/* run loopy belief propagation with residual scheduling: the factor-to-node
+ * message that would change the most is sent first, and only the messages that
+ * depend on it are recomputed. Sent messages are damped towards their previous
+ * values. Returns the number of iterations, in units of the number of edges. */
+double c_lbp_run(lbp_graph *lbp, double max_iter, double damping,
+    double threshold, double *maxres, bool debugging) {
+
+int e = 0, e2 = 0, e3 = 0, f = 0, v = 0, k = 0, l = 0, nl = 0;
+double updates = 0, max_updates = max_iter * (*lbp).nedges, *sent = NULL;
+double *cand = NULL, *sorted = NULL;
+
+  /* start from uniform messages. */
+  for (e = 0; e < (*lbp).nedges; e++) {
+
+    nl = (*lbp).nlevels[(*lbp).evar[e]];
+    for (l = 0; l < nl; l++)
+      (*lbp).fv[(*lbp).moff[e] + l] = 1.0 / nl;
+
+  }/*FOR*/
+
+  for (e = 0; e < (*lbp).nedges; e++)
+    lbp_node_message(lbp, e);
+
+  for (e = 0; e < (*lbp).nedges; e++) {
+
+    lbp_factor_message(lbp, e);
+    (*lbp).residual[e] = lbp_residual(lbp, e);
+    (*lbp).heap[e] = e;
+
+  }/*FOR*/
+
+  /* an array sorted in decreasing order is a valid max-heap. */
+  sorted = Calloc1D((*lbp).nedges, sizeof(double));
+  memcpy(sorted, (*lbp).residual, (*lbp).nedges * sizeof(double));
+  revsort(sorted, (*lbp).heap, (*lbp).nedges);
+  for (k = 0; k < (*lbp).nedges; k++)
+    (*lbp).hpos[(*lbp).heap[k]] = k;
+  Free1D(sorted);
+
+  while ((updates < max_updates) && ((*lbp).nedges > 0)) {
+
+    /* stop when no message would change by more than the threshold, which
+     * may be zero. */
+    e = (*lbp).heap[0];
+    if ((*lbp).residual[e] <= threshold)
+      break;
+
+    /* send the message with the largest residual. */
+    nl = (*lbp).nlevels[(*lbp).evar[e]];
+    sent = (*lbp).fv + (*lbp).moff[e];
+    cand = (*lbp).cand + (*lbp).moff[e];
+    for (l = 0; l < nl; l++)
+      sent[l] = (1 - damping) * cand[l] + damping * sent[l];
+    lbp_normalize(sent, nl);
+
+    (*lbp).residual[e] = lbp_residual(lbp, e);
+    lbp_heap_update(lbp, e);
+    updates++;
+
+    /* update the messages from the node to the other factors, and the
+     * candidate messages from those factors to their other nodes. */
+    v = (*lbp).evar[e];
+    for (k = (*lbp).vstart[v]; k < (*lbp).vstart[v + 1]; k++) {
+
+      e2 = (*lbp).vedges[k];
+      if (e2 == e)
+        continue;
+
+      lbp_node_message(lbp, e2);
+
+      f = (*lbp).efac[e2];
+      for (e3 = (*lbp).fstart[f]; e3 < (*lbp).fstart[f + 1]; e3++) {
+
+        if (e3 == e2)
+          continue;
+
+        lbp_factor_message(lbp, e3);
+        (*lbp).residual[e3] = lbp_residual(lbp, e3);
+        lbp_heap_update(lbp, e3);
+
+      }/*FOR*/
+
+    }/*FOR*/
+
+    /* an iteration is as many messages as there are edges. */
+    if (debugging && (fmod(updates, (*lbp).nedges) == 0))
+      Rprintf("  > iteration %g, largest residual %g.\n",
+        updates / (*lbp).nedges, (*lbp).residual[(*lbp).heap[0]]);
+
+  }/*WHILE*/
+
+  /* make the messages from the nodes consistent with the last messages sent by
+   * the factors. */
+  for (e = 0; e < (*lbp).nedges; e++)
+    lbp_node_message(lbp, e);
+
+  *maxres = ((*lbp).nedges > 0) ? (*lbp).residual[(*lbp).heap[0]] : 0;
+
+  if (debugging)
+    Rprintf("* belief propagation %s after %g iterations (largest residual %g).\n",
+      (*maxres <= threshold) ? "converged" : "did not converge",
+      updates / MAX((*lbp).nedges, 1), *maxres);
+
+  return updates / MAX((*lbp).nedges, 1);
+
+}/*C_LBP_RUN*/
+
+/* the belief of a node: the evidence times all the incoming messages. */
+void c_lbp_marginal(lbp_graph *lbp, int node, double *marginal) {
+
+int nl = (*lbp).nlevels[node], e = 0, l = 0;
+double sum = 0, *in = NULL;
+
+  memcpy(marginal, (*lbp).evidence + (*lbp).voff[node], nl * sizeof(double));
+
+  for (int k = (*lbp).vstart[node]; k < (*lbp).vstart[node + 1]; k++) {
+
+    e = (*lbp).vedges[k];
+    in = (*lbp).fv + (*lbp).moff[e];
+    for (l = 0; l < nl; l++)
+      marginal[l] *= in[l];
+
+  }/*FOR*/
+
+  for (l = 0; l < nl; l++)
+    sum += marginal[l];
+  for (l = 0; l < nl; l++)
+    marginal[l] = (sum > 0) ? marginal[l] / sum : R_NaN;
+
+}/*C_LBP_MARGINAL*/
+
+/* the joint belief of a set of nodes, from the belief of the smallest factor
+ * that contains all of them; the first node varies fastest. Returns FALSE if
+ * no factor contains all the nodes. */
+bool c_lbp_joint(lbp_graph *lbp, int *nodes, int nnodes, double *joint) {
+
+int f = 0, best = -1, first = 0, nfam = 0, i = 0, j = 0, k = 0, size = 1;
+int idx = 0, jsize = 1, *counter = (*lbp).counter, *mult = NULL;
+double p = 0, sum = 0;
+const double *cpt = NULL;
+
+  for (f = 0; f < (*lbp).nnodes; f++) {
+
+    for (i = 0; i < nnodes; i++) {
+
+      for (j = (*lbp).fstart[f]; j < (*lbp).fstart[f + 1]; j++)
+        if ((*lbp).evar[j] == nodes[i])
+          break;
+
+      if (j == (*lbp).fstart[f + 1])
+        break;
+
+    }/*FOR*/
+
+    if ((i == nnodes) && ((best < 0) ||
+        ((*lbp).fstart[f + 1] - (*lbp).fstart[f] <
+         (*lbp).fstart[best + 1] - (*lbp).fstart[best])))
+      best = f;
+
+  }/*FOR*/
+
+  if (best < 0)
+    return FALSE;
+
+  first = (*lbp).fstart[best];
+  nfam = (*lbp).fstart[best + 1] - first;
+  cpt = (*lbp).cpt[best];
+
+  /* the stride of each variable of the factor in the joint belief. */
+  mult = Calloc1D(nfam, sizeof(int));
+  for (i = 0; i < nnodes; i++) {
+
+    for (j = 0; j < nfam; j++)
+      if ((*lbp).evar[first + j] == nodes[i])
+        mult[j] = jsize;
+
+    jsize *= (*lbp).nlevels[nodes[i]];
+
+  }/*FOR*/
+
+  for (j = 0; j < nfam; j++)
+    size *= (*lbp).nlevels[(*lbp).evar[first + j]];
+
+  memset(joint, '\0', jsize * sizeof(double));
+  memset(counter, '\0', nfam * sizeof(int));
+
+  for (k = 0; k < size; k++) {
+
+    p = cpt[k];
+    for (j = 0, idx = 0; j < nfam; j++) {
+
+      p *= (*lbp).vf[(*lbp).moff[first + j] + counter[j]];
+      idx += mult[j] * counter[j];
+
+    }/*FOR*/
+
+    joint[idx] += p;
+
+    for (j = 0; j < nfam; j++) {
+
+      if (++counter[j] < (*lbp).nlevels[(*lbp).evar[first + j]])
+        break;
+      counter[j] = 0;
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  for (k = 0; k < jsize; k++)
+    sum += joint[k];
+  for (k = 0; k < jsize; k++)
+    joint[k] = (sum > 0) ? joint[k] / sum : R_NaN;
+
+  Free1D(mult);
+
+  return TRUE;
+
+}/*C_LBP_JOINT*/
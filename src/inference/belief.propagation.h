@@ -0,0 +1,43 @@
+#ifndef BELIEF_PROPAGATION_HEADER
+#define BELIEF_PROPAGATION_HEADER
+
+#include "../fitted/fitted.h"
+
+/* the factor graph of a discrete Bayesian network for loopy belief propagation:
+ * one factor for each local distribution, connected to the node and its
+ * parents. All messages are stored in flat buffers, indexed by edge. */
+typedef struct {
+
+  int nnodes;        /* number of nodes (and factors). */
+  int *nlevels;      /* number of levels of each node. */
+  const double **cpt;/* the CPT of each factor. */
+  double **owned;    /* CPTs with missing values replaced, if any. */
+  int nedges;        /* number of edges in the factor graph. */
+  int *fstart;       /* edges of each factor (the node first, then the
+                      * parents in the order of the CPT). */
+  int *vstart;       /* edges of each node, as positions in vedges. */
+  int *vedges;       /* edges sorted by node. */
+  int *evar;         /* node at the end of each edge. */
+  int *efac;         /* factor at the end of each edge. */
+  int *moff;         /* offset of the messages of each edge. */
+  int *voff;         /* offset of the evidence of each node. */
+  double *evidence;  /* likelihood of the levels of each node. */
+  double *fv;        /* factor-to-node messages. */
+  double *vf;        /* node-to-factor messages. */
+  double *cand;      /* factor-to-node messages, before they are sent. */
+  double *residual;  /* distance between the candidate and the sent messages. */
+  int *heap;         /* edges in a max-heap ordered by residual. */
+  int *hpos;         /* position of each edge in the heap. */
+  int *counter;      /* scratch space for iterating over CPTs. */
+
+} lbp_graph;
+
+lbp_graph *c_lbp_build(fitted_bn bn);
+void c_lbp_evidence(lbp_graph *lbp, int node, int *levels, int nlevels);
+double c_lbp_run(lbp_graph *lbp, double max_iter, double damping,
+    double threshold, double *maxres, bool debugging);
+void c_lbp_marginal(lbp_graph *lbp, int node, double *marginal);
+bool c_lbp_joint(lbp_graph *lbp, int *nodes, int nnodes, double *joint);
+void FreeLBP(lbp_graph *lbp);
+
+#endif
@@ -0,0 +1,480 @@
+#include "../include/rcore.h"
+#include "../core/allocations.h"
+#include "../include/globals.h"
+#include "gaussian.precision.h"
+
+static void FreeGPRECFACTOR(gprec_factor *f) {
+
+  if (!f)
+    return;
+
+  Free1D((*f).observed);
+  Free1D((*f).free);
+  Free1D((*f).pos);
+  Free1D((*f).Lp);
+  Free1D((*f).Li);
+  Free1D((*f).Lx);
+  Free1D(f);
+
+}/*FREEGPRECFACTOR*/
+
+void FreeGPREC(gprec *gp) {
+
+  if (!gp)
+    return;
+
+  Free1D((*gp).Kp);
+  Free1D((*gp).Ki);
+  Free1D((*gp).Kx);
+  Free1D((*gp).h);
+  FreeGPRECFACTOR((*gp).last);
+  Free1D(gp);
+
+}/*FREEGPREC*/
+
+/* build the precision matrix of the global distribution of a Gaussian Bayesian
+ * network directly from the local distributions. If X = B X + b + E with
+ * E ~ N(0, D), the precision matrix is K = (I - B)^T D^{-1} (I - B), that is,
+ * the sum over the nodes of the outer products of the rows of (I - B) scaled
+ * by the residual variances; and K mu = (I - B)^T D^{-1} b. */
+gprec *c_gprec_build(fitted_bn bn) {
+
+int i = 0, j = 0, k = 0, t = 0, n = bn.nnodes, nf = 0, ntrip = 0, nnz = 0;
+int *family = NULL, *trow = NULL, *tcol = NULL, *count = NULL, *start = NULL;
+int *mark = NULL, *where = NULL, *order = NULL;
+double s2 = 0, *a = NULL, *tval = NULL;
+ldist *ld = NULL;
+gprec *gp = NULL;
+
+  for (i = 0; i < n; i++) {
+
+    if (bn.node_types[i] != GNODE)
+      error("node %s is not Gaussian.", bn.labels[i]);
+    if (ISNAN(bn.ldists[i].g.sd) || (bn.ldists[i].g.sd < MACHINE_TOL))
+      error("the residual standard error of node %s is zero, the precision matrix is singular.",
+        bn.labels[i]);
+
+    ntrip += (bn.ldists[i].nparents + 1) * (bn.ldists[i].nparents + 1);
+
+  }/*FOR*/
+
+  gp = Calloc1D(1, sizeof(gprec));
+  (*gp).nnodes = n;
+  (*gp).h = Calloc1D(n, sizeof(double));
+
+  /* generate the contributions of each node as (row, column, value) triplets. */
+  trow = Calloc1D(ntrip, sizeof(int));
+  tcol = Calloc1D(ntrip, sizeof(int));
+  tval = Calloc1D(ntrip, sizeof(double));
+  family = Calloc1D(n, sizeof(int));
+  a = Calloc1D(n, sizeof(double));
+
+  for (i = 0, t = 0; i < n; i++) {
+
+    ld = bn.ldists + i;
+    nf = (*ld).nparents + 1;
+    s2 = (*ld).g.sd * (*ld).g.sd;
+
+    family[0] = i;
+    a[0] = 1;
+    for (j = 1; j < nf; j++) {
+
+      family[j] = (*ld).parents[j - 1];
+      a[j] = -(*ld).g.coefs[j];
+
+    }/*FOR*/
+
+    for (j = 0; j < nf; j++) {
+
+      (*gp).h[family[j]] += a[j] * (*ld).g.coefs[0] / s2;
+
+      for (k = 0; k < nf; k++, t++) {
+
+        trow[t] = family[j];
+        tcol[t] = family[k];
+        tval[t] = a[j] * a[k] / s2;
+
+      }/*FOR*/
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  /* bucket the triplets by column... */
+  count = Calloc1D(n + 1, sizeof(int));
+  start = Calloc1D(n + 1, sizeof(int));
+  order = Calloc1D(ntrip, sizeof(int));
+  for (t = 0; t < ntrip; t++)
+    count[tcol[t] + 1]++;
+  for (j = 0; j < n; j++)
+    count[j + 1] += count[j];
+  memcpy(start, count, (n + 1) * sizeof(int));
+  for (t = 0; t < ntrip; t++)
+    order[start[tcol[t]]++] = t;
+
+  /* ... and sum duplicate entries within each column. */
+  (*gp).Kp = Calloc1D(n + 1, sizeof(int));
+  (*gp).Ki = Calloc1D(ntrip, sizeof(int));
+  (*gp).Kx = Calloc1D(ntrip, sizeof(double));
+  mark = Calloc1D(n, sizeof(int));
+  where = Calloc1D(n, sizeof(int));
+  for (i = 0; i < n; i++)
+    mark[i] = -1;
+
+  for (j = 0, nnz = 0; j < n; j++) {
+
+    (*gp).Kp[j] = nnz;
+
+    for (k = count[j]; k < count[j + 1]; k++) {
+
+      t = order[k];
+
+      if (mark[trow[t]] != j) {
+
+        mark[trow[t]] = j;
+        where[trow[t]] = nnz;
+        (*gp).Ki[nnz] = trow[t];
+        (*gp).Kx[nnz++] = tval[t];
+
+      }/*THEN*/
+      else {
+
+        (*gp).Kx[where[trow[t]]] += tval[t];
+
+      }/*ELSE*/
+
+    }/*FOR*/
+
+  }/*FOR*/
+  (*gp).Kp[n] = nnz;
+
+  Free1D(trow);
+  Free1D(tcol);
+  Free1D(tval);
+  Free1D(family);
+  Free1D(a);
+  Free1D(count);
+  Free1D(start);
+  Free1D(order);
+  Free1D(mark);
+  Free1D(where);
+
+  return gp;
+
+}/*C_GPREC_BUILD*/
+
+/* a dynamic array of node indexes, for the elimination graph. */
+typedef struct {
+
+  int size;
+  int capacity;
+  int *nodes;
+
+} gprec_adjlist;
+
+static void adjlist_push(gprec_adjlist *adj, int node) {
+
+  if ((*adj).size == (*adj).capacity) {
+
+    (*adj).capacity = ((*adj).capacity == 0) ? 4 : 2 * (*adj).capacity;
+    (*adj).nodes = Realloc1D((*adj).nodes, (*adj).capacity, sizeof(int));
+
+  }/*THEN*/
+
+  (*adj).nodes[(*adj).size++] = node;
+
+}/*ADJLIST_PUSH*/
+
+/* order the unobserved nodes by minimum degree, recording the pattern of each
+ * column of the Cholesky factor (the neighbours of each node when it is
+ * eliminated). */
+static void gprec_symbolic(gprec *gp, gprec_factor *f) {
+
+int i = 0, j = 0, k = 0, v = 0, u = 0, w = 0, best = 0, nfree = (*f).nfree;
+int nnodes = (*gp).nnodes, *loc = NULL, *mark = NULL, nnz = 0;
+bool *eliminated = NULL;
+gprec_adjlist *adj = NULL, *pattern = NULL;
+
+  /* the graph of the precision matrix of the unobserved nodes, using their
+   * positions in (*f).free as indexes. */
+  loc = Calloc1D(nnodes, sizeof(int));
+  for (i = 0; i < nnodes; i++)
+    loc[i] = -1;
+  for (i = 0; i < nfree; i++)
+    loc[(*f).free[i]] = i;
+
+  adj = Calloc1D(nfree, sizeof(gprec_adjlist));
+  pattern = Calloc1D(nfree, sizeof(gprec_adjlist));
+  for (i = 0; i < nfree; i++) {
+
+    v = (*f).free[i];
+
+    for (k = (*gp).Kp[v]; k < (*gp).Kp[v + 1]; k++)
+      if ((loc[(*gp).Ki[k]] >= 0) && ((*gp).Ki[k] != v))
+        adjlist_push(adj + i, loc[(*gp).Ki[k]]);
+
+  }/*FOR*/
+
+  eliminated = Calloc1D(nfree, sizeof(bool));
+  mark = Calloc1D(nfree, sizeof(int));
+  for (i = 0; i < nfree; i++)
+    mark[i] = -1;
+
+  for (i = 0; i < nfree; i++) {
+
+    /* pick the node with the fewest neighbours. */
+    best = -1;
+    for (v = 0; v < nfree; v++)
+      if (!eliminated[v] && ((best < 0) || (adj[v].size < adj[best].size)))
+        best = v;
+
+    eliminated[best] = TRUE;
+    (*f).pos[(*f).free[best]] = i;
+
+    /* connect all the neighbours, and remove the node from their lists. */
+    for (j = 0; j < adj[best].size; j++) {
+
+      u = adj[best].nodes[j];
+      adjlist_push(pattern + best, u);
+
+      for (k = 0; k < adj[u].size; k++)
+        mark[adj[u].nodes[k]] = u;
+
+      for (k = 0, w = 0; k < adj[u].size; k++)
+        if (adj[u].nodes[k] != best)
+          adj[u].nodes[w++] = adj[u].nodes[k];
+      adj[u].size = w;
+
+      for (k = 0; k < adj[best].size; k++) {
+
+        w = adj[best].nodes[k];
+        if ((w != u) && (mark[w] != u))
+          adjlist_push(adj + u, w);
+
+      }/*FOR*/
+
+    }/*FOR*/
+
+    nnz += 1 + adj[best].size;
+
+  }/*FOR*/
+
+  /* store the pattern of the factor, with the nodes in elimination order. */
+  (*f).Lp = Calloc1D(nfree + 1, sizeof(int));
+  (*f).Li = Calloc1D(nnz, sizeof(int));
+  (*f).Lx = Calloc1D(nnz, sizeof(double));
+
+  for (i = 0; i < nfree; i++)
+    loc[(*f).pos[(*f).free[i]]] = i;
+
+  for (j = 0, nnz = 0; j < nfree; j++) {
+
+    v = loc[j];
+    (*f).Lp[j] = nnz;
+    (*f).Li[nnz++] = j;
+    for (k = 0; k < pattern[v].size; k++)
+      (*f).Li[nnz++] = (*f).pos[(*f).free[pattern[v].nodes[k]]];
+
+  }/*FOR*/
+  (*f).Lp[nfree] = nnz;
+
+  /* reorder the unobserved nodes to follow the elimination order. */
+  for (j = 0; j < nfree; j++)
+    mark[j] = (*f).free[loc[j]];
+  memcpy((*f).free, mark, nfree * sizeof(int));
+
+  for (i = 0; i < nfree; i++) {
+
+    Free1D(adj[i].nodes);
+    Free1D(pattern[i].nodes);
+
+  }/*FOR*/
+  Free1D(adj);
+  Free1D(pattern);
+  Free1D(eliminated);
+  Free1D(mark);
+  Free1D(loc);
+
+}/*GPREC_SYMBOLIC*/
+
+/* left-looking numeric Cholesky factorization, using the pattern computed by
+ * gprec_symbolic(). */
+static bool gprec_numeric(gprec *gp, gprec_factor *f) {
+
+int j = 0, k = 0, p = 0, q = 0, r = 0, v = 0, nfree = (*f).nfree;
+int *Lp = (*f).Lp, *Li = (*f).Li, *Rp = NULL, *Rq = NULL, *Rk = NULL;
+int *next = NULL;
+double ljk = 0, d = 0, *Lx = (*f).Lx, *x = NULL;
+bool pd = TRUE;
+
+  /* the row patterns of the factor, to find the columns that update each
+   * column. */
+  Rp = Calloc1D(nfree + 1, sizeof(int));
+  Rq = Calloc1D(Lp[nfree], sizeof(int));
+  Rk = Calloc1D(Lp[nfree], sizeof(int));
+  for (k = 0; k < nfree; k++)
+    for (p = Lp[k] + 1; p < Lp[k + 1]; p++)
+      Rp[Li[p] + 1]++;
+  for (j = 0; j < nfree; j++)
+    Rp[j + 1] += Rp[j];
+  next = Calloc1D(nfree, sizeof(int));
+  memcpy(next, Rp, nfree * sizeof(int));
+  for (k = 0; k < nfree; k++)
+    for (p = Lp[k] + 1; p < Lp[k + 1]; p++) {
+
+      q = next[Li[p]]++;
+      Rk[q] = k;
+      Rq[q] = p;
+
+    }/*FOR*/
+  Free1D(next);
+
+  x = Calloc1D(nfree, sizeof(double));
+
+  for (j = 0; j < nfree; j++) {
+
+    /* scatter the column of the precision matrix... */
+    v = (*f).free[j];
+    for (p = (*gp).Kp[v]; p < (*gp).Kp[v + 1]; p++) {
+
+      r = (*f).pos[(*gp).Ki[p]];
+      if (r >= j)
+        x[r] = (*gp).Kx[p];
+
+    }/*FOR*/
+
+    /* ... subtract the contributions of the previous columns... */
+    for (q = Rp[j]; q < Rp[j + 1]; q++) {
+
+      k = Rk[q];
+      ljk = Lx[Rq[q]];
+
+      for (p = Lp[k] + 1; p < Lp[k + 1]; p++)
+        if (Li[p] >= j)
+          x[Li[p]] -= Lx[p] * ljk;
+
+    }/*FOR*/
+
+    /* ... and scale by the square root of the pivot. */
+    d = x[j];
+    if (d <= 0) {
+
+      pd = FALSE;
+      break;
+
+    }/*THEN*/
+
+    Lx[Lp[j]] = sqrt(d);
+    x[j] = 0;
+    for (p = Lp[j] + 1; p < Lp[j + 1]; p++) {
+
+      Lx[p] = x[Li[p]] / Lx[Lp[j]];
+      x[Li[p]] = 0;
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  Free1D(Rp);
+  Free1D(Rq);
+  Free1D(Rk);
+  Free1D(x);
+
+  return pd;
+
+}/*GPREC_NUMERIC*/
+
+/* factorize the precision matrix of the unobserved nodes, reusing the last
+ * factor if the observed nodes are the same. */
+gprec_factor *c_gprec_factor(gprec *gp, bool *observed, bool debugging) {
+
+int i = 0, n = (*gp).nnodes;
+gprec_factor *f = (*gp).last;
+
+  if (f && (memcmp((*f).observed, observed, n * sizeof(bool)) == 0))
+    return f;
+
+  FreeGPRECFACTOR(f);
+  (*gp).last = NULL;
+
+  f = Calloc1D(1, sizeof(gprec_factor));
+  (*f).observed = Calloc1D(n, sizeof(bool));
+  (*f).free = Calloc1D(n, sizeof(int));
+  (*f).pos = Calloc1D(n, sizeof(int));
+  memcpy((*f).observed, observed, n * sizeof(bool));
+
+  for (i = 0; i < n; i++) {
+
+    (*f).pos[i] = -1;
+    if (!observed[i])
+      (*f).free[(*f).nfree++] = i;
+
+  }/*FOR*/
+
+  gprec_symbolic(gp, f);
+
+  if (!gprec_numeric(gp, f)) {
+
+    FreeGPRECFACTOR(f);
+    error("the precision matrix is not positive definite.");
+
+  }/*THEN*/
+
+  if (debugging)
+    Rprintf("  > factorized the precision matrix of %d unobserved nodes (%d non-zero elements).\n",
+      (*f).nfree, (*f).Lp[(*f).nfree]);
+
+  (*gp).last = f;
+
+  return f;
+
+}/*C_GPREC_FACTOR*/
+
+/* compute the conditional expectations of the unobserved nodes given the values
+ * of the observed nodes in x, by solving K_UU mean_U = h_U - K_UO x_O. The
+ * values of observed nodes are copied over. */
+void c_gprec_condmean(gprec *gp, gprec_factor *f, double *x, double *mean,
+    double *work) {
+
+int j = 0, p = 0, v = 0, nfree = (*f).nfree, *Lp = (*f).Lp, *Li = (*f).Li;
+double s = 0, *Lx = (*f).Lx;
+
+  /* the right-hand side, in elimination order. */
+  for (j = 0; j < nfree; j++) {
+
+    v = (*f).free[j];
+    s = (*gp).h[v];
+    for (p = (*gp).Kp[v]; p < (*gp).Kp[v + 1]; p++)
+      if ((*f).observed[(*gp).Ki[p]])
+        s -= (*gp).Kx[p] * x[(*gp).Ki[p]];
+
+    work[j] = s;
+
+  }/*FOR*/
+
+  /* forward substitution with L... */
+  for (j = 0; j < nfree; j++) {
+
+    work[j] /= Lx[Lp[j]];
+    for (p = Lp[j] + 1; p < Lp[j + 1]; p++)
+      work[Li[p]] -= Lx[p] * work[j];
+
+  }/*FOR*/
+
+  /* ... and backward substitution with t(L). */
+  for (j = nfree - 1; j >= 0; j--) {
+
+    s = work[j];
+    for (p = Lp[j] + 1; p < Lp[j + 1]; p++)
+      s -= Lx[p] * work[Li[p]];
+    work[j] = s / Lx[Lp[j]];
+
+  }/*FOR*/
+
+  for (v = 0; v < (*gp).nnodes; v++)
+    if ((*f).observed[v])
+      mean[v] = x[v];
+  for (j = 0; j < nfree; j++)
+    mean[(*f).free[j]] = work[j];
+
+}/*C_GPREC_CONDMEAN*/
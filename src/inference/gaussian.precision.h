@@ -0,0 +1,40 @@
+#ifndef GAUSSIAN_PRECISION_HEADER
+#define GAUSSIAN_PRECISION_HEADER
+
+#include "../fitted/fitted.h"
+
+/* the sparse Cholesky factor of the precision matrix of the unobserved nodes,
+ * for a given set of observed nodes. */
+typedef struct {
+
+  bool *observed;    /* the observed nodes the factor refers to. */
+  int nfree;         /* number of unobserved nodes. */
+  int *free;         /* unobserved nodes, in elimination order. */
+  int *pos;          /* position of each node in the elimination order (-1 for
+                      * observed nodes). */
+  int *Lp;           /* column pointers of the Cholesky factor. */
+  int *Li;           /* row indexes of the Cholesky factor, diagonal first. */
+  double *Lx;        /* values of the Cholesky factor. */
+
+} gprec_factor;
+
+/* the precision matrix of a Gaussian Bayesian network, in compressed sparse
+ * column format; its pattern is that of the moral graph. */
+typedef struct {
+
+  int nnodes;        /* number of nodes in the network. */
+  int *Kp;           /* column pointers. */
+  int *Ki;           /* row indexes. */
+  double *Kx;        /* values. */
+  double *h;         /* precision matrix times the mean vector. */
+  gprec_factor *last;/* factor for the last set of observed nodes. */
+
+} gprec;
+
+gprec *c_gprec_build(fitted_bn bn);
+gprec_factor *c_gprec_factor(gprec *gp, bool *observed, bool debugging);
+void c_gprec_condmean(gprec *gp, gprec_factor *f, double *x, double *mean,
+    double *work);
+void FreeGPREC(gprec *gp);
+
+#endif
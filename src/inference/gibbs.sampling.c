@@ -0,0 +1,293 @@
+#include "../include/rcore.h"
+#include "../core/allocations.h"
+#include "../include/globals.h"
+#include "../include/bn.h"
+#include "gibbs.sampling.h"
+
+/* build the Markov blanket factor lists of a discrete Bayesian network, with no
+ * evidence. */
+gibbs_sampler *c_gibbs_build(fitted_bn bn, int *poset) {
+
+int i = 0, j = 0, k = 0, f = 0, n = bn.nnodes, size = 0, *position = NULL;
+bool nan_found = FALSE;
+ldist *ld = NULL;
+gibbs_sampler *gs = NULL;
+
+  for (i = 0; i < n; i++)
+    if ((bn.node_types[i] != DNODE) && (bn.node_types[i] != ONODE))
+      error("node %s is not discrete, Gibbs sampling is not possible.",
+        bn.labels[i]);
+
+  gs = Calloc1D(1, sizeof(gibbs_sampler));
+  (*gs).nnodes = n;
+  (*gs).nlevels = Calloc1D(n, sizeof(int));
+  (*gs).cpt = Calloc1D(n, sizeof(double *));
+  (*gs).owned = Calloc1D(n, sizeof(double *));
+  (*gs).poset = Calloc1D(n, sizeof(int));
+  (*gs).voff = Calloc1D(n + 1, sizeof(int));
+  (*gs).nallowed = Calloc1D(n, sizeof(int));
+  memcpy((*gs).poset, poset, n * sizeof(int));
+
+  for (i = 0; i < n; i++) {
+
+    (*gs).nlevels[i] = (*gs).nallowed[i] = bn.ldists[i].d.dims[0];
+    (*gs).voff[i + 1] = (*gs).voff[i] + (*gs).nlevels[i];
+    (*gs).maxlevels = MAX((*gs).maxlevels, (*gs).nlevels[i]);
+
+  }/*FOR*/
+
+  for (i = 0; i < n; i++) {
+
+    ld = bn.ldists + i;
+
+    /* conditional distributions that were not estimated are replaced with
+     * uniform distributions, as in belief propagation. */
+    size = (*gs).nlevels[i];
+    for (j = 0; j < (*ld).nparents; j++)
+      size *= (*gs).nlevels[(*ld).parents[j]];
+
+    nan_found = FALSE;
+    for (k = 0; k < size; k += (*gs).nlevels[i])
+      if (ISNAN((*ld).d.cpt[k]))
+        nan_found = TRUE;
+
+    if (nan_found) {
+
+      (*gs).owned[i] = Calloc1D(size, sizeof(double));
+      memcpy((*gs).owned[i], (*ld).d.cpt, size * sizeof(double));
+      for (k = 0; k < size; k++)
+        if (ISNAN((*gs).owned[i][k]))
+          (*gs).owned[i][k] = 1.0 / (*gs).nlevels[i];
+      (*gs).cpt[i] = (*gs).owned[i];
+
+      warning("NaN conditional probabilities in %s, replaced with a uniform distribution.",
+        bn.labels[i]);
+
+    }/*THEN*/
+    else {
+
+      (*gs).cpt[i] = (*ld).d.cpt;
+
+    }/*ELSE*/
+
+  }/*FOR*/
+
+  /* list the local distributions in each Markov blanket, and replace the
+   * position of the node in each of them with its stride in the CPT. */
+  c_fitted_mb_factors(bn, &((*gs).fstart), &((*gs).factors), &position);
+  (*gs).fstride = Calloc1D((*gs).fstart[n], sizeof(int));
+
+  for (k = 0; k < (*gs).fstart[n]; k++) {
+
+    f = (*gs).factors[k];
+    (*gs).fstride[k] = 1;
+    for (j = 0; j < position[k]; j++)
+      (*gs).fstride[k] *= (j == 0) ? (*gs).nlevels[f] :
+                            (*gs).nlevels[bn.ldists[f].parents[j - 1]];
+
+  }/*FOR*/
+
+  Free1D(position);
+
+  /* the parents of each node, and their strides in its CPT. */
+  (*gs).pstart = Calloc1D(n + 1, sizeof(int));
+  for (i = 0; i < n; i++)
+    (*gs).pstart[i + 1] = (*gs).pstart[i] + bn.ldists[i].nparents;
+  (*gs).parents = Calloc1D((*gs).pstart[n], sizeof(int));
+  (*gs).pstride = Calloc1D((*gs).pstart[n], sizeof(int));
+
+  for (i = 0; i < n; i++) {
+
+    size = (*gs).nlevels[i];
+
+    for (j = 0; j < bn.ldists[i].nparents; j++) {
+
+      (*gs).parents[(*gs).pstart[i] + j] = bn.ldists[i].parents[j];
+      (*gs).pstride[(*gs).pstart[i] + j] = size;
+      size *= (*gs).nlevels[bn.ldists[i].parents[j]];
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  /* all levels are allowed until evidence is set. */
+  (*gs).evidence = Calloc1D((*gs).voff[n], sizeof(double));
+  for (k = 0; k < (*gs).voff[n]; k++)
+    (*gs).evidence[k] = 1;
+
+  return gs;
+
+}/*C_GIBBS_BUILD*/
+
+/* restrict a node to a set of (0-based) levels. */
+void c_gibbs_evidence(gibbs_sampler *gs, int node, int *levels, int nlevels) {
+
+double *ev = (*gs).evidence + (*gs).voff[node];
+
+  memset(ev, '\0', (*gs).nlevels[node] * sizeof(double));
+  for (int l = 0; l < nlevels; l++)
+    if ((levels[l] >= 0) && (levels[l] < (*gs).nlevels[node]))
+      ev[levels[l]] = 1;
+
+  (*gs).nallowed[node] = 0;
+  for (int l = 0; l < (*gs).nlevels[node]; l++)
+    (*gs).nallowed[node] += (ev[l] > 0);
+
+}/*C_GIBBS_EVIDENCE*/
+
+/* sample a level from unnormalized probabilities. */
+static int gibbs_draw(double *prob, int nlevels, double sum, rng_stream *rng) {
+
+int l = 0;
+double u = rng_stream_unif(rng) * sum;
+
+  for (l = 0; l < nlevels - 1; l++) {
+
+    u -= prob[l];
+    if ((u < 0) && (prob[l] > 0))
+      break;
+
+  }/*FOR*/
+
+  /* guard against rounding errors leaving u slightly positive. */
+  while ((l > 0) && (prob[l] == 0))
+    l--;
+
+  return l;
+
+}/*GIBBS_DRAW*/
+
+/* initialize a chain with forward sampling, with the nodes restricted to the
+ * levels allowed by the evidence; retry until all the local distributions give
+ * the initial state a positive probability, so that the chain never visits a
+ * state that is impossible. */
+bool c_gibbs_init(gibbs_sampler *gs, gibbs_chain *chain, int max_tries) {
+
+int i = 0, j = 0, l = 0, t = 0, cur = 0, nl = 0, off = 0;
+double sum = 0, *prob = (*chain).prob, *ev = NULL;
+bool ok = TRUE;
+
+  for (t = 0; t < max_tries; t++) {
+
+    ok = TRUE;
+
+    for (i = 0; (i < (*gs).nnodes) && ok; i++) {
+
+      cur = (*gs).poset[i];
+      nl = (*gs).nlevels[cur];
+      ev = (*gs).evidence + (*gs).voff[cur];
+
+      /* the column of the CPT matching the configuration of the parents. */
+      for (j = (*gs).pstart[cur], off = 0; j < (*gs).pstart[cur + 1]; j++)
+        off += (*gs).pstride[j] * (*chain).state[(*gs).parents[j]];
+
+      for (l = 0, sum = 0; l < nl; l++) {
+
+        prob[l] = (*gs).cpt[cur][off + l] * ev[l];
+        sum += prob[l];
+
+      }/*FOR*/
+
+      if (!(sum > 0)) {
+
+        ok = FALSE;
+        break;
+
+      }/*THEN*/
+
+      (*chain).state[cur] = gibbs_draw(prob, nl, sum, &((*chain).rng));
+      (*chain).cell[cur] = off + (*chain).state[cur];
+
+    }/*FOR*/
+
+    /* the evidence on the children may still be impossible. */
+    for (i = 0; (i < (*gs).nnodes) && ok; i++)
+      if (!((*gs).cpt[i][(*chain).cell[i]] > 0))
+        ok = FALSE;
+
+    if (ok)
+      return TRUE;
+
+  }/*FOR*/
+
+  return FALSE;
+
+}/*C_GIBBS_INIT*/
+
+/* resample each node that is not fixed by the evidence from its full
+ * conditional distribution, in topological order. */
+void c_gibbs_sweep(gibbs_sampler *gs, gibbs_chain *chain) {
+
+int i = 0, k = 0, l = 0, cur = 0, nl = 0, old = 0, delta = 0, from = 0, to = 0;
+int *factors = (*gs).factors, *fstride = (*gs).fstride, *cell = (*chain).cell;
+double sum = 0, p = 0, *prob = (*chain).prob, *ev = NULL;
+
+  for (i = 0; i < (*gs).nnodes; i++) {
+
+    cur = (*gs).poset[i];
+
+    if ((*gs).nallowed[cur] <= 1)
+      continue;
+
+    nl = (*gs).nlevels[cur];
+    ev = (*gs).evidence + (*gs).voff[cur];
+    old = (*chain).state[cur];
+    from = (*gs).fstart[cur];
+    to = (*gs).fstart[cur + 1];
+
+    /* the product of the local distributions in the Markov blanket, moving
+     * along the CPTs from the cells of the current state. */
+    for (l = 0, sum = 0; l < nl; l++) {
+
+      if (ev[l] == 0) {
+
+        prob[l] = 0;
+        continue;
+
+      }/*THEN*/
+
+      for (k = from, p = 1; k < to; k++)
+        p *= (*gs).cpt[factors[k]][cell[factors[k]] + fstride[k] * (l - old)];
+
+      prob[l] = p;
+      sum += p;
+
+    }/*FOR*/
+
+    /* keep the current level if all probabilities underflow. */
+    if (!(sum > 0))
+      continue;
+
+    delta = gibbs_draw(prob, nl, sum, &((*chain).rng)) - old;
+    (*chain).state[cur] += delta;
+    for (k = from; k < to; k++)
+      cell[factors[k]] += fstride[k] * delta;
+
+  }/*FOR*/
+
+}/*C_GIBBS_SWEEP*/
+
+void FreeGIBBS(gibbs_sampler *gs) {
+
+  if (!gs)
+    return;
+
+  for (int i = 0; i < (*gs).nnodes; i++)
+    Free1D((*gs).owned[i]);
+
+  Free1D((*gs).nlevels);
+  Free1D((*gs).cpt);
+  Free1D((*gs).owned);
+  Free1D((*gs).fstart);
+  Free1D((*gs).factors);
+  Free1D((*gs).fstride);
+  Free1D((*gs).pstart);
+  Free1D((*gs).parents);
+  Free1D((*gs).pstride);
+  Free1D((*gs).poset);
+  Free1D((*gs).voff);
+  Free1D((*gs).evidence);
+  Free1D((*gs).nallowed);
+  Free1D(gs);
+
+}/*FREEGIBBS*/
@@ -0,0 +1,47 @@
+#ifndef GIBBS_SAMPLING_HEADER
+#define GIBBS_SAMPLING_HEADER
+
+#include "../fitted/fitted.h"
+#include "../core/random.streams.h"
+
+/* a Gibbs sampler for a discrete Bayesian network: the full conditional
+ * distribution of each node is the product of the local distributions in its
+ * Markov blanket, which are indexed directly in the flat CPTs. */
+typedef struct {
+
+  int nnodes;        /* number of nodes in the network. */
+  int *nlevels;      /* number of levels of each node. */
+  const double **cpt;/* the CPT of each node. */
+  double **owned;    /* CPTs with missing values replaced, if any. */
+  int *fstart;       /* the local distributions in the Markov blanket of each
+                      * node, as positions in factors. */
+  int *factors;      /* the local distributions in the Markov blankets. */
+  int *fstride;      /* the stride of the node in the CPT of each of them. */
+  int *pstart;       /* the parents of each node, as positions in parents. */
+  int *parents;      /* the parents of the nodes. */
+  int *pstride;      /* the stride of each parent in the CPT of the node. */
+  int *poset;        /* topological ordering of the nodes. */
+  int *voff;         /* offset of the evidence of each node. */
+  double *evidence;  /* which levels of each node are allowed. */
+  int *nallowed;     /* how many levels of each node are allowed. */
+  int maxlevels;     /* largest number of levels of any node. */
+
+} gibbs_sampler;
+
+/* the state of a Markov chain. */
+typedef struct {
+
+  int *state;        /* current (0-based) level of each node. */
+  int *cell;         /* current cell of the CPT of each node. */
+  double *prob;      /* scratch space for the full conditional distributions. */
+  rng_stream rng;    /* the random number stream of the chain. */
+
+} gibbs_chain;
+
+gibbs_sampler *c_gibbs_build(fitted_bn bn, int *poset);
+void c_gibbs_evidence(gibbs_sampler *gs, int node, int *levels, int nlevels);
+bool c_gibbs_init(gibbs_sampler *gs, gibbs_chain *chain, int max_tries);
+void c_gibbs_sweep(gibbs_sampler *gs, gibbs_chain *chain);
+void FreeGIBBS(gibbs_sampler *gs);
+
+#endif
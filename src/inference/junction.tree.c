@@ -0,0 +1,628 @@
+#include "../include/rcore.h"
+#include "../core/allocations.h"
+#include "../include/globals.h"
+#include "../math/linear.algebra.h"
+#include "junction.tree.h"
+
+/* map each cell of a table over the variables in "avars" to the corresponding
+ * cell of a table over the variables in "bvars", which must be a subset of
+ * "avars". In both tables the first variable varies fastest. */
+static void jt_index_map(int *avars, int na, int *bvars, int nb, int *nlevels,
+    int *map, int size) {
+
+int j = 0, k = 0, idx = 0, stride = 1, *mult = NULL, *counter = NULL;
+
+  mult = Calloc1D(na, sizeof(int));
+  counter = Calloc1D(na, sizeof(int));
+
+  /* the stride of each variable of the first table in the second table, zero if
+   * it does not appear in the second table. */
+  for (k = 0; k < nb; k++) {
+
+    for (j = 0; j < na; j++)
+      if (avars[j] == bvars[k])
+        mult[j] = stride;
+
+    stride *= nlevels[bvars[k]];
+
+  }/*FOR*/
+
+  for (k = 0; k < size; k++) {
+
+    map[k] = idx;
+
+    /* move to the next cell, odometer-style. */
+    for (j = 0; j < na; j++) {
+
+      counter[j]++;
+      idx += mult[j];
+
+      if (counter[j] < nlevels[avars[j]])
+        break;
+
+      idx -= mult[j] * counter[j];
+      counter[j] = 0;
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  Free1D(mult);
+  Free1D(counter);
+
+}/*JT_INDEX_MAP*/
+
+/* triangulate the moral graph by eliminating the nodes in min-fill order
+ * (breaking ties by the size of the clique, then by node index), and return the
+ * cliques created by the elimination as membership vectors. */
+static int jt_triangulate(bool *adj, int nnodes, int *nlevels, bool **cliques,
+    bool debugging) {
+
+int i = 0, j = 0, k = 0, v = 0, best = 0, nclq = 0, nnbr = 0, *nbr = NULL;
+double fill = 0, weight = 0, best_fill = 0, best_weight = 0;
+bool *eliminated = NULL;
+
+  eliminated = Calloc1D(nnodes, sizeof(bool));
+  nbr = Calloc1D(nnodes, sizeof(int));
+
+  for (i = 0; i < nnodes; i++) {
+
+    best = -1;
+
+    for (v = 0; v < nnodes; v++) {
+
+      if (eliminated[v])
+        continue;
+
+      /* count the fill-in edges and the size of the clique. */
+      nnbr = 0;
+      weight = nlevels[v];
+      for (j = 0; j < nnodes; j++)
+        if (!eliminated[j] && adj[CMC(v, j, nnodes)]) {
+
+          nbr[nnbr++] = j;
+          weight *= nlevels[j];
+
+        }/*THEN*/
+
+      fill = 0;
+      for (j = 0; j < nnbr; j++)
+        for (k = j + 1; k < nnbr; k++)
+          if (!adj[CMC(nbr[j], nbr[k], nnodes)])
+            fill++;
+
+      if ((best < 0) || (fill < best_fill) ||
+          ((fill == best_fill) && (weight < best_weight))) {
+
+        best = v;
+        best_fill = fill;
+        best_weight = weight;
+
+      }/*THEN*/
+
+    }/*FOR*/
+
+    /* eliminate the node, connecting all its neighbours. */
+    nnbr = 0;
+    cliques[nclq] = Calloc1D(nnodes, sizeof(bool));
+    cliques[nclq][best] = TRUE;
+    for (j = 0; j < nnodes; j++)
+      if (!eliminated[j] && adj[CMC(best, j, nnodes)]) {
+
+        nbr[nnbr++] = j;
+        cliques[nclq][j] = TRUE;
+
+      }/*THEN*/
+
+    for (j = 0; j < nnbr; j++)
+      for (k = j + 1; k < nnbr; k++)
+        adj[CMC(nbr[j], nbr[k], nnodes)] = adj[CMC(nbr[k], nbr[j], nnodes)] = TRUE;
+
+    if (debugging)
+      Rprintf("  > eliminating node %d (%g fill-in edges, clique size %g).\n",
+        best + 1, best_fill, best_weight);
+
+    eliminated[best] = TRUE;
+    nclq++;
+
+  }/*FOR*/
+
+  Free1D(eliminated);
+  Free1D(nbr);
+
+  return nclq;
+
+}/*JT_TRIANGULATE*/
+
+/* check whether the first clique is a subset of the second. */
+static bool jt_subset(bool *a, bool *b, int nnodes) {
+
+  for (int i = 0; i < nnodes; i++)
+    if (a[i] && !b[i])
+      return FALSE;
+
+  return TRUE;
+
+}/*JT_SUBSET*/
+
+/* build the junction tree of a discrete Bayesian network: moralize the graph,
+ * triangulate it, connect the maximal cliques with a maximum-weight spanning
+ * tree and initialize the clique potentials with the CPTs. */
+jtree *c_jtree_compile(fitted_bn bn, bool debugging) {
+
+int i = 0, j = 0, k = 0, c = 0, p = 0, n = bn.nnodes, ncand = 0, nclq = 0;
+int *nlevels = NULL, *family = NULL, *fmap = NULL, *best = NULL, *bestp = NULL;
+int nsep = 0, *sepnodes = NULL, maxsep = 1;
+bool *adj = NULL, **cand = NULL, **member = NULL, *intree = NULL, *keep = NULL;
+bool nan_found = FALSE;
+double size = 0, *cpt = NULL;
+ldist *ld = NULL;
+jtree *jt = NULL;
+
+  for (i = 0; i < n; i++)
+    if ((bn.node_types[i] != DNODE) && (bn.node_types[i] != ONODE))
+      error("node %s is not discrete, exact inference is not possible.",
+        bn.labels[i]);
+
+  nlevels = Calloc1D(n, sizeof(int));
+  for (i = 0; i < n; i++)
+    nlevels[i] = bn.ldists[i].d.dims[0];
+
+  /* moralize the graph: link each node to its parents, and marry the parents,
+   * as in dag2ug() with moral = TRUE. */
+  adj = Calloc1D((size_t)n * n, sizeof(bool));
+  for (i = 0; i < n; i++) {
+
+    ld = bn.ldists + i;
+
+    for (j = 0; j < (*ld).nparents; j++) {
+
+      adj[CMC(i, (*ld).parents[j], n)] = adj[CMC((*ld).parents[j], i, n)] = TRUE;
+
+      for (k = j + 1; k < (*ld).nparents; k++)
+        adj[CMC((*ld).parents[j], (*ld).parents[k], n)] =
+          adj[CMC((*ld).parents[k], (*ld).parents[j], n)] = TRUE;
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  if (debugging)
+    Rprintf("* triangulating the moral graph.\n");
+
+  /* triangulate the moral graph, and only keep the maximal cliques. */
+  cand = Calloc1D(n, sizeof(bool *));
+  ncand = jt_triangulate(adj, n, nlevels, cand, debugging);
+
+  keep = Calloc1D(ncand, sizeof(bool));
+  for (i = 0; i < ncand; i++) {
+
+    keep[i] = TRUE;
+
+    for (j = 0; j < ncand; j++) {
+
+      if ((i == j) || !jt_subset(cand[i], cand[j], n))
+        continue;
+      /* drop duplicates only once. */
+      if ((j < i) || !jt_subset(cand[j], cand[i], n)) {
+
+        keep[i] = FALSE;
+        break;
+
+      }/*THEN*/
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  member = Calloc1D(ncand, sizeof(bool *));
+  for (i = 0; i < ncand; i++)
+    if (keep[i])
+      member[nclq++] = cand[i];
+    else
+      Free1D(cand[i]);
+
+  /* allocate the junction tree. */
+  jt = Calloc1D(1, sizeof(jtree));
+  (*jt).nnodes = n;
+  (*jt).nlevels = nlevels;
+  (*jt).nclq = nclq;
+  (*jt).clqsize = Calloc1D(nclq, sizeof(int));
+  (*jt).clqnodes = Calloc1D(nclq, sizeof(int *));
+  (*jt).tabsize = Calloc1D(nclq, sizeof(int));
+  (*jt).order = Calloc1D(nclq, sizeof(int));
+  (*jt).parent = Calloc1D(nclq, sizeof(int));
+  (*jt).sepsize = Calloc1D(nclq, sizeof(int));
+  (*jt).sepmap = Calloc1D(nclq, sizeof(int *));
+  (*jt).pmap = Calloc1D(nclq, sizeof(int *));
+  (*jt).home = Calloc1D(n, sizeof(int));
+  (*jt).init = Calloc1D(nclq, sizeof(double *));
+  (*jt).pot = Calloc1D(nclq, sizeof(double *));
+  (*jt).sep = Calloc1D(nclq, sizeof(double *));
+
+  for (c = 0; c < nclq; c++) {
+
+    (*jt).clqnodes[c] = Calloc1D(n, sizeof(int));
+    size = 1;
+    for (i = 0; i < n; i++)
+      if (member[c][i]) {
+
+        (*jt).clqnodes[c][(*jt).clqsize[c]++] = i;
+        size *= nlevels[i];
+
+      }/*THEN*/
+
+    if (size >= INT_MAX) {
+
+      for (i = 0; i < nclq; i++)
+        Free1D(member[i]);
+      Free1D(member);
+      Free1D(cand);
+      Free1D(keep);
+      Free1D(adj);
+      FreeJTREE(jt);
+
+      error("the junction tree has a clique with more than INT_MAX cells.");
+
+    }/*THEN*/
+
+    (*jt).tabsize[c] = (int)size;
+
+  }/*FOR*/
+
+  /* connect the cliques with a maximum-weight spanning tree, the weights being
+   * the sizes of the separators (Prim's algorithm); disconnected components are
+   * joined by empty separators. */
+  intree = Calloc1D(nclq, sizeof(bool));
+  best = Calloc1D(nclq, sizeof(int));
+  bestp = Calloc1D(nclq, sizeof(int));
+  for (c = 0; c < nclq; c++) {
+
+    best[c] = -1;
+    bestp[c] = -1;
+
+  }/*FOR*/
+
+  for (k = 0; k < nclq; k++) {
+
+    /* pick the clique with the largest separator with the current tree. */
+    c = -1;
+    for (i = 0; i < nclq; i++)
+      if (!intree[i] && ((c < 0) || (best[i] > best[c])))
+        c = i;
+
+    intree[c] = TRUE;
+    (*jt).order[k] = c;
+    (*jt).parent[c] = bestp[c];
+
+    for (i = 0; i < nclq; i++) {
+
+      if (intree[i])
+        continue;
+
+      nsep = 0;
+      for (j = 0; j < n; j++)
+        if (member[c][j] && member[i][j])
+          nsep++;
+
+      if (nsep > best[i]) {
+
+        best[i] = nsep;
+        bestp[i] = c;
+
+      }/*THEN*/
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  /* build the separators and the maps from the cells of the cliques to the
+   * cells of the separators. */
+  sepnodes = Calloc1D(n, sizeof(int));
+  for (c = 0; c < nclq; c++) {
+
+    p = (*jt).parent[c];
+
+    if (p < 0)
+      continue;
+
+    nsep = 0;
+    (*jt).sepsize[c] = 1;
+    for (j = 0; j < n; j++)
+      if (member[c][j] && member[p][j]) {
+
+        sepnodes[nsep++] = j;
+        (*jt).sepsize[c] *= nlevels[j];
+
+      }/*THEN*/
+
+    maxsep = MAX(maxsep, (*jt).sepsize[c]);
+
+    (*jt).sep[c] = Calloc1D((*jt).sepsize[c], sizeof(double));
+    (*jt).sepmap[c] = Calloc1D((*jt).tabsize[c], sizeof(int));
+    (*jt).pmap[c] = Calloc1D((*jt).tabsize[p], sizeof(int));
+    jt_index_map((*jt).clqnodes[c], (*jt).clqsize[c], sepnodes, nsep, nlevels,
+      (*jt).sepmap[c], (*jt).tabsize[c]);
+    jt_index_map((*jt).clqnodes[p], (*jt).clqsize[p], sepnodes, nsep, nlevels,
+      (*jt).pmap[c], (*jt).tabsize[p]);
+
+  }/*FOR*/
+
+  (*jt).work = Calloc1D(maxsep, sizeof(double));
+
+  /* the home clique of each node is the smallest clique containing it. */
+  for (i = 0; i < n; i++) {
+
+    (*jt).home[i] = -1;
+
+    for (c = 0; c < nclq; c++)
+      if (member[c][i] && (((*jt).home[i] < 0) ||
+          ((*jt).tabsize[c] < (*jt).tabsize[(*jt).home[i]])))
+        (*jt).home[i] = c;
+
+  }/*FOR*/
+
+  /* multiply each CPT into the smallest clique containing the node and its
+   * parents. */
+  for (c = 0; c < nclq; c++) {
+
+    (*jt).init[c] = Calloc1D((*jt).tabsize[c], sizeof(double));
+    (*jt).pot[c] = Calloc1D((*jt).tabsize[c], sizeof(double));
+
+    for (k = 0; k < (*jt).tabsize[c]; k++)
+      (*jt).init[c][k] = 1;
+
+  }/*FOR*/
+
+  family = Calloc1D(n, sizeof(int));
+  for (i = 0; i < n; i++) {
+
+    ld = bn.ldists + i;
+
+    family[0] = i;
+    for (j = 0; j < (*ld).nparents; j++)
+      family[j + 1] = (*ld).parents[j];
+
+    p = -1;
+    for (c = 0; c < nclq; c++) {
+
+      for (j = 0; j <= (*ld).nparents; j++)
+        if (!member[c][family[j]])
+          break;
+
+      if ((j > (*ld).nparents) &&
+          ((p < 0) || ((*jt).tabsize[c] < (*jt).tabsize[p])))
+        p = c;
+
+    }/*FOR*/
+
+    /* conditional distributions that were not estimated are replaced with
+     * uniform distributions, as in from.bn.fit.to.grain(). */
+    size = 1;
+    for (j = 0; j <= (*ld).nparents; j++)
+      size *= nlevels[family[j]];
+    cpt = Calloc1D((size_t)size, sizeof(double));
+    memcpy(cpt, (*ld).d.cpt, (size_t)size * sizeof(double));
+
+    nan_found = FALSE;
+    for (k = 0; k < (int)size; k += nlevels[i]) {
+
+      if (!ISNAN(cpt[k]))
+        continue;
+
+      for (j = 0; j < nlevels[i]; j++)
+        cpt[k + j] = 1.0 / nlevels[i];
+      nan_found = TRUE;
+
+    }/*FOR*/
+
+    if (nan_found)
+      warning("NaN conditional probabilities in %s, replaced with a uniform distribution.",
+        bn.labels[i]);
+
+    fmap = Calloc1D((*jt).tabsize[p], sizeof(int));
+    jt_index_map((*jt).clqnodes[p], (*jt).clqsize[p], family,
+      (*ld).nparents + 1, nlevels, fmap, (*jt).tabsize[p]);
+    for (k = 0; k < (*jt).tabsize[p]; k++)
+      (*jt).init[p][k] *= cpt[fmap[k]];
+
+    Free1D(fmap);
+    Free1D(cpt);
+
+  }/*FOR*/
+
+  if (debugging)
+    for (k = 0; k < nclq; k++) {
+
+      c = (*jt).order[k];
+      Rprintf("  > clique %d has %d nodes and %d cells, parent clique %d.\n",
+        c + 1, (*jt).clqsize[c], (*jt).tabsize[c], (*jt).parent[c] + 1);
+
+    }/*FOR*/
+
+  for (c = 0; c < nclq; c++)
+    Free1D(member[c]);
+  Free1D(member);
+  Free1D(cand);
+  Free1D(keep);
+  Free1D(adj);
+  Free1D(intree);
+  Free1D(best);
+  Free1D(bestp);
+  Free1D(sepnodes);
+  Free1D(family);
+
+  c_jtree_reset(jt);
+
+  return jt;
+
+}/*C_JTREE_COMPILE*/
+
+/* restore the clique potentials to their state before entering evidence. */
+void c_jtree_reset(jtree *jt) {
+
+  for (int c = 0; c < (*jt).nclq; c++)
+    memcpy((*jt).pot[c], (*jt).init[c], (*jt).tabsize[c] * sizeof(double));
+
+  (*jt).lognorm = 0;
+
+}/*C_JTREE_RESET*/
+
+/* enter hard evidence (a 0-based level) on a node, zeroing the cells of its home
+ * clique that are inconsistent with it. */
+void c_jtree_evidence(jtree *jt, int node, int level) {
+
+int c = (*jt).home[node], j = 0, k = 0, stride = 1, nl = (*jt).nlevels[node];
+double *pot = (*jt).pot[c];
+
+  for (j = 0; (*jt).clqnodes[c][j] != node; j++)
+    stride *= (*jt).nlevels[(*jt).clqnodes[c][j]];
+
+  for (k = 0; k < (*jt).tabsize[c]; k++)
+    if ((k / stride) % nl != level)
+      pot[k] = 0;
+
+}/*C_JTREE_EVIDENCE*/
+
+/* Hugin propagation: collect the evidence towards the root and distribute it
+ * back to the leaves, after which each clique potential is the posterior
+ * distribution of its nodes. Collect messages are rescaled to sum to one, and
+ * the logarithm of the probability of the evidence is returned. */
+double c_jtree_propagate(jtree *jt) {
+
+int i = 0, k = 0, c = 0, p = 0, root = (*jt).order[0];
+double sum = 0, *pot = NULL, *sep = NULL, *work = (*jt).work;
+int *map = NULL;
+
+  /* collect: from the leaves to the root. */
+  for (i = (*jt).nclq - 1; i > 0; i--) {
+
+    c = (*jt).order[i];
+    p = (*jt).parent[c];
+    pot = (*jt).pot[c];
+    sep = (*jt).sep[c];
+    map = (*jt).sepmap[c];
+
+    memset(sep, '\0', (*jt).sepsize[c] * sizeof(double));
+    for (k = 0; k < (*jt).tabsize[c]; k++)
+      sep[map[k]] += pot[k];
+
+    sum = 0;
+    for (k = 0; k < (*jt).sepsize[c]; k++)
+      sum += sep[k];
+
+    if (sum <= 0) {
+
+      (*jt).lognorm = R_NegInf;
+      return R_NegInf;
+
+    }/*THEN*/
+
+    (*jt).lognorm += log(sum);
+
+    /* the separator keeps the marginal of the clique, while the message is
+     * rescaled to sum to one. */
+    pot = (*jt).pot[p];
+    map = (*jt).pmap[c];
+    for (k = 0; k < (*jt).tabsize[p]; k++)
+      pot[k] *= sep[map[k]] / sum;
+
+  }/*FOR*/
+
+  /* normalize the root clique. */
+  pot = (*jt).pot[root];
+  sum = 0;
+  for (k = 0; k < (*jt).tabsize[root]; k++)
+    sum += pot[k];
+
+  if (sum <= 0) {
+
+    (*jt).lognorm = R_NegInf;
+    return R_NegInf;
+
+  }/*THEN*/
+
+  for (k = 0; k < (*jt).tabsize[root]; k++)
+    pot[k] /= sum;
+  (*jt).lognorm += log(sum);
+
+  /* distribute: from the root to the leaves. */
+  for (i = 1; i < (*jt).nclq; i++) {
+
+    c = (*jt).order[i];
+    p = (*jt).parent[c];
+    sep = (*jt).sep[c];
+
+    memset(work, '\0', (*jt).sepsize[c] * sizeof(double));
+    pot = (*jt).pot[p];
+    map = (*jt).pmap[c];
+    for (k = 0; k < (*jt).tabsize[p]; k++)
+      work[map[k]] += pot[k];
+
+    for (k = 0; k < (*jt).sepsize[c]; k++)
+      work[k] = (sep[k] > 0) ? work[k] / sep[k] : 0;
+
+    pot = (*jt).pot[c];
+    map = (*jt).sepmap[c];
+    for (k = 0; k < (*jt).tabsize[c]; k++)
+      pot[k] *= work[map[k]];
+
+  }/*FOR*/
+
+  return (*jt).lognorm;
+
+}/*C_JTREE_PROPAGATE*/
+
+/* compute the posterior marginal distribution of a node from its home clique. */
+void c_jtree_marginal(jtree *jt, int node, double *marginal) {
+
+int c = (*jt).home[node], j = 0, k = 0, stride = 1, nl = (*jt).nlevels[node];
+double sum = 0, *pot = (*jt).pot[c];
+
+  for (j = 0; (*jt).clqnodes[c][j] != node; j++)
+    stride *= (*jt).nlevels[(*jt).clqnodes[c][j]];
+
+  memset(marginal, '\0', nl * sizeof(double));
+  for (k = 0; k < (*jt).tabsize[c]; k++)
+    marginal[(k / stride) % nl] += pot[k];
+
+  for (j = 0; j < nl; j++)
+    sum += marginal[j];
+  for (j = 0; j < nl; j++)
+    marginal[j] /= sum;
+
+}/*C_JTREE_MARGINAL*/
+
+void FreeJTREE(jtree *jt) {
+
+  if (!jt)
+    return;
+
+  for (int c = 0; c < (*jt).nclq; c++) {
+
+    Free1D((*jt).clqnodes[c]);
+    Free1D((*jt).sepmap[c]);
+    Free1D((*jt).pmap[c]);
+    Free1D((*jt).init[c]);
+    Free1D((*jt).pot[c]);
+    Free1D((*jt).sep[c]);
+
+  }/*FOR*/
+
+  Free1D((*jt).nlevels);
+  Free1D((*jt).clqsize);
+  Free1D((*jt).clqnodes);
+  Free1D((*jt).tabsize);
+  Free1D((*jt).order);
+  Free1D((*jt).parent);
+  Free1D((*jt).sepsize);
+  Free1D((*jt).sepmap);
+  Free1D((*jt).pmap);
+  Free1D((*jt).home);
+  Free1D((*jt).init);
+  Free1D((*jt).pot);
+  Free1D((*jt).sep);
+  Free1D((*jt).work);
+  Free1D(jt);
+
+}/*FREEJTREE*/
@@ -0,0 +1,38 @@
+#ifndef JUNCTION_TREE_HEADER
+#define JUNCTION_TREE_HEADER
+
+#include "../fitted/fitted.h"
+
+/* a junction tree for a discrete Bayesian network, with the clique potentials
+ * stored as flat arrays (the variable with the lowest index varies fastest). */
+typedef struct {
+
+  int nnodes;        /* number of nodes in the network. */
+  int *nlevels;      /* number of levels of each node. */
+  int nclq;          /* number of cliques. */
+  int *clqsize;      /* number of nodes in each clique. */
+  int **clqnodes;    /* nodes in each clique, in increasing order. */
+  int *tabsize;      /* number of cells in each clique potential. */
+  int *order;        /* cliques in the order they were added to the tree, each
+                      * after its parent (the root comes first). */
+  int *parent;       /* parent of each clique (-1 for the root). */
+  int *sepsize;      /* number of cells in the separator with the parent. */
+  int **sepmap;      /* cells of the separator for each cell of the clique. */
+  int **pmap;        /* cells of the separator for each cell of the parent. */
+  int *home;         /* the smallest clique containing each node. */
+  double **init;     /* clique potentials, before entering evidence. */
+  double **pot;      /* clique potentials, after propagation. */
+  double **sep;      /* separator potentials. */
+  double *work;      /* scratch space, as large as the largest separator. */
+  double lognorm;    /* log-normalizing constant from the last propagation. */
+
+} jtree;
+
+jtree *c_jtree_compile(fitted_bn bn, bool debugging);
+void c_jtree_reset(jtree *jt);
+void c_jtree_evidence(jtree *jt, int node, int level);
+double c_jtree_propagate(jtree *jt);
+void c_jtree_marginal(jtree *jt, int node, double *marginal);
+void FreeJTREE(jtree *jt);
+
+#endif
@@ -1,18 +1,23 @@
 #include "../include/rcore.h"
+#include "../core/allocations.h"
 #include "../core/math.functions.h"
-#include "../inference/loss.h"
+#include "../minimal/data.frame.h"
+#include "../minimal/common.h"
+#include "../include/globals.h"
+#include "../math/linear.algebra.h"
+#include "rbn.h"
 
-void c_lw_weights(SEXP fitted, SEXP data, int n, double *w, SEXP keep,
-    bool debugging) {
+/* number of particles simulated at a time by c_lw_particles(), which bounds the
+ * memory used for the nodes that are not returned. */
+#define LW_CHUNK 8192
+
+/* rescale the log-weights before exponentiating them into probabilities (if
+ * possible). */
+void lw_rescale(double *w, int n) {
 
 int i = 0, max_el = 0;
 double maxw = 0;
 
-  /* ensure the buffer is clean. */
-  memset(w, '\0', n * sizeof(double));
-  /* compute log-probabilities for each particle. */
-  c_entropy_loss(fitted, data, n, TRUE, w, NULL, keep, FALSE, FALSE, debugging);
-  /* rescale before exponentiating them into probabilities (if possible). */
   max_el = d_which_max(w, n);
 
   if (max_el == NA_INTEGER)
@@ -27,5 +32,200 @@ double maxw = 0;
 
   }/*ELSE*/
 
-}/*C_LW_WEIGHTS*/
+}/*LW_RESCALE*/
+
+/* add the log-density of an evidence node given its parents to the
+ * log-weights of the particles in [0, len). This does not touch the R API, so
+ * it can be called from parallel regions. */
+void lw_logdensity(compiled_bn *plan, void **cols, int cur, int len,
+    double *lw) {
+
+int i = 0, j = 0, cfg = 0, *x = NULL;
+ldist *ld = (*plan).bn.ldists + cur;
+double mean = 0, sd = 0, *y = NULL, *beta = NULL;
+
+  switch((*plan).bn.node_types[cur]) {
+
+    case DNODE:
+    case ONODE:
+      x = cols[cur];
+
+      for (i = 0; i < len; i++) {
+
+        cfg = lw_config(cols, (*ld).parents, (*plan).cumlevels[cur],
+                (*ld).nparents, i);
+
+        if ((cfg == NA_INTEGER) || (x[i] == NA_INTEGER) || (x[i] < 1))
+          lw[i] += NA_REAL;
+        else
+          lw[i] += log((*ld).d.cpt[CMC(x[i] - 1, cfg, (*plan).nlevels[cur])]);
+
+      }/*FOR*/
+
+      break;
+
+    case GNODE:
+      y = cols[cur];
+      beta = (*ld).g.coefs;
+      sd = ((*ld).g.sd < MACHINE_TOL) ? MACHINE_TOL : (*ld).g.sd;
+
+      for (i = 0; i < len; i++) {
+
+        mean = beta[0];
+        for (j = 1; j < (*ld).g.ncoefs; j++)
+          mean += ((double *)cols[(*ld).parents[j - 1]])[i] * beta[j];
+
+        lw[i] += dnorm(y[i], mean, sd, TRUE);
+
+      }/*FOR*/
+
+      break;
+
+    case CGNODE:
+      y = cols[cur];
+
+      for (i = 0; i < len; i++) {
+
+        cfg = lw_config(cols, (*ld).cg.dparents, (*plan).cumlevels[cur],
+                (*ld).cg.ndparents, i);
+
+        if (cfg == NA_INTEGER) {
+
+          lw[i] += NA_REAL;
+          continue;
+
+        }/*THEN*/
+
+        beta = (*ld).cg.coefs + ((*ld).cg.ngparents + 1) * cfg;
+        sd = ((*ld).cg.sd[cfg] < MACHINE_TOL) ? MACHINE_TOL : (*ld).cg.sd[cfg];
+
+        mean = beta[0];
+        for (j = 0; j < (*ld).cg.ngparents; j++)
+          mean += ((double *)cols[(*ld).cg.gparents[j]])[i] * beta[j + 1];
+
+        lw[i] += dnorm(y[i], mean, sd, TRUE);
+
+      }/*FOR*/
+
+      break;
+
+    case ENOFIT:
+    default:
+      break;
+
+  }/*SWITCH*/
+
+}/*LW_LOGDENSITY*/
+
+/* generate particles and their likelihood weights in a single pass over the
+ * nodes, simulating the nodes that are not fixed by the evidence and adding the
+ * log-densities of those that are. Particles are simulated in chunks, and only
+ * the columns of the nodes listed in "nodes" are returned. */
+SEXP c_lw_particles(SEXP fitted, SEXP nodes, int n, SEXP fix, bool debugging) {
+
+int i = 0, j = 0, k = 0, cur = 0, from = 0, len = 0, chunk = 0, nkeep = 0;
+int nnodes = 0, *keep = NULL;
+size_t *size = NULL;
+bool *warn = NULL;
+double *w = NULL;
+void **cols = NULL, **out = NULL;
+compiled_bn *plan = NULL;
+rbn_fixed *fixed = NULL;
+SEXP result, weights, try;
+
+  plan = compiled_network(fitted);
+  nnodes = (*plan).bn.nnodes;
+
+  for (i = 0; i < nnodes; i++)
+    if ((*plan).bn.node_types[i] == ENOFIT)
+      error("unknown node type (class: %s).",
+         CHAR(STRING_ELT(getAttrib(VECTOR_ELT(fitted, i), R_ClassSymbol), 0)));
+
+  /* allocate the return value, only for the nodes we were asked for. */
+  nkeep = length(nodes);
+  PROTECT(try = match(getAttrib(fitted, R_NamesSymbol), nodes, 0));
+  keep = INTEGER(try);
+  PROTECT(result = allocVector(VECSXP, nkeep));
+  for (k = 0; k < nkeep; k++)
+    SET_VECTOR_ELT(result, k, fitnode2df(fitted, STRING_ELT(nodes, k), n));
+  setAttrib(result, R_NamesSymbol, nodes);
+  if (nkeep > 0)
+    minimal_data_frame(result);
+  PROTECT(weights = allocVector(REALSXP, n));
+  w = REAL(weights);
+
+  /* match fixed nodes, if any, with the variables in the fitted network. */
+  fixed = rbn_match_fixed(plan, fitted, fix);
+
+  /* allocate the scratch space for one chunk of particles. */
+  chunk = MIN(n, LW_CHUNK);
+  cols = Calloc1D(nnodes, sizeof(void *));
+  size = Calloc1D(nnodes, sizeof(size_t));
+  for (i = 0; i < nnodes; i++) {
+
+    if (((*plan).bn.node_types[i] == DNODE) ||
+        ((*plan).bn.node_types[i] == ONODE))
+      size[i] = sizeof(int);
+    else
+      size[i] = sizeof(double);
+
+    cols[i] = Calloc1D(chunk, size[i]);
+
+  }/*FOR*/
+  out = Calloc1D(nkeep, sizeof(void *));
+  for (k = 0; k < nkeep; k++)
+    out[k] = DATAPTR(VECTOR_ELT(result, k));
+  warn = Calloc1D(nnodes, sizeof(bool));
+
+  if (debugging)
+    for (i = 0; i < nnodes; i++)
+      if (fixed[i].n > 0)
+        Rprintf("* weighting particles with the evidence on node %s.\n",
+          (*plan).bn.labels[i]);
+
+  GetRNGstate();
+
+  for (from = 0; from < n; from += chunk) {
+
+    len = MIN(n - from, chunk);
+    memset(w + from, '\0', len * sizeof(double));
+
+    /* simulate the nodes in topological order, weighting as soon as the
+     * parents of an evidence node are available. */
+    for (j = 0; j < nnodes; j++) {
+
+      cur = (*plan).poset[j];
+      rbn_node(plan, cols, fixed, cur, 0, len, NULL, warn);
+
+      if (fixed[cur].n > 0)
+        lw_logdensity(plan, cols, cur, len, w + from);
+
+    }/*FOR*/
+
+    /* save the nodes we were asked for. */
+    for (k = 0; k < nkeep; k++)
+      memcpy((char *)out[k] + from * size[keep[k] - 1], cols[keep[k] - 1],
+        len * size[keep[k] - 1]);
+
+  }/*FOR*/
+
+  PutRNGstate();
+
+  /* rescale before exponentiating them into probabilities (if possible). */
+  lw_rescale(w, n);
+
+  setAttrib(result, BN_WeightsSymbol, weights);
+
+  for (i = 0; i < nnodes; i++)
+    Free1D(cols[i]);
+  Free1D(cols);
+  Free1D(size);
+  Free1D(out);
+  Free1D(warn);
+  FreeRBNFIXED(fixed, nnodes);
+
+  UNPROTECT(3);
+
+  return result;
 
+}/*C_LW_PARTICLES*/
@@ -1,6 +1,15 @@
 #include "../../include/rcore.h"
+#include "../../include/parallel.h"
 #include "../../fitted/fitted.h"
 #include "../../core/data.table.h"
+#include "../../core/allocations.h"
+#include "../../core/math.functions.h"
+#include "../../math/linear.algebra.h"
+#include "loglikelihood.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 /* check whether the data are complete for all the local distributions of
  * interest. */
@@ -47,3 +56,490 @@ incomplete_data:
 
 }/*CHECK_LOCALLY_INCOMPLETE_DATA*/
 
+
+/* check whether any of the coefficients or the standard error of a Gaussian
+ * node we are considering is NA, which makes the log-likelihood NA; this is not
+ * necessarily the case for conditional Gaussian nodes, since not all their
+ * parameters are necessarily involved in the computation. */
+bool check_nan_gaussian_parameters(fitted_bn bn, meta m, bool debugging) {
+
+bool nan_found = FALSE;
+
+  for (int i = 0; i < bn.nnodes; i++) {
+
+    if ((!m.flag[i].fixed) || (bn.node_types[i] != GNODE))
+      continue;
+
+    nan_found = ISNAN(bn.ldists[i].g.sd);
+    for (int j = 0; j < bn.ldists[i].g.ncoefs; j++)
+      nan_found = nan_found || ISNAN(bn.ldists[i].g.coefs[j]);
+
+    if (nan_found) {
+
+      if (debugging)
+        Rprintf("* unidentifiable model in node %s, the log-likelihood is NA.\n",
+            bn.labels[i]);
+
+      return TRUE;
+
+    }/*THEN*/
+
+  }/*FOR*/
+
+  return FALSE;
+
+}/*CHECK_NAN_GAUSSIAN_PARAMETERS*/
+
+/* add the log-probabilities of the observations of a discrete node to their
+ * log-likelihoods: each is a lookup in the logarithm of the conditional
+ * probability table, indexed by the level of the node and the configuration of
+ * its parents (if any), so that the loop reduces to an index computation and a
+ * gather. Missing values are propagated if the data are not locally complete. */
+void logcpt_gather(double *logcpt, int *obs, int *parcfgs, int nlevels,
+    int nobs, bool complete, double *loglik) {
+
+int j = 0;
+
+  if (!complete) {
+
+    for (j = 0; j < nobs; j++) {
+
+      if ((obs[j] == NA_INTEGER) || (parcfgs && (parcfgs[j] == NA_INTEGER)))
+        loglik[j] = NA_REAL;
+      else
+        loglik[j] += logcpt[obs[j] - 1 + (parcfgs ? parcfgs[j] * nlevels : 0)];
+
+    }/*FOR*/
+
+    return;
+
+  }/*THEN*/
+
+  if (!parcfgs) {
+
+    for (j = 0; j < nobs; j++)
+      loglik[j] += logcpt[obs[j] - 1];
+
+    return;
+
+  }/*THEN*/
+
+#ifdef __AVX2__
+  /* four observations at a time; the cells of the table always fit in an int,
+   * because c_fast_config() checks the number of configurations. */
+  __m128i one = _mm_set1_epi32(1), nl = _mm_set1_epi32(nlevels);
+
+  for (; j + 4 <= nobs; j += 4) {
+
+    __m128i o = _mm_loadu_si128((const __m128i *)(obs + j));
+    __m128i c = _mm_loadu_si128((const __m128i *)(parcfgs + j));
+    __m128i idx = _mm_add_epi32(_mm_sub_epi32(o, one), _mm_mullo_epi32(c, nl));
+    __m256d lp = _mm256_i32gather_pd(logcpt, idx, 8);
+
+    _mm256_storeu_pd(loglik + j, _mm256_add_pd(_mm256_loadu_pd(loglik + j), lp));
+
+  }/*FOR*/
+#endif
+
+  for (; j < nobs; j++)
+    loglik[j] += logcpt[CMC(obs[j] - 1, parcfgs[j], nlevels)];
+
+}/*LOGCPT_GATHER*/
+
+/* whether a node and all its parents have no missing values. */
+static void locally_complete_nodes(fitted_bn bn, meta m, bool *complete) {
+
+  for (int i = 0; i < bn.nnodes; i++) {
+
+    complete[i] = m.flag[i].complete;
+    for (int k = 0; k < bn.ldists[i].nparents; k++)
+      complete[i] &= m.flag[bn.ldists[i].parents[k]].complete;
+
+  }/*FOR*/
+
+}/*LOCALLY_COMPLETE_NODES*/
+
+/* configurations of a set of discrete parents in a block of observations, with
+ * the first parent varying fastest as in c_fast_config() and with the number
+ * of levels of each parent taken from its conditional probability table. */
+static void block_configurations(fitted_bn bn, int *parents, int nparents,
+    void **columns, int from, int len, int *configs) {
+
+int j = 0, k = 0, stride = 1, *col = NULL;
+
+  for (j = 0; j < len; j++)
+    configs[j] = 0;
+
+  for (k = 0; k < nparents; k++) {
+
+    col = (int *)columns[parents[k]] + from;
+
+    for (j = 0; j < len; j++) {
+
+      if ((configs[j] == NA_INTEGER) || (col[j] == NA_INTEGER))
+        configs[j] = NA_INTEGER;
+      else
+        configs[j] += (col[j] - 1) * stride;
+
+    }/*FOR*/
+
+    stride *= bn.ldists[parents[k]].d.dims[0];
+
+  }/*FOR*/
+
+}/*BLOCK_CONFIGURATIONS*/
+
+/* log-likelihood of a block of observations for a single node, written in
+ * ll; missing values in discrete nodes and in the discrete parents of
+ * conditional Gaussian nodes give NA, those in continuous variables propagate
+ * through the arithmetic. */
+static void node_block_loglikelihood(fitted_bn bn, int i, void **columns,
+    bool complete, int from, int len, int *configs, double *ll) {
+
+int j = 0, k = 0, ncoefs = 0;
+double *obs = NULL, *par = NULL, *coefs = NULL;
+ldist *ld = bn.ldists + i;
+
+  switch(bn.node_types[i]) {
+
+    case DNODE:
+    case ONODE:
+
+      memset(ll, '\0', len * sizeof(double));
+      if ((*ld).nparents > 0)
+        block_configurations(bn, (*ld).parents, (*ld).nparents, columns,
+          from, len, configs);
+
+      logcpt_gather((*ld).d.logcpt, (int *)columns[i] + from,
+        ((*ld).nparents > 0) ? configs : NULL, (*ld).d.dims[0], len, complete,
+        ll);
+
+      break;
+
+    case GNODE:
+
+      obs = (double *)columns[i] + from;
+      coefs = (*ld).g.coefs;
+
+      /* the expected values are the intercept plus the effects of the
+       * parents... */
+      for (j = 0; j < len; j++)
+        ll[j] = coefs[0];
+      for (k = 0; k < (*ld).nparents; k++) {
+
+        par = (double *)columns[(*ld).parents[k]] + from;
+        for (j = 0; j < len; j++)
+          ll[j] += par[j] * coefs[k + 1];
+
+      }/*FOR*/
+
+      /* ... and they are used with the standard error in the density. */
+      gaussian_logdensity(obs, ll, len, (*ld).g.sd);
+
+      break;
+
+    case CGNODE:
+
+      obs = (double *)columns[i] + from;
+      coefs = (*ld).cg.coefs;
+      ncoefs = (*ld).cg.ncoefs;
+
+      /* the configurations of the discrete parents choose the regression... */
+      block_configurations(bn, (*ld).cg.dparents, (*ld).cg.ndparents, columns,
+        from, len, configs);
+
+      for (j = 0; j < len; j++)
+        ll[j] = (configs[j] == NA_INTEGER) ?
+                  NA_REAL : coefs[CMC(0, configs[j], ncoefs)];
+
+      /* ... which is then used as for Gaussian nodes. */
+      for (k = 0; k < (*ld).cg.ngparents; k++) {
+
+        par = (double *)columns[(*ld).cg.gparents[k]] + from;
+        for (j = 0; j < len; j++)
+          if (configs[j] != NA_INTEGER)
+            ll[j] += par[j] * coefs[CMC(k + 1, configs[j], ncoefs)];
+
+      }/*FOR*/
+
+      for (j = 0; j < len; j++)
+        if (configs[j] != NA_INTEGER)
+          ll[j] = dnorm(obs[j], ll[j], (*ld).cg.sd[configs[j]], TRUE);
+
+      break;
+
+    case ENOFIT:
+    default:
+
+      for (j = 0; j < len; j++)
+        ll[j] = 0;
+
+  }/*SWITCH*/
+
+}/*NODE_BLOCK_LOGLIKELIHOOD*/
+
+/* log-likelihood of individual observations: the observations are split in
+ * blocks that are processed in parallel, all the nodes for one block at a
+ * time, so that the configurations and the partial log-likelihoods stay in the
+ * cache. The result is the same regardless of the number of threads. */
+void bysample_loglikelihood_blocks(fitted_bn bn, meta m, void **columns,
+    double *loglik, bool debugging) {
+
+int nblocks = (m.nobs + LOGLIK_BLOCK - 1) / LOGLIK_BLOCK, nthreads = 1;
+int *configs = NULL;
+double *ll = NULL;
+bool *complete = NULL;
+
+  complete = Calloc1D(bn.nnodes, sizeof(bool));
+  locally_complete_nodes(bn, m, complete);
+
+  if (debugging)
+    for (int i = 0; i < bn.nnodes; i++)
+      if (m.flag[i].fixed)
+        Rprintf("* processing node %s.\n", bn.labels[i]);
+
+  /* allocate the scratch space of each thread beforehand. */
+  nthreads = MAX(1, MIN(MAX_THREADS, nblocks));
+  configs = Calloc1D(nthreads * LOGLIK_BLOCK, sizeof(int));
+  ll = Calloc1D(nthreads * LOGLIK_BLOCK, sizeof(double));
+
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+  for (int b = 0; b < nblocks; b++) {
+
+    int from = b * LOGLIK_BLOCK, len = MIN(m.nobs - from, LOGLIK_BLOCK);
+    int *cfg = configs + THREAD_ID * LOGLIK_BLOCK;
+    double *cur = ll + THREAD_ID * LOGLIK_BLOCK;
+
+    for (int i = 0; i < bn.nnodes; i++) {
+
+      if (!m.flag[i].fixed)
+        continue;
+
+      node_block_loglikelihood(bn, i, columns, complete[i], from, len, cfg,
+        cur);
+
+      for (int j = 0; j < len; j++) {
+
+        if (ISNA(cur[j]))
+          loglik[from + j] = NA_REAL;
+        else
+          loglik[from + j] += cur[j];
+
+      }/*FOR*/
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  Free1D(configs);
+  Free1D(ll);
+  Free1D(complete);
+
+}/*BYSAMPLE_LOGLIKELIHOOD_BLOCKS*/
+
+/* allocate the running totals of the log-likelihoods of the nodes. */
+loglik_totals new_loglik_totals(int nnodes) {
+
+loglik_totals tot = { 0 };
+
+  tot.nnodes = nnodes;
+  tot.sum = Calloc1D(nnodes, sizeof(long double));
+  tot.nused = Calloc1D(nnodes, sizeof(double));
+  tot.finite = Calloc1D(nnodes, sizeof(long double));
+  tot.nfinite = Calloc1D(nnodes, sizeof(double));
+
+  return tot;
+
+}/*NEW_LOGLIK_TOTALS*/
+
+/* add the log-likelihoods of a sample to the running totals of the nodes:
+ * the partial sums of each node over each block are computed in parallel and
+ * then reduced pairwise in a fixed order, so that the result is the same
+ * regardless of the number of threads. */
+void loglikelihood_totals_blocks(fitted_bn bn, meta m, void **columns,
+    loglik_totals *tot) {
+
+int nblocks = (m.nobs + LOGLIK_BLOCK - 1) / LOGLIK_BLOCK, nthreads = 1;
+int *configs = NULL, *nused = NULL, *nfinite = NULL;
+double *ll = NULL, *partial = NULL, *finite = NULL;
+bool *complete = NULL;
+
+  if (nblocks == 0)
+    return;
+
+  complete = Calloc1D(bn.nnodes, sizeof(bool));
+  locally_complete_nodes(bn, m, complete);
+
+  /* allocate the scratch space of each thread and the partial sums of each
+   * node and block beforehand. */
+  nthreads = MAX(1, MIN(MAX_THREADS, nblocks));
+  configs = Calloc1D(nthreads * LOGLIK_BLOCK, sizeof(int));
+  ll = Calloc1D(nthreads * LOGLIK_BLOCK, sizeof(double));
+  partial = Calloc1D(bn.nnodes * nblocks, sizeof(double));
+  nused = Calloc1D(bn.nnodes * nblocks, sizeof(int));
+  finite = Calloc1D(bn.nnodes * nblocks, sizeof(double));
+  nfinite = Calloc1D(bn.nnodes * nblocks, sizeof(int));
+
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+  for (int b = 0; b < nblocks; b++) {
+
+    int from = b * LOGLIK_BLOCK, len = MIN(m.nobs - from, LOGLIK_BLOCK);
+    int *cfg = configs + THREAD_ID * LOGLIK_BLOCK;
+    double *cur = ll + THREAD_ID * LOGLIK_BLOCK;
+
+    for (int i = 0; i < bn.nnodes; i++) {
+
+      double sum = 0, fsum = 0;
+      int n = 0, nf = 0;
+      bool discrete =
+        (bn.node_types[i] == DNODE) || (bn.node_types[i] == ONODE);
+
+      if (!m.flag[i].fixed)
+        continue;
+
+      node_block_loglikelihood(bn, i, columns, complete[i], from, len, cfg,
+        cur);
+
+      for (int j = 0; j < len; j++) {
+
+        /* the loss only uses observations with a finite log-likelihood... */
+        if (R_FINITE(cur[j])) {
+
+          fsum += cur[j];
+          nf++;
+
+        }/*THEN*/
+
+        /* ... while the log-likelihood drops missing values, which are NA for
+         * discrete nodes (NaN parameters propagate) and either NA or NaN for
+         * continuous nodes. */
+        if (discrete ? ISNA(cur[j]) : ISNAN(cur[j]))
+          continue;
+
+        sum += cur[j];
+        n++;
+
+      }/*FOR*/
+
+      partial[CMC(b, i, nblocks)] = sum;
+      nused[CMC(b, i, nblocks)] = n;
+      finite[CMC(b, i, nblocks)] = fsum;
+      nfinite[CMC(b, i, nblocks)] = nf;
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  for (int i = 0; i < bn.nnodes; i++) {
+
+    if (!m.flag[i].fixed)
+      continue;
+
+    (*tot).sum[i] += d_pairwise_sum(partial + CMC(0, i, nblocks), nblocks);
+    (*tot).finite[i] += d_pairwise_sum(finite + CMC(0, i, nblocks), nblocks);
+
+    for (int b = 0; b < nblocks; b++) {
+
+      (*tot).nused[i] += nused[CMC(b, i, nblocks)];
+      (*tot).nfinite[i] += nfinite[CMC(b, i, nblocks)];
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  Free1D(configs);
+  Free1D(ll);
+  Free1D(partial);
+  Free1D(nused);
+  Free1D(finite);
+  Free1D(nfinite);
+  Free1D(complete);
+
+}/*LOGLIKELIHOOD_TOTALS_BLOCKS*/
+
+/* combine the running totals into the log-likelihood of the whole sample: the
+ * observations that are not locally complete are dropped, and the
+ * log-likelihood of each node is rescaled to compensate. The log-likelihoods of
+ * the individual nodes are saved in node_loglik, if not NULL. */
+double loglikelihood_from_totals(fitted_bn bn, meta m, loglik_totals *tot,
+    double nobs, double *node_loglik, bool debugging) {
+
+double loglik = 0, cur = 0;
+
+  /* for each node... */
+  for (int i = 0; i < bn.nnodes; i++) {
+
+    /* ... that we want to consider... */
+    if (!m.flag[i].fixed)
+      continue;
+
+    if (debugging)
+      Rprintf("* processing node %s.\n", bn.labels[i]);
+
+    /* ... scale the log-likelihood to compensate for any missing values
+     * (which will not be propagated as a result), or return -Inf if there are
+     * no locally-complete observations. */
+    cur = (double)(*tot).sum[i];
+    if ((*tot).nused[i] == 0)
+      cur = R_NegInf;
+    else if ((*tot).nused[i] < nobs)
+      cur = cur / (*tot).nused[i] * nobs;
+
+    if (debugging) {
+
+      Rprintf("  > %.0lf locally-complete observations out of %.0lf.\n",
+        (*tot).nused[i], nobs);
+      Rprintf("  > log-likelihood is %lf.\n", cur);
+
+    }/*THEN*/
+
+    if (node_loglik)
+      node_loglik[i] = cur;
+
+    /* if the log-likelihood is NA or -Inf it will never change value again. */
+    if (ISNAN(loglik) || (loglik == R_NegInf)) {
+
+      if (node_loglik)
+        continue;
+      else
+        break;
+
+    }/*THEN*/
+
+    /* cumulate the log-likelihood. */
+    loglik += cur;
+
+  }/*FOR*/
+
+  return loglik;
+
+}/*LOGLIKELIHOOD_FROM_TOTALS*/
+
+void FreeLOGLIKTOTALS(loglik_totals tot) {
+
+  Free1D(tot.sum);
+  Free1D(tot.nused);
+  Free1D(tot.finite);
+  Free1D(tot.nfinite);
+
+}/*FREELOGLIKTOTALS*/
+
+/* log-likelihood of a whole sample. */
+double data_loglikelihood_blocks(fitted_bn bn, meta m, void **columns,
+    bool debugging) {
+
+double loglik = 0;
+loglik_totals tot = new_loglik_totals(bn.nnodes);
+
+  loglikelihood_totals_blocks(bn, m, columns, &tot);
+  loglik = loglikelihood_from_totals(bn, m, &tot, m.nobs, NULL, debugging);
+
+  FreeLOGLIKTOTALS(tot);
+
+  return loglik;
+
+}/*DATA_LOGLIKELIHOOD_BLOCKS*/
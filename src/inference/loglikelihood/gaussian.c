@@ -8,59 +8,25 @@
 void bysample_gaussian_loglikelihood(fitted_bn bn, gdata dt, double *loglik,
     bool debugging) {
 
-int *pars = NULL;
-double *obs = NULL, *coefs = NULL, sd = 0, *scratch = NULL;
+void **columns = NULL;
 
-  /* allocate the scratch space used to compute the expected value of the
-   * distribution of each observation. */
-  scratch = Calloc1D(dt.m.nobs, sizeof(double));
+  /* the columns of the data are in the same order as the nodes. */
+  columns = Calloc1D(dt.m.ncols, sizeof(void *));
+  for (int i = 0; i < dt.m.ncols; i++)
+    columns[i] = dt.col[i];
 
-  /* for each node... */
-  for (int i = 0; i < bn.nnodes; i++) {
+  bysample_loglikelihood_blocks(bn, dt.m, columns, loglik, debugging);
 
-    /* ... that we want to consider... */
-    if (!dt.m.flag[i].fixed)
-      continue;
-
-    if (debugging)
-      Rprintf("* processing node %s.\n", bn.labels[i]);
-
-    /* ... extract the relevant quantities from the data and the network...*/
-    obs = dt.col[i];
-    coefs = bn.ldists[i].g.coefs;
-    pars = bn.ldists[i].parents;
-    sd = bn.ldists[i].g.sd;
-
-    /* ... initialize the log-likelihoods with the intercept... */
-    for (int j = 0; j < dt.m.nobs; j++)
-      scratch[j] = coefs[0];
-
-    /* ... then add the effects of the parents one by one to compute the
-     * expected values (no need to special case missing values, they propagate
-     * correctly)... */
-    for (int k = 0; k < bn.ldists[i].nparents; k++)
-      for (int j = 0; j < dt.m.nobs; j++)
-        scratch[j] += dt.col[pars[k]][j] * coefs[k + 1];
-
-    /* ... and use them together with the standard error to compute the
-     * log-likelihood. */
-    for (int j = 0; j < dt.m.nobs; j++)
-      loglik[j] += dnorm(obs[j], scratch[j], sd, TRUE);
-
-  }/*FOR*/
-
-  Free1D(scratch);
+  Free1D(columns);
 
 }/*BYSAMPLE_GAUSSIAN_LOGLIKELIHOOD*/
 
 /* log-likelihood of a whole sample for a Gaussian network. */
-double data_gaussian_loglikelihood(fitted_bn bn, gdata dt, double *scratch,
-    bool propagate, bool debugging) {
+double data_gaussian_loglikelihood(fitted_bn bn, gdata dt, bool propagate,
+    bool debugging) {
 
-int ncomplete = 0, *pars = NULL;
-double loglik = 0, node_loglik = 0;
-double *obs = NULL, *coefs = NULL, sd = 0;
-bool early_return = FALSE;
+double loglik = 0;
+void **columns = NULL;
 
   /* if the data contain missing values for the nodes we are considering, and
    * we propagate them, the log-likelihood is necessarily NA. */
@@ -69,106 +35,18 @@ bool early_return = FALSE;
 
   /* if any of the coefficients of the nodes we are considering is NA, or the
    * standard error is NA, then the log-likelihood is NA. */
-  for (int i = 0; i < bn.nnodes; i++) {
-
-    if (!dt.m.flag[i].fixed)
-      continue;
-
-    if (ISNAN(bn.ldists[i].g.sd)) {
-
-      early_return = TRUE;
-      goto unidentifiable_model;
-
-    }/*THEN*/
-
-    for (int j = 0; j < bn.ldists[i].g.ncoefs; j++)
-      if (ISNAN(bn.ldists[i].g.coefs[j])) {
-
-        early_return = TRUE;
-        goto unidentifiable_model;
-
-      }/*THEN*/
-
-unidentifiable_model:
-    if (early_return) {
-
-      if (debugging)
-        Rprintf("* unidentifiable model in node %s, the log-likelihood is NA.\n",
-            bn.labels[i]);
-      return NA_REAL;
-
-    }/*THEN*/
-
-  }/*FOR*/
-
-  /* for each node... */
-  for (int i = 0; i < bn.nnodes; i++) {
-
-    /* ... that we want to consider... */
-    if (!dt.m.flag[i].fixed)
-      continue;
-
-    if (debugging)
-      Rprintf("* processing node %s.\n", bn.labels[i]);
-
-    /* ... reset the log-likelihood accumulator... */
-    node_loglik = 0;
-    ncomplete = 0;
-
-    /* ... extract the relevant quantities from the data and the network...*/
-    obs = dt.col[i];
-    coefs = bn.ldists[i].g.coefs;
-    pars = bn.ldists[i].parents;
-    sd = bn.ldists[i].g.sd;
-
-    /* ... initialize the log-likelihoods with the intercept... */
-    for (int j = 0; j < dt.m.nobs; j++)
-      scratch[j] = coefs[0];
-
-    /* ... then add the effects of the parents one by one to compute the
-     * expected values (no need to special case missing values, they propagate
-     * correctly)... */
-    for (int k = 0; k < bn.ldists[i].nparents; k++)
-      for (int j = 0; j < dt.m.nobs; j++)
-        scratch[j] += dt.col[pars[k]][j] * coefs[k + 1];
-
-    /* ... and use them together with the standard error to compute the
-     * log-likelihood. */
-    for (int j = 0; j < dt.m.nobs; j++) {
-
-      if (ISNAN(obs[j]) || ISNAN(scratch[j]))
-        continue;
-
-      node_loglik += dnorm(obs[j], scratch[j], sd, TRUE);
-      ncomplete++;
-
-    }/*FOR*/
-
-    /* ... and scale it to compensate for any missing values (which will not be
-     * propagated as a result), or return -Inf if there are no locally-complete
-     * observations. */
-    if (ncomplete == 0)
-      node_loglik = R_NegInf;
-    else if (ncomplete < dt.m.nobs)
-      node_loglik = node_loglik / ncomplete * dt.m.nobs;
-
-    if (debugging) {
-
-       Rprintf("  > %d locally-complete observations out of %d.\n",
-         ncomplete, dt.m.nobs);
-       Rprintf("  > log-likelihood is %lf.\n", node_loglik);
+  if (check_nan_gaussian_parameters(bn, dt.m, debugging))
+    return NA_REAL;
 
-     }/*THEN*/
+  /* the columns of the data are in the same order as the nodes. */
+  columns = Calloc1D(dt.m.ncols, sizeof(void *));
+  for (int i = 0; i < dt.m.ncols; i++)
+    columns[i] = dt.col[i];
 
-    /* cumulate the log-likelihood. */
-    loglik += node_loglik;
-    /* if the log-likelihood is NA or -Inf it will never change value again. */
-    if (ISNAN(loglik) || (loglik == R_NegInf))
-      break;
+  loglik = data_loglikelihood_blocks(bn, dt.m, columns, debugging);
 
-  }/*FOR*/
+  Free1D(columns);
 
   return loglik;
 
 }/*DATA_GAUSSIAN_LOGLIKELIHOOD*/
-
@@ -1,7 +1,40 @@
 #ifndef LOGLIKELIHOOD_FUNCTIONS_HEADER
 #define LOGLIKELIHOOD_FUNCTIONS_HEADER
 
+/* number of observations in each of the blocks the log-likelihood is computed
+ * over, small enough for the data, the parents' configurations and the partial
+ * results to fit in the L2 cache. */
+#define LOGLIK_BLOCK 2048
+
+/* running totals of the log-likelihoods of the nodes, over one or more
+ * samples. */
+typedef struct {
+
+  int nnodes;            /* number of nodes. */
+  long double *sum;      /* log-likelihood of the locally-complete
+                          * observations. */
+  double *nused;         /* number of locally-complete observations. */
+  long double *finite;   /* log-likelihood of the observations for which it is
+                          * finite, as in the log-likelihood loss. */
+  double *nfinite;       /* number of such observations. */
+
+} loglik_totals;
+
 bool check_locally_incomplete_data(fitted_bn bn, meta m, bool debugging);
+bool check_nan_gaussian_parameters(fitted_bn bn, meta m, bool debugging);
+void bysample_loglikelihood_blocks(fitted_bn bn, meta m, void **columns,
+    double *loglik, bool debugging);
+double data_loglikelihood_blocks(fitted_bn bn, meta m, void **columns,
+    bool debugging);
+loglik_totals new_loglik_totals(int nnodes);
+void loglikelihood_totals_blocks(fitted_bn bn, meta m, void **columns,
+    loglik_totals *tot);
+double loglikelihood_from_totals(fitted_bn bn, meta m, loglik_totals *tot,
+    double nobs, double *node_loglik, bool debugging);
+void FreeLOGLIKTOTALS(loglik_totals tot);
+void **cgdata_node_columns(fitted_bn bn, cgdata dt);
+void logcpt_gather(double *logcpt, int *obs, int *parcfgs, int nlevels,
+    int nobs, bool complete, double *loglik);
 
 void bysample_discrete_loglikelihood(fitted_bn bn, ddata dt, double *loglik,
     bool debugging);
@@ -12,10 +45,10 @@ void bysample_clgaussian_loglikelihood(fitted_bn bn, cgdata dt, double *loglik,
 
 double data_discrete_loglikelihood(fitted_bn bn, ddata dt, bool propagate,
     bool debugging);
-double data_gaussian_loglikelihood(fitted_bn bn, gdata dt, double *scratch,
-    bool propagate, bool debugging);
-double data_clgaussian_loglikelihood(fitted_bn bn, cgdata dt, double *scratch,
-    bool propagate, bool debugging);
+double data_gaussian_loglikelihood(fitted_bn bn, gdata dt, bool propagate,
+    bool debugging);
+double data_clgaussian_loglikelihood(fitted_bn bn, cgdata dt, bool propagate,
+    bool debugging);
 
 #endif
 
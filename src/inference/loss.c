@@ -6,11 +6,12 @@
 #include "../core/sets.h"
 #include "../fitted/fitted.h"
 #include "../math/linear.algebra.h"
+#include "../core/math.functions.h"
 
 double c_gloss(int *cur, SEXP cur_parents, double *coefs, double *sd,
     void **columns, SEXP nodes, int ndata, double *per_sample,
     bool allow_singular, int *dropped);
-double c_dloss(int *cur, SEXP cur_parents, int *configs, double *prob,
+double c_dloss(int *cur, SEXP cur_parents, int *configs, double *logcpt,
     SEXP data, SEXP nodes, int ndata, int nlevels, double *per_sample,
     int *dropped);
 double c_cgloss(int *cur, SEXP cur_parents, SEXP dparents, SEXP gparents,
@@ -29,9 +30,9 @@ double c_entropy_loss(SEXP fitted, SEXP orig_data, int ndata, bool by,
     double *res_sample, double *effective, SEXP keep, bool allow_singular,
     bool warn, bool debugging) {
 
-int i = 0, k = 0, nnodes = length(fitted), nlevels = 0, dropped = 0;
+int i = 0, j = 0, k = 0, nnodes = length(fitted), nlevels = 0, dropped = 0;
 int *configs = NULL, *to_keep = NULL;
-double result = 0, cur_loss = 0;
+double result = 0, cur_loss = 0, *logcpt = NULL;
 fitted_node_e node_type = ENOFIT;
 void **columns = NULL;
 SEXP data, cur_node, nodes, coefs, sd, parents, try;
@@ -93,9 +94,17 @@ SEXP dparents, gparents, dlevels;
         coefs = getListElement(cur_node, "prob");
         nlevels = INT(getAttrib(coefs, R_DimSymbol));
 
-        cur_loss = c_dloss(&i, parents, configs, REAL(coefs), data, nodes,
+        /* take the logarithms of the conditional probabilities once, instead
+         * of once for each observation. */
+        logcpt = Calloc1D(length(coefs), sizeof(double));
+        for (j = 0; j < length(coefs); j++)
+          logcpt[j] = log(REAL(coefs)[j]);
+
+        cur_loss = c_dloss(&i, parents, configs, logcpt, data, nodes,
                      ndata, nlevels, res_sample, &dropped);
 
+        Free1D(logcpt);
+
         break;
 
 
@@ -165,7 +174,7 @@ double c_gloss(int *cur, SEXP cur_parents, double *coefs, double *sd,
     bool allow_singular, int *dropped) {
 
 int i = 0, j = 0, *p = NULL, nparents = length(cur_parents);
-double mean = 0, logprob = 0, result = 0;
+double logprob = 0, result = 0, *x = NULL, *ll = NULL;
 SEXP try;
 
   if (nparents > 0) {
@@ -175,27 +184,37 @@ SEXP try;
 
   }/*THEN*/
 
-  for (i = 0; i < ndata; i++) {
+  /* compute the expected values of all the observations, one parent at a time
+   * (missing values propagate)... */
+  ll = Calloc1D(ndata, sizeof(double));
+  for (i = 0; i < ndata; i++)
+    ll[i] = coefs[0];
 
-    /* compute the mean value for this observation. */
-    mean = coefs[0];
+  for (j = 0; j < nparents; j++) {
 
-    for (j = 0; j < nparents; j++)
-      mean += ((double *)columns[p[j] - 1])[i] * coefs[j + 1];
+    x = (double *)columns[p[j] - 1];
+    for (i = 0; i < ndata; i++)
+      ll[i] += x[i] * coefs[j + 1];
 
-    /* compute the log-likelihood of this observation, propagating missing
-     * values. */
-    if (ISNAN(mean) || ISNAN(((double *)columns[*cur])[i]))
-      logprob = NA_REAL;
-    if ((*sd < MACHINE_TOL) && !allow_singular)
-      logprob = dnorm(((double *)columns[*cur])[i], mean, MACHINE_TOL, TRUE);
-    else
-      logprob = dnorm(((double *)columns[*cur])[i], mean, *sd, TRUE);
+  }/*FOR*/
+
+  /* ... then their log-likelihoods, all at once... */
+  if ((*sd < MACHINE_TOL) && !allow_singular)
+    gaussian_logdensity((double *)columns[*cur], ll, ndata, MACHINE_TOL);
+  else
+    gaussian_logdensity((double *)columns[*cur], ll, ndata, *sd);
+
+  /* ... and accumulate them, dropping missing values. */
+  for (i = 0; i < ndata; i++) {
+
+    logprob = ll[i];
 
     UPDATE_LOSS(ISNAN(logprob))
 
   }/*FOR*/
 
+  Free1D(ll);
+
   if (nparents > 0)
     UNPROTECT(1);
 
@@ -207,7 +226,7 @@ SEXP try;
 }/*C_GLOSS*/
 
 /* multinomial loss for a single node. */
-double c_dloss(int *cur, SEXP cur_parents, int *configs, double *prob,
+double c_dloss(int *cur, SEXP cur_parents, int *configs, double *logcpt,
     SEXP data, SEXP nodes, int ndata, int nlevels, double *per_sample,
     int *dropped) {
 
@@ -230,7 +249,7 @@ SEXP temp_df;
       if (configs[i] == NA_INTEGER || obs[i] == NA_INTEGER)
         logprob = NA_REAL;
       else
-        logprob = log(prob[CMC(obs[i] - 1, configs[i], nlevels)]);
+        logprob = logcpt[CMC(obs[i] - 1, configs[i], nlevels)];
 
       UPDATE_LOSS(!R_FINITE(logprob) || ISNAN(logprob));
 
@@ -246,7 +265,7 @@ SEXP temp_df;
       if (obs[i] == NA_INTEGER)
         logprob = NA_REAL;
       else
-        logprob = log(prob[obs[i] - 1]);
+        logprob = logcpt[obs[i] - 1];
 
       UPDATE_LOSS(!R_FINITE(logprob) || ISNAN(logprob));
 
@@ -1,459 +1,454 @@
 #include "../include/rcore.h"
+#include "../include/parallel.h"
 #include "../core/allocations.h"
 #include "../core/sampling.h"
-#include "../core/sets.h"
 #include "../minimal/data.frame.h"
 #include "../minimal/common.h"
-#include "../include/graph.h"
 #include "../include/globals.h"
-#include "../fitted/fitted.h"
-
-void rbn_discrete_root(SEXP result, int cur, SEXP cpt, int num, SEXP fixed);
-void rbn_discrete_cond(SEXP result, SEXP nodes, int cur, SEXP parents, SEXP cpt,
-    int num, SEXP fixed, bool debugging);
-void rbn_gaussian(SEXP result, int cur, SEXP parents, SEXP coefs, SEXP sigma,
-    int num, SEXP fixed);
-void rbn_mixedcg(SEXP result, int cur, SEXP parents, SEXP coefs, SEXP sigma,
-    SEXP dpar, SEXP gpar, int num, SEXP fixed);
-
-void c_rbn_master(SEXP fitted, SEXP result, SEXP n, SEXP fix, bool debugging) {
-
-int num = INT(n), *poset = NULL, *mf = NULL;
-int has_fixed = (TYPEOF(fix) != LGLSXP);
-int i = 0, k = 0, cur = 0, nnodes = length(fitted), nparents = 0;
-fitted_node_e cur_node_type = ENOFIT;
-SEXP nodes, cur_node, cur_fixed, match_fixed, parents, parent_vars;
-SEXP cpt = R_NilValue, coefs = R_NilValue, sd = R_NilValue;
-SEXP dpar = R_NilValue, gpar = R_NilValue;
-
-  /* allocate and initialize the return value. */
+#include "rbn.h"
+
+/* number of observations generated from each random stream in parallel mode;
+ * it must not depend on the number of threads for the simulated data to be
+ * reproducible. */
+#define RBN_CHUNK 8192
+
+/* draw from R's random number generator or from a random stream. */
+static inline double rbn_unif(rng_stream *rng) {
+
+  return rng ? rng_stream_unif(rng) : unif_rand();
+
+}/*RBN_UNIF*/
+
+static inline double rbn_norm(rng_stream *rng) {
+
+  return rng ? rng_stream_norm(rng) : norm_rand();
+
+}/*RBN_NORM*/
+
+void c_rbn_master(SEXP fitted, SEXP result, SEXP n, SEXP fix, bool parallel,
+    bool debugging) {
+
+int num = INT(n), nnodes = 0, nparents = 0, nchunks = 0, nthreads = 1;
+int i = 0, k = 0, cur = 0;
+uint32_t key[2] = { 0, 0 };
+bool *warn = NULL;
+void **cols = NULL;
+compiled_bn *plan = NULL;
+rbn_fixed *fixed = NULL;
+SEXP nodes;
+
+  /* retrieve the topological ordering, the alias tables and the parents of
+   * each node, which are cached across calls for the same network. */
+  plan = compiled_network(fitted);
+  nnodes = (*plan).bn.nnodes;
   PROTECT(nodes = getAttrib(fitted, R_NamesSymbol));
 
-  /* order the nodes according to their depth in the graph. */
-  poset = Calloc1D(nnodes, sizeof(int));
-  topological_sort(fitted, poset, nnodes);
+  for (i = 0; i < nnodes; i++)
+    if ((*plan).bn.node_types[i] == ENOFIT)
+      error("unknown node type (class: %s).",
+         CHAR(STRING_ELT(getAttrib(VECTOR_ELT(fitted, i), R_ClassSymbol), 0)));
 
   /* match fixed nodes, if any, with the variables in the fitted network. */
-  if (has_fixed) {
+  fixed = rbn_match_fixed(plan, fitted, fix);
 
-    PROTECT(match_fixed = match(getAttrib(fix, R_NamesSymbol), nodes, 0));
-    mf = INTEGER(match_fixed);
-
-  }/*THEN*/
+  /* save pointers to the columns, which are shared by all threads. */
+  cols = Calloc1D(nnodes, sizeof(void *));
+  for (i = 0; i < nnodes; i++)
+    cols[i] = DATAPTR(VECTOR_ELT(result, i));
 
   if (debugging) {
 
     Rprintf("* partial node ordering is:");
 
     for (i = 0; i < nnodes; i++)
-      Rprintf(" %s", NODE(poset[i]));
+      Rprintf(" %s", NODE((*plan).poset[i]));
 
     Rprintf(".\n");
 
+    for (i = 0; i < nnodes; i++) {
+
+      cur = (*plan).poset[i];
+      nparents = (*plan).bn.ldists[cur].nparents;
+
+      if (fixed[cur].n > 0) {
+
+        if (nparents == 0)
+          Rprintf("* node %s is fixed.\n", NODE(cur));
+        else
+          Rprintf("* node %s is fixed, ignoring parents.\n", NODE(cur));
+
+      }/*THEN*/
+      else if (nparents == 0) {
+
+        Rprintf("* simulating node %s, which doesn't have any parent.\n",
+          NODE(cur));
+
+      }/*THEN*/
+      else {
+
+        Rprintf("* simulating node %s with parents ", NODE(cur));
+        for (k = 0; k < nparents - 1; k++)
+          Rprintf("%s, ", NODE((*plan).bn.ldists[cur].parents[k]));
+        Rprintf("%s.\n", NODE((*plan).bn.ldists[cur].parents[nparents - 1]));
+
+      }/*ELSE*/
+
+    }/*FOR*/
+
   }/*THEN*/
 
   /* initialize the random number generator. */
   GetRNGstate();
 
-  for (i = 0; i < nnodes; i++) {
-
-    /* get the index of the node we have to generate random observations from,
-     * its conditional probability table/regression parameters and the number
-     * of its parents. */
-    cur = poset[i];
-    cur_node = VECTOR_ELT(fitted, cur);
-    cur_node_type = fitted_node_to_enum(cur_node);
-    parents = getListElement(cur_node, "parents");
-    nparents = length(parents);
-
-    /* check whether the value of the node is fixed, and if so retrieve it from
-     * the list. */
-    if (has_fixed && mf[cur] != 0)
-      cur_fixed = VECTOR_ELT(fix, mf[cur] - 1);
-    else
-      cur_fixed = R_NilValue;
-
-    /* find out whether the node corresponds to an ordered factor or not. */
-    switch(cur_node_type) {
-
-      case DNODE:
-        cpt = getListElement(cur_node, "prob");
-        break;
+  if (!parallel) {
 
-      case ONODE:
-        cpt = getListElement(cur_node, "prob");
-        break;
+    warn = Calloc1D(nnodes, sizeof(bool));
 
-      case GNODE:
-        coefs = getListElement(cur_node, "coefficients");
-        sd = getListElement(cur_node, "sd");
-        break;
+    /* generate all the observations for one node at a time. */
+    for (i = 0; i < nnodes; i++)
+      rbn_node(plan, cols, fixed, (*plan).poset[i], 0, num, NULL, warn);
 
-      case CGNODE:
-        coefs = getListElement(cur_node, "coefficients");
-        sd = getListElement(cur_node, "sd");
-        dpar = getListElement(cur_node, "dparents");
-        gpar = getListElement(cur_node, "gparents");
-        break;
+  }/*THEN*/
+  else {
 
-      default:
-        error("unknown node type (class: %s).",
-           CHAR(STRING_ELT(getAttrib(cur_node, R_ClassSymbol), 0)));
+    /* split the observations into chunks, each with its own random stream
+     * keyed on R's random seed. */
+    nchunks = (num + RBN_CHUNK - 1) / RBN_CHUNK;
+    nthreads = MAX_THREADS;
+    warn = Calloc1D(nthreads * nnodes, sizeof(bool));
+    rng_stream_key(key);
 
-    }/*SWITCH*/
+    if (debugging)
+      Rprintf("* generating %d chunk(s) of at most %d observations.\n",
+        nchunks, RBN_CHUNK);
 
-    /* generate the random observations for the current node. */
-    if (nparents == 0) {
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+    for (int c = 0; c < nchunks; c++) {
 
-      if (debugging) {
+      rng_stream rng;
+      int from = c * RBN_CHUNK, to = MIN(num, from + RBN_CHUNK);
 
-        if (cur_fixed != R_NilValue)
-          Rprintf("* node %s is fixed.\n", NODE(cur));
-        else
-          Rprintf("* simulating node %s, which doesn't have any parent.\n",
-            NODE(cur));
+      rng_stream_init(&rng, key, (uint64_t)c);
 
-      }/*THEN*/
+      for (int j = 0; j < nnodes; j++)
+        rbn_node(plan, cols, fixed, (*plan).poset[j], from, to, &rng,
+          warn + THREAD_ID * nnodes);
 
-      switch(cur_node_type) {
-
-        case DNODE:
-          rbn_discrete_root(result, cur, cpt, num, cur_fixed);
-          break;
+    }/*FOR*/
 
-        case ONODE:
-          rbn_discrete_root(result, cur, cpt, num, cur_fixed);
-          break;
+    /* merge the missing values flags from the different threads. */
+    for (i = 1; i < nthreads; i++)
+      for (k = 0; k < nnodes; k++)
+        warn[k] = warn[k] || warn[i * nnodes + k];
 
-        case GNODE:
-          rbn_gaussian(result, cur, NULL, coefs, sd, num, cur_fixed);
-          break;
+  }/*ELSE*/
 
-        case CGNODE:
-          /* this cannot happen, a conditional Gaussian node has at least
-           * one discrete parent. */
-          break;
+  PutRNGstate();
 
-        default:
-          error("unknown node type (class: %s).",
-             CHAR(STRING_ELT(getAttrib(cur_node, R_ClassSymbol), 0)));
+  /* warn when returning missing values. */
+  if (debugging)
+    for (i = 0; i < nnodes; i++)
+      if (warn[i])
+        Rprintf("  > some parents configurations of node %s have undefined conditional distributions, NAs will be generated.\n", NODE(i));
 
-      }/*SWITCH*/
+  FreeRBNFIXED(fixed, nnodes);
+  Free1D(cols);
+  Free1D(warn);
 
-    }/*THEN*/
-    else {
+  UNPROTECT(1);
 
-      if (debugging) {
+}/*C_RBN_MASTER*/
 
-        if (cur_fixed != R_NilValue) {
+/* match the values of fixed nodes with their levels (discrete nodes) or save
+ * them as they are (continuous nodes). */
+rbn_fixed *rbn_match_fixed(compiled_bn *plan, SEXP fitted, SEXP fix) {
 
-          Rprintf("* node %s is fixed, ignoring parents.\n", NODE(cur));
+int i = 0, cur = 0, *mf = NULL;
+rbn_fixed *fixed = Calloc1D((*plan).bn.nnodes, sizeof(rbn_fixed));
+SEXP match_fixed, cur_fixed, lvls, fixed_levels;
 
-        }/*THEN*/
-        else {
+  if (TYPEOF(fix) == LGLSXP)
+    return fixed;
 
-          Rprintf("* simulating node %s with parents ", NODE(cur));
-          for (k = 0; k < nparents - 1; k++)
-            Rprintf("%s, ", CHAR(STRING_ELT(parents, k)));
-          Rprintf("%s.\n", CHAR(STRING_ELT(parents, nparents - 1)));
+  PROTECT(match_fixed =
+    match(getAttrib(fix, R_NamesSymbol), getAttrib(fitted, R_NamesSymbol), 0));
+  mf = INTEGER(match_fixed);
 
-        }/*ELSE*/
+  for (cur = 0; cur < (*plan).bn.nnodes; cur++) {
 
-      }/*THEN*/
+    if (mf[cur] == 0)
+      continue;
 
-      PROTECT(parent_vars = dataframe_column(result, parents, FALSESEXP, FALSESEXP));
+    cur_fixed = VECTOR_ELT(fix, mf[cur] - 1);
+    fixed[cur].n = length(cur_fixed);
 
-      switch(cur_node_type) {
+    if (((*plan).bn.node_types[cur] == GNODE) ||
+        ((*plan).bn.node_types[cur] == CGNODE)) {
 
-        case DNODE:
-          rbn_discrete_cond(result, nodes, cur, parent_vars, cpt, num,
-            cur_fixed, debugging);
-          break;
+      fixed[cur].values = REAL(cur_fixed);
+      continue;
 
-        case ONODE:
-          rbn_discrete_cond(result, nodes, cur, parent_vars, cpt, num,
-            cur_fixed, debugging);
-          break;
+    }/*THEN*/
 
-        case GNODE:
-          rbn_gaussian(result, cur, parent_vars, coefs, sd, num, cur_fixed);
-          break;
+    lvls = getListElement(VECTOR_ELT(fitted, cur), "prob");
+    lvls = VECTOR_ELT(getAttrib(lvls, R_DimNamesSymbol), 0);
+    fixed[cur].levels = Calloc1D(fixed[cur].n, sizeof(int));
 
-        case CGNODE:
-          rbn_mixedcg(result, cur, parent_vars, coefs, sd, dpar, gpar, num,
-            cur_fixed);
-          break;
+    /* fixed can be either a label to be matched with the factor's levels or
+     * the corresponding numeric index, which can be used as it is; a set of
+     * values is always a set of labels. */
+    if ((fixed[cur].n == 1) && (TYPEOF(cur_fixed) == INTSXP)) {
 
-        default:
-          error("unknown node type (class: %s).",
-             CHAR(STRING_ELT(getAttrib(cur_node, R_ClassSymbol), 0)));
+      fixed[cur].levels[0] = INT(cur_fixed);
 
-      }/*SWITCH*/
+    }/*THEN*/
+    else {
 
+      PROTECT(fixed_levels = match(lvls, cur_fixed, 0));
+      for (i = 0; i < fixed[cur].n; i++)
+        fixed[cur].levels[i] = INTEGER(fixed_levels)[i];
       UNPROTECT(1);
 
     }/*ELSE*/
 
   }/*FOR*/
 
-  PutRNGstate();
+  UNPROTECT(1);
 
-  Free1D(poset);
+  return fixed;
 
-  UNPROTECT(1 + has_fixed);
+}/*RBN_MATCH_FIXED*/
 
-}/*C_RBN_MASTER*/
+void FreeRBNFIXED(rbn_fixed *fixed, int nnodes) {
 
-void rbn_discrete_fixed(SEXP fixed, SEXP lvls, int *gen, int num) {
+  for (int i = 0; i < nnodes; i++)
+    Free1D(fixed[i].levels);
+  Free1D(fixed);
 
-  if (length(fixed) == 1) {
+}/*FREERBNFIXED*/
 
-    int constant = 0;
+static void rbn_discrete_fixed(rbn_fixed fixed, int *gen, int from, int to,
+    rng_stream *rng) {
 
-    /* fixed can be either a label to be matched with the factor's levels or
-     * the corresponding numeric index, which can be used as it is. */
-    if (TYPEOF(fixed) == INTSXP)
-      constant = INT(fixed);
-    else
-      constant = INT(match(lvls, fixed, 0));
+int i = 0;
 
-    for (int i = 0; i < num; i++)
-      gen[i] = constant;
+  if (fixed.n == 1) {
+
+    for (i = from; i < to; i++)
+      gen[i] = fixed.levels[0];
 
   }/*THEN*/
   else {
 
-    SEXP fixed_levels;
-
-    /* fixed is a set of labels here. */
-    PROTECT(fixed_levels = match(lvls, fixed, 0));
-    SampleReplace(num, length(fixed_levels), gen, INTEGER(fixed_levels));
-    UNPROTECT(1);
+    /* pick one of the levels at random, as in SampleReplace(). */
+    for (i = from; i < to; i++)
+      gen[i] = fixed.levels[(int)((double)fixed.n * rbn_unif(rng))];
 
   }/*ELSE*/
 
 }/*RBN_DISCRETE_FIXED*/
 
-/* unconditional discrete sampling. */
-void rbn_discrete_root(SEXP result, int cur, SEXP cpt, int num, SEXP fixed) {
+/* discrete sampling from the alias tables of the conditional distributions. */
+static void rbn_discrete(compiled_bn *plan, void **cols, int cur, int from,
+    int to, rng_stream *rng, bool *warn) {
 
-int np = length(cpt), *gen = NULL, *workplace = NULL;
-double *p = NULL;
-SEXP generated, lvls;
+int i = 0, j = 0, cfg = 0, nl = (*plan).nlevels[cur], *pcol = NULL;
+int np = (*plan).bn.ldists[cur].nparents, *par = (*plan).bn.ldists[cur].parents;
+int *cumlevels = (*plan).cumlevels[cur], *gen = cols[cur];
+double *aprobs = (*plan).aprobs[cur];
+int *alias = (*plan).alias[cur];
+bool *undefined = (*plan).undefined[cur];
 
-  /* get the levels of the curent variable .*/
-  lvls = VECTOR_ELT(getAttrib(cpt, R_DimNamesSymbol), 0);
-  /* get the column for the generated observations. */
-  generated = VECTOR_ELT(result, cur);
-  gen = INTEGER(generated);
+  /* root nodes have a single distribution to sample from. */
+  if (np == 0) {
 
-  if (fixed != R_NilValue) {
+    for (i = from; i < to; i++)
+      gen[i] = c_alias_draw(aprobs, alias, nl, rbn_unif(rng)) + 1;
 
-    rbn_discrete_fixed(fixed, lvls, gen, num);
+    return;
 
   }/*THEN*/
-  else {
 
-    workplace = Calloc1D(np, sizeof(int));
+  for (i = from; i < to; i++) {
 
-    /* duplicate the probability table to save the original copy from tampering. */
-    p = Calloc1D(np, sizeof(double));
-    memcpy(p, REAL(cpt), np * sizeof(double));
+    /* compute the configuration of the parents, which is missing if any of
+     * them is missing. */
+    for (j = 0, cfg = 0; j < np; j++) {
 
-    /* perform the random sampling. */
-    ProbSampleReplace(np, p, workplace, num, gen);
-
-    Free1D(workplace);
-    Free1D(p);
-
-  }/*ELSE*/
+      pcol = cols[par[j]];
 
-}/*RBN_DISCRETE_ROOT*/
+      if (pcol[i] == NA_INTEGER) {
 
-/* conditional discrete sampling. */
-void rbn_discrete_cond(SEXP result, SEXP nodes, int cur, SEXP parents, SEXP cpt,
-    int num, SEXP fixed, bool debugging) {
-
-int np = length(cpt), nlevels = 0;
-int *workplace = NULL, *configurations = NULL, *gen = NULL;
-double *p = NULL;
-bool warn = FALSE;
-SEXP generated, lvls;
-
-  /* get the number of levels of the curent variable .*/
-  lvls = VECTOR_ELT(getAttrib(cpt, R_DimNamesSymbol), 0);
-  nlevels = length(lvls);
-  /* get the column for the generated observations. */
-  generated = VECTOR_ELT(result, cur);
-  gen = INTEGER(generated);
-
-  if (fixed != R_NilValue) {
+        cfg = NA_INTEGER;
+        break;
 
-    rbn_discrete_fixed(fixed, lvls, gen, num);
+      }/*THEN*/
 
-  }/*THEN*/
-  else {
+      cfg += (pcol[i] - 1) * cumlevels[j];
 
-    workplace = Calloc1D(np, sizeof(int));
+    }/*FOR*/
 
-    /* allocate and initialize the parents' configurations. */
-    configurations = Calloc1D(num, sizeof(int));
-    cfg(parents, configurations, NULL);
+    /* missing configurations and conditional distributions produce missing
+     * values. */
+    if ((cfg == NA_INTEGER) || undefined[cfg]) {
 
-    /* duplicate the probability table to save the original copy from tampering. */
-    p = Calloc1D(np, sizeof(double));
-    memcpy(p, REAL(cpt), np * sizeof(double));
-    /* perform the random sampling. */
-    CondProbSampleReplace(nlevels, length(cpt)/nlevels, p, configurations,
-      workplace, num, gen, &warn);
+      gen[i] = NA_INTEGER;
+      *warn = TRUE;
+      continue;
 
-    Free1D(workplace);
-    Free1D(configurations);
-    Free1D(p);
+    }/*THEN*/
 
-  }/*ELSE*/
+    gen[i] = c_alias_draw(aprobs + (size_t)cfg * nl, alias + (size_t)cfg * nl,
+               nl, rbn_unif(rng)) + 1;
 
-  /* warn when returning missing values. */
-  if (warn && debugging)
-    Rprintf("  > some parents configurations have undefined conditional distributions, NAs will be generated.");
+  }/*FOR*/
 
-}/*RBN_DISCRETE_COND*/
+}/*RBN_DISCRETE*/
 
-void rbn_gaussian_fixed(SEXP fixed, double *gen, int num) {
+static void rbn_gaussian_fixed(rbn_fixed fixed, double *gen, int from, int to,
+    rng_stream *rng) {
 
 int i = 0;
-double *constant = REAL(fixed);
 
-  if (length(fixed) == 1) {
+  if (fixed.n == 1) {
 
     /* conditioning on a single value. */
-    for (i = 0; i < num; i++)
-      gen[i] = constant[0];
+    for (i = from; i < to; i++)
+      gen[i] = fixed.values[0];
 
   }/*THEN*/
   else {
 
-    double offset = constant[0], range = constant[1] - constant[0];
+    double offset = fixed.values[0], range = fixed.values[1] - fixed.values[0];
 
     /* conditioning on an interval, picking a value at random
      * from a uniform distribution. */
-    for (i = 0; i < num; i++)
-      gen[i] = offset + unif_rand() * range;
+    for (i = from; i < to; i++)
+      gen[i] = offset + rbn_unif(rng) * range;
 
   }/*ELSE*/
 
 }/*RBN_GAUSSIAN_FIXED*/
 
 /* conditional and unconditional normal sampling. */
-void rbn_gaussian(SEXP result, int cur, SEXP parents, SEXP coefs, SEXP sigma,
-    int num, SEXP fixed) {
+static void rbn_gaussian(compiled_bn *plan, void **cols, int cur, int from,
+    int to, rng_stream *rng) {
 
-int i = 0, j = 0, p = length(coefs);
-double *beta = REAL(coefs), *sd = REAL(sigma), *gen = NULL, *Xj = NULL;
-SEXP generated;
+int i = 0, j = 0, p = (*plan).bn.ldists[cur].g.ncoefs;
+int *par = (*plan).bn.ldists[cur].parents;
+double *beta = (*plan).bn.ldists[cur].g.coefs, sd = (*plan).bn.ldists[cur].g.sd;
+double *gen = cols[cur], *Xj = NULL;
 
-  /* get the column for the generated observations. */
-  generated = VECTOR_ELT(result, cur);
-  gen = REAL(generated);
+  /* initialize with intercept and standard error. */
+  for (i = from; i < to; i++)
+    gen[i] = beta[0] + rbn_norm(rng) * sd;
 
-  if (fixed != R_NilValue) {
+  /* add the contributions of the other regressors (if any). */
+  for (j = 1; j < p; j++) {
 
-    rbn_gaussian_fixed(fixed, gen, num);
+    Xj = cols[par[j - 1]];
 
-  }/*THEN*/
-  else {
-
-    /* initialize with intercept and standard error. */
-    for (i = 0; i < num; i++)
-      gen[i] = beta[0] + norm_rand() * (*sd);
-
-    /* add the contributions of the other regressors (if any). */
-    for (j = 1; j < p; j++) {
-
-      Xj = REAL(VECTOR_ELT(parents, j - 1));
+    for (i = from; i < to; i++)
+      gen[i] += Xj[i] * beta[j];
 
-      for (i = 0; i < num; i++)
-        gen[i] += Xj[i] * beta[j];
-
-    }/*FOR*/
-
-  }/*ELSE*/
+  }/*FOR*/
 
 }/*RBN_GAUSSIAN*/
 
 /* conditional linear Gaussian sampling. */
-void rbn_mixedcg(SEXP result, int cur, SEXP parents, SEXP coefs, SEXP sigma,
-    SEXP dpar, SEXP gpar, int num, SEXP fixed) {
-
-int i = 0, j = 0;
-double *beta = REAL(coefs), *sd = REAL(sigma), *gen = NULL;
-SEXP generated;
+static void rbn_mixedcg(compiled_bn *plan, void **cols, int cur, int from,
+    int to, rng_stream *rng) {
 
-  /* get the column for the generated observations. */
-  generated = VECTOR_ELT(result, cur);
-  gen = REAL(generated);
+int i = 0, j = 0, cfg = 0, *dcol = NULL;
+int ndp = (*plan).bn.ldists[cur].cg.ndparents;
+int ngp = (*plan).bn.ldists[cur].cg.ngparents;
+int *dp = (*plan).bn.ldists[cur].cg.dparents;
+int *gp = (*plan).bn.ldists[cur].cg.gparents;
+int *cumlevels = (*plan).cumlevels[cur];
+double *beta = (*plan).bn.ldists[cur].cg.coefs;
+double *sd = (*plan).bn.ldists[cur].cg.sd, *beta_offset = NULL;
+double *gen = cols[cur], *gcol = NULL;
 
-  if (fixed != R_NilValue) {
+  for (i = from; i < to; i++) {
 
-    rbn_gaussian_fixed(fixed, gen, num);
+    /* get the configuration of the discrete parents. */
+    for (j = 0, cfg = 0; j < ndp; j++) {
 
-  }/*THEN*/
-  else {
-
-    int *dp = INTEGER(dpar), *gp = INTEGER(gpar);
-    int ndp = length(dpar), ngp = length(gpar), **dcol = NULL;
-    int *nlvls = NULL, *config = NULL, config_nlvl = 0;
-    double **gcol = NULL, *beta_offset = NULL;
-    SEXP temp;
+      dcol = cols[dp[j]];
 
-    /* separate discrete and continuous parents. */
-    gcol = Calloc1D(ngp, sizeof(double *));
-    dcol = Calloc1D(ndp, sizeof(int *));
-    nlvls = Calloc1D(ndp, sizeof(int));
+      if (dcol[i] == NA_INTEGER) {
 
-    for (i = 0; i < ngp; i++)
-      gcol[i] = REAL(VECTOR_ELT(parents, gp[i] - 1));
+        cfg = NA_INTEGER;
+        break;
 
-    for (i = 0; i < ndp; i++) {
+      }/*THEN*/
 
-      temp = VECTOR_ELT(parents, dp[i] - 1);
-      dcol[i] = INTEGER(temp);
-      nlvls[i] = NLEVELS(temp);
+      cfg += (dcol[i] - 1) * cumlevels[j];
 
     }/*FOR*/
 
-    /* generate configurations from the discrete parents. */
-    config = Calloc1D(num, sizeof(int));
-    c_fast_config(dcol, num, ndp, nlvls, config, &config_nlvl, 0);
-
-    for (i = 0; i < num; i++) {
+    /* if the configuration is missing, the random observation is also a
+     * missing value. */
+    if (cfg == NA_INTEGER) {
 
-      /* if the configuration is missing, the random observation is also a
-       * missing value. */
-      if (config[i] == NA_INTEGER) {
+      gen[i] = NA_REAL;
+      continue;
 
-        gen[i] = NA_REAL;
-        continue;
+    }/*THEN*/
 
-      }/*THEN*/
+    /* get the right set of coefficients based on the configuration of the
+     * discrete parents. */
+    beta_offset = beta + (ngp + 1) * cfg;
+    /* initialize with intercept and standard error. */
+    gen[i] = beta_offset[0] + rbn_norm(rng) * sd[cfg];
 
-      /* get the right set of coefficients based on the configuration of the
-       * discrete parents. */
-      beta_offset = beta + (ngp + 1) * config[i];
-      /* initialize with intercept and standard error. */
-      gen[i] = beta_offset[0] + norm_rand() * sd[config[i]];
+    for (j = 0; j < ngp; j++) {
 
-      for (j = 0; j < ngp; j++)
-        gen[i] += gcol[j][i] * beta_offset[j + 1];
+      gcol = cols[gp[j]];
+      gen[i] += gcol[i] * beta_offset[j + 1];
 
     }/*FOR*/
 
-    Free1D(gcol);
-    Free1D(dcol);
-    Free1D(nlvls);
-    Free1D(config);
-
-  }/*ELSE*/
+  }/*FOR*/
 
 }/*RBN_MIXEDCG*/
 
+/* generate the observations in [from, to) for a single node, drawing from R's
+ * random number generator if rng is NULL. This is called from parallel
+ * regions, so it must not touch the R API. */
+void rbn_node(compiled_bn *plan, void **cols, rbn_fixed *fixed, int cur,
+    int from, int to, rng_stream *rng, bool *warn) {
+
+  switch((*plan).bn.node_types[cur]) {
+
+    case DNODE:
+    case ONODE:
+      if (fixed[cur].n > 0)
+        rbn_discrete_fixed(fixed[cur], cols[cur], from, to, rng);
+      else
+        rbn_discrete(plan, cols, cur, from, to, rng, warn + cur);
+      break;
+
+    case GNODE:
+      if (fixed[cur].n > 0)
+        rbn_gaussian_fixed(fixed[cur], cols[cur], from, to, rng);
+      else
+        rbn_gaussian(plan, cols, cur, from, to, rng);
+      break;
+
+    case CGNODE:
+      if (fixed[cur].n > 0)
+        rbn_gaussian_fixed(fixed[cur], cols[cur], from, to, rng);
+      else
+        rbn_mixedcg(plan, cols, cur, from, to, rng);
+      break;
+
+    case ENOFIT:
+    default:
+      break;
+
+  }/*SWITCH*/
+
+}/*RBN_NODE*/
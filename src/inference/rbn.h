@@ -0,0 +1,49 @@
+#ifndef RBN_HEADER
+#define RBN_HEADER
+
+#include "../fitted/compiled.h"
+#include "../core/random.streams.h"
+
+/* the values a node is fixed to, matched with its levels before sampling. */
+typedef struct {
+
+  int n;            /* number of values (zero if the node is not fixed). */
+  int *levels;      /* the levels of a discrete node. */
+  double *values;   /* the value or the interval of a continuous node. */
+
+} rbn_fixed;
+
+/* from rbn.c */
+rbn_fixed *rbn_match_fixed(compiled_bn *plan, SEXP fitted, SEXP fix);
+void FreeRBNFIXED(rbn_fixed *fixed, int nnodes);
+void rbn_node(compiled_bn *plan, void **cols, rbn_fixed *fixed, int cur,
+    int from, int to, rng_stream *rng, bool *warn);
+
+/* from likelihood.weighting.c */
+void lw_rescale(double *w, int n);
+void lw_logdensity(compiled_bn *plan, void **cols, int cur, int len,
+    double *lw);
+
+/* configuration of a set of discrete parents, missing if any of them is; it is
+ * inlined because it is called once for each particle. */
+static inline int lw_config(void **cols, int *parents, int *cumlevels,
+    int nparents, int i) {
+
+int j = 0, cfg = 0, *pcol = NULL;
+
+  for (j = 0; j < nparents; j++) {
+
+    pcol = cols[parents[j]];
+
+    if (pcol[i] == NA_INTEGER)
+      return NA_INTEGER;
+
+    cfg += (pcol[i] - 1) * cumlevels[j];
+
+  }/*FOR*/
+
+  return cfg;
+
+}/*LW_CONFIG*/
+
+#endif
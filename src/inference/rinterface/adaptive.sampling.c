@@ -0,0 +1,11 @@
+#include "../../include/rcore.h"
+#include "../adaptive.sampling.h"
+
+/* generate adaptive importance sampling particles for the nodes in the query. */
+SEXP ais_particles(SEXP fitted, SEXP nodes, SEXP n, SEXP fix, SEXP updates,
+    SEXP size, SEXP debug) {
+
+  return c_ais_particles(fitted, nodes, INT(n), fix, INT(updates), INT(size),
+           isTRUE(debug));
+
+}/*AIS_PARTICLES*/
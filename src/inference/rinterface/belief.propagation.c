@@ -0,0 +1,93 @@
+#include "../../include/rcore.h"
+#include "../../core/allocations.h"
+#include "../../fitted/fitted.h"
+#include "../../minimal/common.h"
+#include "../../include/globals.h"
+#include "../belief.propagation.h"
+
+/* approximate the posterior marginal distributions of a set of nodes given the
+ * evidence with loopy belief propagation; also return their joint distribution
+ * if they all belong to the same local distribution. */
+SEXP lbp_beliefs(SEXP fitted, SEXP nodes, SEXP evidence, SEXP max_iter,
+    SEXP damping, SEXP threshold, SEXP debug) {
+
+int i = 0, j = 0, nnodes = length(nodes), *query = NULL;
+double iterations = 0, maxres = 0, jsize = 1, fsize = 0, maxfsize = 0;
+bool debugging = isTRUE(debug);
+fitted_bn bn;
+lbp_graph *lbp = NULL;
+SEXP result, names, marginals, joint, evmatch, querymatch, ev;
+
+  bn = fitted_network_from_SEXP(fitted);
+  lbp = c_lbp_build(bn);
+
+  /* set the evidence, given as the (1-based) indexes of the allowed levels. */
+  PROTECT(evmatch = match(getAttrib(fitted, R_NamesSymbol),
+                      getAttrib(evidence, R_NamesSymbol), 0));
+  for (i = 0; i < length(evidence); i++) {
+
+    PROTECT(ev = coerceVector(VECTOR_ELT(evidence, i), INTSXP));
+    for (int l = 0; l < length(ev); l++)
+      INTEGER(ev)[l]--;
+    c_lbp_evidence(lbp, INTEGER(evmatch)[i] - 1, INTEGER(ev), length(ev));
+    UNPROTECT(1);
+
+    if (debugging)
+      Rprintf("* setting evidence on node %s.\n",
+        bn.labels[INTEGER(evmatch)[i] - 1]);
+
+  }/*FOR*/
+
+  iterations = c_lbp_run(lbp, NUM(max_iter), NUM(damping), NUM(threshold),
+                 &maxres, debugging);
+
+  /* extract the marginal distributions of the nodes. */
+  PROTECT(querymatch = match(getAttrib(fitted, R_NamesSymbol), nodes, 0));
+  query = Calloc1D(nnodes, sizeof(int));
+  PROTECT(marginals = allocVector(VECSXP, nnodes));
+  for (i = 0; i < nnodes; i++) {
+
+    query[i] = INTEGER(querymatch)[i] - 1;
+    jsize *= (*lbp).nlevels[query[i]];
+    SET_VECTOR_ELT(marginals, i, allocVector(REALSXP, (*lbp).nlevels[query[i]]));
+    c_lbp_marginal(lbp, query[i], REAL(VECTOR_ELT(marginals, i)));
+
+  }/*FOR*/
+  setAttrib(marginals, R_NamesSymbol, nodes);
+
+  /* extract the joint distribution of the nodes, if possible: it cannot be
+   * larger than the largest CPT. */
+  for (i = 0; i < (*lbp).nnodes; i++) {
+
+    fsize = 1;
+    for (j = (*lbp).fstart[i]; j < (*lbp).fstart[i + 1]; j++)
+      fsize *= (*lbp).nlevels[(*lbp).evar[j]];
+    maxfsize = MAX(maxfsize, fsize);
+
+  }/*FOR*/
+
+  PROTECT(joint = allocVector(REALSXP, (jsize <= maxfsize) ? (int)jsize : 0));
+  if ((jsize > maxfsize) || !c_lbp_joint(lbp, query, nnodes, REAL(joint)))
+    joint = R_NilValue;
+
+  PROTECT(result = allocVector(VECSXP, 4));
+  SET_VECTOR_ELT(result, 0, marginals);
+  SET_VECTOR_ELT(result, 1, joint);
+  SET_VECTOR_ELT(result, 2, ScalarReal(iterations));
+  SET_VECTOR_ELT(result, 3, ScalarReal(maxres));
+  PROTECT(names = allocVector(STRSXP, 4));
+  SET_STRING_ELT(names, 0, mkChar("marginals"));
+  SET_STRING_ELT(names, 1, mkChar("joint"));
+  SET_STRING_ELT(names, 2, mkChar("iterations"));
+  SET_STRING_ELT(names, 3, mkChar("residual"));
+  setAttrib(result, R_NamesSymbol, names);
+
+  Free1D(query);
+  FreeLBP(lbp);
+  FreeFittedBN(bn);
+
+  UNPROTECT(6);
+
+  return result;
+
+}/*LBP_BELIEFS*/
@@ -0,0 +1,153 @@
+#include "../../include/rcore.h"
+#include "../../include/parallel.h"
+#include "../../core/allocations.h"
+#include "../../minimal/data.frame.h"
+#include "../../minimal/common.h"
+#include "../../include/globals.h"
+#include "../rbn.h"
+#include "../gibbs.sampling.h"
+
+/* number of times forward sampling is tried to initialize a Markov chain. */
+#define GIBBS_INIT_TRIES 1000
+
+/* generate observations for the nodes in the query from their distribution
+ * conditional on the evidence, with one or more Gibbs sampling chains. */
+SEXP gibbs_particles(SEXP fitted, SEXP nodes, SEXP n, SEXP evidence,
+    SEXP burn_in, SEXP thin, SEXP chains, SEXP debug) {
+
+int i = 0, k = 0, num = INT(n), nchains = INT(chains), nburn = INT(burn_in);
+int nthin = INT(thin), nkeep = length(nodes), nnodes = 0, *keep = NULL;
+int **cols = NULL, *levels = NULL;
+uint32_t key[2] = { 0, 0 };
+bool debugging = isTRUE(debug), *failed = NULL, any_failed = FALSE;
+compiled_bn *plan = NULL;
+rbn_fixed *fixed = NULL;
+gibbs_sampler *gs = NULL;
+gibbs_chain *ch = NULL;
+SEXP result, try;
+
+  /* reuse the topological ordering and the local distributions of the compiled
+   * network. */
+  plan = compiled_network(fitted);
+  nnodes = (*plan).bn.nnodes;
+  gs = c_gibbs_build((*plan).bn, (*plan).poset);
+
+  /* restrict the nodes in the evidence to the levels they are allowed to
+   * take. */
+  fixed = rbn_match_fixed(plan, fitted, evidence);
+  for (i = 0; i < nnodes; i++) {
+
+    if (fixed[i].n == 0)
+      continue;
+
+    levels = Calloc1D(fixed[i].n, sizeof(int));
+    for (k = 0; k < fixed[i].n; k++)
+      levels[k] = fixed[i].levels[k] - 1;
+    c_gibbs_evidence(gs, i, levels, fixed[i].n);
+    Free1D(levels);
+
+    if (debugging)
+      Rprintf("* setting evidence on node %s (%d level(s) allowed).\n",
+        (*plan).bn.labels[i], (*gs).nallowed[i]);
+
+  }/*FOR*/
+  FreeRBNFIXED(fixed, nnodes);
+
+  /* allocate the return value, only for the nodes we were asked for. */
+  PROTECT(try = match(getAttrib(fitted, R_NamesSymbol), nodes, 0));
+  keep = INTEGER(try);
+  PROTECT(result = allocVector(VECSXP, nkeep));
+  cols = Calloc1D(nkeep, sizeof(int *));
+  for (k = 0; k < nkeep; k++) {
+
+    SET_VECTOR_ELT(result, k, fitnode2df(fitted, STRING_ELT(nodes, k), num));
+    cols[k] = INTEGER(VECTOR_ELT(result, k));
+
+  }/*FOR*/
+  setAttrib(result, R_NamesSymbol, nodes);
+  if (nkeep > 0)
+    minimal_data_frame(result);
+
+  /* there is no point in having chains that produce no observations. */
+  nchains = MIN(nchains, MAX(num, 1));
+
+  /* allocate the state of the chains beforehand, since they run in parallel. */
+  ch = Calloc1D(nchains, sizeof(gibbs_chain));
+  for (i = 0; i < nchains; i++) {
+
+    ch[i].state = Calloc1D(nnodes, sizeof(int));
+    ch[i].cell = Calloc1D(nnodes, sizeof(int));
+    ch[i].prob = Calloc1D((*gs).maxlevels, sizeof(double));
+
+  }/*FOR*/
+  failed = Calloc1D(nchains, sizeof(bool));
+
+  if (debugging)
+    Rprintf("* running %d chain(s) with %d burn-in sweep(s), keeping one sweep every %d.\n",
+      nchains, nburn, nthin);
+
+  /* each chain has its own random stream keyed on R's random seed, so the
+   * observations do not depend on the number of threads. */
+  GetRNGstate();
+  rng_stream_key(key);
+  PutRNGstate();
+
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic) num_threads(MAX_THREADS)
+#endif
+  for (int c = 0; c < nchains; c++) {
+
+    int from = (int)(((long long)num * c) / nchains);
+    int to = (int)(((long long)num * (c + 1)) / nchains);
+
+    rng_stream_init(&(ch[c].rng), key, (uint64_t)c);
+
+    if (!c_gibbs_init(gs, ch + c, GIBBS_INIT_TRIES)) {
+
+      failed[c] = TRUE;
+      continue;
+
+    }/*THEN*/
+
+    for (int b = 0; b < nburn; b++)
+      c_gibbs_sweep(gs, ch + c);
+
+    for (int r = from; r < to; r++) {
+
+      for (int t = 0; t < nthin; t++)
+        c_gibbs_sweep(gs, ch + c);
+
+      for (int j = 0; j < nkeep; j++)
+        cols[j][r] = ch[c].state[keep[j] - 1] + 1;
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  for (i = 0; i < nchains; i++)
+    any_failed = any_failed || failed[i];
+
+  if (debugging && !any_failed)
+    Rprintf("* generated %d observations from %d chain(s).\n", num, nchains);
+
+  for (i = 0; i < nchains; i++) {
+
+    Free1D(ch[i].state);
+    Free1D(ch[i].cell);
+    Free1D(ch[i].prob);
+
+  }/*FOR*/
+  Free1D(ch);
+  Free1D(failed);
+  Free1D(cols);
+  FreeGIBBS(gs);
+
+  if (any_failed)
+    error("unable to find a configuration compatible with the evidence after %d attempts, the evidence may have probability zero.",
+      GIBBS_INIT_TRIES);
+
+  UNPROTECT(2);
+
+  return result;
+
+}/*GIBBS_PARTICLES*/
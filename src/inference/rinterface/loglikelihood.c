@@ -31,7 +31,6 @@ SEXP keep, loglikelihood, metadata, complete_nodes, nodes_in_fitted;
   else {
 
     PROTECT(loglikelihood = ScalarReal(0));
-    loglik = Calloc1D(ndata, sizeof(double));
 
   }/*ELSE*/
 
@@ -43,6 +42,10 @@ SEXP keep, loglikelihood, metadata, complete_nodes, nodes_in_fitted;
   PROTECT(metadata = getAttrib(data, BN_MetaDataSymbol));
   PROTECT(complete_nodes = getListElement(metadata, "complete.nodes"));
 
+  /* the log-likelihood of discrete nodes is computed from the logarithms of
+   * their conditional probability tables. */
+  fitted_network_logcpt(&bn);
+
   if (bn.type == DNET || bn.type == ONET || bn.type == DONET) {
 
     if (debugging)
@@ -84,7 +87,7 @@ SEXP keep, loglikelihood, metadata, complete_nodes, nodes_in_fitted;
     else {
 
       NUM(loglikelihood) =
-        data_gaussian_loglikelihood(bn, dt, loglik, propagate, debugging);
+        data_gaussian_loglikelihood(bn, dt, propagate, debugging);
 
     }/*ELSE*/
 
@@ -108,7 +111,7 @@ SEXP keep, loglikelihood, metadata, complete_nodes, nodes_in_fitted;
     else {
 
       NUM(loglikelihood) =
-        data_clgaussian_loglikelihood(bn, dt, loglik, propagate, debugging);
+        data_clgaussian_loglikelihood(bn, dt, propagate, debugging);
 
     }/*ELSE*/
 
@@ -121,8 +124,6 @@ SEXP keep, loglikelihood, metadata, complete_nodes, nodes_in_fitted;
 
   }/*ELSE*/
 
-  if (!by)
-    Free1D(loglik);
   FreeFittedBN(bn);
   UNPROTECT(5);
 
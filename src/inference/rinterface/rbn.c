@@ -3,7 +3,7 @@
 #include "../../minimal/data.frame.h"
 
 /* generate random observations from a bayesian network. */
-SEXP rbn_master(SEXP fitted, SEXP n, SEXP fix, SEXP debug) {
+SEXP rbn_master(SEXP fitted, SEXP n, SEXP fix, SEXP parallel, SEXP debug) {
 
 bool debugging = isTRUE(debug);
 SEXP result;
@@ -11,7 +11,7 @@ SEXP result;
   /* allocate the return value. */
   PROTECT(result = fit2df(fitted, INT(n)));
   /* generate the random observations. */
-  c_rbn_master(fitted, result, n, fix, debugging);
+  c_rbn_master(fitted, result, n, fix, isTRUE(parallel), debugging);
 
   UNPROTECT(1);
 
@@ -0,0 +1,181 @@
+#include "../../include/rcore.h"
+#include "../../include/globals.h"
+#include "../../fitted/fitted.h"
+#include "../../core/data.table.h"
+#include "../../core/data.stream.h"
+#include "../../core/allocations.h"
+#include "../../minimal/common.h"
+#include "../../minimal/strings.h"
+#include "../loglikelihood/loglikelihood.h"
+
+/* log-likelihood and log-likelihood loss of a data set that is read from a
+ * file in batches of observations, so that memory use does not depend on the
+ * size of the data set. */
+SEXP stream_loglikelihood(SEXP fitted, SEXP file, SEXP format, SEXP batch,
+    SEXP keep_nodes, SEXP propagate_missing, SEXP debug) {
+
+int i = 0, nnodes = length(fitted), nbatch = INT(batch), ndisc = 0, ncont = 0;
+int nread = 0, *keep = NULL, nused = 0;
+double nobs = 0, loglik = 0, loss = 0, effective = 0, *node_loglik = NULL;
+bool propagate = isTRUE(propagate_missing), debugging = isTRUE(debug);
+bool *discrete = NULL, incomplete = FALSE, nan_parameters = FALSE;
+int *nlevels = NULL, *map = NULL;
+const char **names = NULL, ***levels = NULL;
+char msg[256] = "";
+void **columns = NULL;
+fitted_bn bn = fitted_network_from_SEXP(fitted);
+loglik_totals tot = { 0 };
+data_stream *s = NULL;
+cgdata dt = { 0 };
+SEXP nodes_in_fitted, try, prob, labels, result, per_node;
+
+  PROTECT(nodes_in_fitted = getAttrib(fitted, R_NamesSymbol));
+  PROTECT(try = match(keep_nodes, nodes_in_fitted, 0));
+  keep = INTEGER(try);
+
+  /* the type and the levels of each variable, from the local distributions. */
+  names = Calloc1D(nnodes, sizeof(char *));
+  discrete = Calloc1D(nnodes, sizeof(bool));
+  nlevels = Calloc1D(nnodes, sizeof(int));
+  levels = Calloc1D(nnodes, sizeof(char **));
+  map = Calloc1D(nnodes, sizeof(int));
+
+  for (i = 0; i < nnodes; i++) {
+
+    names[i] = bn.labels[i];
+    discrete[i] = (bn.node_types[i] == DNODE) || (bn.node_types[i] == ONODE);
+
+    if (discrete[i]) {
+
+      prob = getListElement(VECTOR_ELT(fitted, i), "prob");
+      labels = VECTOR_ELT(getAttrib(prob, R_DimNamesSymbol), 0);
+      nlevels[i] = length(labels);
+      levels[i] = Calloc1D(nlevels[i], sizeof(char *));
+      for (int l = 0; l < nlevels[i]; l++)
+        levels[i][l] = CHAR(STRING_ELT(labels, l));
+      map[i] = ndisc++;
+
+    }/*THEN*/
+    else {
+
+      map[i] = ncont++;
+
+    }/*ELSE*/
+
+  }/*FOR*/
+
+  /* a single data table holds one batch at a time, with the columns in the
+   * same order as the nodes. */
+  dt = new_cgdata(nbatch, ndisc, ncont);
+  for (i = 0; i < nnodes; i++) {
+
+    dt.map[i] = map[i];
+    dt.m.flag[i].discrete = discrete[i];
+    dt.m.flag[i].gaussian = !discrete[i];
+    dt.m.flag[i].fixed = (keep[i] > 0);
+    if (discrete[i])
+      dt.nlvl[map[i]] = nlevels[i];
+
+  }/*FOR*/
+  columns = cgdata_node_columns(bn, dt);
+
+  fitted_network_logcpt(&bn);
+  nan_parameters = check_nan_gaussian_parameters(bn, dt.m, debugging);
+  tot = new_loglik_totals(nnodes);
+
+  s = data_stream_open(CHAR(STRING_ELT(file, 0)),
+        stream_format_to_enum(CHAR(STRING_ELT(format, 0))), nnodes, names,
+        discrete, nlevels, levels);
+
+  while ((*s).msg[0] == '\0') {
+
+    nread = data_stream_read(s, &dt, nbatch);
+
+    if (nread <= 0)
+      break;
+
+    /* missing values are only checked, and propagated, after reading them. */
+    if (propagate && !incomplete)
+      incomplete = check_locally_incomplete_data(bn, dt.m, FALSE);
+
+    loglikelihood_totals_blocks(bn, dt.m, columns, &tot);
+    nobs += nread;
+
+    if (debugging)
+      Rprintf("* read %d observations (%.0lf so far).\n", nread, nobs);
+
+  }/*WHILE*/
+
+  /* copy the error message, if any, to raise the error after cleaning up. */
+  strncpy(msg, (*s).msg, sizeof(msg) - 1);
+
+  if (msg[0] == '\0') {
+
+    /* the log-likelihood of the whole data set, and of each node... */
+    PROTECT(per_node = allocVector(REALSXP, nnodes));
+    node_loglik = REAL(per_node);
+    for (i = 0; i < nnodes; i++)
+      node_loglik[i] = NA_REAL;
+
+    loglik = loglikelihood_from_totals(bn, dt.m, &tot, nobs, node_loglik,
+               debugging);
+    if (incomplete || nan_parameters)
+      loglik = NA_REAL;
+    setAttrib(per_node, R_NamesSymbol, nodes_in_fitted);
+
+    /* ... and the log-likelihood loss, which drops the observations whose
+     * log-likelihood is not finite. */
+    for (i = 0; i < nnodes; i++) {
+
+      if (!dt.m.flag[i].fixed)
+        continue;
+
+      if (tot.nfinite[i] > 0)
+        loss -= (double)tot.finite[i] / tot.nfinite[i];
+      else
+        loss = NA_REAL;
+
+      effective += tot.nfinite[i];
+      nused++;
+
+    }/*FOR*/
+
+    if (nused > 0)
+      effective /= nused;
+
+    PROTECT(result = allocVector(VECSXP, 5));
+    setAttrib(result, R_NamesSymbol,
+      mkStringVec(5, "loglik", "nodes", "loss", "effective.size", "nobs"));
+    SET_VECTOR_ELT(result, 0, ScalarReal(loglik));
+    SET_VECTOR_ELT(result, 1, per_node);
+    SET_VECTOR_ELT(result, 2, ScalarReal(loss));
+    SET_VECTOR_ELT(result, 3, ScalarReal(effective));
+    SET_VECTOR_ELT(result, 4, ScalarReal(nobs));
+
+  }/*THEN*/
+
+  FreeDATASTREAM(s);
+  FreeLOGLIKTOTALS(tot);
+  Free1D(columns);
+  FreeCGDT(dt);
+  for (i = 0; i < nnodes; i++)
+    Free1D(levels[i]);
+  Free1D(levels);
+  Free1D(nlevels);
+  Free1D(discrete);
+  Free1D(names);
+  Free1D(map);
+  FreeFittedBN(bn);
+
+  if (msg[0] != '\0') {
+
+    UNPROTECT(2);
+    error("%s", msg);
+
+  }/*THEN*/
+
+  UNPROTECT(4);
+
+  return result;
+
+}/*STREAM_LOGLIKELIHOOD*/
@@ -1,5 +1,8 @@
 #include "../../include/rcore.h"
+#include "../../include/parallel.h"
+#include "../../include/globals.h"
 #include "../../core/allocations.h"
+#include "../../core/bitmaps.h"
 #include "../../core/uppertriangular.h"
 #include "../../include/graph.h"
 #include "../../tests/tests.h"
@@ -10,6 +13,7 @@
 #include "../../core/contingency.tables.h"
 #include "../../minimal/strings.h"
 #include "../../minimal/common.h"
+#include "../../math/linear.algebra.h"
 
 /* enum for the mutual information estimators, to be matched from the label
  * string passed down from R. */
@@ -32,96 +36,151 @@ mi_estimator_e mi_to_enum(const char *label) {
 
 }/*MI_TO_ENUM*/
 
+/* number of variables in each side of a tile of the mutual information matrix:
+ * pairs are processed one tile at a time, so that the columns they involve are
+ * reused while they are still in cache. */
+#define MI_TILE 32
+
+/* enumerate the tiles covering the upper triangle of the matrix. */
+static int mi_tiles(int dim, int **tile_i, int **tile_j) {
+
+int i = 0, j = 0, k = 0, nblocks = (dim + MI_TILE - 1) / MI_TILE;
+
+  *tile_i = Calloc1D(nblocks * (nblocks + 1) / 2, sizeof(int));
+  *tile_j = Calloc1D(nblocks * (nblocks + 1) / 2, sizeof(int));
+
+  for (i = 0; i < nblocks; i++)
+    for (j = i; j < nblocks; j++) {
+
+      (*tile_i)[k] = i * MI_TILE;
+      (*tile_j)[k] = j * MI_TILE;
+      k++;
+
+    }/*FOR*/
+
+  return k;
+
+}/*MI_TILES*/
+
+/* print all the pairwise mutual information coefficients, which is deferred
+ * until they have all been computed since threads cannot print. */
+static void mi_matrix_debug(uppertriangular mim, const char **names) {
+
+  for (int i = 0; i < mim.dim; i++)
+    for (int j = i + 1; j < mim.dim; j++)
+      Rprintf("  > mutual information between %s and %s is %lf.\n",
+        names[i], names[j], UTREL(mim, i, j));
+
+}/*MI_MATRIX_DEBUG*/
+
 /* compute all the pairwise mutual information coefficients between discrete
  * variables. */
 static void mi_matrix_discrete(uppertriangular mim, ddata data, int *cond,
     int clevels, mi_estimator_e est, bool debugging) {
 
-int i = 0, j = 0;
+int i = 0, t = 0, max_nlvl = 0, ntiles = 0, nthreads = MAX_THREADS;
+int *tile_i = NULL, *tile_j = NULL;
+counts2d *counts = NULL;
+counts3d *ccounts = NULL;
 
   switch (est) {
 
     case MLE:
 
+      /* along the lines of Hartemink's discretisation code, figure out what is
+       * the largest contingency table that we need, so we can allocate only one
+       * for each thread and shrink it as needed. */
+      for (i = 0; i < data.m.ncols; i++)
+        max_nlvl = (max_nlvl < data.nlvl[i]) ? data.nlvl[i] : max_nlvl;
+
       if (!cond) {
 
-        /* along the lines of Hartemink's discretisation code. */
-        int max_nlvl = 0;
-        counts2d counts = { 0 };
+        counts = Calloc1D(nthreads, sizeof(counts2d));
+        for (t = 0; t < nthreads; t++)
+          counts[t] = new_2d_table(max_nlvl, max_nlvl, TRUE);
 
-        /* figure out what is the largest contingency table that we need, so
-         * we can allocate only one and shrink it as needed. */
-        for (i = 0; i < data.m.ncols; i++)
-          max_nlvl = (max_nlvl < data.nlvl[i]) ? data.nlvl[i] : max_nlvl;
+      }/*THEN*/
+      else {
 
-        counts = new_2d_table(max_nlvl, max_nlvl, TRUE);
+        ccounts = Calloc1D(nthreads, sizeof(counts3d));
+        for (t = 0; t < nthreads; t++)
+          ccounts[t] = new_3d_table(max_nlvl, max_nlvl, clevels);
 
-        for (i = 0; i < mim.dim; i++) {
+      }/*ELSE*/
 
-          for (j = i + 1; j < mim.dim; j++) {
+      ntiles = mi_tiles(mim.dim, &tile_i, &tile_j);
 
-            /* resize the contigency table and fill it with the new counts. */
-            resize_2d_table(data.nlvl[i], data.nlvl[j], &counts);
-            refill_2d_table(data.col[i], data.col[j], &counts, data.m.nobs);
+#ifdef _OPENMP
+      #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+      for (t = 0; t < ntiles; t++) {
 
-            /* compute and save the mutual information. */
-            if (counts.nobs == 0)
-              UTREL(mim, i, j) = 0;
-            else
-              UTREL(mim, i, j) = mi_kernel(counts) / counts.nobs;
+        int i = 0, j = 0, id = THREAD_ID;
+        int iend = MIN(tile_i[t] + MI_TILE, mim.dim);
+        int jend = MIN(tile_j[t] + MI_TILE, mim.dim);
 
-            if (debugging)
-              Rprintf("  > mutual information between %s and %s is %lf.\n",
-                data.m.names[i], data.m.names[j], UTREL(mim, i, j));
+        for (i = tile_i[t]; i < iend; i++) {
 
-          }/*FOR*/
+          for (j = MAX(i + 1, tile_j[t]); j < jend; j++) {
 
-        }/*FOR*/
+            /* resize the contigency table and fill it with the new counts,
+             * then compute and save the mutual information. */
+            if (!cond) {
 
-        resize_2d_table(max_nlvl, max_nlvl, &counts);
-        Free2DTAB(counts);
+              resize_2d_table(data.nlvl[i], data.nlvl[j], counts + id);
+              refill_2d_table(data.col[i], data.col[j], counts + id,
+                data.m.nobs);
 
-      }/*THEN*/
-      else {
+              if (counts[id].nobs == 0)
+                UTREL(mim, i, j) = 0;
+              else
+                UTREL(mim, i, j) = mi_kernel(counts[id]) / counts[id].nobs;
 
-        /* along the lines of Hartemink's discretisation code. */
-        int max_nlvl = 0;
-        counts3d counts = { 0 };
+            }/*THEN*/
+            else {
 
-        /* figure out what is the largest contingency table that we need, so
-         * we can allocate only one and shrink it as needed. */
-        for (i = 0; i < data.m.ncols; i++)
-          max_nlvl = (max_nlvl < data.nlvl[i]) ? data.nlvl[i] : max_nlvl;
+              resize_3d_table(data.nlvl[i], data.nlvl[j], clevels, ccounts + id);
+              refill_3d_table(data.col[i], data.col[j], cond, ccounts + id,
+                data.m.nobs);
 
-        counts = new_3d_table(max_nlvl, max_nlvl, clevels);
+              if (ccounts[id].nobs == 0)
+                UTREL(mim, i, j) = 0;
+              else
+                UTREL(mim, i, j) = cmi_kernel(ccounts[id]) / ccounts[id].nobs;
 
-        for (i = 0; i < mim.dim; i++) {
+            }/*ELSE*/
 
-          for (j = i + 1; j < mim.dim; j++) {
+          }/*FOR*/
 
-            /* resize the contigency table and fill it with the new counts. */
-            resize_3d_table(data.nlvl[i], data.nlvl[j], clevels, &counts);
-            refill_3d_table(data.col[i], data.col[j], cond, &counts, data.m.nobs);
+        }/*FOR*/
 
-            /* compute and save the mutual information. */
+      }/*FOR*/
 
-            if (counts.nobs == 0)
-              UTREL(mim, i, j) = 0;
-            else
-              UTREL(mim, i, j) = cmi_kernel(counts) / counts.nobs;
+      for (t = 0; t < nthreads; t++) {
 
-            if (debugging)
-              Rprintf("  > mutual information between %s and %s is %lf.\n",
-                data.m.names[i], data.m.names[j], UTREL(mim, i, j));
+        if (!cond) {
 
-          }/*FOR*/
+          resize_2d_table(max_nlvl, max_nlvl, counts + t);
+          Free2DTAB(counts[t]);
 
-        }/*FOR*/
+        }/*THEN*/
+        else {
 
-        resize_3d_table(max_nlvl, max_nlvl, clevels, &counts);
-        Free3DTAB(counts);
+          resize_3d_table(max_nlvl, max_nlvl, clevels, ccounts + t);
+          Free3DTAB(ccounts[t]);
+
+        }/*ELSE*/
+
+      }/*FOR*/
+
+      Free1D(counts);
+      Free1D(ccounts);
+      Free1D(tile_i);
+      Free1D(tile_j);
+
+      if (debugging)
+        mi_matrix_debug(mim, data.m.names);
 
-      }/*ELSE*/
       break;
 
     default:
@@ -131,44 +190,173 @@ int i = 0, j = 0;
 
 }/*MI_MATRIX_DISCRETE*/
 
+/* linear correlation from the observations that are complete for both
+ * variables, found by intersecting their validity bitmaps. Coefficients
+ * outside [-1, 1] due to floating point errors are fixed and flagged, since
+ * this is called from multiple threads and cannot raise warnings. */
+static double mi_cor_with_mask(double *x, double *y, uint64_t *vx,
+    uint64_t *vy, uint64_t *mask, int nobs, bool *fixed) {
+
+int k = 0, w = 0, nc = 0, nwords = BITMAP_NWORDS(nobs);
+uint64_t bits = 0;
+long double xm = 0, ym = 0, xsse = 0, ysse = 0, cov = 0, cor = 0;
+
+  nc = bitmap_and(vx, vy, mask, nwords);
+
+  /* if there are no complete observations, assume the correlation is zero. */
+  if (nc == 0)
+    return 0;
+
+  FOR_EACH_BIT(mask, nwords, w, bits, k) {
+
+    xm += x[k];
+    ym += y[k];
+
+  }/*FOR*/
+
+  xm /= nc;
+  ym /= nc;
+
+  FOR_EACH_BIT(mask, nwords, w, bits, k) {
+
+    xsse += (x[k] - xm) * (x[k] - xm);
+    ysse += (y[k] - ym) * (y[k] - ym);
+    cov += (x[k] - xm) * (y[k] - ym);
+
+  }/*FOR*/
+
+  /* safety check against "divide by zero" errors. */
+  if ((xsse < MACHINE_TOL) || (ysse < MACHINE_TOL))
+    return 0;
+
+  cor = cov / sqrtl(xsse * ysse);
+
+  if ((cor > 1) || (cor < -1)) {
+
+    cor = (cor > 1) ? 1 : -1;
+    *fixed = TRUE;
+
+  }/*THEN*/
+
+  return (double)cor;
+
+}/*MI_COR_WITH_MASK*/
+
 /* compute all the pairwise mutual information coefficients between Gaussian
- * variables. */
+ * variables. The correlations between complete variables are computed all at
+ * once as the cross-product of the standardized data; those involving
+ * incomplete variables are computed pair by pair from complete observations. */
 static void mi_matrix_gaussian(uppertriangular mim, gdata data, double *sse,
     mi_estimator_e est, bool debugging) {
 
-int i = 0, j = 0;
-double cor = 0;
+int i = 0, k = 0, t = 0, nc = 0, ntiles = 0, nthreads = MAX_THREADS;
+int nobs = data.m.nobs, *pos = NULL, *tile_i = NULL, *tile_j = NULL;
+double *std = NULL, *cor = NULL, one = 1, zero = 0, scale = 0;
+char uplo = 'U', trans = 'T';
+uint64_t **masks = NULL;
+bool *fixed = NULL;
 
   switch (est) {
 
     case MLE_G:
 
-      for (i = 0; i < mim.dim; i++) {
+      /* map the complete variables to the columns of the standardized data. */
+      pos = Calloc1D(mim.dim, sizeof(int));
+      for (i = 0; i < mim.dim; i++)
+        pos[i] = data.m.flag[i].complete ? nc++ : -1;
 
-        for (j = i + 1; j < mim.dim; j++) {
+      if ((nc > 0) && (nobs > 0)) {
 
-          if (data.m.flag[i].complete && data.m.flag[j].complete) {
+        /* standardize the complete variables, so that their correlation matrix
+         * is just their cross-product; constant variables are set to zero. */
+        std = Calloc1D((size_t)nobs * nc, sizeof(double));
+        for (i = 0; i < mim.dim; i++) {
 
-            cor = c_fast_cor(data.col[i], data.col[j], data.m.nobs,
-                    data.mean[i], data.mean[j], sse[i], sse[j]);
+          if (pos[i] < 0)
+            continue;
 
-          }/*THEN*/
-          else {
+          scale = (sse[i] < MACHINE_TOL) ? 0 : 1 / sqrt(sse[i]);
+          for (k = 0; k < nobs; k++)
+            std[CMC(k, pos[i], nobs)] = (data.col[i][k] - data.mean[i]) * scale;
 
-            cor = c_cor_with_missing(data.col[i], data.col[j], data.m.nobs,
-                    NULL, NULL, NULL, NULL, NULL);
+        }/*FOR*/
 
-          }/*ELSE*/
+        cor = Calloc1D((size_t)nc * nc, sizeof(double));
+        F77_CALL(dsyrk)(&uplo, &trans, &nc, &nobs, &one, std, &nobs, &zero, cor,
+          &nc FCONE FCONE);
+        Free1D(std);
 
-          UTREL(mim, i, j) = cor_mi_trans(cor);
+      }/*THEN*/
 
-          if (debugging)
-            Rprintf("  > mutual information between %s and %s is %lf.\n",
-              data.m.names[i], data.m.names[j], UTREL(mim, i, j));
+      /* per-thread scratch space for the masks of the complete observations. */
+      masks = Calloc1D(nthreads, sizeof(uint64_t *));
+      for (t = 0; t < nthreads; t++)
+        masks[t] = new_bitmap(nobs);
+      fixed = Calloc1D(nthreads, sizeof(bool));
+
+      ntiles = mi_tiles(mim.dim, &tile_i, &tile_j);
+
+#ifdef _OPENMP
+      #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+      for (t = 0; t < ntiles; t++) {
+
+        int i = 0, j = 0, id = THREAD_ID;
+        int iend = MIN(tile_i[t] + MI_TILE, mim.dim);
+        int jend = MIN(tile_j[t] + MI_TILE, mim.dim);
+        double r = 0;
+
+        for (i = tile_i[t]; i < iend; i++) {
+
+          for (j = MAX(i + 1, tile_j[t]); j < jend; j++) {
+
+            if ((pos[i] >= 0) && (pos[j] >= 0)) {
+
+              r = cor[CMC(pos[i], pos[j], nc)];
+
+              if ((r > 1) || (r < -1)) {
+
+                r = (r > 1) ? 1 : -1;
+                fixed[id] = TRUE;
+
+              }/*THEN*/
+
+            }/*THEN*/
+            else {
+
+              r = mi_cor_with_mask(data.col[i], data.col[j], data.valid[i],
+                    data.valid[j], masks[id], nobs, fixed + id);
+
+            }/*ELSE*/
+
+            UTREL(mim, i, j) = cor_mi_trans(r);
+
+          }/*FOR*/
 
         }/*FOR*/
 
       }/*FOR*/
+
+      for (t = 0; t < nthreads; t++)
+        if (fixed[t]) {
+
+          warning("fixed correlation coefficients outside [-1, 1], probably due to floating point errors.");
+          break;
+
+        }/*THEN*/
+
+      for (t = 0; t < nthreads; t++)
+        Free1D(masks[t]);
+      Free1D(masks);
+      Free1D(fixed);
+      Free1D(cor);
+      Free1D(pos);
+      Free1D(tile_i);
+      Free1D(tile_j);
+
+      if (debugging)
+        mi_matrix_debug(mim, data.m.names);
+
       break;
 
     default:
@@ -224,6 +412,7 @@ uppertriangular mimatrix = { 0 };
     gdata dt = gdata_from_SEXP(data, 0);
     meta_copy_names(&(dt.m), 0, data);
     meta_init_flags(&(dt.m), 0, complete, R_NilValue);
+    gdata_cache_validity(&dt, 0);
     gdata_cache_means(&dt, 0);
     sse = Calloc1D(ncol, sizeof(double));
     c_ssevec(dt.col, sse, dt.mean, dt.m.nobs, dt.m.ncols, 0);
@@ -930,3 +930,126 @@ void c_ols(double **x, double *y, int nrow, int ncol, double *fitted,
 
 }/*C_OLS*/
 
+
+/* ordinary least squares from the mean and the centred cross-products of the
+ * response (the first variable) and of the regressors, solving the normal
+ * equations with a Cholesky decomposition. The cross-products are in the upper
+ * triangle of a (ncol + 1) x (ncol + 1) matrix, and the sample size may be a
+ * sum of weights. Regressors that are (close to) collinear with the previous
+ * ones either get NA coefficients, as in c_qr(), if pivot is TRUE; or make the
+ * function return FALSE without touching beta and sd, so that the caller can
+ * fall back to the QR decomposition. */
+bool c_ols_moments(double nobs, long double *mean, long double *comoment,
+    int ncol, bool pivot, double *beta, double *sd) {
+
+int i = 0, j = 0, k = 0, d = ncol + 1;
+long double *L = NULL, *b = NULL, sum = 0, rss = 0;
+bool *dropped = NULL;
+
+  L = Calloc1D(ncol * ncol, sizeof(long double));
+  b = Calloc1D(ncol, sizeof(long double));
+  dropped = Calloc1D(ncol, sizeof(bool));
+
+  /* Cholesky decomposition of the cross-products of the regressors. */
+  for (j = 0; j < ncol; j++) {
+
+    sum = comoment[CMC(j + 1, j + 1, d)];
+    for (k = 0; k < j; k++)
+      sum -= L[CMC(j, k, ncol)] * L[CMC(j, k, ncol)];
+
+    /* the regressor is (almost) a linear combination of the previous ones
+     * if little of its variance is left after regressing it on them. */
+    if (sum <= MACHINE_TOL * comoment[CMC(j + 1, j + 1, d)]) {
+
+      if (!pivot) {
+
+        Free1D(L);
+        Free1D(b);
+        Free1D(dropped);
+
+        return FALSE;
+
+      }/*THEN*/
+
+      /* leave the column of L set to zero, which drops the regressor. */
+      dropped[j] = TRUE;
+      continue;
+
+    }/*THEN*/
+
+    L[CMC(j, j, ncol)] = sqrtl(sum);
+
+    for (i = j + 1; i < ncol; i++) {
+
+      sum = comoment[CMC(j + 1, i + 1, d)];
+      for (k = 0; k < j; k++)
+        sum -= L[CMC(i, k, ncol)] * L[CMC(j, k, ncol)];
+      L[CMC(i, j, ncol)] = sum / L[CMC(j, j, ncol)];
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  /* forward substitution with the cross-products with the response... */
+  for (i = 0; i < ncol; i++) {
+
+    if (dropped[i])
+      continue;
+
+    sum = comoment[CMC(0, i + 1, d)];
+    for (k = 0; k < i; k++)
+      sum -= L[CMC(i, k, ncol)] * b[k];
+    b[i] = sum / L[CMC(i, i, ncol)];
+
+  }/*FOR*/
+
+  /* ... and backward substitution. */
+  for (i = ncol - 1; i >= 0; i--) {
+
+    if (dropped[i])
+      continue;
+
+    sum = b[i];
+    for (k = i + 1; k < ncol; k++)
+      sum -= L[CMC(k, i, ncol)] * b[k];
+    b[i] = sum / L[CMC(i, i, ncol)];
+
+  }/*FOR*/
+
+  /* the intercept goes through the means, and the residual sum of squares is
+   * what the regressors do not explain of the variance of the response. */
+  sum = mean[0];
+  rss = comoment[0];
+  for (i = 0; i < ncol; i++) {
+
+    sum -= b[i] * mean[i + 1];
+    rss -= b[i] * comoment[CMC(0, i + 1, d)];
+
+  }/*FOR*/
+
+  if (beta) {
+
+    beta[0] = sum;
+    for (i = 0; i < ncol; i++)
+      beta[i + 1] = dropped[i] ? NA_REAL : b[i];
+
+  }/*THEN*/
+
+  if (sd) {
+
+    if (nobs == 0)
+      *sd = NA_REAL;
+    else if (nobs <= d)
+      *sd = 0;
+    else
+      *sd = sqrt((rss > 0 ? rss : 0) / (nobs - d));
+
+  }/*THEN*/
+
+  Free1D(L);
+  Free1D(b);
+  Free1D(dropped);
+
+  return TRUE;
+
+}/*C_OLS_MOMENTS*/
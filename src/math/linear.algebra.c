@@ -136,6 +136,42 @@ covariance backup = (covariance){ 0 };
 
 }/*C_GINV*/
 
+/* C-level function to compute the inverse of a covariance matrix through its
+ * SVD decomposition, leaving the original matrix untouched. Returns FALSE if
+ * the decomposition fails or if the matrix is not full-rank, in which case the
+ * inverse is not defined and the caller should use the pseudoinverse. */
+bool c_fullrank_inverse(covariance cov, covariance inv) {
+
+int i = 0, j = 0, k = 0, errcode = 0;
+double sv_tol = 0;
+long double temp = 0;
+
+  copy_covariance(&cov, &inv);
+  c_svd(inv.mat, inv.u, inv.d, inv.vt, &inv.dim, &inv.dim, &inv.dim,
+    FALSE, &errcode);
+
+  if (errcode != 0)
+    return FALSE;
+
+  /* set the threshold for the singular values as in corpcor. */
+  sv_tol = inv.dim * inv.d[0] * MACHINE_TOL * MACHINE_TOL;
+  if (inv.d[inv.dim - 1] <= sv_tol)
+    return FALSE;
+
+  for (i = 0; i < inv.dim; i++)
+    for (j = i; j < inv.dim; j++) {
+
+      for (k = 0, temp = 0; k < inv.dim; k++)
+        temp += inv.u[CMC(i, k, inv.dim)] * inv.vt[CMC(k, j, inv.dim)] / inv.d[k];
+
+      inv.mat[CMC(i, j, inv.dim)] = inv.mat[CMC(j, i, inv.dim)] = (double)temp;
+
+    }/*FOR*/
+
+  return TRUE;
+
+}/*C_FULLRANK_INVERSE*/
+
 /* C-level function to perform OLS via QR decomposition. */
 void c_qr(double *qr, double *y, int nrow, int ncol, double *fitted,
     double *resid, double *beta, double *sd) {
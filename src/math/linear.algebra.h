@@ -22,6 +22,7 @@ void c_udvt(double **u, double **d, double **vt, int ncol);
 void c_svd(double *A, double *U, double *D, double *V, int *nrow, int *ncol,
     int *mindim, bool strict, int *errcode);
 void c_ginv(covariance cov, covariance mpinv);
+bool c_fullrank_inverse(covariance cov, covariance inv);
 void c_qr(double *qr, double *y, int nrow, int ncol, double *fitted,
     double *resid, double *beta, double *sd);
 
@@ -30,6 +31,8 @@ void c_ols(double **x, double *y, int nrow, int ncol, double *fitted,
 void c_cls(double **x, double *y, int *z, int nrow, int ncol, int ncond,
     double *fitted, double *resid, double *beta, double *sd, int *nobs,
     bool missing);
+bool c_ols_moments(double nobs, long double *mean, long double *comoment,
+    int ncol, bool pivot, double *beta, double *sd);
 
 void c_qr_matrix(double *qr, double **x, int nrow, int ncol, int *complete,
     int ncomplete);
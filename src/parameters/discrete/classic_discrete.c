@@ -2,16 +2,12 @@
 #include "../../core/contingency.tables.h"
 #include "../../math/linear.algebra.h"
 
-void c_classic_discrete_parameters(int *counts, double *cpt, int nrows,
-    int ncols, double alpha, bool replace) {
+/* normalize the columns of a CPT to sum up to 1. */
+static void normalize_cpt_columns(double *cpt, int nrows, int ncols,
+    bool replace) {
 
 long double colsum = 0;
 
-  /* add the imaginary sample size, if any, ... */
-  for (int i = 0; i < nrows * ncols; i++)
-    cpt[i] = counts[i] + alpha / (nrows * ncols);
-
-  /* ... and normalize the columns to sum up to 1. */
   for (int j = 0; j < ncols; j++) {
 
     colsum = 0;
@@ -45,5 +41,28 @@ long double colsum = 0;
 
   }/*FOR*/
 
+}/*NORMALIZE_CPT_COLUMNS*/
+
+void c_classic_discrete_parameters(int *counts, double *cpt, int nrows,
+    int ncols, double alpha, bool replace) {
+
+  /* add the imaginary sample size, if any, ... */
+  for (int i = 0; i < nrows * ncols; i++)
+    cpt[i] = counts[i] + alpha / (nrows * ncols);
+
+  /* ... and normalize the columns to sum up to 1. */
+  normalize_cpt_columns(cpt, nrows, ncols, replace);
+
 }/*C_CLASSIC_DISCRETE_PARAMETERS*/
 
+/* the same from weighted counts, which are not integers if the observations
+ * have been discounted by a forgetting factor. */
+void c_weighted_discrete_parameters(double *counts, double *cpt, int nrows,
+    int ncols, double alpha, bool replace) {
+
+  for (int i = 0; i < nrows * ncols; i++)
+    cpt[i] = counts[i] + alpha / (nrows * ncols);
+
+  normalize_cpt_columns(cpt, nrows, ncols, replace);
+
+}/*C_WEIGHTED_DISCRETE_PARAMETERS*/
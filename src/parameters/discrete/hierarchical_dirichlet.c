@@ -1,34 +1,135 @@
 #include "../../include/rcore.h"
 #include "../../include/globals.h"
+#include "../../include/parallel.h"
 #include "../../core/allocations.h"
 #include "../../core/contingency.tables.h"
 #include "../../math/linear.algebra.h"
 #include "../parameters.h"
 
-static long double estimate_loglik_tau(double *kappa, double tau, double alpha0,
-    double s, int x_dim, int y_dim) {
+/* minimum number of rows in the table of counts (that is, of configurations of
+ * the node and its parents) for the loops over them to run in parallel. */
+#define HDIR_PARALLEL_ROWS 1024
+
+/* the digamma values of nu, which only change once per EM iteration, and the
+ * scratch spaces used by the Newton updates. Per-row terms are computed in
+ * parallel and then added up sequentially, so that the estimates do not depend
+ * on the number of threads. */
+typedef struct {
+
+  int nthreads;              /* number of threads for the loops over rows. */
+  double *digamma_nu;        /* digamma() of each cell of nu... */
+  double *digamma_rowsums;   /* ... its row sums... */
+  double *colsums;           /* ... the column sums of nu... */
+  double *digamma_colsums;   /* ... and their digamma(). */
+  double *terms;             /* per-row terms of log-likelihoods and... */
+  double *terms2;            /* ... derivatives. */
+  double *gradient;          /* gradient of the log-likelihood of kappa. */
+  double *hessian;           /* diagonal of the hessian of the same. */
+  double *delta_kappa;       /* Newton step for kappa. */
+  double *new_kappa;         /* updated kappa in the line search. */
+  double *kappa0;            /* kappa before the SQUAREM cycle... */
+  double *kappa1;            /* ... after one EM iteration... */
+  double *kappa2;            /* ... and after two EM iterations. */
+
+} hdir_cache;
+
+static hdir_cache new_hdir_cache(int x_dim, int y_dim) {
+
+hdir_cache cache = { 0 };
+
+  cache.nthreads = (x_dim >= HDIR_PARALLEL_ROWS) ? MAX_THREADS : 1;
+  cache.digamma_nu = Calloc1D((size_t)x_dim * y_dim, sizeof(double));
+  cache.digamma_rowsums = Calloc1D(x_dim, sizeof(double));
+  cache.colsums = Calloc1D(y_dim, sizeof(double));
+  cache.digamma_colsums = Calloc1D(y_dim, sizeof(double));
+  cache.terms = Calloc1D(x_dim, sizeof(double));
+  cache.terms2 = Calloc1D(x_dim, sizeof(double));
+  cache.gradient = Calloc1D(x_dim, sizeof(double));
+  cache.hessian = Calloc1D(x_dim, sizeof(double));
+  cache.delta_kappa = Calloc1D(x_dim, sizeof(double));
+  cache.new_kappa = Calloc1D(x_dim, sizeof(double));
+  cache.kappa0 = Calloc1D(x_dim, sizeof(double));
+  cache.kappa1 = Calloc1D(x_dim, sizeof(double));
+  cache.kappa2 = Calloc1D(x_dim, sizeof(double));
+
+  return cache;
+
+}/*NEW_HDIR_CACHE*/
+
+static void FreeHDIRCACHE(hdir_cache cache) {
+
+  Free1D(cache.digamma_nu);
+  Free1D(cache.digamma_rowsums);
+  Free1D(cache.colsums);
+  Free1D(cache.digamma_colsums);
+  Free1D(cache.terms);
+  Free1D(cache.terms2);
+  Free1D(cache.gradient);
+  Free1D(cache.hessian);
+  Free1D(cache.delta_kappa);
+  Free1D(cache.new_kappa);
+  Free1D(cache.kappa0);
+  Free1D(cache.kappa1);
+  Free1D(cache.kappa2);
+
+}/*FREEHDIRCACHE*/
+
+/* recompute the digamma values of nu after it has been updated. */
+static void refresh_hdir_cache(double *nu, int x_dim, int y_dim,
+    hdir_cache *cache) {
+
+double *dnu = (*cache).digamma_nu, *rowsums = (*cache).digamma_rowsums;
+
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(static) num_threads((*cache).nthreads)
+#endif
+  for (int i = 0; i < x_dim; i++) {
 
-long double loglik = 0;
+    rowsums[i] = 0;
 
-  for (int i = 0; i < x_dim; i++)
-    loglik += (digamma(tau * kappa[i]) - digamma(tau)) *
-              (alpha0 - (tau * kappa[i]) + y_dim * (1 - s * kappa[i])) +
-              lgammafn(tau * kappa[i]);
+    for (int j = 0; j < y_dim; j++) {
 
-  loglik += - lgammafn(tau) - (y_dim * s * (x_dim - 1) / tau);
+      dnu[CMC(i, j, x_dim)] = digamma(nu[CMC(i, j, x_dim)]);
+      rowsums[i] += dnu[CMC(i, j, x_dim)];
 
-  return loglik;
+    }/*FOR*/
 
-}/*ESTIMATE_LOGLIK_TAU*/
+  }/*FOR*/
 
-static double estimate_loglik_kappa(double *kappa, double *digamma_rowsums,
-    double tau, double s, double alpha0, int x_dim, int y_dim) {
+  for (int j = 0; j < y_dim; j++) {
 
-long double loglik = 0;
+    (*cache).colsums[j] = 0;
+    for (int i = 0; i < x_dim; i++)
+      (*cache).colsums[j] += nu[CMC(i, j, x_dim)];
+    (*cache).digamma_colsums[j] = digamma((*cache).colsums[j]);
 
+  }/*FOR*/
+
+}/*REFRESH_HDIR_CACHE*/
+
+/* add up the per-row terms sequentially. */
+static long double sum_terms(double *terms, int x_dim) {
+
+long double sum = 0;
+
+  for (int i = 0; i < x_dim; i++)
+    sum += terms[i];
+
+  return sum;
+
+}/*SUM_TERMS*/
+
+static double estimate_loglik_kappa(double *kappa, double tau, double s,
+    double alpha0, int x_dim, int y_dim, hdir_cache *cache) {
+
+double *terms = (*cache).terms, *digamma_rowsums = (*cache).digamma_rowsums;
+
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(static) num_threads((*cache).nthreads)
+#endif
   for (int i = 0; i < x_dim; i++) {
 
-    loglik +=
+    terms[i] =
       digamma(tau * kappa[i]) *
       (alpha0 - (tau * kappa[i]) + y_dim * (1 - s * kappa[i])) +
       lgammafn(tau * kappa[i]) -
@@ -37,84 +138,83 @@ long double loglik = 0;
 
   }/*FOR*/
 
-  return (double) loglik;
+  return (double) sum_terms(terms, x_dim);
 
 }/*ESTIMATE_LOGLIK_KAPPA*/
 
-static long double estimate_loglik_kappa_and_tau(double *nu, double *kappa,
-    double tau, double alpha0, double s, int x_dim, int y_dim) {
+static long double estimate_loglik_kappa_and_tau(double *kappa, double tau,
+    double alpha0, double s, int x_dim, int y_dim, hdir_cache *cache) {
 
-double *digamma_rowsums = 0;
-long double loglik_kappa_tau = 0;
+double *terms = (*cache).terms, *digamma_rowsums = (*cache).digamma_rowsums;
+double digamma_tau = digamma(tau);
 
-  digamma_rowsums = (double *) Calloc1D(x_dim, sizeof(double));
-  for (int i = 0; i < x_dim; i++)
-    for (int j = 0; j < y_dim; j++)
-      digamma_rowsums[i] += digamma(nu[CMC(i, j, x_dim)]);
+  /* the joint log-likelihood of kappa and tau is the sum of the individual
+   * log-likelihoods of kappa and tau minus the shared terms that appear in
+   * both, which simplifies to the terms below. */
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(static) num_threads((*cache).nthreads)
+#endif
+  for (int i = 0; i < x_dim; i++) {
 
-  /* the joint log-likelihood of kappa and tau computed as the sum of the
-   * individual log-likelihoods of kappa and tau, subtracting shared terms that
-   * appear in both. */
-  loglik_kappa_tau =
-    estimate_loglik_kappa(kappa, digamma_rowsums, tau, s, alpha0, x_dim, y_dim) +
-    estimate_loglik_tau(kappa, tau, alpha0, s, x_dim, y_dim);
+    double shared = alpha0 - (tau * kappa[i]) + y_dim * (1 - s * kappa[i]);
 
-  for (int i = 0; i < x_dim; i++)
-    loglik_kappa_tau -=
-      digamma(tau * kappa[i]) *
-        (alpha0 - tau * kappa[i] - y_dim * (s * kappa[i] - 1)) +
-       lgammafn(tau * kappa[i]);
+    terms[i] =
+      (digamma(tau * kappa[i]) - digamma_tau) * shared +
+      lgammafn(tau * kappa[i]) -
+      y_dim * (lgammafn(s * kappa[i]) + (1 - s * kappa[i]) * log(kappa[i])) +
+      s * kappa[i] * digamma_rowsums[i];
 
-  Free1D(digamma_rowsums);
+  }/*FOR*/
 
-  return loglik_kappa_tau;
+  return sum_terms(terms, x_dim) - lgammafn(tau) -
+           (y_dim * s * (x_dim - 1) / tau);
 
 }/*ESTIMATE_LOGLIK_KAPPA_AND_TAU*/
 
 /* compute the log-likelihood component for nu. */
 static long double estimate_loglik_nu(double *nu, double *kappa, cmcmap counts,
-    double s) {
+    double s, hdir_cache *cache) {
 
-double colsum = 0;
+double *terms = (*cache).terms, *dnu = (*cache).digamma_nu;
+double *dcol = (*cache).digamma_colsums;
 long double loglik_nu = 0;
 
-  for (int j = 0; j < counts.ncols; j++) {
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(static) num_threads((*cache).nthreads)
+#endif
+  for (int i = 0; i < counts.nrows; i++) {
 
-    colsum = 0;
-    for (int i = 0; i < counts.nrows; i++)
-      colsum += nu[CMC(i, j, counts.nrows)];
+    terms[i] = 0;
 
-    for (int i = 0; i < counts.nrows; i++)
-      loglik_nu +=
+    for (int j = 0; j < counts.ncols; j++)
+      terms[i] +=
         lgammafn(nu[CMC(i, j, counts.nrows)]) -
-        (nu[CMC(i, j, counts.nrows)] - 1) * (digamma(nu[CMC(i, j, counts.nrows)]) - digamma(colsum)) -
-        digamma(nu[CMC(i, j, counts.nrows)]) +
-        CMEL(counts, i, j) * (digamma(nu[CMC(i, j, counts.nrows)]) - digamma(colsum)) +
-        s * kappa[i] * digamma(nu[CMC(i, j, counts.nrows)]);
-
-    loglik_nu += - lgammafn(colsum) - (s - counts.nrows) * digamma(colsum);
+        (nu[CMC(i, j, counts.nrows)] - 1) * (dnu[CMC(i, j, counts.nrows)] - dcol[j]) -
+        dnu[CMC(i, j, counts.nrows)] +
+        CMEL(counts, i, j) * (dnu[CMC(i, j, counts.nrows)] - dcol[j]) +
+        s * kappa[i] * dnu[CMC(i, j, counts.nrows)];
 
   }/*FOR*/
 
+  loglik_nu = sum_terms(terms, counts.nrows);
+
+  for (int j = 0; j < counts.ncols; j++)
+    loglik_nu += - lgammafn((*cache).colsums[j]) - (s - counts.nrows) * dcol[j];
+
   return loglik_nu;
 
 }/*ESTIMATE_LOGLIK_NU*/
 
 static long double estimate_global_loglik(double *nu, double *kappa, double tau,
-    double alpha0, double s, cmcmap counts) {
+    double alpha0, double s, cmcmap counts, hdir_cache *cache) {
 
-double *digamma_rowsums = NULL;
 long double loglik = 0, loglik_kappa_and_tau = 0, loglik_nu = 0;
 
-  digamma_rowsums = (double *) Calloc1D(counts.nrows, sizeof(double));
-  for (int i = 0; i < counts.nrows; i++)
-    for (int j = 0; j < counts.ncols; j++)
-      digamma_rowsums[i] += digamma(nu[CMC(i, j, counts.nrows)]);
-
   loglik_kappa_and_tau =
-    estimate_loglik_kappa_and_tau(nu, kappa, tau, alpha0, s, counts.nrows, counts.ncols);
+    estimate_loglik_kappa_and_tau(kappa, tau, alpha0, s, counts.nrows,
+      counts.ncols, cache);
   loglik_nu =
-    estimate_loglik_nu(nu, kappa, counts, s);
+    estimate_loglik_nu(nu, kappa, counts, s, cache);
 
   /* the global likelihood is the sum of its components... */
   loglik = loglik_kappa_and_tau + loglik_nu +
@@ -124,47 +224,53 @@ long double loglik = 0, loglik_kappa_and_tau = 0, loglik_nu = 0;
 
   /* ... minus shared terms that are duplicated across components. */
   for (int i = 0; i < counts.nrows; i++)
-    loglik -= s * kappa[i] * digamma_rowsums[i];
-
-  Free1D(digamma_rowsums);
+    loglik -= s * kappa[i] * (*cache).digamma_rowsums[i];
 
 return loglik;
 
 }/*ESTIMATE_GLOBAL_LOGLIK*/
 
 static void update_tau(double *kappa, int x_dim, int y_dim, double alpha0,
-    double s, double *tau, hdstatus *err) {
+    double s, double *tau, hdstatus *err, hdir_cache *cache) {
 
 int newton_iter = 0, max_iter = 200;
-double gradient = 1, hessian = 0;
+double gradient = 1, hessian = 0, trigamma_tau = 0, tetragamma_tau = 0;
 double tau_start = 100, tau_cur = 100;
 double log_tau = log(tau_start);
+double *gterms = (*cache).terms, *hterms = (*cache).terms2;
 
   /* newton iterations: limit the maximum number of iterations to make sure not
    * to be stuck in an infinite loop regardless of how ill-conditioned the data
    * are. */
   for (newton_iter = 0; newton_iter < max_iter; newton_iter++) {
 
-    gradient = hessian = 0;
+    /* the polygamma functions of tau are the same for all the rows. */
+    trigamma_tau = trigamma(tau_cur);
+    tetragamma_tau = tetragamma(tau_cur);
 
     /* the partial derivative of the log-likelihood with respect to tau, the
-     * first formula in Appendix B.3.1. */
-    for (int i = 0; i < x_dim; i++)
-      gradient +=
-        (trigamma(tau_cur * kappa[i]) * kappa[i] - trigamma(tau_cur)) *
-        (alpha0 - (tau_cur * kappa[i]) + y_dim * (1 - s * kappa[i]));
+     * first formula in Appendix B.3.1, and the partial second order derivative,
+     * the second formula in Appendix B.3.1. */
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) num_threads((*cache).nthreads)
+#endif
+    for (int i = 0; i < x_dim; i++) {
 
-    gradient += y_dim * s * (x_dim - 1) / tau_cur / tau_cur;
+      double shared = alpha0 - (tau_cur * kappa[i]) + y_dim * (1 - s * kappa[i]);
+      double tg = trigamma(tau_cur * kappa[i]);
 
-    /* the partial second order derivative of the log-likelihood with respect to
-     * tau, the second formula in Appendix B.3.1. */
-    for (int i = 0; i < x_dim; i++)
-      hessian +=
-        (kappa[i] * kappa[i] * tetragamma(tau_cur * kappa[i]) - tetragamma(tau_cur)) *
-        (alpha0 - (tau_cur * kappa[i]) - y_dim * (s * kappa[i] - 1)) -
-        kappa[i] * kappa[i] * trigamma(tau_cur * kappa[i]);
+      gterms[i] = (tg * kappa[i] - trigamma_tau) * shared;
+      hterms[i] =
+        (kappa[i] * kappa[i] * tetragamma(tau_cur * kappa[i]) - tetragamma_tau) *
+        shared - kappa[i] * kappa[i] * tg;
 
-    hessian += trigamma(tau_cur) -
+    }/*FOR*/
+
+    gradient = (double) sum_terms(gterms, x_dim);
+    gradient += y_dim * s * (x_dim - 1) / tau_cur / tau_cur;
+
+    hessian = (double) sum_terms(hterms, x_dim);
+    hessian += trigamma_tau -
                  2 * (s / tau_cur / tau_cur / tau_cur) * (y_dim * (x_dim - 1));
 
     /* updating tau according to the last two formulas in Appendix B.3.1. */
@@ -202,15 +308,20 @@ double log_tau = log(tau_start);
 
 static void partial_derivatives_kappa(double *kappa, double *digamma_rowsums,
     double tau, double s, double alpha0, int x_dim, int y_dim, double *gradient,
-    double *hessian) {
+    double *hessian, int nthreads) {
 
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(static) num_threads(nthreads)
+#endif
   for (int i = 0; i < x_dim; i++) {
 
+    double shared = alpha0 - (tau * kappa[i]) - y_dim * (s * kappa[i] - 1);
+    double tg = trigamma(tau * kappa[i]);
+
     /* the partial derivative of the log-likelihood with respect to kappa,
      * which is the first equation in Appendix B.3.2. */
     gradient[i] =
-      tau * trigamma(tau * kappa[i]) *
-      (alpha0 - (tau * kappa[i]) - y_dim * (s * kappa[i] - 1)) -
+      tau * tg * shared -
       s * y_dim * (digamma(tau * kappa[i]) + digamma(s * kappa[i])
         - log(kappa[i]) - 1) -
       y_dim / kappa[i] + s * digamma_rowsums[i];
@@ -218,9 +329,8 @@ static void partial_derivatives_kappa(double *kappa, double *digamma_rowsums,
     /* the partial second derivative of the log-likelihood with respect to
      * kappa, which is the second equation in Appendix B.3.2. */
     hessian[i] =
-      (tau * tau) * tetragamma(tau * kappa[i]) *
-      (alpha0 - (tau * kappa[i]) - y_dim *(s * kappa[i] - 1)) -
-      tau * trigamma(tau * kappa[i]) * (tau + 2 * s * y_dim) -
+      (tau * tau) * tetragamma(tau * kappa[i]) * shared -
+      tau * tg * (tau + 2 * s * y_dim) -
       s * s * y_dim * trigamma(s * kappa[i]) +
       s * y_dim / kappa[i] + y_dim / (kappa[i] * kappa[i]);
 
@@ -228,32 +338,22 @@ static void partial_derivatives_kappa(double *kappa, double *digamma_rowsums,
 
 }/*PARTIAL_DERIVATIVES_KAPPA*/
 
-static void update_kappa(double *nu, double tau, int x_dim, int y_dim,
-    double alpha0, double s, double *kappa, hdstatus *err) {
+static void update_kappa(double tau, int x_dim, int y_dim, double alpha0,
+    double s, double *kappa, hdstatus *err, hdir_cache *cache) {
 
 int newton_iter = 0, max_iter = 200;
 double loglik_kappa = 0, loglik_kappa_old = 0;
-double *digamma_rowsums = NULL, *gradient = NULL, *hessian = NULL;
-double *new_kappa = NULL, *delta_kappa = NULL;
+double *gradient = (*cache).gradient, *hessian = (*cache).hessian;
+double *new_kappa = (*cache).new_kappa, *delta_kappa = (*cache).delta_kappa;
 double sqr_newton_decrement = 10 * MACHINE_TOL, step_size = 1;
 double invhsum = 0, goverhsum =  0;
 double expected_increase = 0, limit = 0;
 
-  digamma_rowsums = (double *) Calloc1D(x_dim, sizeof(double));
-  for (int i = 0; i < x_dim; i++)
-    for (int j = 0; j < y_dim; j++)
-      digamma_rowsums[i] += digamma(nu[CMC(i, j, x_dim)]);
-
   for (int i = 0; i < x_dim; i++)
     kappa[i] = 1.0 / x_dim;
 
-  gradient = (double *) Calloc1D(x_dim, sizeof(double));
-  hessian = (double *) Calloc1D(x_dim, sizeof(double));
-  delta_kappa = (double *) Calloc1D(x_dim, sizeof(double));
-  new_kappa = (double *) Calloc1D(x_dim, sizeof(double));
-
   loglik_kappa =
-    estimate_loglik_kappa(kappa, digamma_rowsums, tau, s, alpha0, x_dim, y_dim);
+    estimate_loglik_kappa(kappa, tau, s, alpha0, x_dim, y_dim, cache);
 
   /* constrained newton method: g[] are the gradients, h[] are the diagonal
    * elements of the hessian from Appendix B.3.2. */
@@ -265,8 +365,8 @@ double expected_increase = 0, limit = 0;
     sqr_newton_decrement = expected_increase = 0;
     step_size = 1;
 
-    partial_derivatives_kappa(kappa, digamma_rowsums, tau, s, alpha0, x_dim,
-        y_dim, gradient, hessian);
+    partial_derivatives_kappa(kappa, (*cache).digamma_rowsums, tau, s, alpha0,
+        x_dim, y_dim, gradient, hessian, (*cache).nthreads);
 
     for (int i = 0; i < x_dim; i++) {
 
@@ -302,8 +402,8 @@ double expected_increase = 0, limit = 0;
       for (int i = 0; i < x_dim; i++)
         new_kappa[i] = kappa[i] + step_size * delta_kappa[i];
 
-      loglik_kappa = estimate_loglik_kappa(new_kappa, digamma_rowsums, tau, s,
-                       alpha0, x_dim, y_dim);
+      loglik_kappa = estimate_loglik_kappa(new_kappa, tau, s, alpha0, x_dim,
+                       y_dim, cache);
 
       /* reduce the stepping by 10%. */
       step_size *= 0.9;
@@ -332,17 +432,11 @@ double expected_increase = 0, limit = 0;
   for (int i = 0; i < x_dim; i++)
     kappa[i] = kappa[i] < MACHINE_TOL ? MACHINE_TOL : kappa[i];
 
-  Free1D(digamma_rowsums);
-  Free1D(gradient);
-  Free1D(hessian);
-  Free1D(delta_kappa);
-  Free1D(new_kappa);
-
 }/*UPDATE_KAPPA*/
 
-static void update_kappa_and_tau(double *nu, double *kappa, int x_dim,
-    int y_dim, double alpha0, double s, double *tau, hdstatus *err,
-    bool debugging) {
+static void update_kappa_and_tau(double *kappa, int x_dim, int y_dim,
+    double alpha0, double s, double *tau, hdstatus *err, bool debugging,
+    hdir_cache *cache) {
 
 int newton_iter = 0, max_iter = 200;
 long double loglik_kappa_tau = 0, loglik_kappa_tau_old = 0, relative_difference = 1;
@@ -358,18 +452,14 @@ long double loglik_kappa_tau = 0, loglik_kappa_tau_old = 0, relative_difference
     if (debugging)
       Rprintf("    > updating kappa and tau, iteration %d: ", newton_iter + 1);
 
-    /* reset the log-likelihood component for tau and kappa. */
-    loglik_kappa_tau = 0;
-
-    /* estimate tau and compute the corresponding log-likelihood component. */
-    update_tau(kappa, x_dim, y_dim, alpha0, s, tau, err);
-    estimate_loglik_tau(kappa, *tau, alpha0, s, x_dim, y_dim);
+    /* estimate tau... */
+    update_tau(kappa, x_dim, y_dim, alpha0, s, tau, err, cache);
 
-    /* estimate kappa and compute the corresponding log-likelihood component. */
-    update_kappa(nu, *tau, x_dim, y_dim, alpha0, s, kappa, err);
+    /* ... estimate kappa and compute the log-likelihood component. */
+    update_kappa(*tau, x_dim, y_dim, alpha0, s, kappa, err, cache);
 
     loglik_kappa_tau =
-      estimate_loglik_kappa_and_tau(nu, kappa, *tau, alpha0, s, x_dim, y_dim);
+      estimate_loglik_kappa_and_tau(kappa, *tau, alpha0, s, x_dim, y_dim, cache);
 
     if (debugging)
       Rprintf("the log-likelihood is %lf.\n", (double)loglik_kappa_tau);
@@ -392,7 +482,7 @@ long double loglik_kappa_tau = 0, loglik_kappa_tau_old = 0, relative_difference
 }/*UPDATE_KAPPA_AND_TAU*/
 
 static void update_nu(cmcmap counts, double *kappa, double s, double *nu,
-    bool debugging) {
+    bool debugging, hdir_cache *cache) {
 
   if (debugging)
     Rprintf("    > updating nu.\n");
@@ -403,8 +493,107 @@ static void update_nu(cmcmap counts, double *kappa, double s, double *nu,
     for (int j = 0; j < counts.ncols; j++)
       nu[CMC(i, j, counts.nrows)] = s * kappa[i] + CMEL(counts, i, j);
 
+  refresh_hdir_cache(nu, counts.nrows, counts.ncols, cache);
+
 }/*UPDATE_NU*/
 
+/* one iteration of the EM algorithm: first update kappa and tau, then nu using
+ * the updated values of kappa. */
+static void em_update(cmcmap counts, double alpha0, double s, double *nu,
+    double *kappa, double *tau, hdstatus *err, bool debugging,
+    hdir_cache *cache) {
+
+  update_kappa_and_tau(kappa, counts.nrows, counts.ncols, alpha0, s, tau, err,
+    debugging, cache);
+  update_nu(counts, kappa, s, nu, debugging, cache);
+
+}/*EM_UPDATE*/
+
+/* a SQUAREM cycle (Varadhan and Roland, 2008): once nu = s * kappa + counts,
+ * the EM iterations are a fixed-point map on kappa alone, which is extrapolated
+ * from two EM iterations and then stabilized with a third. The extrapolation is
+ * discarded if it does not improve the log-likelihood. Returns the number of
+ * EM iterations. */
+static int squarem_update(cmcmap counts, double alpha0, double s, double *nu,
+    double *kappa, double *tau, long double *loglik, hdstatus *err,
+    bool debugging, hdir_cache *cache) {
+
+int x_dim = counts.nrows;
+double *k0 = (*cache).kappa0, *k1 = (*cache).kappa1, *k2 = (*cache).kappa2;
+double rr = 0, vv = 0, r = 0, v = 0, step = 0, tau2 = 0, sum2 = 0, sum = 0;
+long double loglik2 = 0, loglik3 = 0;
+
+  memcpy(k0, kappa, x_dim * sizeof(double));
+  em_update(counts, alpha0, s, nu, kappa, tau, err, debugging, cache);
+  memcpy(k1, kappa, x_dim * sizeof(double));
+  em_update(counts, alpha0, s, nu, kappa, tau, err, debugging, cache);
+  memcpy(k2, kappa, x_dim * sizeof(double));
+  tau2 = *tau;
+  loglik2 = estimate_global_loglik(nu, kappa, *tau, alpha0, s, counts, cache);
+
+  for (int i = 0; i < x_dim; i++) {
+
+    r = k1[i] - k0[i];
+    v = k2[i] - 2 * k1[i] + k0[i];
+    rr += r * r;
+    vv += v * v;
+
+  }/*FOR*/
+
+  /* the SqS3 step length, which gives back the second EM iteration when it is
+   * equal to -1 and is then not worth extrapolating. */
+  step = (vv > 0) ? -sqrt(rr / vv) : -1;
+
+  if (step >= -1) {
+
+    *loglik = loglik2;
+    return 2;
+
+  }/*THEN*/
+
+  /* extrapolate, keeping kappa strictly positive and summing up to the same
+   * total as after the EM iterations. */
+  for (int i = 0; i < x_dim; i++) {
+
+    r = k1[i] - k0[i];
+    v = k2[i] - 2 * k1[i] + k0[i];
+    kappa[i] = k0[i] - 2 * step * r + step * step * v;
+    kappa[i] = kappa[i] < MACHINE_TOL ? MACHINE_TOL : kappa[i];
+    sum += kappa[i];
+    sum2 += k2[i];
+
+  }/*FOR*/
+
+  for (int i = 0; i < x_dim; i++)
+    kappa[i] *= sum2 / sum;
+
+  update_nu(counts, kappa, s, nu, debugging, cache);
+  em_update(counts, alpha0, s, nu, kappa, tau, err, debugging, cache);
+  loglik3 = estimate_global_loglik(nu, kappa, *tau, alpha0, s, counts, cache);
+
+  if (debugging)
+    Rprintf("  > SQUAREM step length %lf, the log-likelihood is %lf (%s).\n",
+      step, (double)loglik3, (loglik3 >= loglik2) ? "accepted" : "rejected");
+
+  if (loglik3 >= loglik2) {
+
+    *loglik = loglik3;
+
+  }/*THEN*/
+  else {
+
+    /* go back to the second EM iteration (this also catches NaNs). */
+    memcpy(kappa, k2, x_dim * sizeof(double));
+    *tau = tau2;
+    update_nu(counts, kappa, s, nu, FALSE, cache);
+    *loglik = loglik2;
+
+  }/*ELSE*/
+
+  return 3;
+
+}/*SQUAREM_UPDATE*/
+
 hdstatus c_hierarchical_dirichlet_parameters(cmcmap counts, double alpha0,
     double s, bool debugging, double *nu) {
 
@@ -413,6 +602,7 @@ double tau = 100;
 double *kappa = NULL;
 long double relative_difference = 0, loglik_old = 0, loglik_cur = 0;
 hdstatus err = { 0 };
+hdir_cache cache = new_hdir_cache(counts.nrows, counts.ncols);
 
   /* allocate and initialise the parameters of the variational estimator. */
   for (int i = 0; i < counts.nrows * counts.ncols; i++)
@@ -422,25 +612,32 @@ hdstatus err = { 0 };
   for (int i = 0; i < counts.nrows; i++)
     kappa[i] = 1.0 / counts.nrows;
 
+  refresh_hdir_cache(nu, counts.nrows, counts.ncols, &cache);
+
   /* expectation-maximization iterations: limit the maximum number of iterations
    * to make sure not to be stuck in an infinite loop regardless of how
    * ill-conditioned the data are. */
-  for (em_iter = 0; em_iter < max_iter; em_iter++) {
+  while (em_iter < max_iter) {
 
     if (debugging)
       Rprintf("  > iteration %d.\n", em_iter + 1);
 
-    /* within each iteration, first update kappa and tau and compute the
-     * associated log-likelihood component... */
-    update_kappa_and_tau(nu, kappa, counts.nrows, counts.ncols, alpha0, s, &tau,
-      &err, debugging);
+    /* the first iteration starts from a uniform nu, which is not a function of
+     * kappa, and cannot be extrapolated; neither can the last ones. */
+    if ((em_iter == 0) || (em_iter + 3 > max_iter)) {
 
-    /* ... update nu and the associated log-likelihood component, using the
-     * updated values of kappa... */
-    update_nu(counts, kappa, s, nu, debugging);
+      em_update(counts, alpha0, s, nu, kappa, &tau, &err, debugging, &cache);
+      loglik_cur = estimate_global_loglik(nu, kappa, tau, alpha0, s, counts,
+                     &cache);
+      em_iter++;
 
-    /* ... then add up the pieces of the log-likelihood. */
-    loglik_cur = estimate_global_loglik(nu, kappa, tau, alpha0, s, counts);
+    }/*THEN*/
+    else {
+
+      em_iter += squarem_update(counts, alpha0, s, nu, kappa, &tau, &loglik_cur,
+                   &err, debugging, &cache);
+
+    }/*ELSE*/
 
     if (debugging)
       Rprintf("  > the log-likelihood is now %lf.\n", (double)loglik_cur);
@@ -456,13 +653,15 @@ hdstatus err = { 0 };
     if (fabsl(relative_difference) < MACHINE_TOL)
       break;
 
-  }/*FOR*/
+  }/*WHILE*/
 
-  /* successful convergence if we did not reach the iteration limit. */
-  if (em_iter == max_iter)
+  /* successful convergence if the log-likelihood stopped increasing before we
+   * reached the iteration limit. */
+  if (fabsl(relative_difference) >= MACHINE_TOL)
     err.outer_em_convergence_fail = TRUE;
 
   Free1D(kappa);
+  FreeHDIRCACHE(cache);
 
   return err;
 
@@ -0,0 +1,16 @@
+#include "../include/rcore.h"
+#include "parameters.h"
+
+#define ENTRY(key, value) if (strcmp(label, key) == 0) return value;
+
+fitting_method_e fitting_method_to_enum(const char *label) {
+
+  ENTRY("mle", FIT_MLE);
+  ENTRY("bayes", FIT_BAYES);
+  ENTRY("mle-g", FIT_MLE_G);
+  ENTRY("mle-cg", FIT_MLE_CG);
+  ENTRY("hdir", FIT_HDIR);
+
+  return FIT_ENOMETHOD;
+
+}/*FITTING_METHOD_TO_ENUM*/
@@ -16,8 +16,22 @@ typedef struct {
 
 } hdstatus;
 
+/* enum for the parameter estimators, mirroring the methods in bn.fit(). */
+typedef enum {
+  FIT_ENOMETHOD = 0, /* error code, no such estimator. */
+  FIT_MLE       = 1, /* maximum likelihood, discrete networks. */
+  FIT_BAYES     = 2, /* posterior estimates, discrete networks. */
+  FIT_MLE_G     = 3, /* maximum likelihood, Gaussian networks. */
+  FIT_MLE_CG    = 4, /* maximum likelihood, conditional Gaussian networks. */
+  FIT_HDIR      = 5  /* hierarchical Dirichlet, discrete networks. */
+} fitting_method_e;
+
+fitting_method_e fitting_method_to_enum(const char *label);
+
 void c_classic_discrete_parameters(int *counts, double *cpt, int nrows,
     int ncols, double alpha, bool replace);
+void c_weighted_discrete_parameters(double *counts, double *cpt, int nrows,
+    int ncols, double alpha, bool replace);
 hdstatus c_hierarchical_dirichlet_parameters(cmcmap counts, double alpha0,
     double s, bool debugging, double *nu);
 
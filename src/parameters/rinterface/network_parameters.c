@@ -0,0 +1,783 @@
+#include "../../include/rcore.h"
+#include "../../include/parallel.h"
+#include "../../core/allocations.h"
+#include "../../core/moments.h"
+#include "../../minimal/data.frame.h"
+#include "../../minimal/strings.h"
+#include "../../minimal/common.h"
+#include "../../core/sets.h"
+#include "../../math/linear.algebra.h"
+#include "../parameters.h"
+
+/* number of observations in each block of the pass over the data that
+ * collects the cross-products of all the continuous nodes and their parents. */
+#define MOMENTS_BLOCK 16384
+
+/* how the local distribution of each node is estimated. */
+typedef enum {
+  CLASSIC_NODE   = 1, /* CPT, maximum likelihood or posterior estimates. */
+  HDIR_NODE      = 2, /* CPT, hierarchical Dirichlet posterior estimates. */
+  GAUSSIAN_NODE  = 3, /* linear regression. */
+  CG_NODE        = 4  /* one linear regression for each configuration of the
+                       * discrete parents. */
+} node_fit_e;
+
+/* a local distribution to estimate, with the R objects it is stored in. */
+typedef struct {
+
+  node_fit_e type;   /* how the local distribution is estimated. */
+  int node;          /* the column of the node in the data. */
+  int *xd;           /* the data of a discrete node... */
+  int nx;            /* ... and its number of levels. */
+  double *y;         /* the data of a continuous node. */
+  int nparents;      /* number of parents (the grouping variable is the last
+                      * one for the hierarchical Dirichlet). */
+  int *parents;      /* the columns of the parents in the data. */
+  bool missing;      /* whether the node or its parents have missing values. */
+  int ncells;        /* number of cells in the CPT. */
+  double *cpt;       /* the CPT. */
+  double alpha;      /* imaginary sample size of the CPT. */
+  bool replace;      /* whether unidentifiable parameters are replaced. */
+  int ngp;           /* number of continuous parents. */
+  double **x;        /* the continuous parents. */
+  int *z;            /* configurations of the discrete parents (1-based). */
+  int nz;            /* number of configurations of the discrete parents. */
+  double *coefs;     /* regression coefficients. */
+  double *sd;        /* standard error(s) of the residuals. */
+  double *fitted;    /* fitted values, if they are kept. */
+  double *resid;     /* residuals, if they are kept. */
+  bool gram;         /* whether the regressions are estimated from the
+                      * cross-products of the node and its parents... */
+  double **family;   /* ... which are the node followed by its continuous
+                      * parents... */
+  strata_moments sm; /* ... within each configuration of the discrete parents. */
+  hdstatus err;      /* convergence of the hierarchical Dirichlet estimator. */
+
+} node_fit;
+
+/* a set of discrete parents shared by several nodes, whose configurations are
+ * computed only once for all of them. */
+typedef struct {
+
+  int nparents;      /* number of parents. */
+  int *parents;      /* the columns of the parents in the data. */
+  int **cols;        /* the data of the parents. */
+  int *cumlevels;    /* cumulative products of the number of levels. */
+  int nmembers;      /* number of nodes with this set of parents. */
+  int *members;      /* the nodes with this set of parents. */
+
+} parent_set;
+
+/* the conditional probability table of a discrete node, with dimensions and
+ * dimension names like those of minimal_table(). */
+static SEXP allocate_cpt(SEXP data, SEXP names, node_fit *fit) {
+
+int i = 0, col = 0, *dd = NULL;
+double ncells = 1;
+SEXP cptable, dims, dimnames, dimnames_names, cur;
+
+  PROTECT(dims = allocVector(INTSXP, (*fit).nparents + 1));
+  dd = INTEGER(dims);
+  PROTECT(dimnames = allocVector(VECSXP, (*fit).nparents + 1));
+  PROTECT(dimnames_names = allocVector(STRSXP, (*fit).nparents + 1));
+
+  for (i = 0; i < (*fit).nparents + 1; i++) {
+
+    col = (i == 0) ? (*fit).node : (*fit).parents[i - 1];
+    cur = VECTOR_ELT(data, col);
+    dd[i] = NLEVELS(cur);
+    SET_VECTOR_ELT(dimnames, i, getAttrib(cur, R_LevelsSymbol));
+    SET_STRING_ELT(dimnames_names, i, STRING_ELT(names, col));
+    ncells *= dd[i];
+
+  }/*FOR*/
+
+  if (ncells > INT_MAX) {
+
+    UNPROTECT(3);
+    error("attempting to create a table with more than INT_MAX cells.");
+
+  }/*THEN*/
+
+  setAttrib(dimnames, R_NamesSymbol, dimnames_names);
+  PROTECT(cptable = allocVector(REALSXP, (int)ncells));
+  setAttrib(cptable, R_DimSymbol, dims);
+  setAttrib(cptable, R_DimNamesSymbol, dimnames);
+  setAttrib(cptable, R_ClassSymbol, mkString("table"));
+
+  (*fit).ncells = (int)ncells;
+  (*fit).cpt = REAL(cptable);
+  (*fit).xd = INTEGER(VECTOR_ELT(data, (*fit).node));
+  (*fit).nx = dd[0];
+
+  UNPROTECT(4);
+
+  return cptable;
+
+}/*ALLOCATE_CPT*/
+
+/* the regression coefficients (one set for each configuration of the discrete
+ * parents, if any), the standard errors, the residuals and the fitted values,
+ * like gaussian_ols_parameters() and mixture_gaussian_ols_parameters(). */
+static SEXP allocate_regression(SEXP data, SEXP names, node_fit *fit,
+    bool keep) {
+
+int i = 0, j = 0, *dparents = NULL, ndp = 0, nobs = length(VECTOR_ELT(data, 0));
+bool mixture = ((*fit).type == CG_NODE);
+SEXP result, coefficients, coefnames, sd, fitted, residuals, configs = R_NilValue;
+SEXP confnames = R_NilValue, dpdata;
+
+  PROTECT(coefnames = allocVector(STRSXP, (*fit).ngp + 1));
+  SET_STRING_ELT(coefnames, 0, mkChar("(Intercept)"));
+  (*fit).y = REAL(VECTOR_ELT(data, (*fit).node));
+  (*fit).x = Calloc1D((*fit).ngp, sizeof(double *));
+  dparents = Calloc1D((*fit).nparents, sizeof(int));
+
+  /* split the parents into continuous (the regressors) and discrete (whose
+   * configurations index the regressions), preserving their order. */
+  for (i = 0; i < (*fit).nparents; i++) {
+
+    if (isFactor(VECTOR_ELT(data, (*fit).parents[i]))) {
+
+      dparents[ndp++] = (*fit).parents[i];
+
+    }/*THEN*/
+    else {
+
+      SET_STRING_ELT(coefnames, j + 1, STRING_ELT(names, (*fit).parents[i]));
+      (*fit).x[j++] = REAL(VECTOR_ELT(data, (*fit).parents[i]));
+
+    }/*ELSE*/
+
+  }/*FOR*/
+
+  if (mixture) {
+
+    /* the configurations of the discrete parents, as in configurations(). */
+    PROTECT(dpdata = allocVector(VECSXP, ndp));
+    for (i = 0; i < ndp; i++)
+      SET_VECTOR_ELT(dpdata, i, VECTOR_ELT(data, dparents[i]));
+    PROTECT(configs = c_configurations(dpdata, TRUE, TRUE));
+    confnames = getAttrib(configs, R_LevelsSymbol);
+    (*fit).z = INTEGER(configs);
+    (*fit).nz = length(confnames);
+
+    PROTECT(result = allocVector(VECSXP, 5));
+    setAttrib(result, R_NamesSymbol,
+      mkStringVec(5, "coefficients", "sd", "configs", "residuals", "fitted.values"));
+    PROTECT(coefficients = allocMatrix(REALSXP, (*fit).ngp + 1, (*fit).nz));
+    setDimNames(coefficients, coefnames, confnames);
+    PROTECT(sd = allocVector(REALSXP, (*fit).nz));
+    setAttrib(sd, R_NamesSymbol, confnames);
+
+  }/*THEN*/
+  else {
+
+    PROTECT(result = allocVector(VECSXP, 4));
+    setAttrib(result, R_NamesSymbol,
+      mkStringVec(4, "coefficients", "sd", "residuals", "fitted.values"));
+    PROTECT(coefficients = allocVector(REALSXP, (*fit).ngp + 1));
+    setAttrib(coefficients, R_NamesSymbol, coefnames);
+    PROTECT(sd = allocVector(REALSXP, 1));
+
+  }/*ELSE*/
+
+  (*fit).coefs = REAL(coefficients);
+  (*fit).sd = REAL(sd);
+
+  if (keep) {
+
+    PROTECT(fitted = allocVector(REALSXP, nobs));
+    PROTECT(residuals = allocVector(REALSXP, nobs));
+    (*fit).fitted = REAL(fitted);
+    (*fit).resid = REAL(residuals);
+
+  }/*THEN*/
+  else {
+
+    /* fitted values and residuals are just dummy NAs. */
+    PROTECT(fitted = ScalarReal(NA_REAL));
+    PROTECT(residuals = ScalarReal(NA_REAL));
+
+  }/*ELSE*/
+
+  /* the configurations are needed to estimate the regressions, they are
+   * replaced with dummy NAs afterwards if they are not kept. */
+  if (mixture)
+    SET_VECTOR_ELT(result, 2, configs);
+
+  SET_VECTOR_ELT(result, 0, coefficients);
+  SET_VECTOR_ELT(result, 1, sd);
+  SET_VECTOR_ELT(result, mixture ? 3 : 2, residuals);
+  SET_VECTOR_ELT(result, mixture ? 4 : 3, fitted);
+
+  Free1D(dparents);
+
+  UNPROTECT(6 + 2 * mixture);
+
+  return result;
+
+}/*ALLOCATE_REGRESSION*/
+
+/* the configurations of a set of discrete parents, which must not overflow. */
+static void parent_configurations(parent_set *ps, int nobs, int *cfg) {
+
+int i = 0, j = 0, *col = NULL;
+
+  for (i = 0; i < nobs; i++)
+    cfg[i] = 0;
+
+  for (j = 0; j < (*ps).nparents; j++) {
+
+    col = (*ps).cols[j];
+
+    for (i = 0; i < nobs; i++) {
+
+      if (cfg[i] == NA_INTEGER)
+        continue;
+
+      if (col[i] == NA_INTEGER)
+        cfg[i] = NA_INTEGER;
+      else
+        cfg[i] += (col[i] - 1) * (*ps).cumlevels[j];
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+}/*PARENT_CONFIGURATIONS*/
+
+/* tabulate a discrete node and the configurations of its parents, and
+ * estimate its CPT. */
+static void fit_discrete_node(int *cfg, int nobs, node_fit *fit, int *counts,
+    double alpha0, double iss, int ngroups, bool debugging) {
+
+int i = 0, j = 0, *x = (*fit).xd, nlevels = (*fit).nx;
+int nrows = nlevels, ncols = (*fit).ncells / nlevels;
+long double colsum = 0;
+cmcmap cc = { 0 };
+
+  memset(counts, '\0', (*fit).ncells * sizeof(int));
+
+  /* observations with missing values are dropped, as in minimal_table(). */
+  for (i = 0; i < nobs; i++) {
+
+    if (x[i] == NA_INTEGER)
+      continue;
+
+    if (!cfg)
+      counts[x[i] - 1]++;
+    else if (cfg[i] != NA_INTEGER)
+      counts[(x[i] - 1) + nlevels * cfg[i]]++;
+
+  }/*FOR*/
+
+  if ((*fit).type == CLASSIC_NODE) {
+
+    c_classic_discrete_parameters(counts, (*fit).cpt, nrows, ncols,
+      (*fit).alpha, (*fit).replace);
+
+  }/*THEN*/
+  else {
+
+    /* one row per configuration of the node and the parents, one column per
+     * group. */
+    cc.el = counts;
+    cc.nrows = (*fit).ncells / ngroups;
+    cc.ncols = ngroups;
+
+    (*fit).err = c_hierarchical_dirichlet_parameters(cc, alpha0,
+                   iss / ngroups, debugging, (*fit).cpt);
+
+    /* normalize the columns to sum up to 1. */
+    for (j = 0; j < ncols; j++) {
+
+      colsum = 0;
+      for (i = 0; i < nrows; i++)
+        colsum += (*fit).cpt[CMC(i, j, nrows)];
+      for (i = 0; i < nrows; i++)
+        (*fit).cpt[CMC(i, j, nrows)] /= colsum;
+
+    }/*FOR*/
+
+  }/*ELSE*/
+
+}/*FIT_DISCRETE_NODE*/
+
+/* replace unidentifiable regression coefficients and standard errors. */
+static void replace_unidentifiable(node_fit *fit) {
+
+int i = 0, nsd = ((*fit).type == CG_NODE) ? (*fit).nz : 1;
+int ncoefs = ((*fit).ngp + 1) * nsd;
+
+  /* replace unidentifiable regression coefficients and the standard errors
+   * with zeroes to prevent NAs from propagating. */
+  if ((*fit).replace) {
+
+    for (i = 0; i < ncoefs; i++)
+      if (ISNAN((*fit).coefs[i]))
+        (*fit).coefs[i] = 0;
+
+    for (i = 0; i < nsd; i++)
+      if (ISNAN((*fit).sd[i]))
+        (*fit).sd[i] = 0;
+
+  }/*THEN*/
+
+}/*REPLACE_UNIDENTIFIABLE*/
+
+/* estimate the regression(s) of a continuous node. */
+static void fit_continuous_node(int nobs, node_fit *fit) {
+
+double *y = (*fit).y;
+
+  if ((*fit).type == GAUSSIAN_NODE)
+    c_ols((*fit).x, y, nobs, (*fit).ngp, (*fit).fitted, (*fit).resid,
+      (*fit).coefs, (*fit).sd, NULL, (*fit).missing);
+  else
+    c_cls((*fit).x, y, (*fit).z, nobs, (*fit).ngp, (*fit).nz, (*fit).fitted,
+      (*fit).resid, (*fit).coefs, (*fit).sd, NULL, (*fit).missing);
+
+  replace_unidentifiable(fit);
+
+}/*FIT_CONTINUOUS_NODE*/
+
+/* collect the cross-products of each continuous node and its continuous
+ * parents (within each configuration of the discrete parents) in a single
+ * pass over the data, one block of observations at a time, so that the columns
+ * shared by several nodes are read while they are still in the cache. */
+static void collect_moments(node_fit *fits, int *gram, int ngram, int nobs,
+    int nthreads) {
+
+int i = 0, maxdim = 0;
+double **shifted = NULL;
+
+  for (i = 0; i < ngram; i++)
+    maxdim = MAX(maxdim, fits[gram[i]].ngp + 1);
+
+  shifted = Calloc1D((size_t)nthreads * maxdim, sizeof(double *));
+
+  /* the blocks are processed in order and each node by a single thread, so
+   * the moments do not depend on the number of threads. */
+  for (int from = 0; from < nobs; from += MOMENTS_BLOCK) {
+
+    int len = MIN(MOMENTS_BLOCK, nobs - from);
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+    for (int k = 0; k < ngram; k++) {
+
+      node_fit *fit = fits + gram[k];
+      double **cur = shifted + (size_t)THREAD_ID * maxdim;
+
+      for (int j = 0; j < (*fit).ngp + 1; j++)
+        cur[j] = (*fit).family[j] + from;
+
+      c_strata_moments(cur, len, ((*fit).z) ? (*fit).z + from : NULL,
+        (*fit).sm);
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  Free1D(shifted);
+
+}/*COLLECT_MOMENTS*/
+
+/* estimate the regression(s) of a continuous node from the cross-products,
+ * falling back to the QR decomposition for configurations of the discrete
+ * parents with too few observations and for collinear parents. */
+static void fit_continuous_moments(int nobs, node_fit *fit) {
+
+int i = 0, s = 0, d = (*fit).ngp + 1;
+int nstrata = (*fit).sm.nstrata;
+double *beta = NULL;
+
+  for (s = 0; s < nstrata; s++) {
+
+    /* unobserved configurations have all parameters set to NA, as in c_cls(). */
+    if ((*fit).sm.n[s] == 0) {
+
+      for (i = 0; i < d; i++)
+        (*fit).coefs[s * d + i] = NA_REAL;
+      (*fit).sd[s] = NA_REAL;
+
+      continue;
+
+    }/*THEN*/
+
+    if (((*fit).sm.n[s] <= d) ||
+        !c_ols_moments((*fit).sm.n[s], (*fit).sm.mean + s * d,
+           (*fit).sm.comoment + s * d * d, (*fit).ngp, FALSE,
+           (*fit).coefs + s * d,
+           (*fit).sd + s)) {
+
+      fit_continuous_node(nobs, fit);
+      return;
+
+    }/*THEN*/
+
+  }/*FOR*/
+
+  /* fitted values and residuals, if they are kept. */
+  if ((*fit).fitted) {
+
+    for (i = 0; i < nobs; i++) {
+
+      beta = (*fit).coefs + (((*fit).z) ? ((*fit).z[i] - 1) * d : 0);
+
+      (*fit).fitted[i] = beta[0];
+      for (int j = 0; j < (*fit).ngp; j++)
+        (*fit).fitted[i] += beta[j + 1] * (*fit).x[j][i];
+      (*fit).resid[i] = (*fit).y[i] - (*fit).fitted[i];
+
+    }/*FOR*/
+
+  }/*THEN*/
+
+  replace_unidentifiable(fit);
+
+}/*FIT_CONTINUOUS_MOMENTS*/
+
+/* estimate the parameters of all the local distributions of a network in one
+ * call: discrete nodes with the same parents share the configurations of the
+ * parents, and all nodes are fitted in parallel. */
+SEXP network_parameters(SEXP data, SEXP nodes, SEXP parents, SEXP method,
+    SEXP group, SEXP iss, SEXP alpha0, SEXP replace_unidentifiable, SEXP keep,
+    SEXP debug) {
+
+int i = 0, j = 0, k = 0, nnodes = length(nodes), ncols = length(data);
+int nobs = length(VECTOR_ELT(data, 0)), gcol = -1, ngroups = 0;
+int nsets = 0, ntasks = 0, *tasks = NULL, maxcells = 0, nthreads = 1;
+int *cfg = NULL, *counts = NULL, *pcol = NULL, *gram = NULL, ngram = 0;
+double a0 = 0, ssize = 0;
+bool debugging = isTRUE(debug), keep_fitted = isTRUE(keep), *incomplete = NULL;
+fitting_method_e fm = fitting_method_to_enum(CHAR(STRING_ELT(method, 0)));
+node_fit *fits = NULL;
+parent_set *sets = NULL;
+SEXP names, try, result, cur, dummy_configs;
+
+  PROTECT(names = getAttrib(data, R_NamesSymbol));
+  PROTECT(result = allocVector(VECSXP, nnodes));
+  setAttrib(result, R_NamesSymbol, nodes);
+
+  /* which variables have missing values, checked only once. */
+  incomplete = Calloc1D(ncols, sizeof(bool));
+  for (j = 0; j < ncols; j++) {
+
+    cur = VECTOR_ELT(data, j);
+
+    if (isFactor(cur)) {
+
+      for (i = 0; i < nobs; i++)
+        if (INTEGER(cur)[i] == NA_INTEGER) {
+
+          incomplete[j] = TRUE;
+          break;
+
+        }/*THEN*/
+
+    }/*THEN*/
+    else {
+
+      for (i = 0; i < nobs; i++)
+        if (ISNAN(REAL(cur)[i])) {
+
+          incomplete[j] = TRUE;
+          break;
+
+        }/*THEN*/
+
+    }/*ELSE*/
+
+  }/*FOR*/
+
+  /* the grouping variable of the hierarchical Dirichlet estimator. */
+  if (fm == FIT_HDIR) {
+
+    PROTECT(try = match(names, group, 0));
+    gcol = INT(try) - 1;
+    UNPROTECT(1);
+    ngroups = NLEVELS(VECTOR_ELT(data, gcol));
+    a0 = NUM(alpha0);
+
+  }/*THEN*/
+
+  if (iss != R_NilValue)
+    ssize = NUM(iss);
+
+  /* map the nodes and their parents to the columns of the data. */
+  fits = Calloc1D(nnodes, sizeof(node_fit));
+  PROTECT(try = match(names, nodes, 0));
+  for (i = 0; i < nnodes; i++)
+    fits[i].node = INTEGER(try)[i] - 1;
+  UNPROTECT(1);
+
+  for (i = 0; i < nnodes; i++) {
+
+    node_fit *fit = fits + i;
+
+    PROTECT(try = match(names, VECTOR_ELT(parents, i), 0));
+    (*fit).nparents = length(try);
+    (*fit).parents = Calloc1D((*fit).nparents + 1, sizeof(int));
+    for (j = 0; j < (*fit).nparents; j++)
+      (*fit).parents[j] = INTEGER(try)[j] - 1;
+    UNPROTECT(1);
+
+    (*fit).replace = isTRUE(replace_unidentifiable);
+
+    if (isFactor(VECTOR_ELT(data, (*fit).node))) {
+
+      if ((fm == FIT_HDIR) && ((*fit).node != gcol)) {
+
+        /* the grouping variable is the slowest-varying dimension. */
+        (*fit).type = HDIR_NODE;
+        (*fit).parents[(*fit).nparents++] = gcol;
+
+      }/*THEN*/
+      else {
+
+        /* the grouping variable has no pooling, and it is fitted by maximum
+         * likelihood. */
+        (*fit).type = CLASSIC_NODE;
+        (*fit).alpha = (fm == FIT_HDIR) ? 0 : ssize;
+        (*fit).replace = (fm == FIT_HDIR) ? FALSE : (*fit).replace;
+
+      }/*ELSE*/
+
+    }/*THEN*/
+    else {
+
+      (*fit).type = GAUSSIAN_NODE;
+      for (j = 0; j < (*fit).nparents; j++)
+        if (isFactor(VECTOR_ELT(data, (*fit).parents[j])))
+          (*fit).type = CG_NODE;
+        else
+          (*fit).ngp++;
+
+    }/*ELSE*/
+
+    (*fit).missing = incomplete[(*fit).node];
+    for (j = 0; j < (*fit).nparents; j++)
+      (*fit).missing = (*fit).missing || incomplete[(*fit).parents[j]];
+
+    /* allocate the objects the estimates are stored in. */
+    if (((*fit).type == CLASSIC_NODE) || ((*fit).type == HDIR_NODE)) {
+
+      SET_VECTOR_ELT(result, i, allocate_cpt(data, names, fit));
+      maxcells = MAX(maxcells, (*fit).ncells);
+
+    }/*THEN*/
+    else {
+
+      SET_VECTOR_ELT(result, i,
+        allocate_regression(data, names, fit, keep_fitted));
+
+    }/*ELSE*/
+
+  }/*FOR*/
+
+  /* group the discrete nodes by their parents. */
+  sets = Calloc1D(nnodes, sizeof(parent_set));
+
+  for (i = 0; i < nnodes; i++) {
+
+    node_fit *fit = fits + i;
+
+    if (((*fit).type != CLASSIC_NODE) && ((*fit).type != HDIR_NODE))
+      continue;
+
+    for (k = 0; k < nsets; k++) {
+
+      if (sets[k].nparents != (*fit).nparents)
+        continue;
+      if (memcmp(sets[k].parents, (*fit).parents,
+                 (*fit).nparents * sizeof(int)) == 0)
+        break;
+
+    }/*FOR*/
+
+    if (k == nsets) {
+
+      sets[k].nparents = (*fit).nparents;
+      sets[k].parents = (*fit).parents;
+      sets[k].members = Calloc1D(nnodes, sizeof(int));
+      sets[k].cols = Calloc1D(MAX(1, (*fit).nparents), sizeof(int *));
+      for (j = 0; j < (*fit).nparents; j++)
+        sets[k].cols[j] = INTEGER(VECTOR_ELT(data, (*fit).parents[j]));
+      /* the size of the CPT has already been checked not to overflow. */
+      sets[k].cumlevels = Calloc1D(MAX(1, (*fit).nparents), sizeof(int));
+      for (j = 0, sets[k].cumlevels[0] = 1; j < (*fit).nparents - 1; j++)
+        sets[k].cumlevels[j + 1] = sets[k].cumlevels[j] *
+          NLEVELS(VECTOR_ELT(data, (*fit).parents[j]));
+      nsets++;
+
+    }/*THEN*/
+
+    sets[k].members[sets[k].nmembers++] = i;
+
+  }/*FOR*/
+
+  /* each set of discrete parents is a task, and so is each continuous node. */
+  tasks = Calloc1D(nsets + nnodes, sizeof(int));
+  for (k = 0; k < nsets; k++)
+    tasks[ntasks++] = -(k + 1);
+  for (i = 0; i < nnodes; i++)
+    if ((fits[i].type == GAUSSIAN_NODE) || (fits[i].type == CG_NODE))
+      tasks[ntasks++] = i;
+
+  /* the regressions of continuous nodes with complete data and continuous
+   * parents are estimated from cross-products collected for all of them in a
+   * single pass over the data. */
+  gram = Calloc1D(nnodes, sizeof(int));
+  for (i = 0; i < nnodes; i++) {
+
+    node_fit *fit = fits + i;
+
+    if (((*fit).type != GAUSSIAN_NODE) && ((*fit).type != CG_NODE))
+      continue;
+    if ((*fit).missing || ((*fit).ngp == 0))
+      continue;
+
+    (*fit).gram = TRUE;
+    (*fit).family = Calloc1D((*fit).ngp + 1, sizeof(double *));
+    (*fit).family[0] = (*fit).y;
+    for (j = 0; j < (*fit).ngp; j++)
+      (*fit).family[j + 1] = (*fit).x[j];
+    (*fit).sm = new_strata_moments(((*fit).type == CG_NODE) ? (*fit).nz : 1,
+                  (*fit).ngp + 1);
+    gram[ngram++] = i;
+
+  }/*FOR*/
+
+  if (debugging)
+    Rprintf("* fitting %d node(s), %d set(s) of discrete parents, %d %s.\n",
+      nnodes, nsets, ngram, "regression(s) from cross-products");
+
+  if (ngram > 0)
+    collect_moments(fits, gram, ngram, nobs,
+      debugging ? 1 : MAX(1, MIN(MAX_THREADS, ngram)));
+
+  /* the debugging output of the hierarchical Dirichlet estimator is printed
+   * from the C code, so it must not be interleaved. */
+  nthreads = debugging ? 1 : MAX(1, MIN(MAX_THREADS, ntasks));
+  cfg = Calloc1D((size_t)nthreads * nobs, sizeof(int));
+  counts = Calloc1D((size_t)nthreads * MAX(1, maxcells), sizeof(int));
+
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+  for (int t = 0; t < ntasks; t++) {
+
+    int *tcfg = cfg + (size_t)THREAD_ID * nobs;
+    int *tcounts = counts + (size_t)THREAD_ID * MAX(1, maxcells);
+
+    if (tasks[t] >= 0) {
+
+      node_fit *fit = fits + tasks[t];
+
+      if ((*fit).gram)
+        fit_continuous_moments(nobs, fit);
+      else
+        fit_continuous_node(nobs, fit);
+
+    }/*THEN*/
+    else {
+
+      parent_set *ps = sets - tasks[t] - 1;
+
+      /* the configurations of the parents are computed once for all the nodes
+       * that share them. */
+      if ((*ps).nparents > 0)
+        parent_configurations(ps, nobs, tcfg);
+
+      for (int m = 0; m < (*ps).nmembers; m++)
+        fit_discrete_node(((*ps).nparents > 0) ? tcfg : NULL, nobs,
+          fits + (*ps).members[m], tcounts, a0, ssize, ngroups, debugging);
+
+    }/*ELSE*/
+
+  }/*FOR*/
+
+  /* warnings at the end of the function, so that they do not cause leaks even
+   * if warnings are transformed into errors via options(). */
+  pcol = Calloc1D(nnodes, sizeof(int));
+  for (i = 0; i < nnodes; i++) {
+
+    hdstatus err = fits[i].err;
+
+    pcol[i] = (err.outer_em_convergence_fail << 0) |
+              (err.kappa_tau_convergence_fail << 1) |
+              (err.tau_convergence_fail << 2) |
+              (err.kappa_convergence_fail << 3) |
+              (err.tau_is_zero << 4);
+
+    /* configurations that are not kept are just dummy NAs. */
+    if ((fits[i].type == CG_NODE) && !keep_fitted) {
+
+      cur = VECTOR_ELT(VECTOR_ELT(result, i), 2);
+      PROTECT(dummy_configs = allocVector(INTSXP, 1));
+      INT(dummy_configs) = NA_INTEGER;
+      setAttrib(dummy_configs, R_ClassSymbol, mkString("factor"));
+      setAttrib(dummy_configs, R_LevelsSymbol,
+        getAttrib(cur, R_LevelsSymbol));
+      SET_VECTOR_ELT(VECTOR_ELT(result, i), 2, dummy_configs);
+      UNPROTECT(1);
+
+    }/*THEN*/
+
+    Free1D(fits[i].parents);
+    Free1D(fits[i].x);
+    if (fits[i].gram) {
+
+      Free1D(fits[i].family);
+      FreeSMOMENTS(fits[i].sm);
+
+    }/*THEN*/
+
+  }/*FOR*/
+
+  for (k = 0; k < nsets; k++) {
+
+    Free1D(sets[k].members);
+    Free1D(sets[k].cols);
+    Free1D(sets[k].cumlevels);
+
+  }/*FOR*/
+
+  Free1D(sets);
+  Free1D(fits);
+  Free1D(tasks);
+  Free1D(gram);
+  Free1D(cfg);
+  Free1D(counts);
+  Free1D(incomplete);
+
+  for (i = 0; i < nnodes; i++) {
+
+    if (pcol[i] & (1 << 0))
+      warning("possible convergence failure in the EM outer loop for node %s.",
+        CHAR(STRING_ELT(nodes, i)));
+    if (pcol[i] & (1 << 1))
+      warning("possible convergence failure in the Newton update for kappa and tau for node %s.",
+        CHAR(STRING_ELT(nodes, i)));
+    if (pcol[i] & (1 << 2))
+      warning("possible convergence failure in the Newton update for tau for node %s.",
+        CHAR(STRING_ELT(nodes, i)));
+    if (pcol[i] & (1 << 3))
+      warning("possible convergence failure in the Newton update for kappa for node %s.",
+        CHAR(STRING_ELT(nodes, i)));
+    if (pcol[i] & (1 << 4))
+      warning("tau is zero, restarting the Newton updates for node %s.",
+        CHAR(STRING_ELT(nodes, i)));
+
+  }/*FOR*/
+
+  Free1D(pcol);
+
+  UNPROTECT(2);
+
+  return result;
+
+}/*NETWORK_PARAMETERS*/
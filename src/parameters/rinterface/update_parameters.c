@@ -0,0 +1,407 @@
+#include "../../include/rcore.h"
+#include "../../include/parallel.h"
+#include "../../core/allocations.h"
+#include "../../core/moments.h"
+#include "../../core/sets.h"
+#include "../../minimal/strings.h"
+#include "../../minimal/common.h"
+#include "../../math/linear.algebra.h"
+#include "../parameters.h"
+
+/* the sufficient statistics of a local distribution and the data in the new
+ * batch of observations that are used to update them. */
+typedef struct {
+
+  bool discrete;      /* whether the local distribution is a CPT. */
+  int nobs;           /* number of complete observations in the batch. */
+  int nrows;          /* number of levels of the node (discrete nodes). */
+  int ncells;         /* number of cells of the CPT, or number of
+                       * configurations of the discrete parents. */
+  int d;              /* the node and its continuous parents. */
+  int *cfg;           /* the cell of the CPT (from 0) or the configuration of
+                       * the discrete parents (from 1) of each observation. */
+  double **family;    /* the node and its continuous parents. */
+  bool copied;        /* whether family and cfg hold only the complete
+                       * observations, and should be freed. */
+  double alpha;       /* imaginary sample size (discrete nodes). */
+  bool replace;       /* whether to replace unidentifiable parameters. */
+  double *counts;     /* counts (discrete nodes). */
+  double *n;          /* sample size of each configuration... */
+  double *mean;       /* ... the means of the node and its parents... */
+  double *comoment;   /* ... and their centred cross-products. */
+  double *prob;       /* the updated CPT... */
+  double *coefs;      /* ... or the updated regression coefficients... */
+  double *sd;         /* ... and standard errors. */
+
+} node_update;
+
+/* keep only the observations that are complete for the family of a node. */
+static void drop_incomplete(node_update *upd, int nobs) {
+
+int i = 0, j = 0, k = 0, nkept = 0, *cfg = NULL;
+double **family = NULL;
+bool *keep = Calloc1D(nobs, sizeof(bool));
+
+  for (i = 0; i < nobs; i++) {
+
+    keep[i] = !(*upd).cfg || ((*upd).cfg[i] != NA_INTEGER);
+    for (j = 0; (j < (*upd).d) && keep[i]; j++)
+      keep[i] = !ISNAN((*upd).family[j][i]);
+
+    nkept += keep[i];
+
+  }/*FOR*/
+
+  if (nkept < nobs) {
+
+    if ((*upd).d > 0) {
+
+      family = Calloc1D((*upd).d, sizeof(double *));
+      for (j = 0; j < (*upd).d; j++) {
+
+        family[j] = Calloc1D(MAX(1, nkept), sizeof(double));
+        for (i = 0, k = 0; i < nobs; i++)
+          if (keep[i])
+            family[j][k++] = (*upd).family[j][i];
+
+      }/*FOR*/
+
+      Free1D((*upd).family);
+      (*upd).family = family;
+
+    }/*THEN*/
+
+    if ((*upd).cfg) {
+
+      cfg = Calloc1D(MAX(1, nkept), sizeof(int));
+      for (i = 0, k = 0; i < nobs; i++)
+        if (keep[i])
+          cfg[k++] = (*upd).cfg[i];
+
+      Free1D((*upd).cfg);
+      (*upd).cfg = cfg;
+
+    }/*THEN*/
+
+    (*upd).copied = TRUE;
+
+  }/*THEN*/
+
+  (*upd).nobs = nkept;
+
+  Free1D(keep);
+
+}/*DROP_INCOMPLETE*/
+
+/* update the counts of a discrete node and recompute its CPT. */
+static void update_discrete_node(node_update *upd, double forget) {
+
+int i = 0;
+
+  for (i = 0; i < (*upd).ncells; i++)
+    (*upd).counts[i] *= forget;
+  for (i = 0; i < (*upd).nobs; i++)
+    (*upd).counts[(*upd).cfg[i]] += 1;
+
+  c_weighted_discrete_parameters((*upd).counts, (*upd).prob, (*upd).nrows,
+    (*upd).ncells / (*upd).nrows, (*upd).alpha, (*upd).replace);
+
+}/*UPDATE_DISCRETE_NODE*/
+
+/* update the moments of a continuous node and recompute its regression(s). */
+static void update_continuous_node(node_update *upd, double forget) {
+
+int s = 0, a = 0, b = 0, d = (*upd).d, nz = (*upd).ncells;
+long double *mean = NULL, *cm = NULL, delta = 0, n = 0, w = 0;
+double *beta = NULL;
+strata_moments batch = new_strata_moments(nz, d);
+
+  /* the moments of the new batch of observations... */
+  if ((*upd).nobs > 0)
+    c_strata_moments((*upd).family, (*upd).nobs, (*upd).cfg, batch);
+
+  mean = Calloc1D(d, sizeof(long double));
+  cm = Calloc1D(d * d, sizeof(long double));
+
+  for (s = 0; s < nz; s++) {
+
+    /* ... are merged with the discounted ones, whose means do not change,
+     * as in Chan, Golub and LeVeque. */
+    (*upd).n[s] *= forget;
+    for (a = 0; a < d * d; a++)
+      (*upd).comoment[s * d * d + a] *= forget;
+
+    n = (*upd).n[s] + batch.n[s];
+
+    for (b = 0; b < d; b++)
+      for (a = 0; a <= b; a++)
+        (*upd).comoment[s * d * d + CMC(a, b, d)] +=
+          batch.comoment[s * d * d + CMC(a, b, d)];
+
+    if ((batch.n[s] > 0) && (n > 0)) {
+
+      w = (long double)(*upd).n[s] * batch.n[s] / n;
+
+      for (b = 0; b < d; b++)
+        for (a = 0; a <= b; a++)
+          (*upd).comoment[s * d * d + CMC(a, b, d)] += w *
+            (batch.mean[s * d + a] - (*upd).mean[s * d + a]) *
+            (batch.mean[s * d + b] - (*upd).mean[s * d + b]);
+
+      for (a = 0; a < d; a++) {
+
+        delta = batch.mean[s * d + a] - (*upd).mean[s * d + a];
+        (*upd).mean[s * d + a] += delta * batch.n[s] / n;
+
+      }/*FOR*/
+
+    }/*THEN*/
+
+    (*upd).n[s] = n;
+
+    /* re-estimate the regression from the updated moments, setting the
+     * coefficients of collinear parents to NA. */
+    beta = (*upd).coefs + s * d;
+
+    if (n == 0) {
+
+      for (a = 0; a < d; a++)
+        beta[a] = NA_REAL;
+      (*upd).sd[s] = NA_REAL;
+
+    }/*THEN*/
+    else {
+
+      for (a = 0; a < d; a++)
+        mean[a] = (*upd).mean[s * d + a];
+      for (a = 0; a < d * d; a++)
+        cm[a] = (*upd).comoment[s * d * d + a];
+
+      c_ols_moments(n, mean, cm, d - 1, TRUE, beta, (*upd).sd + s);
+
+    }/*ELSE*/
+
+  }/*FOR*/
+
+  /* replace unidentifiable regression coefficients and the standard errors
+   * with zeroes to prevent NAs from propagating. */
+  if ((*upd).replace) {
+
+    for (a = 0; a < d * nz; a++)
+      if (ISNAN((*upd).coefs[a]))
+        (*upd).coefs[a] = 0;
+    for (s = 0; s < nz; s++)
+      if (ISNAN((*upd).sd[s]))
+        (*upd).sd[s] = 0;
+
+  }/*THEN*/
+
+  Free1D(mean);
+  Free1D(cm);
+  FreeSMOMENTS(batch);
+
+}/*UPDATE_CONTINUOUS_NODE*/
+
+/* check that the sufficient statistics of a node match the levels of the node
+ * and of its discrete parents in the data, before allocating anything. */
+static void check_stats(SEXP data, const char *node, SEXP dp, SEXP gp,
+    SEXP stats) {
+
+int j = 0, d = length(gp) + 1;
+long long ncells = 1;
+SEXP node_data = getListElement(data, (char *)node);
+
+  if (TYPEOF(node_data) == INTSXP)
+    ncells *= NLEVELS(node_data);
+  for (j = 0; j < length(dp); j++)
+    ncells *= NLEVELS(getListElement(data, (char *)CHAR(STRING_ELT(dp, j))));
+
+  if (ncells >= INT_MAX)
+    error("attempting to create a factor with more than INT_MAX levels.");
+
+  if (TYPEOF(node_data) == INTSXP) {
+
+    if (length(getListElement(stats, "counts")) != ncells)
+      error("the counts of node %s do not match the levels in the data.",
+        node);
+
+  }/*THEN*/
+  else {
+
+    if ((length(getListElement(stats, "n")) != ncells) ||
+        (length(getListElement(stats, "mean")) != d * ncells) ||
+        (length(getListElement(stats, "comoment")) != d * d * ncells))
+      error("the moments of node %s do not match the levels in the data.",
+        node);
+
+  }/*ELSE*/
+
+}/*CHECK_STATS*/
+
+/* update the sufficient statistics of the local distributions of some nodes
+ * with a new batch of observations, discounting the old ones by a forgetting
+ * factor, and recompute their parameters. */
+SEXP update_parameters(SEXP data, SEXP nodes, SEXP dparents, SEXP gparents,
+    SEXP stats, SEXP forget, SEXP debug) {
+
+int i = 0, j = 0, nnodes = length(nodes), nobs = length(VECTOR_ELT(data, 0));
+int ndp = 0, ngp = 0, *levels = NULL, **columns = NULL, nthreads = 1;
+int ncells = 0;
+double lambda = NUM(forget);
+bool debugging = isTRUE(debug);
+node_update *upd = NULL;
+SEXP result, new_stats, node_result, node_data, dp, gp, temp;
+
+  /* validate all the nodes first, so that no error is raised after memory
+   * has been allocated. */
+  for (i = 0; i < nnodes; i++)
+    check_stats(data, CHAR(STRING_ELT(nodes, i)), VECTOR_ELT(dparents, i),
+      VECTOR_ELT(gparents, i), VECTOR_ELT(stats, i));
+
+  upd = Calloc1D(nnodes, sizeof(node_update));
+  PROTECT(result = allocVector(VECSXP, nnodes));
+  setAttrib(result, R_NamesSymbol, nodes);
+
+  /* collect the data and the sufficient statistics of each node, which are
+   * duplicated so that the fitted network is not modified in place. */
+  for (i = 0; i < nnodes; i++) {
+
+    PROTECT(new_stats = duplicate(VECTOR_ELT(stats, i)));
+    node_data = getListElement(data, (char *)CHAR(STRING_ELT(nodes, i)));
+    dp = VECTOR_ELT(dparents, i);
+    gp = VECTOR_ELT(gparents, i);
+    ndp = length(dp);
+    ngp = length(gp);
+
+    upd[i].discrete = (TYPEOF(node_data) == INTSXP);
+    upd[i].replace = isTRUE(getListElement(new_stats, "replace"));
+
+    if (upd[i].discrete) {
+
+      /* the cells of the CPT are the configurations of the node and its
+       * parents, with the node varying fastest. */
+      columns = Calloc1D(ndp + 1, sizeof(int *));
+      levels = Calloc1D(ndp + 1, sizeof(int));
+      columns[0] = INTEGER(node_data);
+      levels[0] = NLEVELS(node_data);
+      for (j = 0; j < ndp; j++) {
+
+        temp = getListElement(data, (char *)CHAR(STRING_ELT(dp, j)));
+        columns[j + 1] = INTEGER(temp);
+        levels[j + 1] = NLEVELS(temp);
+
+      }/*FOR*/
+
+      upd[i].cfg = Calloc1D(nobs, sizeof(int));
+      c_fast_config(columns, nobs, ndp + 1, levels, upd[i].cfg, &ncells, 0);
+      upd[i].nrows = levels[0];
+      upd[i].ncells = ncells;
+      upd[i].alpha = NUM(getListElement(new_stats, "iss"));
+
+      upd[i].counts = REAL(getListElement(new_stats, "counts"));
+
+      PROTECT(node_result = allocVector(VECSXP, 2));
+      setAttrib(node_result, R_NamesSymbol, mkStringVec(2, "prob", "stats"));
+      SET_VECTOR_ELT(node_result, 0, allocVector(REALSXP, ncells));
+      upd[i].prob = REAL(VECTOR_ELT(node_result, 0));
+
+      Free1D(columns);
+      Free1D(levels);
+
+    }/*THEN*/
+    else {
+
+      /* the configurations of the discrete parents, if any, index the
+       * regressions in the same order as the columns of the coefficients. */
+      if (ndp > 0) {
+
+        columns = Calloc1D(ndp, sizeof(int *));
+        levels = Calloc1D(ndp, sizeof(int));
+        for (j = 0; j < ndp; j++) {
+
+          temp = getListElement(data, (char *)CHAR(STRING_ELT(dp, j)));
+          columns[j] = INTEGER(temp);
+          levels[j] = NLEVELS(temp);
+
+        }/*FOR*/
+
+        upd[i].cfg = Calloc1D(nobs, sizeof(int));
+        c_fast_config(columns, nobs, ndp, levels, upd[i].cfg, &ncells, 1);
+
+        Free1D(columns);
+        Free1D(levels);
+
+      }/*THEN*/
+      else {
+
+        ncells = 1;
+
+      }/*ELSE*/
+
+      upd[i].ncells = ncells;
+      upd[i].d = ngp + 1;
+      upd[i].family = Calloc1D(ngp + 1, sizeof(double *));
+      upd[i].family[0] = REAL(node_data);
+      for (j = 0; j < ngp; j++)
+        upd[i].family[j + 1] =
+          REAL(getListElement(data, (char *)CHAR(STRING_ELT(gp, j))));
+
+      upd[i].n = REAL(getListElement(new_stats, "n"));
+      upd[i].mean = REAL(getListElement(new_stats, "mean"));
+      upd[i].comoment = REAL(getListElement(new_stats, "comoment"));
+
+      PROTECT(node_result = allocVector(VECSXP, 3));
+      setAttrib(node_result, R_NamesSymbol,
+        mkStringVec(3, "coefficients", "sd", "stats"));
+      SET_VECTOR_ELT(node_result, 0, allocVector(REALSXP, (ngp + 1) * ncells));
+      SET_VECTOR_ELT(node_result, 1, allocVector(REALSXP, ncells));
+      upd[i].coefs = REAL(VECTOR_ELT(node_result, 0));
+      upd[i].sd = REAL(VECTOR_ELT(node_result, 1));
+
+    }/*ELSE*/
+
+    SET_VECTOR_ELT(node_result, length(node_result) - 1, new_stats);
+    SET_VECTOR_ELT(result, i, node_result);
+    UNPROTECT(2);
+
+    drop_incomplete(upd + i, nobs);
+
+  }/*FOR*/
+
+  /* the nodes are updated independently, and all the allocations that touch
+   * the R heap are done by now. */
+  nthreads = debugging ? 1 : MAX(1, MIN(MAX_THREADS, nnodes));
+
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+  for (i = 0; i < nnodes; i++) {
+
+    if (upd[i].discrete)
+      update_discrete_node(upd + i, lambda);
+    else
+      update_continuous_node(upd + i, lambda);
+
+  }/*FOR*/
+
+  for (i = 0; i < nnodes; i++) {
+
+    if (debugging)
+      Rprintf("* updating the parameters of node %s (%d new observations).\n",
+        CHAR(STRING_ELT(nodes, i)), upd[i].nobs);
+
+    if (upd[i].copied)
+      for (j = 0; j < upd[i].d; j++)
+        Free1D(upd[i].family[j]);
+    Free1D(upd[i].family);
+    Free1D(upd[i].cfg);
+
+  }/*FOR*/
+
+  Free1D(upd);
+
+  UNPROTECT(1);
+
+  return result;
+
+}/*UPDATE_PARAMETERS*/
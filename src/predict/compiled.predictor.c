@@ -0,0 +1,287 @@
+#include "../include/rcore.h"
+#include "../core/allocations.h"
+#include "../core/math.functions.h"
+#include "../minimal/common.h"
+#include "compiled.predictor.h"
+
+/* the last discrete node and the last classifier that were compiled, wrapped in
+ * external pointers that also protect the objects the plans point into. */
+static SEXP last_dmode = NULL;
+static SEXP last_naive = NULL;
+
+static void FreeDMODEPLAN(dmode_plan *plan) {
+
+  Free1D((*plan).nmax);
+  Free1D((*plan).maxima);
+  Free1D(plan);
+
+}/*FREEDMODEPLAN*/
+
+static void FreeNAIVEPLAN(naive_plan *plan) {
+
+  for (int j = 0; j < (*plan).nvars; j++)
+    Free1D((*plan).logtab[j]);
+
+  Free1D((*plan).nodes);
+  Free1D((*plan).parents);
+  Free1D((*plan).nx);
+  Free1D((*plan).cpt);
+  Free1D((*plan).prior);
+  Free1D((*plan).logprior);
+  Free1D((*plan).logtab);
+  Free1D(plan);
+
+}/*FREENAIVEPLAN*/
+
+static void dmode_plan_finalizer(SEXP ptr) {
+
+dmode_plan *plan = R_ExternalPtrAddr(ptr);
+
+  if (!plan)
+    return;
+
+  FreeDMODEPLAN(plan);
+  R_ClearExternalPtr(ptr);
+
+}/*DMODE_PLAN_FINALIZER*/
+
+static void naive_plan_finalizer(SEXP ptr) {
+
+naive_plan *plan = R_ExternalPtrAddr(ptr);
+
+  if (!plan)
+    return;
+
+  FreeNAIVEPLAN(plan);
+  R_ClearExternalPtr(ptr);
+
+}/*NAIVE_PLAN_FINALIZER*/
+
+/* keep a plan as the last one that was compiled, replacing the previous one. */
+static void *cache_plan(SEXP *last, void *plan, SEXP prot,
+    R_CFinalizer_t finalizer) {
+
+SEXP ptr;
+
+  PROTECT(ptr = R_MakeExternalPtr(plan, R_NilValue, prot));
+  R_RegisterCFinalizerEx(ptr, finalizer, TRUE);
+
+  if (*last) {
+
+    finalizer(*last);
+    R_ReleaseObject(*last);
+
+  }/*THEN*/
+
+  R_PreserveObject(ptr);
+  *last = ptr;
+
+  UNPROTECT(1);
+
+  return plan;
+
+}/*CACHE_PLAN*/
+
+/* find the mode(s) of each conditional distribution in the CPT of a discrete
+ * node, in the same order as all_max() returns them. */
+static dmode_plan *compile_discrete_predictor(SEXP fitted) {
+
+int i = 0, k = 0, nrow = 0, ncol = 0, *iscratch = NULL;
+double *buf = NULL;
+SEXP prob = getListElement(fitted, "prob");
+dmode_plan *plan = Calloc1D(1, sizeof(dmode_plan));
+
+  /* nodes without parents have a one-dimensional table. */
+  if (isNull(getAttrib(prob, R_DimSymbol)))
+    nrow = length(prob);
+  else
+    nrow = INT(getAttrib(prob, R_DimSymbol));
+  ncol = length(prob) / nrow;
+
+  (*plan).node = fitted;
+  (*plan).nlevels = nrow;
+  (*plan).nconfigs = ncol;
+  (*plan).cpt = REAL(prob);
+  (*plan).nmax = Calloc1D(ncol, sizeof(int));
+  (*plan).maxima = Calloc1D((size_t)nrow * ncol, sizeof(int));
+
+  iscratch = Calloc1D(nrow, sizeof(int));
+  buf = Calloc1D(nrow, sizeof(double));
+
+  for (i = 0; i < ncol; i++) {
+
+    /* initialize the vector of indexes. */
+    for (k = 0; k < nrow; k++)
+      iscratch[k] = k + 1;
+
+    (*plan).nmax[i] = all_max((*plan).cpt + (size_t)i * nrow, nrow,
+                        (*plan).maxima + (size_t)i * nrow, iscratch, buf);
+
+  }/*FOR*/
+
+  Free1D(iscratch);
+  Free1D(buf);
+
+  return plan;
+
+}/*COMPILE_DISCRETE_PREDICTOR*/
+
+/* return the modes of the CPT of a discrete node, reusing the last ones that
+ * were computed if the local distribution is the same. */
+dmode_plan *compiled_discrete_predictor(SEXP fitted) {
+
+dmode_plan *plan = NULL;
+
+  if (last_dmode) {
+
+    plan = R_ExternalPtrAddr(last_dmode);
+    if (plan && ((*plan).node == fitted))
+      return plan;
+
+  }/*THEN*/
+
+  return cache_plan(&last_dmode, compile_discrete_predictor(fitted), fitted,
+           dmode_plan_finalizer);
+
+}/*COMPILED_DISCRETE_PREDICTOR*/
+
+/* store the CPT of an explanatory variable as log-probabilities, transposing
+ * it so that the levels of the training variable are contiguous. */
+static double *naive_log_table(double *cpt, int nx, int ntr, int nz) {
+
+int x = 0, k = 0, z = 0;
+double *logtab = Calloc1D((size_t)nx * ntr * nz, sizeof(double));
+
+  /* in the CPT the first dimension corresponds to the current node [X], the
+   * second to the training node [Y], the third to the only other parent of
+   * the current node [Z]. */
+  for (z = 0; z < nz; z++)
+    for (x = 0; x < nx; x++)
+      for (k = 0; k < ntr; k++)
+        logtab[((size_t)x + (size_t)z * nx) * ntr + k] =
+          log(cpt[x + k * nx + (size_t)z * nx * ntr]);
+
+  return logtab;
+
+}/*NAIVE_LOG_TABLE*/
+
+static naive_plan *compile_naive_predictor(SEXP fitted, SEXP parents,
+    SEXP training, SEXP prior) {
+
+int j = 0, k = 0, nvars = length(fitted), *prn = INTEGER(parents);
+double *pr = REAL(prior);
+SEXP prob;
+naive_plan *plan = Calloc1D(1, sizeof(naive_plan));
+
+  (*plan).nvars = nvars;
+  (*plan).target = INT(training) - 1;
+  (*plan).nodes = Calloc1D(nvars, sizeof(SEXP));
+  (*plan).parents = Calloc1D(nvars, sizeof(int));
+  (*plan).nx = Calloc1D(nvars, sizeof(int));
+  (*plan).cpt = Calloc1D(nvars, sizeof(double *));
+  (*plan).logtab = Calloc1D(nvars, sizeof(double *));
+
+  for (j = 0; j < nvars; j++) {
+
+    (*plan).nodes[j] = VECTOR_ELT(fitted, j);
+    (*plan).parents[j] = prn[j];
+    prob = getListElement((*plan).nodes[j], "prob");
+    (*plan).cpt[j] = REAL(prob);
+
+    if (isNull(getAttrib(prob, R_DimSymbol)))
+      (*plan).nx[j] = length(prob);
+    else
+      (*plan).nx[j] = INT(getAttrib(prob, R_DimSymbol));
+
+  }/*FOR*/
+
+  (*plan).nlevels = (*plan).nx[(*plan).target];
+
+  (*plan).prior = Calloc1D((*plan).nlevels, sizeof(double));
+  (*plan).logprior = Calloc1D((*plan).nlevels, sizeof(double));
+  for (k = 0; k < (*plan).nlevels; k++) {
+
+    (*plan).prior[k] = pr[k];
+    (*plan).logprior[k] = log(pr[k]);
+
+  }/*FOR*/
+
+  for (j = 0; j < nvars; j++) {
+
+    if (j == (*plan).target)
+      continue;
+
+    (*plan).logtab[j] = naive_log_table((*plan).cpt[j], (*plan).nx[j],
+                          (*plan).nlevels,
+                          (prn[j] == NA_INTEGER) ? 1 : (*plan).nx[prn[j] - 1]);
+
+  }/*FOR*/
+
+  return plan;
+
+}/*COMPILE_NAIVE_PREDICTOR*/
+
+/* check whether a compiled classifier still matches its arguments. */
+static bool naive_plan_matches(SEXP ptr, SEXP fitted, SEXP parents,
+    SEXP training, SEXP prior) {
+
+naive_plan *plan = R_ExternalPtrAddr(ptr);
+int *prn = INTEGER(parents);
+double *pr = REAL(prior);
+
+  if (!plan || (R_ExternalPtrProtected(ptr) != fitted))
+    return FALSE;
+  if (((*plan).nvars != length(fitted)) || ((*plan).target != INT(training) - 1))
+    return FALSE;
+  if (length(prior) != (*plan).nlevels)
+    return FALSE;
+
+  for (int j = 0; j < (*plan).nvars; j++)
+    if (((*plan).nodes[j] != VECTOR_ELT(fitted, j)) ||
+        ((*plan).parents[j] != prn[j]))
+      return FALSE;
+
+  for (int k = 0; k < (*plan).nlevels; k++)
+    if ((*plan).prior[k] != pr[k])
+      return FALSE;
+
+  return TRUE;
+
+}/*NAIVE_PLAN_MATCHES*/
+
+/* return the compiled version of a naive Bayes or TAN classifier, reusing the
+ * last one if neither the classifier nor the prior have changed. */
+naive_plan *compiled_naive_predictor(SEXP fitted, SEXP parents, SEXP training,
+    SEXP prior) {
+
+  if (last_naive &&
+      naive_plan_matches(last_naive, fitted, parents, training, prior))
+    return R_ExternalPtrAddr(last_naive);
+
+  return cache_plan(&last_naive,
+           compile_naive_predictor(fitted, parents, training, prior), fitted,
+           naive_plan_finalizer);
+
+}/*COMPILED_NAIVE_PREDICTOR*/
+
+/* drop the cached plans, freeing them right away so that no finalizer is left
+ * pointing into the shared library after it is unloaded. */
+void compiled_predictors_release(void) {
+
+  if (last_dmode) {
+
+    dmode_plan_finalizer(last_dmode);
+    R_ReleaseObject(last_dmode);
+    last_dmode = NULL;
+
+  }/*THEN*/
+
+  if (last_naive) {
+
+    naive_plan_finalizer(last_naive);
+    R_ReleaseObject(last_naive);
+    last_naive = NULL;
+
+  }/*THEN*/
+
+}/*COMPILED_PREDICTORS_RELEASE*/
@@ -0,0 +1,44 @@
+#ifndef COMPILED_PREDICTOR_HEADER
+#define COMPILED_PREDICTOR_HEADER
+
+/* the modes of all the conditional distributions in the CPT of a discrete
+ * node, which are all that is needed to predict its values from its parents. */
+typedef struct {
+
+  SEXP node;         /* the local distribution in the bn.fit object. */
+  int nlevels;       /* number of levels of the node. */
+  int nconfigs;      /* number of configurations of the parents. */
+  double *cpt;       /* the CPT, pointing into the bn.fit object. */
+  int *nmax;         /* number of modes of each conditional distribution. */
+  int *maxima;       /* the modes (1-based), nlevels slots for each
+                      * configuration of the parents. */
+
+} dmode_plan;
+
+/* a naive Bayes or a Tree-Augmented naive Bayes classifier, with the CPTs of
+ * the explanatory variables stored as log-probabilities and laid out so that
+ * the levels of the training variable are contiguous. */
+typedef struct {
+
+  int nvars;         /* number of variables, including the training one. */
+  int target;        /* index of the training variable (0-based). */
+  int nlevels;       /* number of levels of the training variable. */
+  SEXP *nodes;       /* the local distributions in the bn.fit object, to detect
+                      * changes. */
+  int *parents;      /* the parent of each explanatory variable other than the
+                      * training variable (1-based), NA_INTEGER if none. */
+  int *nx;           /* number of levels of each variable. */
+  double **cpt;      /* the CPTs, pointing into the bn.fit object. */
+  double *prior;     /* the prior distribution of the training variable. */
+  double *logprior;  /* the same, on the log-scale. */
+  double **logtab;   /* the log-probabilities of each explanatory variable, in
+                      * the cell ((x - 1) + (z - 1) * nx) * nlevels + k. */
+
+} naive_plan;
+
+dmode_plan *compiled_discrete_predictor(SEXP fitted);
+naive_plan *compiled_naive_predictor(SEXP fitted, SEXP parents, SEXP training,
+    SEXP prior);
+void compiled_predictors_release(void);
+
+#endif
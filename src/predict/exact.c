@@ -0,0 +1,344 @@
+#include "../include/rcore.h"
+#include "../core/allocations.h"
+#include "../minimal/data.frame.h"
+#include "../minimal/common.h"
+#include "../fitted/compiled.h"
+#include "../include/globals.h"
+#include "../math/linear.algebra.h"
+#include "predict.h"
+
+/* predict the values of a discrete variable by exact inference, propagating the
+ * predictors as evidence in the junction tree of the network. The junction
+ * tree is compiled once and cached with the network, and observations with the
+ * same evidence share the same propagation. */
+SEXP jtpred(SEXP node, SEXP fitted, SEXP data, SEXP from, SEXP prob,
+    SEXP debug) {
+
+int i = 0, j = 0, k = 0, p = 0, nobs = 0, nev = 0, nlvls = 0, target = 0;
+int npatterns = 0, *vartypes = NULL, *evnode = NULL, *pattern = NULL;
+int *first = NULL, *res = NULL, *pmax = NULL, *pmaxima = NULL, *nmax = NULL;
+int *maxima = NULL;
+void **varptrs = NULL;
+double logp = 0, *marginal = NULL, *pprob = NULL, *pt = NULL;
+bool debugging = isTRUE(debug), include_prob = isTRUE(prob);
+compiled_bn *plan = NULL;
+jtree *jt = NULL;
+SEXP result, lvls, evmatch, nodematch, probtab = R_NilValue;
+
+  /* compile the junction tree the first time it is needed. */
+  plan = compiled_network(fitted);
+  if (!(*plan).jt)
+    (*plan).jt = c_jtree_compile((*plan).bn, debugging);
+  jt = (*plan).jt;
+
+  if (debugging)
+    Rprintf("* predicting values for node %s.\n", CHAR(STRING_ELT(node, 0)));
+
+  nev = length(from);
+  PROTECT(evmatch = match(getAttrib(data, R_NamesSymbol), from, 0));
+  PROTECT(nodematch = match(getAttrib(fitted, R_NamesSymbol), from, 0));
+  target = INT(match(getAttrib(fitted, R_NamesSymbol), node, 0)) - 1;
+
+  /* cache variable types and pointers. */
+  vartypes = Calloc1D(nev, sizeof(int));
+  varptrs = (void **) Calloc1D(nev, sizeof(void *));
+  evnode = Calloc1D(nev, sizeof(int));
+  for (j = 0; j < nev; j++) {
+
+    vartypes[j] = INTSXP;
+    varptrs[j] = INTEGER(VECTOR_ELT(data, INTEGER(evmatch)[j] - 1));
+    evnode[j] = INTEGER(nodematch)[j] - 1;
+
+  }/*FOR*/
+
+  /* cache the sample size. */
+  nobs = length(VECTOR_ELT(data, 0));
+
+  /* allocate the return value. */
+  PROTECT(result = fitnode2df(fitted, STRING_ELT(node, 0), nobs));
+  res = INTEGER(result);
+  lvls = getAttrib(result, R_LevelsSymbol);
+  nlvls = length(lvls);
+
+  if (include_prob) {
+
+    PROTECT(probtab = allocMatrix(REALSXP, nlvls, nobs));
+    pt = REAL(probtab);
+
+  }/*THEN*/
+
+  /* group the observations by their evidence. */
+  pattern = Calloc1D(nobs, sizeof(int));
+  first = Calloc1D(nobs, sizeof(int));
+  npatterns = evidence_patterns(varptrs, vartypes, nev, nobs, pattern, first);
+
+  if (debugging)
+    Rprintf("* %d distinct evidence patterns in %d observations.\n",
+      npatterns, nobs);
+
+  /* the number of levels with the highest probability and the levels
+   * themselves, for each evidence pattern. */
+  pmax = Calloc1D(npatterns, sizeof(int));
+  pmaxima = Calloc1D((size_t)npatterns * nlvls, sizeof(int));
+  pprob = Calloc1D((size_t)npatterns * nlvls, sizeof(double));
+  marginal = Calloc1D(nlvls, sizeof(double));
+
+  for (p = 0; p < npatterns; p++) {
+
+    /* set the predictors as evidence and propagate it. */
+    c_jtree_reset(jt);
+    for (j = 0; j < nev; j++)
+      c_jtree_evidence(jt, evnode[j], ((int *)varptrs[j])[first[p]] - 1);
+    logp = c_jtree_propagate(jt);
+
+    /* check that it is possible to observe the evidence. */
+    if (exp(logp) <= sqrt(DBL_EPSILON)) {
+
+      pmax[p] = 0;
+      for (k = 0; k < nlvls; k++)
+        pprob[(size_t)p * nlvls + k] = NA_REAL;
+
+      if (debugging)
+        Rprintf("  > prediction for observation %d is 'NA' (the evidence is not possible).\n",
+          first[p] + 1);
+
+      continue;
+
+    }/*THEN*/
+
+    /* get the probability distribution of the node being predicted... */
+    c_jtree_marginal(jt, target, marginal);
+    memcpy(pprob + (size_t)p * nlvls, marginal, nlvls * sizeof(double));
+
+    /* ... and find the level(s) with the highest probability; ties are broken
+     * separately for each observation below. */
+    maxima = pmaxima + (size_t)p * nlvls;
+    nmax = pmax + p;
+    for (k = 0, *nmax = 0; k < nlvls; k++) {
+
+      if ((*nmax == 0) || (marginal[k] > marginal[maxima[0]])) {
+
+        maxima[0] = k;
+        *nmax = 1;
+
+      }/*THEN*/
+      else if (marginal[k] == marginal[maxima[0]]) {
+
+        maxima[(*nmax)++] = k;
+
+      }/*THEN*/
+
+    }/*FOR*/
+
+    if (debugging) {
+
+      if (*nmax == 1)
+        Rprintf("  > prediction for observation %d is '%s' with probabilities:\n  ",
+          first[p] + 1, CHAR(STRING_ELT(lvls, maxima[0])));
+      else
+        Rprintf("  > prediction for observation %d is a tie between %d levels with probabilities:\n  ",
+          first[p] + 1, *nmax);
+      for (k = 0; k < nlvls; k++)
+        Rprintf("  %lf", marginal[k]);
+      Rprintf("\n");
+
+    }/*THEN*/
+
+  }/*FOR*/
+
+  GetRNGstate();
+
+  /* copy the predictions to all the observations with the same evidence,
+   * breaking ties at random independently for each observation. */
+  for (i = 0; i < nobs; i++) {
+
+    p = pattern[i];
+    maxima = pmaxima + (size_t)p * nlvls;
+
+    if (pmax[p] == 0)
+      res[i] = NA_INTEGER;
+    else if (pmax[p] == 1)
+      res[i] = maxima[0] + 1;
+    else
+      res[i] = maxima[(int)(unif_rand() * pmax[p])] + 1;
+
+    if (include_prob)
+      for (k = 0; k < nlvls; k++)
+        pt[CMC(k, i, nlvls)] = pprob[(size_t)pattern[i] * nlvls + k];
+
+  }/*FOR*/
+
+  PutRNGstate();
+
+  if (include_prob) {
+
+    /* set the levels of the target variable as rownames. */
+    setDimNames(probtab, lvls, R_NilValue);
+    /* add the posterior probabilities to the return value. */
+    setAttrib(result, BN_ProbSymbol, probtab);
+
+    UNPROTECT(1);
+
+  }/*THEN*/
+
+  Free1D(vartypes);
+  Free1D(varptrs);
+  Free1D(evnode);
+  Free1D(pattern);
+  Free1D(first);
+  Free1D(pmax);
+  Free1D(pmaxima);
+  Free1D(pprob);
+  Free1D(marginal);
+
+  UNPROTECT(3);
+
+  return result;
+
+}/*JTPRED*/
+
+/* compute the conditional expectations of one or more variables given the
+ * observed values of the predictors in a Gaussian network, from the sparse
+ * precision matrix of the global distribution. The predictors that are missing
+ * in an observation are integrated out; observations with the same predictors
+ * share the same factorization of the precision matrix. */
+SEXP gprecpred(SEXP fitted, SEXP data, SEXP from, SEXP to, SEXP debug) {
+
+int i = 0, j = 0, k = 0, p = 0, nobs = 0, nev = 0, nto = 0, nnodes = 0;
+int npatterns = 0, *vartypes = NULL, *evnode = NULL, *tonode = NULL;
+int *pattern = NULL, *first = NULL, *start = NULL, *rows = NULL;
+int **flags = NULL;
+double **evptr = NULL, **res = NULL, *x = NULL, *mean = NULL, *work = NULL;
+bool debugging = isTRUE(debug), *observed = NULL;
+compiled_bn *plan = NULL;
+gprec_factor *f = NULL;
+SEXP result, evmatch, nodematch, tomatch;
+
+  /* build the precision matrix the first time it is needed. */
+  plan = compiled_network(fitted);
+  if (!(*plan).gp)
+    (*plan).gp = c_gprec_build((*plan).bn);
+  nnodes = (*plan).bn.nnodes;
+
+  /* match the predictors with the data and with the network. */
+  nev = length(from);
+  PROTECT(evmatch = match(getAttrib(data, R_NamesSymbol), from, 0));
+  PROTECT(nodematch = match(getAttrib(fitted, R_NamesSymbol), from, 0));
+  PROTECT(tomatch = match(getAttrib(fitted, R_NamesSymbol), to, 0));
+
+  /* cache the sample size. */
+  nobs = length(VECTOR_ELT(data, 0));
+
+  /* flag which predictors are observed in each observation. */
+  evptr = Calloc1D(nev, sizeof(double *));
+  evnode = Calloc1D(nev, sizeof(int));
+  flags = Calloc1D(nev, sizeof(int *));
+  vartypes = Calloc1D(nev, sizeof(int));
+  for (j = 0, k = 0; j < nev; j++) {
+
+    /* variables that are not in the network carry no evidence. */
+    if (INTEGER(nodematch)[j] == 0)
+      continue;
+
+    evptr[k] = REAL(VECTOR_ELT(data, INTEGER(evmatch)[j] - 1));
+    evnode[k] = INTEGER(nodematch)[j] - 1;
+    vartypes[k] = INTSXP;
+    flags[k] = Calloc1D(nobs, sizeof(int));
+    for (i = 0; i < nobs; i++)
+      flags[k][i] = !ISNAN(evptr[k][i]);
+    k++;
+
+  }/*FOR*/
+  nev = k;
+
+  /* allocate the return value. */
+  nto = length(to);
+  tonode = INTEGER(tomatch);
+  PROTECT(result = allocVector(VECSXP, nto));
+  res = Calloc1D(nto, sizeof(double *));
+  for (j = 0; j < nto; j++) {
+
+    SET_VECTOR_ELT(result, j, allocVector(REALSXP, nobs));
+    res[j] = REAL(VECTOR_ELT(result, j));
+
+  }/*FOR*/
+  setAttrib(result, R_NamesSymbol, to);
+  if (nto > 0)
+    minimal_data_frame(result);
+
+  /* group the observations by which predictors are observed... */
+  pattern = Calloc1D(nobs, sizeof(int));
+  first = Calloc1D(nobs, sizeof(int));
+  npatterns = evidence_patterns((void **)flags, vartypes, nev, nobs, pattern,
+                first);
+
+  /* ... and sort them by group. */
+  start = Calloc1D(npatterns + 1, sizeof(int));
+  rows = Calloc1D(nobs, sizeof(int));
+  for (i = 0; i < nobs; i++)
+    start[pattern[i] + 1]++;
+  for (p = 0; p < npatterns; p++)
+    start[p + 1] += start[p];
+  for (i = 0; i < nobs; i++)
+    rows[start[pattern[i]]++] = i;
+  for (p = npatterns; p > 0; p--)
+    start[p] = start[p - 1];
+  start[0] = 0;
+
+  if (debugging)
+    Rprintf("* %d distinct sets of observed predictors in %d observations.\n",
+      npatterns, nobs);
+
+  observed = Calloc1D(nnodes, sizeof(bool));
+  x = Calloc1D(nnodes, sizeof(double));
+  mean = Calloc1D(nnodes, sizeof(double));
+  work = Calloc1D(nnodes, sizeof(double));
+
+  for (p = 0; p < npatterns; p++) {
+
+    /* factorize the precision matrix of the unobserved nodes... */
+    memset(observed, '\0', nnodes * sizeof(bool));
+    for (j = 0; j < nev; j++)
+      observed[evnode[j]] = flags[j][first[p]];
+
+    f = c_gprec_factor((*plan).gp, observed, debugging);
+
+    /* ... and compute the conditional expectations for each observation. */
+    for (k = start[p]; k < start[p + 1]; k++) {
+
+      i = rows[k];
+
+      for (j = 0; j < nev; j++)
+        if (observed[evnode[j]])
+          x[evnode[j]] = evptr[j][i];
+
+      c_gprec_condmean((*plan).gp, f, x, mean, work);
+
+      for (j = 0; j < nto; j++)
+        res[j][i] = mean[tonode[j] - 1];
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  for (j = 0; j < nev; j++)
+    Free1D(flags[j]);
+  Free1D(flags);
+  Free1D(evptr);
+  Free1D(evnode);
+  Free1D(vartypes);
+  Free1D(res);
+  Free1D(pattern);
+  Free1D(first);
+  Free1D(start);
+  Free1D(rows);
+  Free1D(observed);
+  Free1D(x);
+  Free1D(mean);
+  Free1D(work);
+
+  UNPROTECT(4);
+
+  return result;
+
+}/*GPRECPRED*/
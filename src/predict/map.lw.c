@@ -4,8 +4,12 @@
 #include "../minimal/data.frame.h"
 #include "../minimal/common.h"
 #include "../include/sampling.h"
+#include "../include/parallel.h"
+#include "../inference/rbn.h"
+#include "../inference/adaptive.sampling.h"
 #include "../include/globals.h"
 #include "../math/linear.algebra.h"
+#include "predict.h"
 
 static double posterior_mean(double *x, double *wgt, int n, int *drop,
     bool debugging) {
@@ -15,7 +19,7 @@ long double wsum = 0, wtot = 0;
 
   for (k = 0; k < n; k++) {
 
-    /* c_rbn_master() may generate NAs, c_lw_weights() can generate NA and NaNs
+    /* rbn_node() may generate NAs, lw_logdensity() can generate NA and NaNs
        as well, disregard and print a warning. */
     if (ISNAN(x[k]) || ISNAN(wgt[k])) {
 
@@ -59,7 +63,7 @@ int k = 0, max_prob = 0;
 
   for (k = 0; k < n; k++) {
 
-    /* c_rbn_master() may generate NAs, and c_lw_weights() can generate NaNs as
+    /* rbn_node() may generate NAs, and lw_logdensity() can generate NaNs as
      * well, disregard and print a warning. */
     if ((x[k] == NA_INTEGER) || (ISNAN(wgt[k])))
       (*drop)++;
@@ -88,19 +92,118 @@ int k = 0, max_prob = 0;
 
 }/*POSTERIOR_MODE*/
 
+/* group the observations by the values of the evidence variables, using an
+ * open-addressing hash table over the rows. Patterns are numbered in order of
+ * first appearance, and first[] holds the first observation of each. */
+int evidence_patterns(void **varptrs, int *vartypes, int nev, int nobs,
+    int *pattern, int *first) {
+
+int i = 0, j = 0, npatterns = 0, *slot = NULL;
+size_t size = 16, mask = 0, pos = 0;
+uint64_t h = 0, bits = 0;
+double d = 0;
+bool match = FALSE;
+
+  while (size < 2 * (size_t)nobs)
+    size <<= 1;
+  mask = size - 1;
+
+  slot = Calloc1D(size, sizeof(int));
+  for (pos = 0; pos < size; pos++)
+    slot[pos] = -1;
+
+  for (i = 0; i < nobs; i++) {
+
+    /* hash the evidence in the current observation. */
+    for (j = 0, h = 0; j < nev; j++) {
+
+      if (vartypes[j] == INTSXP) {
+
+        bits = (uint64_t)(uint32_t)((int *)varptrs[j])[i];
+
+      }/*THEN*/
+      else {
+
+        /* zeroes compare equal regardless of their sign. */
+        d = ((double *)varptrs[j])[i];
+        if (d == 0)
+          d = 0;
+        memcpy(&bits, &d, sizeof(double));
+
+      }/*ELSE*/
+
+      h = (h ^ bits) * 0x9E3779B97F4A7C15ULL;
+      h ^= h >> 29;
+
+    }/*FOR*/
+
+    /* look for an observation with the same evidence. */
+    for (pos = h & mask; slot[pos] >= 0; pos = (pos + 1) & mask) {
+
+      for (j = 0, match = TRUE; (j < nev) && match; j++) {
+
+        if (vartypes[j] == INTSXP)
+          match = ((int *)varptrs[j])[i] ==
+                    ((int *)varptrs[j])[first[slot[pos]]];
+        else
+          match = ((double *)varptrs[j])[i] ==
+                    ((double *)varptrs[j])[first[slot[pos]]];
+
+      }/*FOR*/
+
+      if (match)
+        break;
+
+    }/*FOR*/
+
+    if (slot[pos] < 0) {
+
+      slot[pos] = npatterns;
+      first[npatterns++] = i;
+
+    }/*THEN*/
+
+    pattern[i] = slot[pos];
+
+  }/*FOR*/
+
+  Free1D(slot);
+
+  return npatterns;
+
+}/*EVIDENCE_PATTERNS*/
+
 /* predict the values of one or more variables given one or more variables by
- * maximum a posteriori (MAP). */
+ * maximum a posteriori (MAP). Observations with the same evidence share the
+ * same prediction, so particles are generated once for each distinct pattern
+ * of evidence. Nodes that have no evidence among their ancestors are simulated
+ * once and shared by all patterns. Patterns are predicted in parallel, each
+ * with its own random stream. If updates is positive, particles are generated
+ * with adaptive importance sampling instead of likelihood weighting, learning
+ * the importance distribution separately for each pattern. */
 SEXP mappred(SEXP node, SEXP fitted, SEXP data, SEXP n, SEXP from, SEXP prob,
-    SEXP debug) {
-
-int i = 0, j = 0, nobs = 0, nev = 0, nlvls = 0, drop = 0;
-int *vartypes = NULL, nsims = INT(n);
-void **varptrs = NULL, **evptrs = NULL, *pred = NULL, *res = NULL;
-SEXP result, colnames, evidence, evmatch, temp = R_NilValue;
-SEXP cpdist, predicted, lvls = R_NilValue, probtab = R_NilValue;
-double *wgt = NULL, *pt = NULL;
-long double *lvls_counts = NULL, lvls_tot = 0;
+    SEXP updates, SEXP debug) {
+
+int i = 0, j = 0, k = 0, cur = 0, nobs = 0, nev = 0, nlvls = 0, drop = 0;
+int nnodes = 0, target = 0, npatterns = 0, nthreads = 1, nsims = INT(n);
+int nupdates = INT(updates);
+int *vartypes = NULL, *evnode = NULL, *pattern = NULL, *first = NULL;
+int *pdrop = NULL, *pres_int = NULL;
+uint32_t key[2] = { 0, 0 };
+void **varptrs = NULL, *res = NULL, **shared = NULL, **cols = NULL;
+double *wgt = NULL, *pt = NULL, *pres_real = NULL, *pprob = NULL;
+long double *lvls_counts = NULL;
+bool *affected = NULL, *warn = NULL;
 bool debugging = isTRUE(debug), include_prob = isTRUE(prob);
+compiled_bn *plan = NULL;
+rbn_fixed *fixed = NULL, nofix = { 0, NULL, NULL };
+ais_proposal **proposal = NULL;
+rng_stream rng;
+SEXP result, colnames, evmatch, nodematch, temp = R_NilValue;
+SEXP lvls = R_NilValue, probtab = R_NilValue;
+
+  plan = compiled_network(fitted);
+  nnodes = (*plan).bn.nnodes;
 
   /* extract the names of the variables in the data. */
   colnames = getAttrib(data, R_NamesSymbol);
@@ -108,51 +211,40 @@ bool debugging = isTRUE(debug), include_prob = isTRUE(prob);
   /* remove the name of the variable to predict. */
   nev = length(from);
   PROTECT(evmatch = match(colnames, from, 0));
+  PROTECT(nodematch = match(getAttrib(fitted, R_NamesSymbol), from, 0));
+  target = INT(match(getAttrib(fitted, R_NamesSymbol), node, 0)) - 1;
 
   /* cache variable types and pointers. */
   vartypes = Calloc1D(nev, sizeof(int));
   varptrs = (void **) Calloc1D(nev, sizeof(void *));
-  for (j = 0; j < nev; j++) {
+  evnode = Calloc1D(nev, sizeof(int));
+  for (j = 0, k = 0; j < nev; j++) {
+
+    /* variables that are not in the network carry no evidence. */
+    if (INTEGER(nodematch)[j] == 0)
+      continue;
 
     temp = VECTOR_ELT(data, INTEGER(evmatch)[j] - 1);
-    vartypes[j] = TYPEOF(temp);
-    varptrs[j] = DATAPTR(temp);
+    vartypes[k] = TYPEOF(temp);
+    varptrs[k] = DATAPTR(temp);
+    evnode[k++] = INTEGER(nodematch)[j] - 1;
 
   }/*FOR*/
+  nev = k;
 
   /* cache the sample size. */
   nobs = length(VECTOR_ELT(data, 0));
 
-  /* allocate a list to hold the evidence. */
-  PROTECT(evidence = allocVector(VECSXP, nev));
-  setAttrib(evidence, R_NamesSymbol, from);
-
-  /* cache pointers to the elements of the evidence .*/
-  evptrs = (void **) Calloc1D(nev, sizeof(void *));
-
-  for (j = 0; j < nev; j++) {
-
-    PROTECT(temp = allocVector(vartypes[j], 1));
-    evptrs[j] = DATAPTR(temp);
-    SET_VECTOR_ELT(evidence, j, temp);
-    UNPROTECT(1);
-
-  }/*FOR*/
-
-  /* make the evidence a data frame to compact debugging output. */
-  minimal_data_frame(evidence);
-
   /* allocate the return value. */
   PROTECT(result = fitnode2df(fitted, STRING_ELT(node, 0), nobs));
   res = DATAPTR(result);
 
-  /* in the case of discrete variables, allocate scratch space for levels'
-   * frequencies. */
+  /* in the case of discrete variables, allocate the space for the posterior
+   * probabilities. */
   if (TYPEOF(result) == INTSXP) {
 
     lvls = getAttrib(result, R_LevelsSymbol);
     nlvls = length(lvls);
-    lvls_counts = Calloc1D(nlvls, sizeof(long double));
 
     if (include_prob) {
 
@@ -164,93 +256,255 @@ bool debugging = isTRUE(debug), include_prob = isTRUE(prob);
 
   }/*THEN*/
 
-  /* allocate the weights. */
-  wgt = Calloc1D(nsims, sizeof(double));
+  /* group the observations by their evidence. */
+  pattern = Calloc1D(nobs, sizeof(int));
+  first = Calloc1D(nobs, sizeof(int));
+  npatterns = evidence_patterns(varptrs, vartypes, nev, nobs, pattern, first);
+
+  if (debugging)
+    Rprintf("* %d distinct evidence patterns in %d observations.\n",
+      npatterns, nobs);
+
+  /* find out which nodes are affected by the evidence, that is, which nodes
+   * are evidence nodes or have evidence nodes among their ancestors. With
+   * adaptive importance sampling all nodes are resimulated for each evidence
+   * pattern, because the importance distributions of all the nodes are
+   * learned from the evidence in that pattern. */
+  affected = Calloc1D(nnodes, sizeof(bool));
+  for (j = 0; j < nev; j++)
+    affected[evnode[j]] = TRUE;
+  if (nupdates > 0)
+    for (i = 0; i < nnodes; i++)
+      affected[i] = TRUE;
+  for (i = 0; i < nnodes; i++) {
+
+    cur = (*plan).poset[i];
+    for (k = 0; k < (*plan).bn.ldists[cur].nparents; k++)
+      affected[cur] = affected[cur] ||
+                        affected[(*plan).bn.ldists[cur].parents[k]];
 
-  /* allocate sratch space for the random samplings. */
-  PROTECT(cpdist = fit2df(fitted, nsims));
-  predicted = getListElement(cpdist, (char *)CHAR(STRING_ELT(node, 0)));
-  pred = DATAPTR(predicted);
+  }/*FOR*/
 
-  /* iterate over the observations. */
-  for (i = 0; i < nobs; i++) {
+  /* allocate per-thread scratch space: the particles of the affected nodes,
+   * their weights, the evidence and the frequencies of the levels. */
+  nthreads = debugging ? 1 : MAX_THREADS;
+  shared = Calloc1D(nnodes, sizeof(void *));
+  cols = Calloc1D(nthreads * nnodes, sizeof(void *));
+  fixed = Calloc1D(nthreads * nnodes, sizeof(rbn_fixed));
+  warn = Calloc1D(nthreads * nnodes, sizeof(bool));
+  wgt = Calloc1D(nthreads * nsims, sizeof(double));
+  if (TYPEOF(result) == INTSXP)
+    lvls_counts = Calloc1D(nthreads * nlvls, sizeof(long double));
+
+  for (i = 0; i < nnodes; i++) {
+
+    size_t size = (((*plan).bn.node_types[i] == DNODE) ||
+                   ((*plan).bn.node_types[i] == ONODE)) ?
+                     sizeof(int) : sizeof(double);
+
+    if (!affected[i])
+      shared[i] = Calloc1D(nsims, size);
+
+    for (k = 0; k < nthreads; k++)
+      cols[k * nnodes + i] = affected[i] ? Calloc1D(nsims, size) : shared[i];
+
+  }/*FOR*/
+
+  if (nupdates > 0) {
+
+    proposal = Calloc1D(nthreads, sizeof(ais_proposal *));
+    for (k = 0; k < nthreads; k++)
+      proposal[k] = ais_alloc(plan);
+
+  }/*THEN*/
+
+  for (k = 0; k < nthreads; k++) {
 
-    /* copy the values into the list. */
     for (j = 0; j < nev; j++) {
 
-      switch(vartypes[j]) {
+      fixed[k * nnodes + evnode[j]].n = 1;
+      fixed[k * nnodes + evnode[j]].levels = Calloc1D(1, sizeof(int));
+      fixed[k * nnodes + evnode[j]].values = Calloc1D(1, sizeof(double));
+
+    }/*FOR*/
+
+  }/*FOR*/
+
+  /* allocate the predictions for each pattern. */
+  pdrop = Calloc1D(npatterns, sizeof(int));
+  if (TYPEOF(result) == INTSXP) {
+
+    pres_int = Calloc1D(npatterns, sizeof(int));
+    if (include_prob)
+      pprob = Calloc1D((size_t)npatterns * nlvls, sizeof(double));
 
-        case REALSXP:
+  }/*THEN*/
+  else {
+
+    pres_real = Calloc1D(npatterns, sizeof(double));
+
+  }/*ELSE*/
 
-          *((double *)evptrs[j]) = ((double *)varptrs[j])[i];
-          break;
+  /* derive the key of the random streams from R's random seed. */
+  GetRNGstate();
+  rng_stream_key(key);
+  PutRNGstate();
 
-        case INTSXP:
+  /* simulate the nodes that are not affected by the evidence, once. */
+  rng_stream_init(&rng, key, 0);
+  for (i = 0; i < nnodes; i++)
+    if (!affected[(*plan).poset[i]])
+      rbn_node(plan, shared, &nofix, (*plan).poset[i], 0, nsims, &rng, warn);
 
-          *((int *)evptrs[j]) = ((int *)varptrs[j])[i];
-          break;
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+  for (int p = 0; p < npatterns; p++) {
 
-      }/*SWITCH*/
+    int t = THREAD_ID, obs = first[p];
+    void **tcols = cols + t * nnodes;
+    rbn_fixed *tfixed = fixed + t * nnodes;
+    double *twgt = wgt + t * nsims;
+    rng_stream trng;
+
+    /* set the evidence from the first observation with this pattern. */
+    for (int e = 0; e < nev; e++) {
+
+      if (vartypes[e] == INTSXP)
+        tfixed[evnode[e]].levels[0] = ((int *)varptrs[e])[obs];
+      else
+        tfixed[evnode[e]].values[0] = ((double *)varptrs[e])[obs];
 
     }/*FOR*/
 
-    if (debugging) {
+    if (debugging)
+      Rprintf("* predicting observation %d (and those with the same evidence).\n",
+        obs + 1);
+
+    /* generate samples from the conditional posterior distribution,
+     * computing the weights along the way. */
+    rng_stream_init(&trng, key, (uint64_t)p + 1);
+    memset(twgt, '\0', nsims * sizeof(double));
+
+    if (proposal) {
 
-      Rprintf("* predicting observation %d conditional on:\n", i + 1);
-      PrintValue(evidence);
+      ais_reset(plan, proposal[t], tfixed);
+      ais_learn(plan, proposal[t], tfixed, tcols, nsims, twgt, nupdates, &trng,
+        warn + t * nnodes, debugging);
+      ais_sample(plan, proposal[t], tfixed, tcols, nsims, twgt, &trng,
+        warn + t * nnodes);
 
     }/*THEN*/
+    else {
+
+      for (int l = 0; l < nnodes; l++) {
+
+        int c = (*plan).poset[l];
+
+        if (!affected[c])
+          continue;
+
+        rbn_node(plan, tcols, tfixed, c, 0, nsims, &trng, warn + t * nnodes);
+
+        if (tfixed[c].n > 0)
+          lw_logdensity(plan, tcols, c, nsims, twgt);
+
+      }/*FOR*/
+
+    }/*ELSE*/
 
-    /* generate samples from the conditional posterior distribution. */
-    c_rbn_master(fitted, cpdist, n, evidence, FALSE);
-    /* compute the weights. */
-    c_lw_weights(fitted, cpdist, nsims, wgt, from, FALSE);
+    lw_rescale(twgt, nsims);
+
+    if (debugging && proposal)
+      Rprintf("  > effective sample size %.2lf.\n", ais_ess(twgt, nsims));
 
     /* compute the posterior estimate. */
-    switch(TYPEOF(predicted)) {
+    if (pres_real) {
 
-      case REALSXP:
+      /* average the predicted values. */
+      pres_real[p] = posterior_mean((double *)tcols[target], twgt, nsims,
+                       pdrop + p, debugging);
 
-        /* average the predicted values. */
-        ((double *)res)[i] = posterior_mean((double *)pred, wgt, nsims,
-                               &drop, debugging);
-        break;
+    }/*THEN*/
+    else {
 
-      case INTSXP:
+      long double *tcounts = lvls_counts + t * nlvls, tot = 0;
 
-        /* pick the most frequent value. */
-        ((int *)res)[i] = posterior_mode((int *)pred, wgt, nsims, lvls_counts,
-                            lvls, nlvls, &drop, debugging);
+      /* pick the most frequent value. */
+      pres_int[p] = posterior_mode((int *)tcols[target], twgt, nsims,
+                      tcounts, lvls, nlvls, pdrop + p, debugging);
 
-        /* compute the posterior probabilities on the right scale, to attach
-         * them to the return value. */
-        if (include_prob) {
+      /* compute the posterior probabilities on the right scale, to attach
+       * them to the return value. */
+      if (pprob) {
 
-          for (j = 0, lvls_tot = 0; j < nlvls; j++) {
+        for (int l = 0; l < nlvls; l++)
+          tot += tcounts[l];
+        for (int l = 0; l < nlvls; l++)
+          pprob[(size_t)p * nlvls + l] = tcounts[l] / tot;
 
-            pt[CMC(j, i, nlvls)] = lvls_counts[j];
-            lvls_tot += lvls_counts[j];
+      }/*THEN*/
 
-          }/*FOR*/
+    }/*ELSE*/
+
+  }/*FOR*/
 
-          for (j = 0; j < nlvls; j++)
-            pt[CMC(j, i, nlvls)] /= lvls_tot;
+  /* copy the predictions to all the observations with the same evidence. */
+  for (i = 0; i < nobs; i++) {
 
-        }/*THEN*/
+    if (pres_real)
+      ((double *)res)[i] = pres_real[pattern[i]];
+    else
+      ((int *)res)[i] = pres_int[pattern[i]];
 
-        break;
+    if (pprob)
+      for (j = 0; j < nlvls; j++)
+        pt[CMC(j, i, nlvls)] = pprob[(size_t)pattern[i] * nlvls + j];
 
-    }/*SWITCH*/
+    drop += pdrop[pattern[i]];
 
   }/*FOR*/
 
   /* deallocate here to avoid leaking memory if warnings are errors. */
+  for (i = 0; i < nnodes; i++) {
+
+    if (affected[i])
+      for (k = 0; k < nthreads; k++)
+        Free1D(cols[k * nnodes + i]);
+    else
+      Free1D(shared[i]);
+
+  }/*FOR*/
+  for (k = 0; k < nthreads; k++) {
+
+    for (j = 0; j < nev; j++) {
+
+      Free1D(fixed[k * nnodes + evnode[j]].levels);
+      Free1D(fixed[k * nnodes + evnode[j]].values);
+
+    }/*FOR*/
+
+  }/*FOR*/
+  if (proposal)
+    for (k = 0; k < nthreads; k++)
+      FreeAIS(proposal[k]);
+  Free1D(proposal);
+  Free1D(shared);
+  Free1D(cols);
+  Free1D(fixed);
+  Free1D(warn);
+  Free1D(wgt);
+  Free1D(lvls_counts);
+  Free1D(affected);
+  Free1D(pattern);
+  Free1D(first);
+  Free1D(pdrop);
+  Free1D(pres_int);
+  Free1D(pres_real);
+  Free1D(pprob);
   Free1D(vartypes);
   Free1D(varptrs);
-  Free1D(evptrs);
-  Free1D(wgt);
-  if (TYPEOF(result) == INTSXP)
-    Free1D(lvls_counts);
+  Free1D(evnode);
 
   if (drop > 0)
     warning("dropping %d observations because generated samples are NAs.", drop);
@@ -262,16 +516,15 @@ bool debugging = isTRUE(debug), include_prob = isTRUE(prob);
     /* add the posterior probabilities to the return value. */
     setAttrib(result, BN_ProbSymbol, probtab);
 
-    UNPROTECT(5);
+    UNPROTECT(4);
 
   }/*THEN*/
   else {
 
-    UNPROTECT(4);
+    UNPROTECT(3);
 
   }/*ELSE*/
 
   return result;
 
 }/*MAPPRED*/
-
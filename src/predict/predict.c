@@ -9,6 +9,9 @@
 #include "../fitted/fitted.h"
 #include "../core/data.table.h"
 #include "../math/linear.algebra.h"
+#include "../include/parallel.h"
+#include "../core/random.streams.h"
+#include "compiled.predictor.h"
 
 /* predict the value of a gaussian node without parents. */
 SEXP gpred(SEXP fitted, SEXP ndata, SEXP debug) {
@@ -88,31 +91,18 @@ gdata dt = { 0 };
 SEXP dpred(SEXP fitted, SEXP ndata, SEXP prob, SEXP debug) {
 
 int i = 0, nmax = 0, n = INT(ndata), length = 0;
-int *iscratch = NULL, *maxima = NULL, tr_nlevels = 0, *res = NULL;
-double *cpt = NULL, *dscratch = NULL, *buf = NULL, *pt = NULL;
+int *maxima = NULL, tr_nlevels = 0, *res = NULL;
+double *cpt = NULL, *pt = NULL;
 bool debugging = isTRUE(debug), include_prob = isTRUE(prob);
-SEXP ptab, result, tr_levels, probtab = R_NilValue;
+SEXP result, tr_levels, probtab = R_NilValue;
+dmode_plan *plan = NULL;
 
-  /* get the probabilities of the multinomial distribution. */
-  ptab = getListElement(fitted, "prob");
-  length = length(ptab);
-  cpt = REAL(ptab);
-
-  /* create the vector of indexes. */
-  iscratch = Calloc1D(length, sizeof(int));
-  for (i = 0; i < length; i++)
-    iscratch[i] = i + 1;
-
-  /* create a scratch copy of the array. */
-  buf = Calloc1D(length, sizeof(double));
-  dscratch = Calloc1D(length, sizeof(double));
-  memcpy(dscratch, cpt, length * sizeof(double));
-
-  /* allocate the array for the indexes of the maxima. */
-  maxima = Calloc1D(length, sizeof(int));
-
-  /* find out the mode(s). */
-  nmax = all_max(dscratch, length, maxima, iscratch, buf);
+  /* get the mode(s) of the multinomial distribution. */
+  plan = compiled_discrete_predictor(fitted);
+  length = (*plan).nlevels;
+  cpt = (*plan).cpt;
+  nmax = (*plan).nmax[0];
+  maxima = (*plan).maxima;
 
   /* allocate and initialize the return value. */
   PROTECT(result = node2df(fitted, n));
@@ -146,7 +136,7 @@ SEXP ptab, result, tr_levels, probtab = R_NilValue;
           CHAR(STRING_ELT(tr_levels, res[0] - 1)));
 
       Rprintf("  ");
-      for (i = 0; i < length(ptab); i++)
+      for (i = 0; i < length; i++)
         Rprintf("  %lf", cpt[i]);
       Rprintf("\n");
 
@@ -188,78 +178,34 @@ SEXP ptab, result, tr_levels, probtab = R_NilValue;
 
   }/*ELSE*/
 
-  Free1D(iscratch);
-  Free1D(buf);
-  Free1D(dscratch);
-  Free1D(maxima);
-
   return result;
 
 }/*DPRED*/
 
-/* predict the value of a discrete node with one or more parents. */
-SEXP cdpred(SEXP fitted, SEXP parents, SEXP prob, SEXP debug) {
-
-int i = 0, k = 0, n = length(parents), nrow = 0, ncol = 0, tr_nlevels = 0;
-int *configs = INTEGER(parents);
-int *iscratch = NULL, *maxima = NULL, *nmax = NULL, *res = NULL;
-double *cpt = NULL, *dscratch = NULL, *buf = NULL, *pt = NULL;
-bool debugging = isTRUE(debug), include_prob = isTRUE(prob);
-SEXP temp, result, tr_levels, probtab = R_NilValue;
-
-  /* get the probabilities of the multinomial distribution. */
-  temp = getListElement(fitted, "prob");
-  nrow = INT(getAttrib(temp, R_DimSymbol));
-  ncol = length(temp) / nrow;
-  cpt = REAL(temp);
+/* number of observations predicted using each random stream in parallel mode;
+ * it must not depend on the number of threads for tie breaking to be
+ * reproducible. */
+#define PRED_CHUNK 4096
 
-  /* create the vector of indexes. */
-  iscratch = Calloc1D(nrow, sizeof(int));
+/* draw from R's random number generator or from a random stream. */
+static inline double pred_unif(rng_stream *rng) {
 
-  /* create a scratch copy of the array. */
-  buf = Calloc1D(nrow, sizeof(double));
-  dscratch = Calloc1D(nrow * ncol, sizeof(double));
-  memcpy(dscratch, cpt, nrow * ncol * sizeof(double));
+  return rng ? rng_stream_unif(rng) : unif_rand();
 
-  /* allocate the array for the indexes of the maxima. */
-  maxima = Calloc1D(nrow * ncol, sizeof(int));
-
-  /* allocate the maxima counters. */
-  nmax = Calloc1D(ncol, sizeof(int));
-
-  /* get the mode for each configuration. */
-  for (i = 0; i < ncol; i++) {
-
-    /* initialize the vector of indexes. */
-    for (k = 0; k < nrow; k++)
-      iscratch[k] = k + 1;
+}/*PRED_UNIF*/
 
-    /* find out the mode(s). */
-    nmax[i] = all_max(dscratch + i * nrow, nrow, maxima + i * nrow,
-                iscratch, buf);
-
-  }/*FOR*/
-
-  /* allocate and initialize the return value. */
-  PROTECT(result = node2df(fitted, n));
-  res = INTEGER(result);
-  /* copy the levels for use in debuggging. */
-  tr_levels = getAttrib(result, R_LevelsSymbol);
-  tr_nlevels = length(tr_levels);
-
-  /* allocate and initialize the table of the prediction probabilities. */
-  if (include_prob) {
-
-    PROTECT(probtab = allocMatrix(REALSXP, tr_nlevels, n));
-    pt = REAL(probtab);
+/* predict the observations from..(to - 1) of a discrete node with one or more
+ * parents, breaking ties at random. */
+static void cdpred_kernel(dmode_plan *plan, int *configs, int *res, double *pt,
+    SEXP tr_levels, int from, int to, rng_stream *rng, bool debugging) {
 
-  }/*THEN*/
+int i = 0, k = 0, cfg = 0, nrow = (*plan).nlevels;
+int *nmax = (*plan).nmax, *maxima = (*plan).maxima;
+double *cpt = (*plan).cpt;
 
-  /* initialize the random seed, just in case we need it for tie breaking. */
-  GetRNGstate();
+  for (i = from; i < to; i++) {
 
-  /* copy the index of the mode in the return value. */
-  for (i = 0; i < n; i++) {
+    cfg = (configs[i] == NA_INTEGER) ? 0 : configs[i] - 1;
 
     if (configs[i] == NA_INTEGER) {
 
@@ -269,7 +215,7 @@ SEXP temp, result, tr_levels, probtab = R_NilValue;
         Rprintf("  > prediction for observation %d is NA because at least one parent is NA.\n", i + 1);
 
     }/*THEN*/
-    else if (nmax[configs[i] - 1] == 0) {
+    else if (nmax[cfg] == 0) {
 
       res[i] = NA_INTEGER;
 
@@ -277,9 +223,9 @@ SEXP temp, result, tr_levels, probtab = R_NilValue;
         Rprintf("  > prediction for observation %d is NA because the probabilities are missing.\n", i + 1);
 
     }/*THEN*/
-    else if (nmax[configs[i] - 1] == 1) {
+    else if (nmax[cfg] == 1) {
 
-      res[i] = maxima[CMC(0, configs[i] - 1, nrow)];
+      res[i] = maxima[CMC(0, cfg, nrow)];
 
       if (debugging) {
 
@@ -290,8 +236,8 @@ SEXP temp, result, tr_levels, probtab = R_NilValue;
             i + 1, CHAR(STRING_ELT(tr_levels, res[i] - 1)));
 
         Rprintf("  ");
-        for (int k = 0; k < nrow; k++)
-          Rprintf("  %lf", (cpt + nrow * (configs[i] - 1))[k]);
+        for (k = 0; k < nrow; k++)
+          Rprintf("  %lf", (cpt + nrow * cfg)[k]);
         Rprintf("\n");
 
       }/*THEN*/
@@ -300,15 +246,15 @@ SEXP temp, result, tr_levels, probtab = R_NilValue;
     else {
 
       /* break ties: sample with replacement from all the maxima. */
-      SampleReplace(1, nmax[configs[i] - 1], res + i, maxima + (configs[i] - 1) * nrow);
+      res[i] = maxima[CMC((int)((double)nmax[cfg] * pred_unif(rng)), cfg, nrow)];
 
       if (debugging) {
 
         Rprintf("  > there are %d levels tied for prediction of observation %d, applying tie breaking.\n",
-          nmax[configs[i] - 1], i + 1);
+          nmax[cfg], i + 1);
         Rprintf("  > tied levels are:");
-        for (k = 0; k < nmax[configs[i] - 1]; k++)
-          Rprintf(" %s", CHAR(STRING_ELT(tr_levels, maxima[CMC(k, configs[i] - 1, nrow)] - 1)));
+        for (k = 0; k < nmax[cfg]; k++)
+          Rprintf(" %s", CHAR(STRING_ELT(tr_levels, maxima[CMC(k, cfg, nrow)] - 1)));
         Rprintf(".\n");
 
       }/*THEN*/
@@ -316,15 +262,82 @@ SEXP temp, result, tr_levels, probtab = R_NilValue;
     }/*ELSE*/
 
     /* attach the prediction probabilities to the return value. */
-    if (include_prob) {
+    if (pt) {
 
-      memcpy(pt + i * tr_nlevels, cpt + nrow * (configs[i] - 1),
-        tr_nlevels * sizeof(double));
+      if (configs[i] == NA_INTEGER)
+        for (k = 0; k < nrow; k++)
+          pt[(size_t)i * nrow + k] = NA_REAL;
+      else
+        memcpy(pt + (size_t)i * nrow, cpt + nrow * cfg, nrow * sizeof(double));
 
     }/*THEN*/
 
   }/*FOR*/
 
+}/*CDPRED_KERNEL*/
+
+/* predict the value of a discrete node with one or more parents. */
+SEXP cdpred(SEXP fitted, SEXP parents, SEXP prob, SEXP parallel, SEXP debug) {
+
+int n = length(parents), nchunks = 0, nthreads = 1, tr_nlevels = 0;
+int *configs = INTEGER(parents), *res = NULL;
+uint32_t key[2] = { 0, 0 };
+double *pt = NULL;
+bool debugging = isTRUE(debug), include_prob = isTRUE(prob);
+SEXP result, tr_levels, probtab = R_NilValue;
+dmode_plan *plan = NULL;
+
+  /* get the mode(s) of each conditional distribution in the CPT, which are
+   * computed only once for each local distribution. */
+  plan = compiled_discrete_predictor(fitted);
+
+  /* allocate and initialize the return value. */
+  PROTECT(result = node2df(fitted, n));
+  res = INTEGER(result);
+  /* copy the levels for use in debuggging. */
+  tr_levels = getAttrib(result, R_LevelsSymbol);
+  tr_nlevels = length(tr_levels);
+
+  /* allocate the table of the prediction probabilities, which is filled in
+   * place. */
+  if (include_prob) {
+
+    PROTECT(probtab = allocMatrix(REALSXP, tr_nlevels, n));
+    pt = REAL(probtab);
+
+  }/*THEN*/
+
+  /* initialize the random seed, just in case we need it for tie breaking. */
+  GetRNGstate();
+
+  if (!isTRUE(parallel)) {
+
+    cdpred_kernel(plan, configs, res, pt, tr_levels, 0, n, NULL, debugging);
+
+  }/*THEN*/
+  else {
+
+    /* split the observations into chunks, each breaking ties with its own
+     * random stream keyed on R's random seed. */
+    rng_stream_key(key);
+    nchunks = (n + PRED_CHUNK - 1) / PRED_CHUNK;
+    nthreads = debugging ? 1 : MAX_THREADS;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+    for (int c = 0; c < nchunks; c++) {
+
+      rng_stream rng;
+
+      rng_stream_init(&rng, key, (uint64_t)c);
+      cdpred_kernel(plan, configs, res, pt, tr_levels, c * PRED_CHUNK,
+        MIN(n, (c + 1) * PRED_CHUNK), &rng, debugging);
+
+    }/*FOR*/
+
+  }/*ELSE*/
+
   /* save the state of the random number generator. */
   PutRNGstate();
 
@@ -344,41 +357,18 @@ SEXP temp, result, tr_levels, probtab = R_NilValue;
 
   }/*ELSE*/
 
-  Free1D(iscratch);
-  Free1D(buf);
-  Free1D(dscratch);
-  Free1D(maxima);
-  Free1D(nmax);
-
   return result;
 
 }/*CDPRED*/
 
-/* predict the values of a conditional Gaussian node. */
-SEXP ccgpred(SEXP fitted, SEXP configurations, SEXP parents, SEXP debug) {
+/* predict the observations from..(to - 1) of a conditional Gaussian node. */
+static void ccgpred_kernel(double *beta, gdata dt, int *config, double *res,
+    int from, int to, bool debugging) {
 
-int i = 0, j = 0, cur_config = 0;
-int *config = INTEGER(configurations);
-double *res = NULL, *beta = NULL, *beta_offset = NULL;
-bool debugging = isTRUE(debug);
-SEXP result;
-gdata dt = { 0 };
-
-  /* get the regression coefficients of the conditional Gaussian distribution. */
-  beta = REAL(getListElement(fitted, "coefficients"));
-  /* extract the columns of the data frame. */
-  dt = gdata_from_SEXP(parents, 0);
-
-  /* if there are no continuous parents the data table is empty; reset the
-   * sample size using the discrete parents configurations for consistency. */
-  if ((dt.m.nobs == 0) && (dt.m.ncols == 0))
-    dt.m.nobs = length(configurations);
-
-  /* allocate the return value. */
-  PROTECT(result = allocVector(REALSXP, dt.m.nobs));
-  res = REAL(result);
+int i = 0, j = 0;
+double *beta_offset = NULL;
 
-  for (i = 0; i < dt.m.nobs; i++)  {
+  for (i = from; i < to; i++)  {
 
     /* is the configuration of the discrete parents defined? */
     if (config[i] == NA_INTEGER) {
@@ -389,8 +379,7 @@ gdata dt = { 0 };
     }/*THEN*/
 
     /* find out which conditional regression to use for prediction. */
-    cur_config = config[i] - 1;
-    beta_offset = beta + cur_config * (dt.m.ncols + 1);
+    beta_offset = beta + (config[i] - 1) * (dt.m.ncols + 1);
 
     /* compute the mean value for this observation. */
     res[i] = beta_offset[0];
@@ -412,108 +401,83 @@ gdata dt = { 0 };
 
   }/*FOR*/
 
-  UNPROTECT(1);
-
-  FreeGDT(dt);
-
-  return result;
-
-}/*CCGPRED*/
-
-/* predict the value of the training variable in a naive Bayes or Tree-Augmented
- * naive Bayes classifier. */
-SEXP naivepred(SEXP fitted, SEXP data, SEXP parents, SEXP training, SEXP prior,
-    SEXP prob, SEXP debug) {
-
-int i = 0, j = 0, k = 0, n = 0, nvars = length(fitted), nmax = 0, tr_nlevels = 0;
-int *res = NULL, **ex = NULL, *ex_nlevels = NULL;
-int idx = 0, *tr_id = INTEGER(training);
-int *iscratch = NULL, *maxima = NULL, *prn = NULL;
-bool debugging = isTRUE(debug), include_prob = isTRUE(prob);
-bool incomplete_observation = FALSE;
-double **cpt = NULL, *pr = NULL, *scratch = NULL, *buf = NULL, *pt = NULL;
-double sum = 0;
-SEXP temp, tr, tr_levels, tr_node, result, nodes, probtab = R_NilValue;
-
-  /* cache the node labels. */
-  PROTECT(nodes = getAttrib(fitted, R_NamesSymbol));
-
-  /* cache the pointers to all the variables. */
-  ex = (int **) Calloc1D(nvars, sizeof(int *));
-  ex_nlevels = Calloc1D(nvars, sizeof(int));
+}/*CCGPRED_KERNEL*/
 
-  for (i = 0; i < nvars; i++) {
+/* predict the values of a conditional Gaussian node. */
+SEXP ccgpred(SEXP fitted, SEXP configurations, SEXP parents, SEXP parallel,
+    SEXP debug) {
 
-    if (i == *tr_id - 1)
-      continue;
+int nchunks = 0, nthreads = 1, *config = INTEGER(configurations);
+double *res = NULL, *beta = NULL;
+bool debugging = isTRUE(debug);
+SEXP result;
+gdata dt = { 0 };
 
-    temp = VECTOR_ELT(data, i);
-    ex[i] = INTEGER(temp);
-    ex_nlevels[i] = NLEVELS(temp);
+  /* get the regression coefficients of the conditional Gaussian distribution. */
+  beta = REAL(getListElement(fitted, "coefficients"));
+  /* extract the columns of the data frame. */
+  dt = gdata_from_SEXP(parents, 0);
 
-  }/*FOR*/
+  /* if there are no continuous parents the data table is empty; reset the
+   * sample size using the discrete parents configurations for consistency. */
+  if ((dt.m.nobs == 0) && (dt.m.ncols == 0))
+    dt.m.nobs = length(configurations);
 
-  /* get the training variable and its levels. */
-  n = length(VECTOR_ELT(data, (*tr_id - 1 != 0) ? 0 : 1));
-  tr_node = VECTOR_ELT(fitted, *tr_id - 1);
-  tr = getListElement(tr_node, "prob");
-  tr_levels = VECTOR_ELT(getAttrib(tr, R_DimNamesSymbol), 0);
-  tr_nlevels = length(tr_levels);
-  /* get the prior distribution. */
-  pr = REAL(prior);
+  /* allocate the return value. */
+  PROTECT(result = allocVector(REALSXP, dt.m.nobs));
+  res = REAL(result);
 
-  if (debugging) {
+  if (!isTRUE(parallel)) {
 
-    Rprintf("* the prior distribution for the target variable is:\n");
-    PrintValue(prior);
+    ccgpred_kernel(beta, dt, config, res, 0, dt.m.nobs, debugging);
 
   }/*THEN*/
+  else {
 
-  /* allocate the scratch space used to compute posterior probabilities. */
-  scratch = Calloc1D(tr_nlevels, sizeof(double));
-  buf = Calloc1D(tr_nlevels, sizeof(double));
-
-  /* cache the pointers to the conditional probability tables. */
-  cpt = (double **) Calloc1D(nvars, sizeof(double *));
-
-  for (i = 0; i < nvars; i++)
-    cpt[i] = REAL(getListElement(VECTOR_ELT(fitted, i), "prob"));
-
-  /* dereference the parents' vector. */
-  prn = INTEGER(parents);
+    nchunks = (dt.m.nobs + PRED_CHUNK - 1) / PRED_CHUNK;
+    nthreads = debugging ? 1 : MAX_THREADS;
 
-  /* create the vector of indexes. */
-  iscratch = Calloc1D(tr_nlevels, sizeof(int));
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+    for (int c = 0; c < nchunks; c++)
+      ccgpred_kernel(beta, dt, config, res, c * PRED_CHUNK,
+        MIN(dt.m.nobs, (c + 1) * PRED_CHUNK), debugging);
 
-  /* allocate the array for the indexes of the maxima. */
-  maxima = Calloc1D(tr_nlevels, sizeof(int));
+  }/*ELSE*/
 
-  /* allocate the return value. */
-  PROTECT(result = allocVector(INTSXP, n));
-  res = INTEGER(result);
+  UNPROTECT(1);
 
-  /* allocate and initialize the table of the posterior probabilities. */
-  if (include_prob) {
+  FreeGDT(dt);
 
-    PROTECT(probtab = allocMatrix(REALSXP, tr_nlevels, n));
-    pt = REAL(probtab);
-    memset(pt, '\0', n * tr_nlevels * sizeof(double));
+  return result;
 
-  }/*THEN*/
+}/*CCGPRED*/
 
-  /* initialize the random seed, just in case we need it for tie breaking. */
-  GetRNGstate();
+/* predict the observations from..(to - 1) of the training variable in a naive
+ * Bayes or Tree-Augmented naive Bayes classifier, breaking ties at random; the
+ * scratch spaces hold one value for each level of the training variable. */
+static void naivepred_kernel(naive_plan *plan, int **ex, int *res, double *pt,
+    double *scratch, double *buf, int *iscratch, int *maxima, SEXP tr_levels,
+    SEXP nodes, int from, int to, rng_stream *rng, bool debugging) {
+
+int i = 0, j = 0, k = 0, x = 0, z = 0, idx = 0, nmax = 0;
+int nvars = (*plan).nvars, tr = (*plan).target, tr_nlevels = (*plan).nlevels;
+int *nx = (*plan).nx, *prn = (*plan).parents;
+double **cpt = (*plan).cpt, **logtab = (*plan).logtab, *row = NULL, sum = 0;
+bool incomplete_observation = FALSE;
 
   /* for each observation... */
-  for (i = 0; i < n; i++) {
+  for (i = from; i < to; i++) {
 
     /* ... check that it is a complete observation... */
     incomplete_observation = FALSE;
+    nmax = 0;
 
     for (j = 0; j < nvars; j++) {
 
       /* (skip the training variable...) */
-      if (*tr_id == j + 1)
+      if (j == tr)
         continue;
 
       if (ex[j][i] == NA_INTEGER) {
@@ -533,7 +497,7 @@ SEXP temp, tr, tr_levels, tr_node, result, nodes, probtab = R_NilValue;
     /* ... reset the scratch space and the indexes array... */
     for (k = 0; k < tr_nlevels; k++) {
 
-      scratch[k] = log(pr[k]);
+      scratch[k] = (*plan).logprior[k];
       iscratch[k] = k + 1;
 
     }/*FOR*/
@@ -545,53 +509,40 @@ SEXP temp, tr, tr_levels, tr_node, result, nodes, probtab = R_NilValue;
     for (j = 0; j < nvars; j++) {
 
       /* ... skip the training variable... */
-      if (*tr_id == j + 1)
+      if (j == tr)
         continue;
 
-      /* ... (this is the root node of the Chow-Liu tree) ... */
-      if (prn[j] == NA_INTEGER) {
+      /* ... look up the log-probabilities of the observed value given each
+       * level of the training variable (and the value of the only other
+       * parent, unless this is the root node of the Chow-Liu tree)... */
+      x = ex[j][i] - 1;
+      z = (prn[j] == NA_INTEGER) ? 0 : ex[prn[j] - 1][i] - 1;
+      row = logtab[j] + ((size_t)x + (size_t)z * nx[j]) * tr_nlevels;
+
+      if (debugging) {
 
-        /* ... and for each row of the conditional probability table... */
         for (k = 0; k < tr_nlevels; k++) {
 
-          if (debugging) {
+          /* (the first dimension corresponds to the current node [X], the
+           * second to the training node [Y], the third to the only parent of
+           * the current node [Z]; CMC coordinates are computed as
+           * X + Y * NX + Z * NX * NY. */
+          idx = x + k * nx[j] + z * nx[j] * tr_nlevels;
 
+          if (prn[j] == NA_INTEGER)
             Rprintf("  > node %s: picking cell %d (%d, %d) from the CPT (p = %lf).\n",
-              NODE(j), CMC(ex[j][i] - 1, k, ex_nlevels[j]), ex[j][i], k + 1,
-              cpt[j][CMC(ex[j][i] - 1, k, ex_nlevels[j])]);
-
-          }/*THEN*/
-
-          /* ... update the posterior probability. */
-          scratch[k] += log(cpt[j][CMC(ex[j][i] - 1, k, ex_nlevels[j])]);
+              NODE(j), idx, x + 1, k + 1, cpt[j][idx]);
+          else
+            Rprintf("  > node %s: picking cell %d (%d, %d, %d) from the CPT (p = %lf).\n",
+              NODE(j), idx, x + 1, k + 1, z + 1, cpt[j][idx]);
 
         }/*FOR*/
 
       }/*THEN*/
-      else {
-
-        /* ... and for each row of the conditional probability table... */
-        for (k = 0; k < tr_nlevels; k++) {
 
-          /* (the first dimension corresponds to the current node [X], the second
-           * to the training node [Y], the third to the only parent of the current
-           * node [Z]; CMC coordinates are computed as X + Y * NX + Z * NX * NY. */
-          idx = (ex[j][i] - 1) + k * ex_nlevels[j] +
-                  (ex[prn[j] - 1][i] - 1) * ex_nlevels[j] * tr_nlevels;
-
-          if (debugging) {
-
-            Rprintf("  > node %s: picking cell %d (%d, %d, %d) from the CPT (p = %lf).\n",
-              NODE(j), idx, ex[j][i], k + 1, ex[prn[j] - 1][i], cpt[j][idx]);
-
-          }/*THEN*/
-
-          /* ... update the posterior probability. */
-          scratch[k] += log(cpt[j][idx]);
-
-        }/*FOR*/
-
-      }/*ELSE*/
+      /* ... and update the posterior probabilities. */
+      for (k = 0; k < tr_nlevels; k++)
+        scratch[k] += row[k];
 
     }/*FOR*/
 
@@ -601,19 +552,22 @@ SEXP temp, tr, tr_levels, tr_node, result, nodes, probtab = R_NilValue;
 wrap_up:
 
     /* compute the posterior probabilities on the right scale, to attach them
-     * to the return value. */
-    if (include_prob) {
+     * to the return value (they are missing if there is no mode). */
+    if (pt && (nmax == 0)) {
+
+      memcpy(pt + (size_t)i * tr_nlevels, scratch, tr_nlevels * sizeof(double));
 
-      /* copy the log-probabilities from scratch. */
-      memcpy(pt + i * tr_nlevels, scratch, tr_nlevels * sizeof(double));
+    }/*THEN*/
+    else if (pt) {
 
-      /* transform log-probabilities into plain probabilities. */
+      /* transform log-probabilities into plain probabilities... */
       for (k = 0, sum = 0; k < tr_nlevels; k++)
-        sum += pt[i * tr_nlevels + k] = exp(pt[i * tr_nlevels + k] - scratch[maxima[0] - 1]);
+        sum += pt[(size_t)i * tr_nlevels + k] =
+                 exp(scratch[k] - scratch[maxima[0] - 1]);
 
-      /* rescale them to sum up to 1. */
+      /* ... and rescale them to sum up to 1. */
       for (k = 0; k < tr_nlevels; k++)
-        pt[i * tr_nlevels + k] /= sum;
+        pt[(size_t)i * tr_nlevels + k] /= sum;
 
     }/*THEN*/
 
@@ -653,7 +607,7 @@ wrap_up:
     else {
 
       /* break ties: sample with replacement from all the maxima. */
-      SampleReplace(1, nmax, res + i, maxima);
+      res[i] = maxima[(int)((double)nmax * pred_unif(rng))];
 
       if (debugging) {
 
@@ -675,6 +629,111 @@ wrap_up:
 
   }/*FOR*/
 
+}/*NAIVEPRED_KERNEL*/
+
+/* predict the value of the training variable in a naive Bayes or Tree-Augmented
+ * naive Bayes classifier. */
+SEXP naivepred(SEXP fitted, SEXP data, SEXP parents, SEXP training, SEXP prior,
+    SEXP prob, SEXP parallel, SEXP debug) {
+
+int i = 0, n = 0, nvars = length(fitted), tr_nlevels = 0, *tr_id = INTEGER(training);
+int nchunks = 0, nthreads = 1, *res = NULL, **ex = NULL;
+int *iscratch = NULL, *maxima = NULL;
+uint32_t key[2] = { 0, 0 };
+bool debugging = isTRUE(debug), include_prob = isTRUE(prob);
+double *scratch = NULL, *buf = NULL, *pt = NULL;
+SEXP tr, tr_levels, tr_node, result, nodes, probtab = R_NilValue;
+naive_plan *plan = NULL;
+
+  /* cache the node labels. */
+  PROTECT(nodes = getAttrib(fitted, R_NamesSymbol));
+
+  /* cache the pointers to all the variables. */
+  ex = (int **) Calloc1D(nvars, sizeof(int *));
+
+  for (i = 0; i < nvars; i++) {
+
+    if (i == *tr_id - 1)
+      continue;
+
+    ex[i] = INTEGER(VECTOR_ELT(data, i));
+
+  }/*FOR*/
+
+  /* get the training variable and its levels. */
+  n = length(VECTOR_ELT(data, (*tr_id - 1 != 0) ? 0 : 1));
+  tr_node = VECTOR_ELT(fitted, *tr_id - 1);
+  tr = getListElement(tr_node, "prob");
+  tr_levels = VECTOR_ELT(getAttrib(tr, R_DimNamesSymbol), 0);
+  tr_nlevels = length(tr_levels);
+
+  if (debugging) {
+
+    Rprintf("* the prior distribution for the target variable is:\n");
+    PrintValue(prior);
+
+  }/*THEN*/
+
+  /* get the log-probability tables and the log-prior of the classifier, which
+   * are computed only once for each classifier and prior. */
+  plan = compiled_naive_predictor(fitted, parents, training, prior);
+
+  /* allocate the scratch spaces used to compute posterior probabilities and to
+   * find their modes, one for each thread. */
+  if (isTRUE(parallel))
+    nthreads = debugging ? 1 : MAX_THREADS;
+
+  scratch = Calloc1D((size_t)nthreads * tr_nlevels, sizeof(double));
+  buf = Calloc1D((size_t)nthreads * tr_nlevels, sizeof(double));
+  iscratch = Calloc1D((size_t)nthreads * tr_nlevels, sizeof(int));
+  maxima = Calloc1D((size_t)nthreads * tr_nlevels, sizeof(int));
+
+  /* allocate the return value. */
+  PROTECT(result = allocVector(INTSXP, n));
+  res = INTEGER(result);
+
+  /* allocate the table of the posterior probabilities, which is filled in
+   * place. */
+  if (include_prob) {
+
+    PROTECT(probtab = allocMatrix(REALSXP, tr_nlevels, n));
+    pt = REAL(probtab);
+
+  }/*THEN*/
+
+  /* initialize the random seed, just in case we need it for tie breaking. */
+  GetRNGstate();
+
+  if (!isTRUE(parallel)) {
+
+    naivepred_kernel(plan, ex, res, pt, scratch, buf, iscratch, maxima,
+      tr_levels, nodes, 0, n, NULL, debugging);
+
+  }/*THEN*/
+  else {
+
+    /* split the observations into chunks, each breaking ties with its own
+     * random stream keyed on R's random seed. */
+    rng_stream_key(key);
+    nchunks = (n + PRED_CHUNK - 1) / PRED_CHUNK;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+    for (int c = 0; c < nchunks; c++) {
+
+      size_t offset = (size_t)THREAD_ID * tr_nlevels;
+      rng_stream rng;
+
+      rng_stream_init(&rng, key, (uint64_t)c);
+      naivepred_kernel(plan, ex, res, pt, scratch + offset, buf + offset,
+        iscratch + offset, maxima + offset, tr_levels, nodes, c * PRED_CHUNK,
+        MIN(n, (c + 1) * PRED_CHUNK), &rng, debugging);
+
+    }/*FOR*/
+
+  }/*ELSE*/
+
   /* save the state of the random number generator. */
   PutRNGstate();
 
@@ -714,10 +773,8 @@ wrap_up:
   }/*ELSE*/
 
   Free1D(ex);
-  Free1D(ex_nlevels);
   Free1D(scratch);
   Free1D(buf);
-  Free1D(cpt);
   Free1D(iscratch);
   Free1D(maxima);
 
@@ -0,0 +1,7 @@
+#ifndef PREDICT_HEADER
+#define PREDICT_HEADER
+
+int evidence_patterns(void **varptrs, int *vartypes, int nev, int nobs,
+    int *pattern, int *first);
+
+#endif
@@ -55,59 +55,116 @@ SEXP temp;
 double c_fast_ccgloglik(double *xx, double **gp, int ngp, int nobs,
     int *config, int nconfig) {
 
-int i = 0, j = 0;
-double res = 0, *fitted = NULL, *sd = NULL;
+int i = 0, *predictors = NULL;
+double res = 0, **data = NULL;
+strata_moments sm = { 0 };
 
-  /* allocate the fitted values and the standard error. */
-  fitted = Calloc1D(nobs, sizeof(double));
-  sd = Calloc1D((!config) ? 1 : nconfig, sizeof(double));
+  /* collect the continuous parents and the node (last) in the same table. */
+  data = Calloc1D(ngp + 1, sizeof(double *));
+  predictors = Calloc1D(ngp + 1, sizeof(int));
+  for (i = 0; i < ngp; i++) {
 
-  /* if the regression is conditional on config, iterate over its values,
-   * otherwise fit using the whole sample. */
-  if (!config) {
+    data[i] = gp[i];
+    predictors[i] = i;
 
-    c_ols(gp, xx, nobs, ngp, fitted, NULL, NULL, sd, NULL, FALSE);
+  }/*FOR*/
+  data[ngp] = xx;
 
-    /* compute the log-likelihood (singular models haze zero density). */
-    if (*sd < MACHINE_TOL)
-      res = R_NegInf;
-    else
-      for (j = 0; j < nobs; j++)
-        res += dnorm(xx[j], fitted[j], *sd, TRUE);
+  /* if the regression is conditional on config, fit one regression for each
+   * of its values, otherwise fit using the whole sample. */
+  sm = new_strata_moments((!config) ? 1 : nconfig, ngp + 1);
+  c_strata_moments(data, nobs, config, sm);
+  res = c_cgloglik_moments(sm, predictors, ngp, ngp);
 
-  }/*THEN*/
-  else {
+  FreeSMOMENTS(sm);
+  Free1D(predictors);
+  Free1D(data);
+
+  return res;
 
-    c_cls(gp, xx, config, nobs, ngp, nconfig, fitted, NULL, NULL, sd, NULL,
-      FALSE);
+}/*C_FAST_CCGLOGLIK*/
 
-    /* if any standard error is zero, the model is singular and has density
-     * zero. */
-    for (i = 0; i < nconfig; i++) {
+/* log-likelihood of the (conditional) linear regression of the response on the
+ * predictors, computed from the per-stratum moments without going back to the
+ * data. The residual sum of squares of each stratum is what is left of the
+ * variance of the response after eliminating the predictors from the matrix
+ * of centred cross-products; predictors that are constant or collinear with
+ * those eliminated before them are skipped, as the pivoting QR decomposition
+ * does. */
+double c_cgloglik_moments(strata_moments sm, int *predictors, int npred,
+    int response) {
 
-      if (sd[i] < MACHINE_TOL) {
+int i = 0, j = 0, k = 0, s = 0, m = npred + 1, d = sm.dim, *idx = NULL;
+double res = 0, rss = 0, sd = 0, pivot = 0;
+long double *cm = NULL, *work = NULL, *diag = NULL;
 
-        res = R_NegInf;
-        goto end;
+  idx = Calloc1D(m, sizeof(int));
+  work = Calloc1D(m * m, sizeof(long double));
+  diag = Calloc1D(m, sizeof(long double));
+  memcpy(idx, predictors, npred * sizeof(int));
+  idx[npred] = response;
 
-      }/*THEN*/
+  for (s = 0; s < sm.nstrata; s++) {
+
+    /* unobserved strata have no parameters and do not contribute. */
+    if (sm.n[s] == 0)
+      continue;
+
+    /* the standard error is zero if there are no residual degrees of freedom,
+     * and singular models have density zero. */
+    if (sm.n[s] <= m) {
+
+      res = R_NegInf;
+      break;
+
+    }/*THEN*/
+
+    /* extract the cross-products of the predictors and of the response. */
+    cm = sm.comoment + s * d * d;
+    for (i = 0; i < m; i++)
+      for (j = 0; j < m; j++)
+        work[CMC(i, j, m)] = (idx[i] <= idx[j]) ?
+          cm[CMC(idx[i], idx[j], d)] : cm[CMC(idx[j], idx[i], d)];
+    for (i = 0; i < m; i++)
+      diag[i] = work[CMC(i, i, m)];
+
+    /* eliminate the predictors one at a time. */
+    for (k = 0; k < npred; k++) {
+
+      pivot = work[CMC(k, k, m)];
+      if ((diag[k] < MACHINE_TOL) || (pivot < MACHINE_TOL * diag[k]))
+        continue;
+
+      for (j = k + 1; j < m; j++)
+        for (i = k + 1; i < m; i++)
+          work[CMC(i, j, m)] -= work[CMC(i, k, m)] * work[CMC(k, j, m)] / pivot;
 
     }/*FOR*/
 
-    /* if the model is not singular compute the log-likelihood. */
-    for (j = 0; j < nobs; j++)
-      res += dnorm(xx[j], fitted[j], sd[config[j] - 1], TRUE);
+    rss = work[CMC(npred, npred, m)];
+    if (rss < 0)
+      rss = 0;
+    sd = sqrt(rss / (sm.n[s] - m));
 
-  }/*ELSE*/
+    if (sd < MACHINE_TOL) {
 
-end:
+      res = R_NegInf;
+      break;
 
-  Free1D(fitted);
-  Free1D(sd);
+    }/*THEN*/
+
+    /* the sum of the log-densities of the residuals. */
+    res += - sm.n[s] * (M_LN_SQRT_2PI + log(sd)) - rss / (2 * sd * sd);
+
+  }/*FOR*/
+
+  Free1D(idx);
+  Free1D(work);
+  Free1D(diag);
 
   return res;
 
-}/*CCGLOGLIK*/
+}/*C_CGLOGLIK_MOMENTS*/
 
 double loglik_cgnode(SEXP target, SEXP x, SEXP data, double *nparams,
     int *np, bool debugging) {
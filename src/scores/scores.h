@@ -2,6 +2,7 @@
 #define NETWORK_SCORES_HEADER
 
 #include "../core/contingency.tables.h"
+#include "../core/moments.h"
 
 /* enum for scores, to be matched from the label string passed down from R. */
 typedef enum {
@@ -93,6 +94,8 @@ double predictive_loglik_gnode(SEXP target, SEXP x, SEXP data, SEXP newdata,
     double *nparams, bool debugging);
 double c_fast_ccgloglik(double *xx, double **gp, int ngp, int nobs, int *config,
     int nconfig);
+double c_cgloglik_moments(strata_moments sm, int *predictors, int npred,
+    int response);
 double loglik_gnode(SEXP target, SEXP x, SEXP data, double *nparams,
     int *nparents, bool debugging);
 double loglik_cgnode(SEXP target, SEXP x, SEXP data, double *nparams,
@@ -2,6 +2,7 @@
 #include "../../core/allocations.h"
 #include "../../scores/scores.h"
 #include "../../core/sets.h"
+#include "../../core/moments.h"
 #include "../../tests/tests.h"
 #include "../../core/correlation.h"
 
@@ -62,19 +63,38 @@ double lognum = 0, logden = 0, *mu = NULL, *sd = NULL;
 
 }/*C_MICG*/
 
-/* conditional mutual information, to be used in C code. */
+/* conditional mutual information, to be used in C code. The per-stratum
+ * moments of all the continuous variables are accumulated in a single pass
+ * over the data, and both the null and the alternative models are fitted from
+ * them. */
 double c_cmicg(double *yy, double **xx, int nx, int **zz, int nz, int *z0,
     int nz0, int *nlvls, int num, double *df) {
 
-double logden = 0, lognum = 0;
-int *z1 = NULL, nz1 = 0;
+int i = 0, *z1 = NULL, nz1 = 0, *predictors = NULL, *map = NULL;
+double logden = 0, lognum = 0, **data = NULL;
+bool nested = TRUE;
+strata_moments sm0 = { 0 }, sm1 = { 0 };
+
+  /* collect the continuous variables, with the response last. */
+  data = Calloc1D(nx + 1, sizeof(double *));
+  predictors = Calloc1D(nx + 1, sizeof(int));
+  for (i = 0; i < nx; i++) {
+
+    data[i] = xx[i];
+    predictors[i] = i;
+
+  }/*FOR*/
+  data[nx] = yy;
 
   if (!zz) {
 
+    sm0 = new_strata_moments((!z0) ? 1 : nz0, nx + 1);
+    c_strata_moments(data, num, z0, sm0);
+
     /* compute the denominator (model under the null). */
-    logden = c_fast_ccgloglik(yy, xx + 1, nx - 1, num, z0, nz0);
+    logden = c_cgloglik_moments(sm0, predictors + 1, nx - 1, nx);
     /* compute the numerator (model under the alternative). */
-    lognum = c_fast_ccgloglik(yy, xx, nx, num, z0, nz0);
+    lognum = c_cgloglik_moments(sm0, predictors, nx, nx);
 
     /* one regression coefficient for each conditioning level is added
      * (and there are no new standard errors since there are no new discrete
@@ -86,13 +106,42 @@ int *z1 = NULL, nz1 = 0;
   }/*THEN*/
   else {
 
-    /* compute the denominator (model under the null). */
-    logden = c_fast_ccgloglik(yy, xx, nx, num, z0, nz0);
-    /* compute the numerator (model under the alternative). */
     z1 = Calloc1D(num, sizeof(int));
     c_fast_config(zz, num, nz, nlvls, z1, &nz1, 1);
-    lognum = c_fast_ccgloglik(yy, xx, nx, num, z1, nz1);
+
+    sm1 = new_strata_moments(nz1, nx + 1);
+    c_strata_moments(data, num, z1, sm1);
+
+    /* when the strata of the alternative model are nested in those of the
+     * null model (as they are when zz includes the conditioning variables),
+     * pool the moments of the former to get those of the latter instead of
+     * going through the data again. */
+    map = Calloc1D(nz1, sizeof(int));
+    for (i = 0; i < nz1; i++)
+      map[i] = -1;
+    for (i = 0; (i < num) && nested; i++) {
+
+      if (map[z1[i] - 1] < 0)
+        map[z1[i] - 1] = (!z0) ? 0 : z0[i] - 1;
+      else
+        nested = (map[z1[i] - 1] == ((!z0) ? 0 : z0[i] - 1));
+
+    }/*FOR*/
+
+    sm0 = new_strata_moments((!z0) ? 1 : nz0, nx + 1);
+    if (nested)
+      strata_moments_collapse(sm1, map, sm0);
+    else
+      c_strata_moments(data, num, z0, sm0);
+
+    /* compute the denominator (model under the null). */
+    logden = c_cgloglik_moments(sm0, predictors, nx, nx);
+    /* compute the numerator (model under the alternative). */
+    lognum = c_cgloglik_moments(sm1, predictors, nx, nx);
+
     Free1D(z1);
+    Free1D(map);
+    FreeSMOMENTS(sm1);
 
     /* for each additional configuration of the discrete conditioning
      * variables plus the discrete yptr, one whole set of regression
@@ -103,6 +152,10 @@ int *z1 = NULL, nz1 = 0;
 
   }/*ELSE*/
 
+  FreeSMOMENTS(sm0);
+  Free1D(predictors);
+  Free1D(data);
+
   /* if the null model is singular, the alternative model is even more singular
    * so it should always be rejected. */
   return (R_FINITE(logden) && R_FINITE(lognum)) ? (lognum - logden) / num : 0;
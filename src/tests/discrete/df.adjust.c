@@ -53,7 +53,7 @@ double df = 0;
     case MI:
     case MI_SH:
     case X2:
-      df = (llx - 1) * (lly - 1) * llz;
+      df = (double)(llx - 1) * (double)(lly - 1) * (double)llz;
       break;
 
     /* adjust degrees of freedom: zeroes are considered structural if they
@@ -57,13 +57,15 @@ double c_cchisqtest(int *xx, int llx, int *yy, int lly, int *zz, int llz,
 double res = 0;
 counts3d joint = { 0 };
 
-  /* initialize the contingency table and the marginal frequencies. */
-  joint = new_3d_table(llx, lly, llz);
-  fill_3d_table(xx, yy, zz, &joint, num);
+  /* initialize the contingency table and the marginal frequencies, storing
+   * only the observed strata if most are empty. */
+  joint = new_filled_3d_table(xx, llx, yy, lly, zz, llz, num);
 
-  /* compute the degrees of freedom. */
+  /* compute the degrees of freedom: the adjusted ones only depend on the
+   * observed strata, the usual ones on all the possible strata. */
   if (df)
-    *df = discrete_cdf(test, joint.ni, joint.llx, joint.nj, joint.lly, joint.llz);
+    *df = discrete_cdf(test, joint.ni, joint.llx, joint.nj, joint.lly,
+            ((test == MI_ADF) || (test == X2_ADF)) ? joint.llz : llz);
 
   /* if there are no complete data points, return independence. */
   if (joint.nobs == 0)
@@ -72,7 +74,7 @@ counts3d joint = { 0 };
   /* if there are less than 5 observations per cell on average, assume the
    * test does not have enough power and return independence. */
   if ((test == MI_ADF) || (test == X2_ADF))
-    if (joint.nobs < 5 * joint.llx * joint.lly * joint.llz)
+    if (joint.nobs < 5 * (double)llx * (double)lly * (double)llz)
       goto free_and_return;
 
   /* compute the conditional mutual information or Pearson's X^2. */
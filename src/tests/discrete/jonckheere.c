@@ -48,9 +48,9 @@ int k = 0;
 double stat = 0, var = 0, tvar = 0;
 counts3d joint = { 0 };
 
-  /* initialize the contingency table and the marginal frequencies. */
-  joint = new_3d_table(llx, lly, llz);
-  fill_3d_table(xx, yy, zz, &joint, num);
+  /* initialize the contingency table and the marginal frequencies, storing
+   * only the observed strata if most are empty. */
+  joint = new_filled_3d_table(xx, llx, yy, lly, zz, llz, num);
 
   /* sum up over the parents' configurations. */
   for (k = 0; k < joint.llz; k++) {
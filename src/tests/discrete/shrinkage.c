@@ -39,7 +39,7 @@ double res = 0;
     goto free_and_return;
 
   /* estimate the optimal lambda for the data. */
-  mi_lambda((double *)n, &lambda, target, ncomplete, llx, lly, 0);
+  mi_lambda((double *)n, &lambda, target, ncomplete, llx, lly, 0, 0);
 
   /* switch to the probability scale and shrink the estimates. */
   for (i = 0; i < llx; i++)
@@ -78,14 +78,28 @@ free_and_return:
 double c_shcmi(int *xx, int llx, int *yy, int lly, int *zz, int llz,
     int num, double *df, int scale) {
 
-int i = 0, j = 0, k = 0, ncomplete = 0;
+int i = 0, j = 0, k = 0, ncomplete = 0, *strata = NULL, nstrata = llz;
 double ***n = NULL, **ni = NULL, **nj = NULL, *nk = NULL;
-double lambda = 0, target = 1/(double)(llx * lly * llz);
-double res = 0;
+double ncells = (double)llx * (double)lly * (double)llz;
+double lambda = 0, target = 1/ncells, res = 0;
 
   /* compute the degrees of freedom. */
   *df = (double)(llx - 1) * (double)(lly - 1) * (double)(llz);
 
+  /* if there are more strata than observations, only store the observed ones:
+   * the cells in the other strata are all equal to the target after shrinkage,
+   * so they do not contribute to the mutual information and their contribution
+   * to the shrinkage intensity is known in closed form. */
+  if (llz > num) {
+
+    strata = Calloc1D(num, sizeof(int));
+    nstrata = sparse_strata(zz, num, strata);
+    nstrata = (nstrata > 0) ? nstrata : 1;
+    zz = strata;
+
+  }/*THEN*/
+  llz = nstrata;
+
   /* initialize the contingency table and the marginal frequencies. */
   n = (double ***) Calloc3D(llx, lly, llz, sizeof(double));
   ni = (double **) Calloc2D(llx, llz, sizeof(double));
@@ -107,7 +121,8 @@ double res = 0;
     goto free_and_return;
 
   /* estimate the optimal lambda for the data. */
-  mi_lambda((double *)n, &lambda, target, ncomplete, llx, lly, llz);
+  mi_lambda((double *)n, &lambda, target, ncomplete, llx, lly, llz,
+    ncells - (double)llx * (double)lly * (double)llz);
 
   /* switch to the probability scale and shrink the estimates. */
   for (i = 0; i < llx; i++)
@@ -152,6 +167,7 @@ free_and_return:
   Free2D(ni, llx);
   Free2D(nj, lly);
   Free3D(n, llx, lly);
+  Free1D(strata);
 
   if (scale)
     res *= 2 * ncomplete;
@@ -162,7 +178,7 @@ free_and_return:
 
 /* compute the shrinkage intensity lambda for the mutual information. */
 void mi_lambda(double *n, double *lambda, double target, int num, int llx,
-    int lly, int llz) {
+    int lly, int llz, double nempty) {
 
 double lden = 0, lnum = 0, temp = 0;
 
@@ -196,6 +212,10 @@ double lden = 0, lnum = 0, temp = 0;
 
   }/*ELSE*/
 
+  /* cells that are not stored because they are known to be empty only
+   * contribute to the denominator. */
+  lden += nempty * target * target;
+
    /* compute the shrinkage intensity (avoiding "divide by zero" errors). */
   if (lden == 0)
     *lambda = 1;
@@ -6,6 +6,7 @@
 #include "../../minimal/strings.h"
 #include "../../minimal/common.h"
 #include "../../include/globals.h"
+#include "../../core/bitmaps.h"
 #include "../../core/covariance.matrix.h"
 #include "../../core/correlation.h"
 #include "../../core/data.table.h"
@@ -80,7 +81,7 @@ ddata sub = { 0 };
       /* prepare the current subset. */
       ddata_subset_columns(&dtz, &sub, subset, cursize + nf);
       /* construct the parents' configurations. */
-      c_fast_config(sub.col, sub.m.nobs, cursize + nf, sub.nlvl, zptr, &llz, 1);
+      c_test_config(sub.col, sub.m.nobs, cursize + nf, sub.nlvl, zptr, &llz, 1);
 
       if (test == MI || test == MI_ADF || test == X2 || test == X2_ADF) {
 
@@ -293,10 +294,12 @@ SEXP ast_gaustests_with_missing(gdata dt, int nf, int minsize, int maxsize,
     double a, bool debugging, test_e test) {
 
 int i = 0, cursize = 0, *subset = NULL, ncomplete = 0;
+int nwords = BITMAP_NWORDS(dt.m.nobs);
 double statistic = 0, lambda = 0, df = 0;
 double pvalue = 0, min_pvalue = 1, max_pvalue = 0;
 double *mean = NULL;
-bool *missing_xy = NULL, *missing_all = NULL;
+bool *missing_all = NULL;
+uint64_t *mask_xy = NULL, *mask = NULL;
 SEXP retval;
 gdata sub = { 0 };
 covariance cov = { 0 };
@@ -304,16 +307,19 @@ covariance cov = { 0 };
   /* allocate a second data table to hold the conditioning variables. */
   sub = empty_gdata(dt.m.nobs, dt.m.ncols);
   sub.mean = Calloc1D(dt.m.ncols, sizeof(double));
-  /* allocate the missingness indicators. */
-  missing_xy = Calloc1D(dt.m.nobs, sizeof(bool));
-  gdata_incomplete_cases_range(&dt, missing_xy, 0, 1);
+  sub.valid = Calloc1D(dt.m.ncols, sizeof(uint64_t *));
+  /* intersect the validity bitmaps of the two variables. */
+  mask_xy = new_bitmap(dt.m.nobs);
+  mask = new_bitmap(dt.m.nobs);
+  bitmap_and(dt.valid[0], dt.valid[1], mask_xy, nwords);
 
   for (cursize = imax(1, minsize); cursize <= maxsize; cursize++) {
 
     /* allocate a vector to store column means (from complete observations). */
     mean = Calloc1D(cursize + nf + 2, sizeof(double));
-    /* allocate missingness indicators. */
-    missing_all = Calloc1D(sub.m.nobs, sizeof(bool));
+    /* allocate missingness indicators, only used for shrinkage. */
+    if (test == MI_G_SH)
+      missing_all = Calloc1D(sub.m.nobs, sizeof(bool));
     /* allocate and initialize the subset indexes array. */
     subset = Calloc1D(cursize + nf + 2, sizeof(int));
     /* allocate the covariance matrix and the U, D, V matrix. */
@@ -327,9 +333,12 @@ covariance cov = { 0 };
 
       /* prepare the current subset. */
       gdata_subset_columns(&dt, &sub, subset, cursize + nf + 2);
-      /* compute the covariance matrix. */
-      c_covmat_with_missing(sub.col, sub.m.nobs, sub.m.ncols, missing_xy,
-        missing_all, mean, cov.mat, &ncomplete);
+      /* find the complete observations and compute the covariance matrix. */
+      memcpy(mask, mask_xy, nwords * sizeof(uint64_t));
+      for (i = 2, ncomplete = bitmap_count(mask, nwords); i < sub.m.ncols; i++)
+        ncomplete = bitmap_and(mask, sub.valid[i], mask, nwords);
+      c_covmat_with_mask(sub.col, sub.m.nobs, sub.m.ncols, mask, ncomplete,
+        mean, cov.mat);
 
       /* compute the degrees of freedom for correlation and mutual information. */
       df = gaussian_cdf(test, ncomplete, cursize + nf);
@@ -355,7 +364,8 @@ covariance cov = { 0 };
                            a, dt.m.names + 2, cursize + nf));
 
         FreeGDT(sub);
-        Free1D(missing_xy);
+        Free1D(mask_xy);
+        Free1D(mask);
         Free1D(missing_all);
         Free1D(subset);
         Free1D(mean);
@@ -384,6 +394,7 @@ covariance cov = { 0 };
       }/*THEN*/
       else if (test == MI_G_SH) {
 
+        bitmap_to_missing(mask, sub.m.nobs, missing_all);
         lambda = covmat_lambda(sub.col, mean, cov, sub.m.nobs, missing_all,
                    ncomplete);
         covmat_shrink(cov, lambda);
@@ -425,7 +436,8 @@ covariance cov = { 0 };
         FreeCOV(cov);
         FreeGDT(sub);
         Free1D(mean);
-        Free1D(missing_xy);
+        Free1D(mask_xy);
+        Free1D(mask);
         Free1D(missing_all);
 
         UNPROTECT(1);
@@ -442,7 +454,8 @@ covariance cov = { 0 };
 
   }/*FOR*/
 
-  Free1D(missing_xy);
+  Free1D(mask_xy);
+  Free1D(mask);
   FreeGDT(sub);
 
   return ast_prepare_retval(pvalue, min_pvalue, max_pvalue, a, NULL, 0);
@@ -820,7 +833,7 @@ ddata sub = { 0 };
       /* prepare the current subset. */
       ddata_subset_columns(&dtz, &sub, subset, cursize + nf);
       /* construct the parents' configurations. */
-      c_fast_config(sub.col, sub.m.nobs, cursize + nf, sub.nlvl, zptr, &llz, 1);
+      c_test_config(sub.col, sub.m.nobs, cursize + nf, sub.nlvl, zptr, &llz, 1);
 
       c_cmcarlo(xptr, llx, yptr, lly, zptr, llz, sub.m.nobs, nperms, &statistic,
         &pvalue, threshold, type, &df);
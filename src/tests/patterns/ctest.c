@@ -4,6 +4,7 @@
 #include "../../minimal/data.frame.h"
 #include "../tests.h"
 #include "../../core/moments.h"
+#include "../../core/bitmaps.h"
 #include "../../core/covariance.matrix.h"
 #include "../../core/correlation.h"
 #include "../../include/globals.h"
@@ -19,7 +20,7 @@ int *xptr = NULL, *yptr = dty.col[0], *zptr = NULL;
 double statistic = 0;
 
   zptr = Calloc1D(dtz.m.nobs, sizeof(int));
-  c_fast_config(dtz.col, dtz.m.nobs, dtz.m.ncols, dtz.nlvl, zptr, &llz, 1);
+  c_test_config(dtz.col, dtz.m.nobs, dtz.m.ncols, dtz.nlvl, zptr, &llz, 1);
 
   for (i = 0; i < dtx.m.ncols; i++) {
 
@@ -147,30 +148,65 @@ covariance cov = { 0 }, basecov = { 0 };
 double ct_gaustests_with_missing(gdata dtx, gdata dt, double *pvalue,
     double *df, test_e test) {
 
-int i = 0, ncomplete = 0;
-double transform = 0, *mean = NULL, statistic = 0, lambda = 0;
-bool *missing_yz = NULL, *missing_all = NULL;
-covariance cov = { 0 };
+int i = 0, j = 0, ncomplete = 0, nc_yz = 0, nwords = BITMAP_NWORDS(dt.m.nobs);
+double transform = 0, *mean = NULL, *basemean = NULL, statistic = 0, lambda = 0;
+bool *missing_all = NULL, cached = FALSE;
+uint64_t *mask_yz = NULL, *mask = NULL;
+covariance cov = { 0 }, basecov = { 0 };
 
-  /* allocate the mean vector. */
+  /* allocate the mean vectors. */
   mean = Calloc1D(dt.m.ncols, sizeof(double));
-  /* allocate the covariance matrix. */
+  basemean = Calloc1D(dt.m.ncols, sizeof(double));
+  /* allocate the covariance matrices. */
   cov = new_covariance(dt.m.ncols, TRUE);
+  basecov = new_covariance(dt.m.ncols, FALSE);
 
-  /* allocate and initialize the missing values indicators. */
-  missing_yz = Calloc1D(dt.m.nobs, sizeof(bool));
-  missing_all = Calloc1D(dt.m.nobs, sizeof(bool));
+  /* allocate the missing values indicators, only used for shrinkage. */
+  if (test == MI_G_SH)
+    missing_all = Calloc1D(dt.m.nobs, sizeof(bool));
 
-  gdata_incomplete_cases(&dt, missing_yz, 1);
+  /* intersect the validity bitmaps of y and of the conditioning variables. */
+  mask_yz = new_bitmap(dt.m.nobs);
+  mask = new_bitmap(dt.m.nobs);
+  bitmap_fill(mask_yz, dt.m.nobs);
+  for (j = 1; j < dt.m.ncols; j++)
+    nc_yz = bitmap_and(mask_yz, dt.valid[j], mask_yz, nwords);
 
   /* compute the partial correlation and the test statistic. */
   for (i = 0; i < dtx.m.ncols; i++) {
 
     /* extract and plug in the i-th variable. */
     dt.col[0] = dtx.col[i];
-    /* compute the covariance matrix. */
-    c_covmat_with_missing(dt.col, dt.m.nobs, dt.m.ncols, missing_yz,
-      missing_all, mean, cov.mat, &ncomplete);
+    /* find the complete observations. */
+    ncomplete = bitmap_and(mask_yz, dtx.valid[i], mask, nwords);
+
+    /* compute the covariance matrix: when the i-th variable is observed
+     * whenever y and the conditioning variables are, the complete observations
+     * are the same for all such variables and only its own row and column in
+     * the covariance matrix must be computed. */
+    if (ncomplete != nc_yz) {
+
+      c_covmat_with_mask(dt.col, dt.m.nobs, dt.m.ncols, mask, ncomplete,
+        mean, cov.mat);
+
+    }/*THEN*/
+    else if (!cached) {
+
+      c_covmat_with_mask(dt.col, dt.m.nobs, dt.m.ncols, mask, ncomplete,
+        basemean, basecov.mat);
+      memcpy(mean, basemean, dt.m.ncols * sizeof(double));
+      copy_covariance(&basecov, &cov);
+      cached = TRUE;
+
+    }/*THEN*/
+    else {
+
+      memcpy(mean, basemean, dt.m.ncols * sizeof(double));
+      copy_covariance(&basecov, &cov);
+      c_update_covmat_with_mask(dt.col, dt.m.nobs, dt.m.ncols, mask,
+        ncomplete, 0, mean, cov.mat);
+
+    }/*ELSE*/
 
     /* compute the degrees of freedom for correlation and mutual information. */
     *df = gaussian_cdf(test, ncomplete, dt.m.ncols - 2);
@@ -204,6 +240,7 @@ covariance cov = { 0 };
     }/*THEN*/
     else if (test == MI_G_SH) {
 
+      bitmap_to_missing(mask, dt.m.nobs, missing_all);
       lambda = covmat_lambda(dt.col, mean, cov, dt.m.nobs, missing_all,
                  ncomplete);
       covmat_shrink(cov, lambda);
@@ -223,9 +260,12 @@ covariance cov = { 0 };
   }/*FOR*/
 
   Free1D(mean);
-  Free1D(missing_yz);
+  Free1D(basemean);
   Free1D(missing_all);
+  Free1D(mask_yz);
+  Free1D(mask);
   FreeCOV(cov);
+  FreeCOV(basecov);
 
   return statistic;
 
@@ -418,7 +458,7 @@ int i = 0, *zptr = NULL, llz = 0;
 double statistic = 0;
 
   zptr = Calloc1D(dtz.m.nobs, sizeof(int));
-  c_fast_config(dtz.col, dtz.m.nobs, dtz.m.ncols, dtz.nlvl, zptr, &llz, 1);
+  c_test_config(dtz.col, dtz.m.nobs, dtz.m.ncols, dtz.nlvl, zptr, &llz, 1);
 
   for (i = 0; i < dtx.m.ncols; i++) {
 
@@ -38,11 +38,17 @@ int i = 0, cur = 0, valid = dtz.m.ncols, lly = 0, llz = 0;
 int *yptr = NULL, *zptr = NULL;
 double statistic = 0, df = 0;
 ddata sub = { 0 };
+rconfig rc = { 0 };
 
-  /* allocate a second data table to hold the conditioning variables. */
-  sub = empty_ddata(dtz.m.nobs, dtz.m.ncols);
+  /* allocate a second data table to hold the conditioning variables, which
+   * is only needed to print debugging messages. */
+  if (debugging)
+    sub = empty_ddata(dtz.m.nobs, dtz.m.ncols);
   /* allocate the parents' configurations. */
   zptr = Calloc1D(dtz.m.nobs, sizeof(int));
+  /* compute the configurations of the whole conditioning set once, removing
+   * variables from it as they are found to be independent. */
+  rc = new_rconfig(dtz.col, dtz.m.nobs, dtz.m.ncols, dtz.nlvl);
 
   for (i = 0; i < dtz.m.ncols; i++) {
 
@@ -56,17 +62,15 @@ ddata sub = { 0 };
     /* extract the variable to test. */
     yptr = dtz.col[i];
     lly = dtz.nlvl[i];
-    /* drop the variable to test from the conditioning set. */
-    dtz.m.flag[i].drop = TRUE;
-    ddata_drop_flagged(&dtz, &sub);
-    /* construct the configurations of the conditioning variables. */
-    c_fast_config(sub.col, sub.m.nobs, sub.m.ncols, sub.nlvl, zptr, &llz, 1);
+    /* construct the configurations of the conditioning variables, dropping
+     * the variable to test. */
+    rconfig_without(rc, i, zptr, &llz, 1);
 
     if (test == MI || test == MI_ADF || test == X2 || test == X2_ADF) {
 
       /* mutual information and Pearson's X^2 asymptotic tests. */
       statistic = c_cchisqtest(dtx.col[0], dtx.nlvl[0], yptr, lly, zptr, llz,
-                    sub.m.nobs, &df, test, (test == MI) || (test == MI_ADF));
+                    dtz.m.nobs, &df, test, (test == MI) || (test == MI_ADF));
       pvalue[cur] = pchisq(statistic, df, FALSE, FALSE);
 
     }/*THEN*/
@@ -74,7 +78,7 @@ ddata sub = { 0 };
 
       /* shrinkage mutual information test. */
       statistic = c_shcmi(dtx.col[0], dtx.nlvl[0], yptr, lly, zptr, llz,
-                    sub.m.nobs, &df, TRUE);
+                    dtz.m.nobs, &df, TRUE);
       pvalue[cur] = pchisq(statistic, df, FALSE, FALSE);
 
     }/*THEN*/
@@ -82,36 +86,61 @@ ddata sub = { 0 };
 
       /* Jonckheere-Terpstra test. */
       statistic = c_cjt(dtx.col[0], dtx.nlvl[0], yptr, lly, zptr, llz,
-                    sub.m.nobs);
+                    dtz.m.nobs);
       pvalue[cur] = 2 * pnorm(fabs(statistic), 0, 1, FALSE, FALSE);
 
     }/*THEN*/
 
-    if (debugging)
+    if (debugging) {
+
+      dtz.m.flag[i].drop = TRUE;
+      ddata_drop_flagged(&dtz, &sub);
+      dtz.m.flag[i].drop = FALSE;
       rrd_disc_message(sub.m, dtx.m.names[0], 0, dtz.m.names[i], pvalue[cur],
         alpha);
 
-    /* do not drop the variable if the tests is significant. */
-    if (pvalue[cur++] > alpha)
+    }/*THEN*/
+
+    /* drop the variable if the tests is not significant. */
+    if (pvalue[cur++] > alpha) {
+
       valid--;
-    else
-      dtz.m.flag[i].drop = FALSE;
+      dtz.m.flag[i].drop = TRUE;
+      rconfig_drop(&rc, i);
+
+    }/*THEN*/
 
   }/*FOR*/
 
   Free1D(zptr);
-  FreeDDT(sub);
+  FreeRCONFIG(rc);
+  if (debugging)
+    FreeDDT(sub);
 
 }/*RRD_DISCRETE*/
 
+/* partial correlation between the target and the t-th variable given all the
+ * others: from the inverse of the covariance matrix when it is kept up to
+ * date, from the SVD decomposition of the covariance matrix otherwise. */
+static double rrd_pcor(covariance cov, covariance prec, int t, bool use_prec,
+    bool run_svd) {
+
+  if (use_prec)
+    return c_fast_pcor_precision(prec, 0, t);
+  else
+    return c_fast_pcor(cov, 0, t, NULL, run_svd);
+
+}/*RRD_PCOR*/
+
 /* parametric tests for gaussian variables (and complete data). */
 void rrd_gaustests_complete(gdata dt, test_e test, double *pvalue, double
     alpha, bool debugging) {
 
 int i = 1, cur = 0, valid = dt.m.ncols - 1, t = 0, run_svd = TRUE;
 double statistic = 0, lambda = 0, df = 0;
+bool use_prec = FALSE;
 gdata sub = { 0 };
-covariance cov = { 0 }, backup = { 0 };
+covariance cov = { 0 }, backup = { 0 }, prec = { 0 };
 
   /* allocate a second data table to hold the conditioning variables. */
   sub = empty_gdata(dt.m.nobs, dt.m.ncols);
@@ -123,6 +152,17 @@ covariance cov = { 0 }, backup = { 0 };
   backup = new_covariance(dt.m.ncols, TRUE);
   c_covmat(dt.col, dt.mean, dt.m.nobs, dt.m.ncols, cov, 0);
 
+  /* if the covariance matrix is full-rank, invert it once and downdate the
+   * inverse as variables are dropped instead of recomputing the SVD after each
+   * drop. The shrinkage test changes the covariance matrix at every step, so
+   * it cannot benefit from this. */
+  if (test != MI_G_SH) {
+
+    prec = new_covariance(dt.m.ncols, TRUE);
+    use_prec = c_fullrank_inverse(cov, prec);
+
+  }/*THEN*/
+
   /* the counter starts at 1 because the first column is the target variable,
    * swapping it does not make sense and would just add a duplicate, redundant
    * test. */
@@ -157,18 +197,19 @@ covariance cov = { 0 }, backup = { 0 };
     }/*THEN*/
 
     /* backup a copy of the covariance matrix before messing with it. */
-    copy_covariance(&cov, &backup);
+    if (!use_prec)
+      copy_covariance(&cov, &backup);
 
     if (test == COR) {
 
-      statistic = c_fast_pcor(cov, 0, t, NULL, run_svd);
+      statistic = rrd_pcor(cov, prec, t, use_prec, run_svd);
       statistic = cor_t_trans(statistic, df);
       pvalue[cur] = 2 * pt(fabs(statistic), df, FALSE, FALSE);
 
     }/*THEN*/
     else if (test == MI_G) {
 
-      statistic = c_fast_pcor(cov, 0, t, NULL, run_svd);
+      statistic = rrd_pcor(cov, prec, t, use_prec, run_svd);
       statistic = 2 * sub.m.nobs * cor_mi_trans(statistic);
       pvalue[cur] = pchisq(statistic, df, FALSE, FALSE);
 
@@ -185,7 +226,7 @@ covariance cov = { 0 }, backup = { 0 };
     }/*THEN*/
     else if (test == ZF) {
 
-      statistic = c_fast_pcor(cov, 0, t, NULL, run_svd);
+      statistic = rrd_pcor(cov, prec, t, use_prec, run_svd);
       statistic = cor_zf_trans(statistic, df);
       pvalue[cur] = 2 * pnorm(fabs(statistic), 0, 1, FALSE, FALSE);
 
@@ -195,7 +236,8 @@ covariance cov = { 0 }, backup = { 0 };
       rrd_gauss_message(sub, t, pvalue[cur], alpha);
 
     /* restore the covariance matrix before subsetting it. */
-    copy_covariance(&backup, &cov);
+    if (!use_prec)
+      copy_covariance(&backup, &cov);
 
     /* remove ifrom the covariance matrix and make sure to recompute SVD. */
     if (pvalue[cur++] > alpha) {
@@ -205,6 +247,10 @@ covariance cov = { 0 }, backup = { 0 };
       covariance_drop_variable(&cov, &cov, t);
       run_svd = TRUE;
 
+      /* fall back to the SVD if the downdate is numerically unsafe. */
+      if (use_prec)
+        use_prec = precision_drop_variable(&prec, &prec, t);
+
     }/*THEN*/
     else {
 
@@ -217,6 +263,7 @@ covariance cov = { 0 }, backup = { 0 };
   FreeGDT(sub);
   FreeCOV(backup);
   FreeCOV(cov);
+  FreeCOV(prec);
 
 }/*RRD_GAUSTESTS_COMPLETE*/
 
@@ -224,12 +271,12 @@ covariance cov = { 0 }, backup = { 0 };
 void rrd_gaustests_with_missing(gdata dt, test_e test, double *pvalue,
     double alpha, bool debugging) {
 
-int i = 1, cur = 0, valid = dt.m.ncols - 1, t = 0, run_svd = TRUE;
-int ncomplete = 0;
+int i = 1, k = 0, cur = 0, valid = dt.m.ncols - 1, t = 0, run_svd = TRUE;
+int ncomplete = 0, nadded = 0, *nmissing = NULL;
 double statistic = 0, lambda = 0, *mean = NULL, df = 0;
-bool *missing = NULL;
+bool *missing = NULL, use_prec = FALSE;
 gdata sub = { 0 };
-covariance cov = { 0 }, backup = { 0 };
+covariance cov = { 0 }, backup = { 0 }, prec = { 0 };
 
   /* allocate a second data table to hold the conditioning variables. */
   sub = empty_gdata(dt.m.nobs, dt.m.ncols);
@@ -244,6 +291,20 @@ covariance cov = { 0 }, backup = { 0 };
   c_covmat_with_missing(dt.col, dt.m.nobs, dt.m.ncols, NULL, missing, mean,
     cov.mat, &ncomplete);
 
+  /* count the missing values in each observation, to find out which ones
+   * become complete when a variable is dropped. */
+  nmissing = Calloc1D(dt.m.nobs, sizeof(int));
+  for (i = 0; i < dt.m.ncols; i++)
+    for (k = 0; k < dt.m.nobs; k++)
+      nmissing[k] += ISNAN(dt.col[i][k]);
+
+  if ((test != MI_G_SH) && (ncomplete > 1)) {
+
+    prec = new_covariance(dt.m.ncols, TRUE);
+    use_prec = c_fullrank_inverse(cov, prec);
+
+  }/*THEN*/
+
   /* the counter starts at 1 because the first column is the target variable,
    * swapping it does not make sense and would just add a duplicate, redundant
    * test. */
@@ -278,18 +339,19 @@ covariance cov = { 0 }, backup = { 0 };
     }/*THEN*/
 
     /* backup a copy of the covariance matrix before messing with it. */
-    copy_covariance(&cov, &backup);
+    if (!use_prec)
+      copy_covariance(&cov, &backup);
 
     if (test == COR) {
 
-      statistic = c_fast_pcor(cov, 0, t, NULL, run_svd);
+      statistic = rrd_pcor(cov, prec, t, use_prec, run_svd);
       statistic = cor_t_trans(statistic, df);
       pvalue[cur] = 2 * pt(fabs(statistic), df, FALSE, FALSE);
 
     }/*THEN*/
     else if (test == MI_G) {
 
-      statistic = c_fast_pcor(cov, 0, t, NULL, run_svd);
+      statistic = rrd_pcor(cov, prec, t, use_prec, run_svd);
       statistic = 2 * ncomplete * cor_mi_trans(statistic);
       pvalue[cur] = pchisq(statistic, df, FALSE, FALSE);
 
@@ -305,7 +367,7 @@ covariance cov = { 0 }, backup = { 0 };
     }/*THEN*/
     else if (test == ZF) {
 
-      statistic = c_fast_pcor(cov, 0, t, NULL, run_svd);
+      statistic = rrd_pcor(cov, prec, t, use_prec, run_svd);
       statistic = cor_zf_trans(statistic, df);
       pvalue[cur] = 2 * pnorm(fabs(statistic), 0, 1, FALSE, FALSE);
 
@@ -315,16 +377,64 @@ covariance cov = { 0 }, backup = { 0 };
       rrd_gauss_message(sub, t, pvalue[cur], alpha);
 
     /* restore the covariance matrix before subsetting it. */
-    copy_covariance(&backup, &cov);
+    if (!use_prec)
+      copy_covariance(&backup, &cov);
 
     /* remove ifrom the covariance matrix and make sure to recompute SVD. */
     if (pvalue[cur++] > alpha) {
 
       valid--;
       dt.m.flag[i].drop = TRUE;
+      covariance_drop_variable(&cov, &cov, t);
+      for (k = t; k < sub.m.ncols - 1; k++)
+        mean[k] = mean[k + 1];
+
       gdata_drop_flagged(&dt, &sub);
-      c_covmat_with_missing(sub.col, sub.m.nobs, sub.m.ncols, NULL, missing,
-        mean, cov.mat, &ncomplete);
+
+      if (ncomplete > 1) {
+
+        /* observations that were incomplete only because of the dropped
+         * variable are added to the covariance matrix with rank-one updates,
+         * instead of recomputing it from all the complete observations. */
+        for (k = 0, nadded = 0; k < dt.m.nobs; k++) {
+
+          if (!ISNAN(dt.col[i][k]))
+            continue;
+
+          if (--nmissing[k] == 0) {
+
+            c_covmat_add_observation(sub.col, k, sub.m.ncols, mean, cov.mat,
+              &ncomplete);
+            missing[k] = FALSE;
+            nadded++;
+
+          }/*THEN*/
+
+        }/*FOR*/
+
+      }/*THEN*/
+      else {
+
+        for (k = 0, nadded = 1; k < dt.m.nobs; k++)
+          nmissing[k] -= ISNAN(dt.col[i][k]);
+
+        c_covmat_with_missing(sub.col, sub.m.nobs, sub.m.ncols, NULL, missing,
+          mean, cov.mat, &ncomplete);
+
+      }/*ELSE*/
+
+      /* the inverse can be downdated only if the set of complete observations
+       * has not changed, otherwise it must be recomputed. */
+      if (use_prec && (nadded == 0))
+        use_prec = precision_drop_variable(&prec, &prec, t);
+      else if (prec.mat && (ncomplete > 1)) {
+
+        prec.dim = cov.dim;
+        use_prec = c_fullrank_inverse(cov, prec);
+
+      }/*THEN*/
+      else
+        use_prec = FALSE;
 
       run_svd = TRUE;
 
@@ -340,7 +450,9 @@ covariance cov = { 0 }, backup = { 0 };
   FreeGDT(sub);
   FreeCOV(backup);
   FreeCOV(cov);
+  FreeCOV(prec);
   Free1D(missing);
+  Free1D(nmissing);
   Free1D(mean);
 
 }/*RRD_GAUSTESTS_WITH_MISSING*/
@@ -421,11 +533,16 @@ int cur = 0, valid = dtz.m.ncols - 2, llz = 0;
 int *configurations = NULL, *zptr = NULL;
 double statistic = 0, df = 0;
 cgdata sub = { 0 }, dty = { 0 };
+rconfig rc = { 0 };
 
   /* allocate a second data table to hold the conditioning variables. */
   sub = empty_cgdata(dtz.m.nobs, dtz.ndcols, dtz.ngcols);
   configurations = Calloc1D(dtz.m.nobs, sizeof(int));
   dty = empty_cgdata(dtz.m.nobs, 1, 1);
+  /* compute the configurations of the discrete conditioning variables once
+   * (the first discrete column is a placeholder). */
+  if (dtz.ndcols > 1)
+    rc = new_rconfig(dtz.dcol + 1, dtz.m.nobs, dtz.ndcols - 1, dtz.nlvl + 1);
 
   for (i = 2; i < dtz.m.ncols; i++) {
 
@@ -444,12 +561,15 @@ cgdata sub = { 0 }, dty = { 0 };
     cgdata_subset_columns(&dtz, &dty, &i, 1);
 
     /* if there are discrete conditioning variables, compute their
-     * configurations. */
+     * configurations (they only change if the variable to test is discrete). */
     if (sub.ndcols  > 1) {
 
       zptr = configurations;
-      c_fast_config(sub.dcol + 1, sub.m.nobs, sub.ndcols - 1, sub.nlvl + 1,
-        zptr, &llz, 1);
+
+      if (dtz.m.flag[i].discrete)
+        rconfig_without(rc, dtz.map[i] - 1, zptr, &llz, 1);
+      else
+        rconfig_current(rc, zptr, &llz, 1);
 
     }/*THEN*/
     else {
@@ -468,14 +588,23 @@ cgdata sub = { 0 }, dty = { 0 };
         alpha);
 
     /* do not drop the variable if the tests is significant. */
-    if (pvalue[cur++] > alpha)
+    if (pvalue[cur++] > alpha) {
+
       valid--;
-    else
+      if (dtz.m.flag[i].discrete)
+        rconfig_drop(&rc, dtz.map[i] - 1);
+
+    }/*THEN*/
+    else {
+
       dtz.m.flag[i].drop = FALSE;
 
+    }/*ELSE*/
+
   }/*FOR*/
 
   Free1D(configurations);
+  FreeRCONFIG(rc);
   FreeCGDT(sub);
   FreeCGDT(dty);
 
@@ -644,11 +773,16 @@ int i = 0, cur = 0, valid = dtz.m.ncols, lly = 0, llz = 0;
 int *yptr = NULL, *zptr = NULL;
 double statistic = 0, df = 0;
 ddata sub = { 0 };
+rconfig rc = { 0 };
 
-  /* allocate a second data table to hold the conditioning variables. */
-  sub = empty_ddata(dtz.m.nobs, dtz.m.ncols);
+  /* allocate a second data table to hold the conditioning variables, which
+   * is only needed to print debugging messages. */
+  if (debugging)
+    sub = empty_ddata(dtz.m.nobs, dtz.m.ncols);
   /* allocate the parents' configurations. */
   zptr = Calloc1D(dtz.m.nobs, sizeof(int));
+  /* compute the configurations of the whole conditioning set once. */
+  rc = new_rconfig(dtz.col, dtz.m.nobs, dtz.m.ncols, dtz.nlvl);
 
   for (i = 0; i < dtz.m.ncols; i++) {
 
@@ -662,29 +796,38 @@ ddata sub = { 0 };
     /* extract the variable to test. */
     yptr = dtz.col[i];
     lly = dtz.nlvl[i];
-    /* drop the variable to test from the conditioning set. */
-    dtz.m.flag[i].drop = TRUE;
-    ddata_drop_flagged(&dtz, &sub);
-    /* construct the configurations of the conditioning variables. */
-    c_fast_config(sub.col, sub.m.nobs, sub.m.ncols, sub.nlvl, zptr, &llz, 1);
+    /* construct the configurations of the conditioning variables, dropping
+     * the variable to test. */
+    rconfig_without(rc, i, zptr, &llz, 1);
 
-    c_cmcarlo(dtx.col[0], dtx.nlvl[0], yptr, lly, zptr, llz, sub.m.nobs, nperms,
+    c_cmcarlo(dtx.col[0], dtx.nlvl[0], yptr, lly, zptr, llz, dtz.m.nobs, nperms,
       &statistic, pvalue + cur, threshold, test, &df);
 
-    if (debugging)
+    if (debugging) {
+
+      dtz.m.flag[i].drop = TRUE;
+      ddata_drop_flagged(&dtz, &sub);
+      dtz.m.flag[i].drop = FALSE;
       rrd_disc_message(sub.m, dtx.m.names[0], 0, dtz.m.names[i], pvalue[cur],
         alpha);
 
-    /* do not drop the variable if the tests is significant. */
-    if (pvalue[cur++] > alpha)
+    }/*THEN*/
+
+    /* drop the variable if the tests is not significant. */
+    if (pvalue[cur++] > alpha) {
+
       valid--;
-    else
-      dtz.m.flag[i].drop = FALSE;
+      dtz.m.flag[i].drop = TRUE;
+      rconfig_drop(&rc, i);
+
+    }/*THEN*/
 
   }/*FOR*/
 
   Free1D(zptr);
-  FreeDDT(sub);
+  FreeRCONFIG(rc);
+  if (debugging)
+    FreeDDT(sub);
 
 }/*RRD_DPERM*/
 
@@ -172,9 +172,10 @@ counts3d joint = { 0 };
   allocfact(num);
   /* allocate and initialize the workspace for rcont2. */
   workspace = Calloc1D(nc, sizeof(int));
-  /* initialize the contingency table and the marginal frequencies. */
-  joint = new_3d_table(nr, nc, nl);
-  fill_3d_table(xx, yy, zz, &joint, num);
+  /* initialize the contingency table and the marginal frequencies, storing
+   * only the observed strata if most are empty (empty strata do not consume
+   * random numbers in rcounts3d(), so the permutations are unchanged). */
+  joint = new_filled_3d_table(xx, nr, yy, nc, zz, nl, num);
 
   /* if at least one of the two variables is constant, or if there are no
    * complete observations, the variables are taken to be independent. */
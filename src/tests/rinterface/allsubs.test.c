@@ -111,6 +111,7 @@ SEXP xx, yy, zz, cc, res = R_NilValue;
     }/*THEN*/
     else {
 
+      gdata_cache_validity(&dt, 0);
       res = ast_gaustests_with_missing(dt, nf, minsize, maxsize, a, debugging,
               test_type);
 
@@ -59,6 +59,8 @@ SEXP xx2, yy2, zz, cc, result;
     }/*THEN*/
     else {
 
+      gdata_cache_validity(&dtx, 0);
+      gdata_cache_validity(&dt, 1);
       statistic = ct_gaustests_with_missing(dtx, dt, pvalue, &df, test_type);
 
     }/*ELSE*/
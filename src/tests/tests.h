@@ -108,7 +108,7 @@ double cjt_var_kernel(counts3d table);
 
 /* from shrinkage.c */
 void mi_lambda(double *n, double *lambda, double target, int num, int llx,
-    int lly, int llz);
+    int lly, int llz, double nempty);
 double cor_lambda(double *xx, double *yy, int nobs, int ncomplete,
    double xm, double ym, double xsd, double ysd, double cor);
 double c_shmi(int *xx, int llx, int *yy, int lly, int num, int scale);